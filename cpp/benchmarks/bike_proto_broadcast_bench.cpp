@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/broadcast_command_builder.h"
+
+namespace {
+
+using DataType = iot::backend::proto::ProtocolConverter::TransportDataType;
+
+iot::backend::proto::CommandPayload MakePayload()
+{
+    iot::backend::proto::CommandPayload payload;
+    auto& params = *payload.mutable_set_params()->mutable_params();
+    params["vehicle_lock"] = "locked";
+    params["speed_limit"] = "25";
+    params["iot_light_color"] = "white";
+    return payload;
+}
+
+const std::string kChainId = "856ccfc0-8c02-4f6b-a6f6-376b4871f246";
+
+}  // namespace
+
+static void BM_Broadcast_Regular(benchmark::State& state)
+{
+    const auto type = static_cast<DataType>(state.range(0));
+    const iot::backend::proto::ProtocolConverter converter(type);
+    const auto payload = MakePayload();
+
+    for (auto _ : state) {
+        auto packet = iot::backend::proto::helpers::MakeCommand(std::chrono::seconds(300), kChainId);
+        *packet.mutable_command()->mutable_payload() = payload;
+        benchmark::DoNotOptimize(converter.Serialize(packet));
+    }
+}
+BENCHMARK(BM_Broadcast_Regular)->Arg(static_cast<int>(DataType::JSON))->Arg(static_cast<int>(DataType::BINARY));
+
+static void BM_Broadcast_Template(benchmark::State& state)
+{
+    const auto type = static_cast<DataType>(state.range(0));
+    const iot::backend::proto::BroadcastCommandBuilder builder(type, MakePayload(), std::chrono::seconds(300));
+    const auto timestamp = iot::backend::proto::helpers::GetCurrentUtcTimestamp();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(builder.Build(kChainId, timestamp));
+    }
+}
+BENCHMARK(BM_Broadcast_Template)->Arg(static_cast<int>(DataType::JSON))->Arg(static_cast<int>(DataType::BINARY));
+
+static void BM_Broadcast_Fleet(benchmark::State& state)
+{
+    const iot::backend::proto::BroadcastCommandBuilder builder(DataType::JSON, MakePayload(), std::chrono::seconds(300));
+    const std::vector<std::string> devices(50000, "bike");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(builder.BuildForFleet(devices, state.range(0)));
+    }
+    state.SetItemsProcessed(state.iterations() * devices.size());
+}
+BENCHMARK(BM_Broadcast_Fleet)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,102 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/command_wal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Durability vs throughput of logging outbound CmdSetState commands:
+// CommandWal with group commit for <threads> concurrent writers, the same
+// log without fdatasync, and a naive log that syncs every record.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+std::string GetDirectory(const char *name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+Packet MakeSetState(uint64_t i)
+{
+    Packet packet;
+    packet.set_version(0x00010000);
+    packet.set_timestamp(1700000000);
+    packet.set_valid_until(1700000300);
+    packet.mutable_command()->set_chain_id("0190f5c2-7a4b-7cde-8f01-" + std::to_string(100000000000ULL + i));
+    packet.mutable_command()->mutable_payload()->mutable_set_state()->set_state(i % 2 == 0 ? "locked" : "unlocked");
+    return packet;
+}
+
+/// WAL shared by the threads of one benchmark run
+std::unique_ptr<CommandWal> wal;
+
+void RunWal(benchmark::State& state, bool sync)
+{
+    if (state.thread_index() == 0) {
+        CommandWalOptions options;
+        options.directory = GetDirectory("bike_proto_wal_bench");
+        options.sync = sync;
+        std::filesystem::remove_all(options.directory);
+        wal = std::make_unique<CommandWal>(options);
+    }
+    const std::string device_id = std::to_string(860000000000000ULL + state.thread_index());
+    uint64_t          i = static_cast<uint64_t>(state.thread_index()) << 32;
+    for (auto _ : state) {
+        const Packet packet = MakeSetState(i++);
+        wal->Append(device_id, packet);
+        // The result comes right away, so the log does not grow
+        wal->Acknowledge(packet.command().chain_id());
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        if (const uint64_t syncs = wal->GetSyncCount(); syncs != 0)
+            state.counters["records_per_sync"] = static_cast<double>(state.iterations() * state.threads()) / syncs;
+        wal.reset();
+    }
+}
+
+}  // namespace
+
+// Group commit: every Append is durable, concurrent appends share fdatasync
+static void BM_CommandWal_GroupCommit(benchmark::State& state)
+{
+    RunWal(state, true);
+}
+BENCHMARK(BM_CommandWal_GroupCommit)->ThreadRange(1, 16)->UseRealTime();
+
+// No fdatasync: survives a process crash, not a host crash
+static void BM_CommandWal_NoSync(benchmark::State& state)
+{
+    RunWal(state, false);
+}
+BENCHMARK(BM_CommandWal_NoSync)->ThreadRange(1, 16)->UseRealTime();
+
+// Baseline: write and fdatasync of every record under one mutex
+static void BM_CommandWal_SyncEachRecord(benchmark::State& state)
+{
+    static std::mutex mutex;
+    static int        fd = -1;
+    const std::string path = GetDirectory("bike_proto_wal_naive.log");
+    if (state.thread_index() == 0)
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    uint64_t i = static_cast<uint64_t>(state.thread_index()) << 32;
+    for (auto _ : state) {
+        const std::string record = MakeSetState(i++).SerializeAsString();
+        std::lock_guard   lock(mutex);
+        benchmark::DoNotOptimize(::write(fd, record.data(), record.size()));
+        benchmark::DoNotOptimize(::fdatasync(fd));
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        ::close(fd);
+        std::filesystem::remove(path);
+    }
+}
+BENCHMARK(BM_CommandWal_SyncEachRecord)->ThreadRange(1, 16)->UseRealTime();
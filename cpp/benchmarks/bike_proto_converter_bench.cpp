@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+
+#include "bike_proto_corpus.h"
+
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+namespace {
+
+using iot::backend::proto::ProtocolConverter;
+using iot::backend::proto::bench::GetCorpus;
+
+ProtocolConverter MakeConverter(const benchmark::State& state)
+{
+    return ProtocolConverter(static_cast<ProtocolConverter::TransportDataType>(state.range(0)));
+}
+
+const iot::backend::proto::bench::NamedPacket& GetPacket(const benchmark::State& state)
+{
+    return GetCorpus()[state.range(1)];
+}
+
+}  // namespace
+
+static void BM_ProtocolConverter_Serialize(benchmark::State& state)
+{
+    const auto converter = MakeConverter(state);
+    const auto& [name, packet] = GetPacket(state);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        const auto data = converter.Serialize(packet);
+        bytes += data.size();
+        benchmark::DoNotOptimize(data.data());
+    }
+    state.SetLabel(name);
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ProtocolConverter_Serialize)->Apply(iot::backend::proto::bench::TransportCorpusArgs);
+
+static void BM_ProtocolConverter_SerializeTo(benchmark::State& state)
+{
+    const auto converter = MakeConverter(state);
+    const auto& [name, packet] = GetPacket(state);
+    std::string buffer;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        buffer.clear();
+        converter.SerializeTo(packet, buffer);
+        bytes += buffer.size();
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetLabel(name);
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ProtocolConverter_SerializeTo)->Apply(iot::backend::proto::bench::TransportCorpusArgs);
+
+static void BM_ProtocolConverter_Deserialize(benchmark::State& state)
+{
+    const auto converter = MakeConverter(state);
+    const auto& [name, packet] = GetPacket(state);
+    const auto data = converter.Serialize(packet);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(converter.Deserialize(data));
+    }
+    state.SetLabel(name);
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ProtocolConverter_Deserialize)->Apply(iot::backend::proto::bench::TransportCorpusArgs);
+
+static void BM_ProtocolConverter_DeserializeInPlace(benchmark::State& state)
+{
+    const auto converter = MakeConverter(state);
+    const auto& [name, packet] = GetPacket(state);
+    const auto data = converter.Serialize(packet);
+    iot::backend::proto::Packet result;
+    for (auto _ : state) {
+        converter.Deserialize(data, result);
+        benchmark::DoNotOptimize(result);
+    }
+    state.SetLabel(name);
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ProtocolConverter_DeserializeInPlace)->Apply(iot::backend::proto::bench::TransportCorpusArgs);
+
+static void BM_ProtocolConverter_ToString(benchmark::State& state)
+{
+    const auto& [name, packet] = GetCorpus()[state.range(0)];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(ProtocolConverter::ToString(packet));
+    }
+    state.SetLabel(name);
+}
+BENCHMARK(BM_ProtocolConverter_ToString)->Apply(iot::backend::proto::bench::CorpusArgs);
@@ -0,0 +1,221 @@
+#include "bike_proto_corpus.h"
+
+namespace iot::backend::proto::bench {
+
+namespace {
+
+constexpr uint64_t kTimestamp = 1707425629;
+constexpr char     kChainId[] = "856ccfc0-8c02-4f6b-a6f6-376b4871f246";
+
+Packet MakeHeader(bool with_valid_until)
+{
+    Packet packet;
+    packet.set_version(0x10000);
+    packet.set_timestamp(kTimestamp);
+    if (with_valid_until)
+        packet.set_valid_until(kTimestamp + 300);
+    return packet;
+}
+
+}  // namespace
+
+const std::vector<std::string_view> &GetOptionParams()
+{
+    static const std::vector<std::string_view> kParams = {
+    "alarm", "all_icons", "animation_color", "animation_duration",
+    "animation_type", "available_locations", "bad_pose", "battery_charge",
+    "battery_charge_custom", "battery_charge_custom_coef",
+    "battery_charge_custom_offset", "battery_fw", "battery_heat_cell1_temp",
+    "battery_heat_cell2_temp", "battery_heat_cell3_temp", "battery_heat_func",
+    "battery_heat_preserv", "battery_heat_preserv_start_temp",
+    "battery_heat_preserv_stop_temp", "battery_heat_start_temp",
+    "battery_heat_status", "battery_heat_stop_temp", "battery_is_charging",
+    "battery_is_plugged", "battery_lock", "battery_temp", "battery_voltage",
+    "ble_key_min_rssi", "bleid", "cable_lock", "chainlock_exists",
+    "debug_app_salt", "display_bld_dt", "display_fw", "display_led_brightness",
+    "display_led_color", "display_led_frequency", "display_led_mode",
+    "drivemode_ebike", "drivemode_wind50", "ecu_fw", "engine", "errors",
+    "gas_throttle", "gsm_apn", "gsm_area_code", "gsm_cell_id", "gsm_info_ts",
+    "gsm_network_code", "gsm_operator", "gsm_reg_info", "gsm_signal_strength",
+    "gsm_sim_slot", "gsm_sys_info_str", "heatbox", "hwtype", "icon_color",
+    "icon_duration", "icon_type", "iot_fw", "iot_light_color",
+    "iot_light_effect", "iot_light_freq", "iot_voltage", "last_unlock_ts",
+    "loc_altitude", "loc_hdop", "loc_lat", "loc_lon", "loc_satellites",
+    "loc_source", "loc_updated_at", "locate", "mileage", "nb_ble_key_private",
+    "nb_ble_key_public", "night_sound_begin", "night_sound_end",
+    "night_sound_volume", "notify_config", "play_sound", "power_save_reason",
+    "power_save_sleep_mins", "power_save_state", "power_save_wake_up_mins",
+    "reboot_display", "reboot_iot", "reboot_vehicle", "remaining_mileage",
+    "service_app_salt", "sound_volume", "speed", "speed_limit", "user_app_salt",
+    "usernearby", "vehicle_lock", "vehicle_online",
+    };
+    return kParams;
+}
+
+Packet MakeTelemetry()
+{
+    auto  packet = MakeHeader(false);
+    auto &payload = *packet.mutable_telemetry()->mutable_payload();
+    payload.set_battery_level(87);
+    payload.set_speed_kmh(14.5);
+    payload.set_voltage(373);
+    payload.set_gsm_signal_level(70);
+    payload.set_charging(false);
+    payload.set_locked(false);
+
+    auto &location = *payload.mutable_location();
+    location.set_lat(55.743544);
+    location.set_lon(37.475560);
+    location.set_utc_time_ms(kTimestamp * 1000 + 250);
+    location.set_satellites_amount(11);
+    location.set_hdop(0.9);
+    location.set_altitude_meters(152);
+    location.set_valid(true);
+    location.set_speed(14.1);
+
+    auto &sensors = *payload.mutable_sensors();
+    sensors["imei"] = "869492042841493";
+    sensors["Tyre pressure"] = "2";
+    sensors["Wheel count"] = "1";
+    sensors["battery_temp"] = "23";
+    sensors["iot_fw"] = "2.14.7";
+    sensors["mileage"] = "18342";
+    sensors["gsm_operator"] = "25001";
+    sensors["errors"] = "";
+    return packet;
+}
+
+Packet MakeLargeConfigure(size_t states_count, size_t params_per_state)
+{
+    auto  packet = MakeHeader(true);
+    auto *command = packet.mutable_command();
+    command->set_chain_id(kChainId);
+    auto       *configure = command->mutable_payload()->mutable_configure();
+    const auto &params = GetOptionParams();
+
+    configure->set_state_name("state_0");
+    for (size_t state = 0; state < states_count; ++state) {
+        auto &state_params =
+            *(*configure->mutable_states())["state_" + std::to_string(state)]
+                 .mutable_state_params();
+        for (size_t i = 0; i < params_per_state; ++i) {
+            const auto &name = params[(state * 7 + i) % params.size()];
+            state_params[std::string(name)] = std::to_string(state * 100 + i);
+        }
+    }
+    return packet;
+}
+
+Packet MakeSetParams()
+{
+    auto  packet = MakeHeader(true);
+    auto *command = packet.mutable_command();
+    command->set_chain_id(kChainId);
+    auto &params = *command->mutable_payload()->mutable_set_params()->mutable_params();
+    params["vehicle_lock"] = "locked";
+    params["speed_limit"] = "25";
+    params["iot_light_color"] = "white";
+    return packet;
+}
+
+Packet MakeGetParamsAll()
+{
+    auto  packet = MakeHeader(true);
+    auto *command = packet.mutable_command();
+    command->set_chain_id(kChainId);
+    auto *get_params = command->mutable_payload()->mutable_get_params();
+    for (const auto name : GetOptionParams())
+        get_params->add_param(std::string(name));
+    return packet;
+}
+
+Packet MakeResultGetParamsAll()
+{
+    auto  packet = MakeHeader(false);
+    auto *result = packet.mutable_command_result();
+    result->set_chain_id(kChainId);
+    result->set_result(RESULT_SUCCESS);
+    result->set_cmd_delivery_time(1);
+    result->set_cmd_execution_time_ms(35);
+
+    auto *get_params = result->mutable_payload()->mutable_get_params();
+    size_t i = 0;
+    for (const auto name : GetOptionParams()) {
+        // Часть параметров устройство не поддерживает
+        if (++i % 16 == 0) {
+            (*get_params->mutable_errors())[std::string(name)] = "not supported";
+        } else {
+            (*get_params->mutable_values())[std::string(name)] = std::to_string(i * 37);
+        }
+    }
+    return packet;
+}
+
+Packet MakeResultError()
+{
+    auto  packet = MakeHeader(false);
+    auto *result = packet.mutable_command_result();
+    result->set_chain_id(kChainId);
+    result->set_result(RESULT_FAILED);
+    result->mutable_error_description()->set_status(STATUS_OUTDATED);
+    result->mutable_error_description()->set_message("Command is outdated");
+    return packet;
+}
+
+Packet MakeRequest()
+{
+    auto packet = MakeHeader(false);
+    packet.mutable_request()->set_chain_id(kChainId);
+    return packet;
+}
+
+Packet MakeResponse()
+{
+    auto  packet = MakeHeader(false);
+    auto *response = packet.mutable_response();
+    response->set_chain_id(kChainId);
+    response->set_result(RESULT_SUCCESS);
+    return packet;
+}
+
+Packet MakeNotification()
+{
+    auto packet = MakeHeader(false);
+    packet.mutable_notification();
+    return packet;
+}
+
+const std::vector<NamedPacket> &GetCorpus()
+{
+    static const std::vector<NamedPacket> kCorpus = {
+        {"telemetry", MakeTelemetry()},
+        {"configure_large", MakeLargeConfigure()},
+        {"set_params", MakeSetParams()},
+        {"get_params_all", MakeGetParamsAll()},
+        {"result_get_params_all", MakeResultGetParamsAll()},
+        {"result_error", MakeResultError()},
+        {"request", MakeRequest()},
+        {"response", MakeResponse()},
+        {"notification", MakeNotification()},
+    };
+    return kCorpus;
+}
+
+void CorpusArgs(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgName("packet");
+    for (size_t i = 0; i < GetCorpus().size(); ++i)
+        benchmark->Arg(static_cast<int64_t>(i));
+}
+
+void TransportCorpusArgs(benchmark::internal::Benchmark *benchmark)
+{
+    benchmark->ArgNames({"binary", "packet"});
+    for (const auto type : {ProtocolConverter::TransportDataType::JSON,
+                            ProtocolConverter::TransportDataType::BINARY}) {
+        for (size_t i = 0; i < GetCorpus().size(); ++i)
+            benchmark->Args({static_cast<int64_t>(type), static_cast<int64_t>(i)});
+    }
+}
+
+}  // namespace iot::backend::proto::bench
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Реалистичные пакеты для бенчмарков протокола
+namespace iot::backend::proto::bench {
+
+/// Имена параметров устройства, копия params/options.json
+const std::vector<std::string_view> &GetOptionParams();
+
+/// Телеметрия со всеми типизированными полями и набором sensors
+Packet MakeTelemetry();
+
+/// CmdConfigure с states_count состояниями по params_per_state параметров
+Packet MakeLargeConfigure(size_t states_count = 8, size_t params_per_state = 24);
+
+/// CmdSetParams с несколькими параметрами
+Packet MakeSetParams();
+
+/// CmdGetParams со всеми параметрами из options.json
+Packet MakeGetParamsAll();
+
+/// CommandResult c CmdResultGetParams со значениями всех параметров
+Packet MakeResultGetParamsAll();
+
+/// CommandResult с ошибкой
+Packet MakeResultError();
+
+Packet MakeRequest();
+Packet MakeResponse();
+Packet MakeNotification();
+
+struct NamedPacket {
+    const char *name;
+    Packet      packet;
+};
+
+/// Все пакеты корпуса, по одному каждого вида
+const std::vector<NamedPacket> &GetCorpus();
+
+/// Добавляет бенчмарку аргумент - индекс пакета в GetCorpus()
+void CorpusArgs(benchmark::internal::Benchmark *benchmark);
+
+/// Как CorpusArgs, но для каждого вида транспорта (JSON, BINARY)
+void TransportCorpusArgs(benchmark::internal::Benchmark *benchmark);
+
+}  // namespace iot::backend::proto::bench
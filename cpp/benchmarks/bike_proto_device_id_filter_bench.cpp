@@ -0,0 +1,104 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/device_id_filter.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Early rejection of unknown device ids: 2^20 registered devices, half of
+// the checked ids are not registered. DeviceIdFilter lookups one by one and
+// in prefetched batches, against a hash set of registered ids.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t kDevices = 1 << 20;
+constexpr size_t kQueries = 1 << 16;
+constexpr size_t kBatch = 64;
+
+std::string MakeId(size_t i)
+{
+    return std::to_string(860000000000000ULL + i);
+}
+
+const DeviceIdFilter &GetFilter()
+{
+    static const auto kFilter = [] {
+        auto filter = std::make_unique<DeviceIdFilter>(kDevices);
+        for (size_t i = 0; i < kDevices; ++i)
+            filter->Insert(MakeId(i));
+        return filter;
+    }();
+    return *kFilter;
+}
+
+/// Ids from traffic: registered and unknown in equal parts, in random order
+const std::vector<std::string> &GetQueries()
+{
+    static const auto kQueries = [] {
+        std::vector<std::string> queries;
+        uint64_t                 lcg = 1;
+        for (size_t i = 0; i < ::kQueries; ++i) {
+            lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+            queries.push_back(MakeId((lcg >> 33) % (2 * kDevices)));
+        }
+        return queries;
+    }();
+    return kQueries;
+}
+
+}  // namespace
+
+// One id at a time; with several threads every thread runs the same loop
+// over the shared filter
+static void BM_DeviceIdFilter_MayContain(benchmark::State& state)
+{
+    const auto &filter = GetFilter();
+    const auto &queries = GetQueries();
+    size_t      i = state.thread_index() * 977;
+    size_t      accepted = 0;
+    for (auto _ : state) {
+        accepted += filter.MayContain(queries[i++ % kQueries]);
+    }
+    benchmark::DoNotOptimize(accepted);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_device"] =
+        benchmark::Counter(static_cast<double>(filter.GetMemoryBytes()) / kDevices, benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(BM_DeviceIdFilter_MayContain)->ThreadRange(1, 4)->UseRealTime();
+
+// Batches of 64 ids with the buckets prefetched before the checks
+static void BM_DeviceIdFilter_MayContainBatch(benchmark::State& state)
+{
+    const auto &filter = GetFilter();
+    const auto &queries = GetQueries();
+    std::vector<std::string_view> views(queries.begin(), queries.end());
+    bool                          results[kBatch];
+    size_t                        offset = state.thread_index() * kBatch * 16;
+    for (auto _ : state) {
+        filter.MayContainBatch(views.data() + offset % kQueries, kBatch, results);
+        benchmark::DoNotOptimize(results);
+        offset += kBatch;
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+BENCHMARK(BM_DeviceIdFilter_MayContainBatch)->ThreadRange(1, 4)->UseRealTime();
+
+// Baseline: exact lookup in a hash set of registered ids
+static void BM_DeviceIdFilter_HashSet(benchmark::State& state)
+{
+    std::unordered_set<std::string> registered;
+    for (size_t i = 0; i < kDevices; ++i)
+        registered.insert(MakeId(i));
+    const auto &queries = GetQueries();
+    size_t      i = 0;
+    size_t      accepted = 0;
+    for (auto _ : state) {
+        accepted += registered.count(queries[i++ % kQueries]);
+    }
+    benchmark::DoNotOptimize(accepted);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DeviceIdFilter_HashSet);
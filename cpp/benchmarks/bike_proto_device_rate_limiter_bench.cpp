@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/device_rate_limiter.h"
+#include "iot_scale/cpp/src/device_topics.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Ingest-side rate limiting of 2^20 devices, checked from the topic and the
+// raw payload before decode. DeviceRateLimiter against a hash map of
+// buckets under one mutex, for <threads> ingest threads.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t   kDevices = 1 << 20;
+constexpr uint64_t kStartMs = 1700000000000;
+
+DeviceRateLimiterOptions MakeOptions()
+{
+    DeviceRateLimiterOptions options;
+    options.limits.push_back({Packet::kTelemetry, 10, 1});
+    options.limits.push_back({Packet::kCommandResult, 10, 1});
+    options.max_devices = kDevices;
+    return options;
+}
+
+const std::vector<std::string> &GetTopics()
+{
+    static const auto kTopics = [] {
+        std::vector<std::string> topics;
+        for (size_t i = 0; i < kDevices; ++i)
+            topics.push_back(MakeDeviceTopic(std::to_string(860000000000000ULL + i), DeviceTopicKind::TELEMETRY));
+        return topics;
+    }();
+    return kTopics;
+}
+
+const std::string &GetPayload()
+{
+    static const auto kPayload = [] {
+        Packet packet;
+        packet.set_version(0x00010000);
+        packet.set_timestamp(1700000000);
+        packet.mutable_telemetry()->mutable_payload()->set_battery_level(80);
+        return packet.SerializeAsString();
+    }();
+    return kPayload;
+}
+
+/// Limiter shared by the threads of one benchmark run, with every device
+/// already known
+std::unique_ptr<DeviceRateLimiter> limiter;
+
+/// Baseline: a bucket per device in a hash map under one mutex
+struct LockedLimiter {
+    struct Bucket {
+        double   tokens = 10;
+        uint64_t time_ms = kStartMs;
+    };
+
+    bool Admit(std::string_view topic, std::string_view payload, uint64_t now_ms)
+    {
+        const auto device_topic = ParseDeviceTopic(topic);
+        if (!device_topic || PeekPacketType(payload) != Packet::kTelemetry)
+            return true;
+        std::lock_guard lock(mutex);
+        auto           &bucket = buckets.try_emplace(std::string(device_topic->device_id)).first->second;
+        bucket.tokens = std::min(10.0, bucket.tokens + (now_ms - bucket.time_ms) / 1000.0);
+        bucket.time_ms = now_ms;
+        if (bucket.tokens < 1)
+            return false;
+        bucket.tokens -= 1;
+        return true;
+    }
+
+    std::mutex                              mutex;
+    std::unordered_map<std::string, Bucket> buckets;
+};
+
+std::unique_ptr<LockedLimiter> locked;
+
+template <class Limiter>
+void RunAdmit(benchmark::State& state, Limiter& target)
+{
+    const auto &topics = GetTopics();
+    const auto &payload = GetPayload();
+    uint64_t    rnd = state.thread_index() + 1;
+    uint64_t    now_ms = kStartMs;
+    size_t      dropped = 0;
+    for (auto _ : state) {
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Devices are well behaved: each one is hit rarely, far below its limit
+        ++now_ms;
+        dropped += !target.Admit(topics[(rnd >> 33) % kDevices], payload, now_ms);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["dropped"] = static_cast<double>(dropped);
+}
+
+}  // namespace
+
+static void BM_DeviceRateLimiter_Admit(benchmark::State& state)
+{
+    if (state.thread_index() == 0 && !limiter) {
+        limiter = std::make_unique<DeviceRateLimiter>(MakeOptions(), kStartMs);
+        for (const auto &topic : GetTopics())
+            limiter->Admit(topic, GetPayload(), kStartMs);
+    }
+    RunAdmit(state, *limiter);
+}
+BENCHMARK(BM_DeviceRateLimiter_Admit)->ThreadRange(1, 4)->UseRealTime();
+
+// One faulty device floods the ingest: every packet is dropped
+static void BM_DeviceRateLimiter_Flood(benchmark::State& state)
+{
+    if (state.thread_index() == 0 && !limiter)
+        limiter = std::make_unique<DeviceRateLimiter>(MakeOptions(), kStartMs);
+    const auto &topic = GetTopics().front();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(limiter->Admit(topic, GetPayload(), kStartMs));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DeviceRateLimiter_Flood)->ThreadRange(1, 4)->UseRealTime();
+
+static void BM_DeviceRateLimiter_LockedMap(benchmark::State& state)
+{
+    if (state.thread_index() == 0 && !locked) {
+        locked = std::make_unique<LockedLimiter>();
+        for (const auto &topic : GetTopics())
+            locked->Admit(topic, GetPayload(), kStartMs);
+    }
+    RunAdmit(state, *locked);
+}
+BENCHMARK(BM_DeviceRateLimiter_LockedMap)->ThreadRange(1, 4)->UseRealTime();
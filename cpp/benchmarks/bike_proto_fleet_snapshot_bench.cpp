@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/fleet_snapshot.h"
+
+#include <string>
+#include <unordered_map>
+
+// Fleet queries over 2^20 devices: "unlocked bikes with battery_level < 15
+// and no GSM for 10 minutes" against the FleetSnapshot columns and against
+// a hash map of TelemetryPayload objects.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr uint64_t kNowS = 1700000000;
+constexpr size_t   kDevices = 1 << 20;
+
+TelemetryPayload MakePayload(uint64_t lcg)
+{
+    TelemetryPayload payload;
+    payload.set_battery_level((lcg >> 33) % 101);
+    payload.set_speed_kmh(static_cast<float>((lcg >> 40) % 30));
+    payload.set_voltage(3600 + (lcg >> 20) % 600);
+    payload.set_gsm_signal_level((lcg >> 45) % 8 == 0 ? 0 : (lcg >> 48) % 100);
+    payload.set_locked((lcg >> 52) % 4 != 0);
+    payload.set_charging(false);
+    payload.mutable_location()->set_lat(55.0f + static_cast<float>((lcg >> 24) % 1000) / 1000);
+    payload.mutable_location()->set_lon(37.0f + static_cast<float>((lcg >> 14) % 1000) / 1000);
+    return payload;
+}
+
+template <class Func>
+void ForEachDevice(Func &&func)
+{
+    uint64_t lcg = 1;
+    for (size_t i = 0; i < kDevices; ++i) {
+        lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+        func(std::to_string(860000000000000ULL + i), kNowS - (lcg >> 50) % 1200, MakePayload(lcg));
+    }
+}
+
+const FleetSnapshot &GetSnapshot()
+{
+    static const FleetSnapshot kSnapshot = [] {
+        FleetSnapshot snapshot;
+        ForEachDevice([&](const std::string &id, uint64_t time_s, const TelemetryPayload &payload) {
+            snapshot.Update(id, time_s, payload);
+        });
+        return snapshot;
+    }();
+    return kSnapshot;
+}
+
+const std::vector<FleetPredicate> kQuery = {
+    {FleetColumn::LOCKED, FleetCompare::EQUAL, 0},
+    {FleetColumn::BATTERY_LEVEL, FleetCompare::LESS, 15},
+    {FleetColumn::GSM_SEEN_S, FleetCompare::LESS, kNowS - 600},
+};
+
+}  // namespace
+
+// Whole-fleet scan in <threads> threads. Each thread takes a contiguous
+// range of 64-row blocks, so the scan scales with cores until memory
+// bandwidth is saturated.
+static void BM_FleetSnapshot_Filter(benchmark::State& state)
+{
+    const auto &snapshot = GetSnapshot();
+    size_t      selected = 0;
+    for (auto _ : state) {
+        const auto selection = snapshot.ParallelFilter(kQuery, state.range(0));
+        selected = selection.Count();
+    }
+    state.SetItemsProcessed(state.iterations() * snapshot.GetSize());
+    state.counters["selected"] = selected;
+}
+BENCHMARK(BM_FleetSnapshot_Filter)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The same query plus projection of the coordinates of the selected bikes
+static void BM_FleetSnapshot_FilterProject(benchmark::State& state)
+{
+    const auto &snapshot = GetSnapshot();
+    for (auto _ : state) {
+        const auto selection = snapshot.Filter(kQuery);
+        auto       lat = snapshot.Project(selection, FleetColumn::LAT);
+        auto       lon = snapshot.Project(selection, FleetColumn::LON);
+        benchmark::DoNotOptimize(lat.data());
+        benchmark::DoNotOptimize(lon.data());
+    }
+    state.SetItemsProcessed(state.iterations() * snapshot.GetSize());
+}
+BENCHMARK(BM_FleetSnapshot_FilterProject)->Unit(benchmark::kMillisecond);
+
+// Baseline: the same query over a hash map of protobuf payloads
+static void BM_FleetSnapshot_ProtoMapScan(benchmark::State& state)
+{
+    struct Device {
+        uint64_t         time_s;
+        uint64_t         gsm_seen_s;
+        TelemetryPayload payload;
+    };
+    std::unordered_map<std::string, Device> fleet;
+    ForEachDevice([&](const std::string &id, uint64_t time_s, const TelemetryPayload &payload) {
+        fleet[id] = {time_s, payload.gsm_signal_level() > 0 ? time_s : 0, payload};
+    });
+
+    size_t selected = 0;
+    for (auto _ : state) {
+        selected = 0;
+        for (const auto &[id, device] : fleet) {
+            const auto &payload = device.payload;
+            selected += payload.has_locked() && !payload.locked() && payload.has_battery_level() &&
+                        payload.battery_level() < 15 && device.gsm_seen_s < kNowS - 600;
+        }
+        benchmark::DoNotOptimize(selected);
+    }
+    state.SetItemsProcessed(state.iterations() * fleet.size());
+    state.counters["selected"] = selected;
+}
+BENCHMARK(BM_FleetSnapshot_ProtoMapScan)->Unit(benchmark::kMillisecond);
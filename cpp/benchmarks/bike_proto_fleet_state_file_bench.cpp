@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/fleet_state_file.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Restart of the ingest service with the state of 2^20 devices: taking a
+// snapshot, writing the state file, and getting back to serving from the
+// file, against rebuilding the state by replaying telemetry.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr uint64_t kNowS = 1700000000;
+constexpr size_t   kDevices = 1 << 20;
+constexpr size_t   kLookups = 1000;
+
+std::string MakeId(size_t i)
+{
+    return std::to_string(860000000000000ULL + i);
+}
+
+TelemetryPayload MakePayload(uint64_t lcg)
+{
+    TelemetryPayload payload;
+    payload.set_battery_level((lcg >> 33) % 101);
+    payload.set_speed_kmh(static_cast<float>((lcg >> 40) % 30));
+    payload.set_voltage(3600 + (lcg >> 20) % 600);
+    payload.set_gsm_signal_level((lcg >> 48) % 100);
+    payload.set_locked((lcg >> 52) % 4 != 0);
+    payload.mutable_location()->set_lat(55.0f + static_cast<float>((lcg >> 24) % 1000) / 1000);
+    payload.mutable_location()->set_lon(37.0f + static_cast<float>((lcg >> 14) % 1000) / 1000);
+    return payload;
+}
+
+/// One packet per device: the least a replay has to process
+void Replay(DeviceStateTable &table)
+{
+    uint64_t lcg = 1;
+    for (size_t i = 0; i < kDevices; ++i) {
+        lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+        table.UpdateTelemetry(MakeId(i), kNowS - (lcg >> 50) % 1200, MakePayload(lcg));
+    }
+}
+
+DeviceStateTable &GetTable()
+{
+    static DeviceStateTable kTable = [] {
+        DeviceStateTable table;
+        Replay(table);
+        for (size_t i = 0; i < kDevices; i += 3)
+            table.SetConfigHash(MakeId(i), 0xC0FFEE + i % 7);
+        return table;
+    }();
+    return kTable;
+}
+
+const std::string &GetPath()
+{
+    static const std::string kPath = [] {
+        std::string path = (std::filesystem::temp_directory_path() / "bike_proto_fleet_state_bench.bin").string();
+        WriteFleetStateFile(GetTable().TakeSnapshot(), path, kNowS);
+        return path;
+    }();
+    return kPath;
+}
+
+}  // namespace
+
+// Snapshot of the live table: shares the record blocks, no copying
+static void BM_FleetStateFile_TakeSnapshot(benchmark::State& state)
+{
+    const auto &table = GetTable();
+    for (auto _ : state) {
+        auto snapshot = table.TakeSnapshot();
+        benchmark::DoNotOptimize(snapshot);
+    }
+}
+BENCHMARK(BM_FleetStateFile_TakeSnapshot)->Unit(benchmark::kMicrosecond);
+
+// Cost the ingest thread pays after a snapshot: the first update of every
+// block copies it once
+static void BM_FleetStateFile_UpdateAfterSnapshot(benchmark::State& state)
+{
+    auto            &table = GetTable();
+    TelemetryPayload payload;
+    payload.set_battery_level(50);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto snapshot = table.TakeSnapshot();
+        state.ResumeTiming();
+        for (size_t i = 0; i < kDevices; i += 64)
+            table.UpdateTelemetry(MakeId(i), kNowS, payload);
+        state.PauseTiming();
+        snapshot = DeviceStateSnapshot();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * (kDevices / 64));
+}
+BENCHMARK(BM_FleetStateFile_UpdateAfterSnapshot)->Unit(benchmark::kMillisecond);
+
+// Background write of the whole fleet, including fdatasync
+static void BM_FleetStateFile_Write(benchmark::State& state)
+{
+    const auto snapshot = GetTable().TakeSnapshot();
+    const auto path = GetPath() + ".write";
+    for (auto _ : state) {
+        WriteFleetStateFile(snapshot, path, kNowS);
+    }
+    state.SetBytesProcessed(state.iterations() * std::filesystem::file_size(path));
+    std::remove(path.c_str());
+}
+BENCHMARK(BM_FleetStateFile_Write)->Unit(benchmark::kMillisecond);
+
+// Restart to serving: map the file and answer lookups, validating only
+// the blocks they touch
+static void BM_FleetStateFile_OpenAndServe(benchmark::State& state)
+{
+    const auto &path = GetPath();
+    size_t      found = 0;
+    for (auto _ : state) {
+        const FleetStateFile file(path);
+        uint64_t             lcg = 1;
+        for (size_t i = 0; i < kLookups; ++i) {
+            lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+            found += file.Find(MakeId((lcg >> 33) % kDevices)) != nullptr;
+        }
+    }
+    benchmark::DoNotOptimize(found);
+}
+BENCHMARK(BM_FleetStateFile_OpenAndServe)->Unit(benchmark::kMillisecond);
+
+// Restart with a writable table: map, validate every block and copy it
+static void BM_FleetStateFile_Restore(benchmark::State& state)
+{
+    const auto &path = GetPath();
+    for (auto _ : state) {
+        const FleetStateFile   file(path);
+        const DeviceStateTable table(file);
+        benchmark::DoNotOptimize(table.GetSize());
+    }
+    state.SetItemsProcessed(state.iterations() * kDevices);
+}
+BENCHMARK(BM_FleetStateFile_Restore)->Unit(benchmark::kMillisecond);
+
+// Baseline: rebuilding the table from one telemetry packet per device
+static void BM_FleetStateFile_Replay(benchmark::State& state)
+{
+    for (auto _ : state) {
+        DeviceStateTable table;
+        Replay(table);
+        benchmark::DoNotOptimize(table.GetSize());
+    }
+    state.SetItemsProcessed(state.iterations() * kDevices);
+}
+BENCHMARK(BM_FleetStateFile_Replay)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/chain_id.h"
+#include "iot_scale/cpp/src/helpers.h"
+
+#include <random>
+
+namespace {
+
+std::string MakeRandomBytes(size_t size)
+{
+    std::mt19937 random(42);
+    std::string data(size, '\0');
+    for (auto& c : data)
+        c = static_cast<char>(random());
+    return data;
+}
+
+const std::string kChainId = "856ccfc0-8c02-4f6b-a6f6-376b4871f246";
+
+}  // namespace
+
+static void BM_Helpers_GenerateChainId(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::GenerateChainId());
+    }
+}
+BENCHMARK(BM_Helpers_GenerateChainId);
+
+static void BM_Helpers_ChainIdGenerate(benchmark::State& state)
+{
+    char buffer[iot::backend::proto::ChainId::kStringSize];
+    for (auto _ : state) {
+        iot::backend::proto::ChainId::Generate().FormatTo(buffer);
+        benchmark::DoNotOptimize(buffer);
+    }
+}
+BENCHMARK(BM_Helpers_ChainIdGenerate);
+
+static void BM_Helpers_ToBase64(benchmark::State& state)
+{
+    const auto data = MakeRandomBytes(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::ToBase64(data));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Helpers_ToBase64)->Arg(64)->Arg(512)->Arg(4096);
+
+static void BM_Helpers_FromBase64(benchmark::State& state)
+{
+    const auto encoded = iot::backend::proto::helpers::ToBase64(MakeRandomBytes(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::FromBase64(encoded));
+    }
+    state.SetBytesProcessed(state.iterations() * encoded.size());
+}
+BENCHMARK(BM_Helpers_FromBase64)->Arg(64)->Arg(512)->Arg(4096);
+
+static void BM_Helpers_MakePacket(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::MakePacket(std::chrono::seconds(300)));
+    }
+}
+BENCHMARK(BM_Helpers_MakePacket);
+
+static void BM_Helpers_MakeCommand(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::MakeCommand(std::chrono::seconds(300), kChainId));
+    }
+}
+BENCHMARK(BM_Helpers_MakeCommand);
+
+static void BM_Helpers_MakeCommandResultSuccess(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::MakeCommandResultSuccess(
+            kChainId, std::nullopt, 1, 35));
+    }
+}
+BENCHMARK(BM_Helpers_MakeCommandResultSuccess);
+
+static void BM_Helpers_MakeCommandResultError(benchmark::State& state)
+{
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::MakeCommandResultError(
+            kChainId, iot::backend::proto::RESULT_FAILED, iot::backend::proto::STATUS_OUTDATED,
+            "Command is outdated", kChainId, 1, 35));
+    }
+}
+BENCHMARK(BM_Helpers_MakeCommandResultError);
@@ -0,0 +1,107 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/liveness_tracker.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+// LivenessTracker over a fleet of 2^20 devices with a 5 minute report
+// interval.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr uint64_t kStartMs = 1700000000000ULL;
+
+const std::vector<std::string> &GetDeviceIds()
+{
+    static const std::vector<std::string> kIds = [] {
+        constexpr size_t kCount = 1 << 20;
+        std::vector<std::string> ids;
+        ids.reserve(kCount);
+        for (size_t i = 0; i < kCount; ++i)
+            ids.push_back(std::to_string(860000000000000ULL + i));
+        return ids;
+    }();
+    return kIds;
+}
+
+/// Bytes allocated on the heap so far; 0 where it can't be measured
+size_t GetHeapBytes()
+{
+#if defined(__GLIBC__)
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+LivenessOptions MakeOptions()
+{
+    LivenessOptions options;
+    options.reports = {"heartbeat", "location", "info"};
+    options.default_interval = std::chrono::seconds(300);
+    return options;
+}
+
+}  // namespace
+
+// One packet from a random device: lookup plus one reschedule. Time moves
+// by 1 ms per 16 packets (every device reports about once a minute), the
+// wheel is advanced every 1024 packets and the cost is included. Rare
+// devices that stay silent for 10 minutes are reported and come back.
+// bytes_per_device is the heap taken by the tracker per device (glibc only).
+static void BM_Liveness_OnPacket(benchmark::State& state)
+{
+    const auto     &ids = GetDeviceIds();
+    const size_t    heap_before = GetHeapBytes();
+    LivenessTracker tracker(MakeOptions(), kStartMs);
+    uint64_t        now_ms = kStartMs;
+    for (const auto &id : ids)
+        tracker.OnPacket(id, now_ms);
+    const size_t heap_bytes = GetHeapBytes() - heap_before;
+
+    size_t     events = 0;
+    const auto on_offline = [&](const LivenessEvent &) { ++events; };
+    uint64_t   lcg = 1;
+    size_t     packets = 0;
+    for (auto _ : state) {
+        lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+        tracker.OnPacket(ids[(lcg >> 33) & (ids.size() - 1)], now_ms);
+        if (++packets % 16 == 0)
+            ++now_ms;
+        if (packets % 1024 == 0)
+            tracker.Advance(now_ms, on_offline);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["events"] = events;
+    state.counters["bytes_per_device"] = static_cast<double>(heap_bytes) / ids.size();
+}
+BENCHMARK(BM_Liveness_OnPacket);
+
+// The whole fleet goes silent: Advance delivers one event per device
+static void BM_Liveness_Expire(benchmark::State& state)
+{
+    const auto &ids = GetDeviceIds();
+    size_t      events = 0;
+    std::unique_ptr<LivenessTracker> tracker;
+    for (auto _ : state) {
+        state.PauseTiming();
+        tracker = std::make_unique<LivenessTracker>(MakeOptions(), kStartMs);
+        for (size_t i = 0; i < ids.size(); ++i)
+            tracker->OnPacket(ids[i], kStartMs + i % 60000);
+        state.ResumeTiming();
+
+        events += tracker->Advance(kStartMs + 3600000, [](const LivenessEvent &event) {
+            benchmark::DoNotOptimize(event.device_id.data());
+        });
+    }
+    state.SetItemsProcessed(events);
+}
+BENCHMARK(BM_Liveness_Expire)->Unit(benchmark::kMillisecond);
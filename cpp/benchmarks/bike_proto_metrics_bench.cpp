@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include "bike_proto_corpus.h"
+
+#include "iot_scale/cpp/src/hot_path_metrics.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+// Overhead of hot path metrics: compare /0 (disabled) with /1 (enabled).
+// Build with -DIOT_PROTO_NO_METRICS to measure the library without them.
+
+namespace {
+
+class MetricsGuard {
+  public:
+    explicit MetricsGuard(bool enabled)
+    {
+        iot::backend::proto::metrics::SetEnabled(enabled);
+    }
+    ~MetricsGuard()
+    {
+        iot::backend::proto::metrics::SetEnabled(false);
+        iot::backend::proto::metrics::Reset();
+    }
+};
+
+}  // namespace
+
+static void BM_Metrics_IsValid(benchmark::State& state)
+{
+    const MetricsGuard guard(state.range(0) != 0);
+    const auto packet = iot::backend::proto::bench::MakeTelemetry();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::IsValid(packet));
+    }
+}
+BENCHMARK(BM_Metrics_IsValid)->Arg(0)->Arg(1);
+
+static void BM_Metrics_Deserialize(benchmark::State& state)
+{
+    const MetricsGuard guard(state.range(0) != 0);
+    const iot::backend::proto::ProtocolConverter converter(
+        iot::backend::proto::ProtocolConverter::TransportDataType::BINARY);
+    const auto buffer = converter.Serialize(iot::backend::proto::bench::MakeTelemetry());
+    iot::backend::proto::Packet packet;
+    for (auto _ : state) {
+        converter.Deserialize(buffer, packet);
+        benchmark::DoNotOptimize(packet);
+    }
+}
+BENCHMARK(BM_Metrics_Deserialize)->Arg(0)->Arg(1);
+
+static void BM_Metrics_SerializeTo(benchmark::State& state)
+{
+    const MetricsGuard guard(state.range(0) != 0);
+    const iot::backend::proto::ProtocolConverter converter(
+        iot::backend::proto::ProtocolConverter::TransportDataType::BINARY);
+    const auto packet = iot::backend::proto::bench::MakeTelemetry();
+    std::string buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        converter.SerializeTo(packet, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+}
+BENCHMARK(BM_Metrics_SerializeTo)->Arg(0)->Arg(1);
+
+static void BM_Metrics_Collect(benchmark::State& state)
+{
+    const MetricsGuard guard(true);
+    for (const auto& [name, packet] : iot::backend::proto::bench::GetCorpus()) {
+        benchmark::DoNotOptimize(iot::backend::proto::IsValid(packet));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::metrics::Collect().ToText());
+    }
+}
+BENCHMARK(BM_Metrics_Collect);
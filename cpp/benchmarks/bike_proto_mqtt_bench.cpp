@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/device_topics.h"
+#include "iot_scale/cpp/src/fleet_simulator.h"
+#include "iot_scale/cpp/src/helpers.h"
+#include "iot_scale/cpp/src/mqtt_broker.h"
+#include "iot_scale/cpp/src/mqtt_client.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// End-to-end traffic through LoopbackMqttBroker over loopback TCP. The
+// broker runs in its own thread, so results depend on the number of cores.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr std::chrono::seconds kTimeout(5);
+
+// Backend subscribed to all device events and devices subscribed to their
+// command topics
+struct Fleet {
+    explicit Fleet(size_t device_count) : model(device_count, 1)
+    {
+        broker.Start();
+        backend = std::make_unique<MqttClient>(broker.GetPort(), "backend");
+        backend->Subscribe(kAllDeviceEventsFilter, 1);
+        for (size_t i = 0; i < device_count; ++i) {
+            const auto &imei = model.GetDevice(i).imei;
+            devices.push_back(std::make_unique<MqttClient>(broker.GetPort(), imei));
+            devices.back()->Subscribe(MakeDeviceTopic(imei, DeviceTopicKind::COMMAND), 1);
+            command_topics.push_back(MakeDeviceTopic(imei, DeviceTopicKind::COMMAND));
+            telemetry_topics.push_back(MakeDeviceTopic(imei, DeviceTopicKind::TELEMETRY));
+            status_topics.push_back(MakeDeviceTopic(imei, DeviceTopicKind::STATUS));
+        }
+    }
+
+    LoopbackMqttBroker                       broker;
+    FleetModel                               model;
+    std::unique_ptr<MqttClient>              backend;
+    std::vector<std::unique_ptr<MqttClient>> devices;
+    std::vector<std::string>                 command_topics;
+    std::vector<std::string>                 telemetry_topics;
+    std::vector<std::string>                 status_topics;
+};
+
+}  // namespace
+
+// Backend publishes CmdSetParams to every device (QoS 1), each device
+// decodes, validates and answers with CommandResult on events/status, the
+// backend decodes and validates the results
+static void BM_Mqtt_CommandRoundTrip(benchmark::State& state)
+{
+    Fleet fleet(state.range(0));
+    const ProtocolConverter converter(ProtocolConverter::TransportDataType::JSON);
+    Packet      command;
+    Packet      packet;
+    MqttMessage message;
+    std::string buffer;
+    std::string chain_id;
+    uint64_t    invalid = 0;
+
+    for (auto _ : state) {
+        helpers::MakeCommand(command, std::chrono::seconds(300), helpers::GenerateChainId());
+        (*command.mutable_command()->mutable_payload()->mutable_set_params()->mutable_params())["vehicle_lock"] = "locked";
+        for (const auto &topic : fleet.command_topics) {
+            buffer.clear();
+            converter.SerializeTo(command, buffer);
+            fleet.backend->Publish(topic, buffer, 1);
+        }
+
+        for (size_t i = 0; i < fleet.devices.size(); ++i) {
+            auto &device = *fleet.devices[i];
+            if (!device.Receive(message, kTimeout)) {
+                state.SkipWithError("command is not delivered");
+                return;
+            }
+            converter.Deserialize(message.payload, packet);
+            invalid += !IsValid(packet);
+            chain_id = packet.command().chain_id();
+            fleet.model.MakeCommandResult(chain_id, packet);
+            buffer.clear();
+            converter.SerializeTo(packet, buffer);
+            device.Publish(fleet.status_topics[i], buffer, 1);
+        }
+
+        for (size_t i = 0; i < fleet.devices.size(); ++i) {
+            if (!fleet.backend->Receive(message, kTimeout)) {
+                state.SkipWithError("command result is not delivered");
+                return;
+            }
+            converter.Deserialize(message.payload, packet);
+            invalid += !IsValid(packet);
+        }
+        fleet.backend->WaitForAcks();
+        for (auto &device : fleet.devices)
+            device->WaitForAcks();
+    }
+    state.SetItemsProcessed(state.iterations() * fleet.devices.size());
+    state.counters["invalid"] = invalid;
+}
+BENCHMARK(BM_Mqtt_CommandRoundTrip)->Arg(1)->Arg(100)->Arg(1000)->UseRealTime();
+
+// Every device publishes telemetry with QoS 0, the backend decodes and
+// validates it
+static void BM_Mqtt_TelemetryQos0(benchmark::State& state)
+{
+    Fleet fleet(state.range(0));
+    const ProtocolConverter converter(ProtocolConverter::TransportDataType::BINARY);
+    Packet      packet;
+    MqttMessage message;
+    std::string buffer;
+    uint64_t    invalid = 0;
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < fleet.devices.size(); ++i) {
+            fleet.model.MakeTelemetry(i, std::chrono::seconds(10), packet);
+            buffer.clear();
+            converter.SerializeTo(packet, buffer);
+            fleet.devices[i]->Publish(fleet.telemetry_topics[i], buffer, 0);
+        }
+        for (size_t i = 0; i < fleet.devices.size(); ++i) {
+            if (!fleet.backend->Receive(message, kTimeout)) {
+                state.SkipWithError("telemetry is not delivered");
+                return;
+            }
+            converter.Deserialize(message.payload, packet);
+            invalid += !IsValid(packet);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * fleet.devices.size());
+    state.counters["invalid"] = invalid;
+}
+BENCHMARK(BM_Mqtt_TelemetryQos0)->Arg(100)->Arg(1000)->UseRealTime();
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/packet_pool.h"
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+#include "iot_scale/cpp/testing/alloc_counter.h"
+
+namespace {
+
+const std::string kTelemetry =
+    R"({"version":16777216,"timestamp":"1707425629","telemetry":{"payload":{"batteryLevel":87,"speedKmh":14.5,"voltage":373,"gsmSignalLevel":70,"locked":false,"sensors":{"imei":"869492042841493","Tyre pressure":"2"}}}})";
+
+}  // namespace
+
+static void ReportAllocations(benchmark::State& state, const iot::backend::proto::testing::AllocationScope& scope)
+{
+    state.counters["allocs_per_op"] = benchmark::Counter(
+        static_cast<double>(scope.Get().count) / state.iterations());
+}
+
+static void BM_PacketPool_MakeCommandResult_ByValue(benchmark::State& state)
+{
+    const iot::backend::proto::testing::AllocationScope scope;
+    for (auto _ : state) {
+        auto packet = iot::backend::proto::helpers::MakeCommandResultSuccess(
+            "856ccfc0-8c02-4f6b-a6f6-376b4871f246", std::nullopt, 1, 20);
+        benchmark::DoNotOptimize(packet);
+    }
+    ReportAllocations(state, scope);
+}
+BENCHMARK(BM_PacketPool_MakeCommandResult_ByValue);
+
+static void BM_PacketPool_MakeCommandResult_Pooled(benchmark::State& state)
+{
+    const iot::backend::proto::testing::AllocationScope scope;
+    for (auto _ : state) {
+        auto packet = iot::backend::proto::PacketPool::Acquire();
+        iot::backend::proto::helpers::MakeCommandResultSuccess(
+            *packet, "856ccfc0-8c02-4f6b-a6f6-376b4871f246", std::nullopt, 1, 20);
+        benchmark::DoNotOptimize(packet.Get());
+    }
+    ReportAllocations(state, scope);
+}
+BENCHMARK(BM_PacketPool_MakeCommandResult_Pooled);
+
+static void BM_PacketPool_Deserialize_ByValue(benchmark::State& state)
+{
+    const iot::backend::proto::ProtocolConverter converter(
+        iot::backend::proto::ProtocolConverter::TransportDataType::BINARY);
+    const auto binary = converter.Serialize(
+        iot::backend::proto::ProtocolConverter(iot::backend::proto::ProtocolConverter::TransportDataType::JSON)
+            .Deserialize(kTelemetry));
+
+    const iot::backend::proto::testing::AllocationScope scope;
+    for (auto _ : state) {
+        auto packet = converter.Deserialize(binary);
+        benchmark::DoNotOptimize(packet);
+    }
+    ReportAllocations(state, scope);
+}
+BENCHMARK(BM_PacketPool_Deserialize_ByValue);
+
+static void BM_PacketPool_Deserialize_Pooled(benchmark::State& state)
+{
+    const iot::backend::proto::ProtocolConverter converter(
+        iot::backend::proto::ProtocolConverter::TransportDataType::BINARY);
+    const auto binary = converter.Serialize(
+        iot::backend::proto::ProtocolConverter(iot::backend::proto::ProtocolConverter::TransportDataType::JSON)
+            .Deserialize(kTelemetry));
+
+    const iot::backend::proto::testing::AllocationScope scope;
+    for (auto _ : state) {
+        auto packet = iot::backend::proto::PacketPool::Acquire();
+        converter.Deserialize(binary, *packet);
+        benchmark::DoNotOptimize(packet.Get());
+    }
+    ReportAllocations(state, scope);
+}
+BENCHMARK(BM_PacketPool_Deserialize_Pooled);
@@ -0,0 +1,205 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/param_schema_registry.h"
+#include "iot_scale/cpp/src/params_files.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Hot-path lookups of parameter names in the current schema on <threads>
+// readers: ParamSchemaRegistry (RCU) against a shared_ptr behind a mutex
+// and std::atomic_load of a shared_ptr, with and without reloads. Reloads
+// run on a separate thread, so only the readers are timed.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t kOptions = 256;
+// Lookups per read-side section, as when checking one command
+constexpr size_t kLookups = 4;
+constexpr auto kReloadPeriod = std::chrono::milliseconds(10);
+
+std::string TempPath(const std::string& name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+std::vector<std::string> MakeNames(const std::string& prefix, size_t count)
+{
+    std::vector<std::string> names;
+    for (size_t i = 0; i < count; ++i)
+        names.push_back(prefix + std::to_string(i));
+    return names;
+}
+
+struct Files {
+    std::string options = TempPath("bike_proto_bench_options.json");
+    std::string reports = TempPath("bike_proto_bench_reports.json");
+
+    Files()
+    {
+        const auto write = [](const std::string& path, const std::vector<std::string>& names) {
+            std::ofstream out(path);
+            out << '[';
+            for (size_t i = 0; i < names.size(); ++i)
+                out << (i ? ", \"" : "\"") << names[i] << '"';
+            out << ']';
+        };
+        write(options, MakeNames("option_", kOptions));
+        write(reports, MakeNames("report_", 16));
+    }
+};
+
+const Files& GetFiles()
+{
+    static const Files kFiles;
+    return kFiles;
+}
+
+/// Reads the files like ParamSchemaRegistry::Reload
+std::unique_ptr<const ParamSchema> LoadSchema(uint64_t version)
+{
+    return std::make_unique<const ParamSchema>(LoadParamNames(GetFiles().options), LoadParamNames(GetFiles().reports),
+                                               version);
+}
+
+/// Baseline: the current version as a shared_ptr copied under a mutex
+class LockedHolder {
+  public:
+    std::shared_ptr<const ParamSchema> Get() const
+    {
+        std::lock_guard lock(mutex_);
+        return schema_;
+    }
+
+    void Publish(std::shared_ptr<const ParamSchema> schema)
+    {
+        std::lock_guard lock(mutex_);
+        schema_ = std::move(schema);
+    }
+
+  private:
+    mutable std::mutex                 mutex_;
+    std::shared_ptr<const ParamSchema> schema_ = LoadSchema(1);
+};
+
+/// Baseline: the current version as a shared_ptr read with std::atomic_load
+class AtomicHolder {
+  public:
+    std::shared_ptr<const ParamSchema> Get() const { return std::atomic_load(&schema_); }
+    void Publish(std::shared_ptr<const ParamSchema> schema) { std::atomic_store(&schema_, std::move(schema)); }
+
+  private:
+    std::shared_ptr<const ParamSchema> schema_ = LoadSchema(1);
+};
+
+const std::vector<std::string>& GetQueries()
+{
+    static const auto kQueries = [] {
+        std::vector<std::string> queries;
+        uint64_t                 rnd = 1;
+        for (size_t i = 0; i < 1024; ++i) {
+            rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+            queries.push_back("option_" + std::to_string((rnd >> 33) % (kOptions + kOptions / 8)));
+        }
+        return queries;
+    }();
+    return kQueries;
+}
+
+/// Calls reload every kReloadPeriod on its own thread until destroyed
+class Reloader {
+  public:
+    explicit Reloader(std::function<void()> reload)
+        : thread_([this, reload = std::move(reload)] {
+            while (!stop_.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(kReloadPeriod);
+                reload();
+            }
+        })
+    {
+    }
+
+    ~Reloader()
+    {
+        stop_.store(true, std::memory_order_relaxed);
+        thread_.join();
+    }
+
+  private:
+    std::atomic<bool> stop_{false};
+    std::thread       thread_;
+};
+
+size_t Lookup(const ParamSchema& schema, const std::vector<std::string>& queries, size_t& next)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < kLookups; ++i)
+        found += schema.IsOption(queries[next++ & (queries.size() - 1)]);
+    return found;
+}
+
+}  // namespace
+
+static void BM_ParamSchema_Rcu(benchmark::State& state)
+{
+    static ParamSchemaRegistry *registry = nullptr;
+    static Reloader            *reloader = nullptr;
+    if (state.thread_index() == 0) {
+        registry = new ParamSchemaRegistry(GetFiles().options, GetFiles().reports);
+        if (state.range(0) != 0)
+            reloader = new Reloader([] { registry->Reload(); });
+    }
+    const auto& queries = GetQueries();
+    size_t      next = state.thread_index() * 64;
+    size_t      found = 0;
+    for (auto _ : state) {
+        rcu::ReadLock lock;
+        found += Lookup(*registry->Get(lock), queries, next);
+    }
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations() * kLookups);
+    if (state.thread_index() == 0) {
+        delete reloader;
+        reloader = nullptr;
+        state.counters["versions"] = registry->GetVersion();
+        delete registry;
+    }
+}
+BENCHMARK(BM_ParamSchema_Rcu)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+template <class Holder>
+static void BM_ParamSchema_SharedPtr(benchmark::State& state)
+{
+    static Holder   *holder = nullptr;
+    static Reloader *reloader = nullptr;
+    if (state.thread_index() == 0) {
+        holder = new Holder();
+        if (state.range(0) != 0)
+            reloader = new Reloader([version = uint64_t{1}]() mutable { holder->Publish(LoadSchema(++version)); });
+    }
+    const auto& queries = GetQueries();
+    size_t      next = state.thread_index() * 64;
+    size_t      found = 0;
+    for (auto _ : state) {
+        found += Lookup(*holder->Get(), queries, next);
+    }
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations() * kLookups);
+    if (state.thread_index() == 0) {
+        delete reloader;
+        reloader = nullptr;
+        delete holder;
+    }
+}
+BENCHMARK_TEMPLATE(BM_ParamSchema_SharedPtr, LockedHolder)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ParamSchema_SharedPtr, AtomicHolder)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
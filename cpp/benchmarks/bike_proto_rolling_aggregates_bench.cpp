@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/rolling_aggregates.h"
+
+#include <string>
+#include <vector>
+
+// RollingAggregates with the default 5 min / 1 h / 24 h windows over 2^16
+// devices. Each device reports about every 30 seconds and packets arrive in
+// a scattered order.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr uint64_t kStartS = 1700000000;
+constexpr size_t   kDevices = 1 << 16;
+
+const std::vector<std::string> &GetDeviceIds()
+{
+    static const std::vector<std::string> kIds = [] {
+        std::vector<std::string> ids;
+        ids.reserve(kDevices);
+        for (size_t i = 0; i < kDevices; ++i)
+            ids.push_back(std::to_string(860000000000000ULL + i));
+        return ids;
+    }();
+    return kIds;
+}
+
+TelemetryPayload MakePayload(size_t i)
+{
+    TelemetryPayload payload;
+    payload.set_battery_level(100 - i % 100);
+    payload.set_speed_kmh(static_cast<float>(i % 25));
+    payload.set_gsm_signal_level(40 + i % 60);
+    return payload;
+}
+
+}  // namespace
+
+// One telemetry packet: device lookup plus one bucket update per window.
+// bytes_per_device is the size of the rings of one device.
+static void BM_RollingAggregates_Update(benchmark::State& state)
+{
+    const auto       &ids = GetDeviceIds();
+    RollingAggregates aggregates;
+    const auto        payload = MakePayload(7);
+    for (const auto &id : ids)
+        aggregates.Update(id, kStartS, payload);
+
+    uint64_t          lcg = 1;
+    size_t            packets = 0;
+    for (auto _ : state) {
+        lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Time moves by 1 s per kDevices / 30 packets
+        aggregates.Update(ids[(lcg >> 33) & (kDevices - 1)], kStartS + packets++ * 30 / kDevices, payload);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes_per_device"] = aggregates.GetBytesPerDevice();
+}
+BENCHMARK(BM_RollingAggregates_Update);
+
+// Summary of one window of a random device after a day of traffic
+static void BM_RollingAggregates_Query(benchmark::State& state)
+{
+    const auto       &ids = GetDeviceIds();
+    RollingAggregates aggregates;
+    const uint64_t    day_s = 24 * 3600;
+    for (uint64_t time_s = 0; time_s < day_s; time_s += 300) {
+        for (size_t i = 0; i < kDevices; i += 16)
+            aggregates.Update(ids[i], kStartS + time_s, MakePayload(time_s + i));
+    }
+
+    const auto window = static_cast<size_t>(state.range(0));
+    uint64_t   lcg = 1;
+    for (auto _ : state) {
+        lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+        auto aggregate = aggregates.Query(ids[(lcg >> 33) & (kDevices - 1) & ~size_t{15}], window, kStartS + day_s);
+        benchmark::DoNotOptimize(aggregate);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RollingAggregates_Query)->DenseRange(0, 2);
@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include "bike_proto_corpus.h"
+
+#include "iot_scale/cpp/src/sensor_record.h"
+
+#include <string>
+#include <vector>
+
+// Reading typed sensor values (tyre pressure, battery temperature,
+// mileage, wheel count) of one telemetry packet by kConsumers consumers:
+// a SensorRecord decoded once against a map lookup and a text parse in
+// every consumer.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t kConsumers = 3;
+
+const SensorSchema &GetSchema()
+{
+    static const auto kSchema = [] {
+        std::vector<std::string> options;
+        for (const auto name : bench::GetOptionParams())
+            options.emplace_back(name);
+        return SensorSchema::FromOptions(options);
+    }();
+    return kSchema;
+}
+
+}  // namespace
+
+static void BM_SensorRecord_Decode(benchmark::State& state)
+{
+    const auto   packet = bench::MakeTelemetry();
+    const auto&  payload = packet.telemetry().payload();
+    const auto&  schema = GetSchema();
+    SensorRecord record;
+    for (auto _ : state) {
+        record.Decode(schema, payload);
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SensorRecord_Decode);
+
+static void BM_SensorRecord_TypedReads(benchmark::State& state)
+{
+    const auto     packet = bench::MakeTelemetry();
+    const auto&    payload = packet.telemetry().payload();
+    const auto&    schema = GetSchema();
+    // Consumers resolve field numbers once, at start-up
+    const uint32_t tyre_pressure = *schema.Find("Tyre pressure");
+    const uint32_t battery_temp = *schema.Find("battery_temp");
+    const uint32_t mileage = *schema.Find("mileage");
+    const uint32_t wheel_count = *schema.Find("Wheel count");
+    SensorRecord   record;
+    for (auto _ : state) {
+        record.Decode(schema, payload);
+        double sum = 0;
+        for (size_t i = 0; i < kConsumers; ++i) {
+            sum += record.GetFloat(tyre_pressure).value_or(0) + record.GetFloat(battery_temp).value_or(0) +
+                   record.GetInt(mileage).value_or(0) + record.GetInt(wheel_count).value_or(0);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SensorRecord_TypedReads);
+
+// Baseline: every consumer looks the keys up in the map and parses the text
+static void BM_SensorRecord_MapParse(benchmark::State& state)
+{
+    const auto  packet = bench::MakeTelemetry();
+    const auto& sensors = packet.telemetry().payload().sensors();
+    const auto  get = [&sensors](const char* name) {
+        const auto it = sensors.find(name);
+        return it != sensors.end() ? &it->second : nullptr;
+    };
+    for (auto _ : state) {
+        double sum = 0;
+        for (size_t i = 0; i < kConsumers; ++i) {
+            if (const auto* value = get("Tyre pressure"))
+                sum += std::stod(*value);
+            if (const auto* value = get("battery_temp"))
+                sum += std::stod(*value);
+            if (const auto* value = get("mileage"))
+                sum += std::stoll(*value);
+            if (const auto* value = get("Wheel count"))
+                sum += std::stoll(*value);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SensorRecord_MapParse);
@@ -0,0 +1,235 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/device_rate_limiter.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/shard_executor.h"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Per-packet device processing (IsValid, rate limit, shadow update) of
+// telemetry from 2^16 devices on <threads> workers. ShardExecutor, where
+// each worker owns the state of its devices, against a thread pool that
+// shares one state between all workers.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t   kDevices = 1 << 16;
+constexpr size_t   kPackets = 1 << 14;
+constexpr uint64_t kStartMs = 1700000000000;
+
+struct Shadow {
+    uint32_t battery_level = 0;
+    uint64_t last_seen_s = 0;
+    uint64_t packets = 0;
+};
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+using ShadowMap = std::unordered_map<std::string, Shadow, StringHash, std::equal_to<>>;
+
+DeviceRateLimiterOptions MakeLimiterOptions(size_t devices)
+{
+    DeviceRateLimiterOptions options;
+    options.limits.push_back({Packet::kTelemetry, 100, 100});
+    options.max_devices = devices;
+    return options;
+}
+
+void UpdateShadow(Shadow& shadow, const Packet& packet)
+{
+    shadow.battery_level = packet.telemetry().payload().battery_level();
+    shadow.last_seen_s = packet.timestamp();
+    ++shadow.packets;
+}
+
+struct Traffic {
+    std::vector<std::string> device_ids;
+    std::vector<Packet>      packets;
+};
+
+const Traffic& GetTraffic()
+{
+    static const auto kTraffic = [] {
+        Traffic  traffic;
+        uint64_t rnd = 1;
+        for (size_t i = 0; i < kPackets; ++i) {
+            rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+            traffic.device_ids.push_back(std::to_string(860000000000000ULL + (rnd >> 33) % kDevices));
+            Packet packet;
+            packet.set_version(0x00010000);
+            packet.set_timestamp(1700000000 + i);
+            packet.mutable_telemetry()->mutable_payload()->set_battery_level(i % 100);
+            traffic.packets.push_back(std::move(packet));
+        }
+        return traffic;
+    }();
+    return kTraffic;
+}
+
+/// Owns the shadows and the limiter of its devices, no locks
+class DeviceShardHandler : public ShardHandler {
+  public:
+    explicit DeviceShardHandler(size_t shards) : limiter_(MakeLimiterOptions(kDevices / shards), kStartMs) {}
+
+    void Handle(ShardContext&, std::string_view device_id, Packet& packet) override
+    {
+        if (!IsValid(packet) || !limiter_.Admit(device_id, Packet::kTelemetry, packet.timestamp() * 1000))
+            return;
+        auto it = shadows_.find(device_id);
+        if (it == shadows_.end())
+            it = shadows_.emplace(device_id, Shadow()).first;
+        UpdateShadow(it->second, packet);
+    }
+
+  private:
+    DeviceRateLimiter limiter_;
+    ShadowMap         shadows_;
+};
+
+/// Baseline: workers take packets from one queue and update shared state
+/// (shadows under striped locks, one shared limiter)
+class SharedStatePool {
+  public:
+    explicit SharedStatePool(size_t threads) : limiter_(MakeLimiterOptions(kDevices), kStartMs)
+    {
+        for (size_t i = 0; i < threads; ++i)
+            threads_.emplace_back([this]() { Run(); });
+    }
+
+    ~SharedStatePool()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        queued_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    void Submit(const std::string& device_id, Packet& packet)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            auto&           message = queue_.emplace_back();
+            message.device_id = device_id;
+            message.packet.Swap(&packet);
+            ++pending_;
+        }
+        queued_.notify_one();
+    }
+
+    void Drain()
+    {
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [&]() { return pending_ == 0; });
+    }
+
+  private:
+    struct Message {
+        std::string device_id;
+        Packet      packet;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        ShadowMap  shadows;
+    };
+
+    void Run()
+    {
+        std::vector<Message> batch;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex_);
+                queued_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+                if (queue_.empty())
+                    return;
+                for (size_t i = 0; i < 64 && !queue_.empty(); ++i) {
+                    batch.push_back(std::move(queue_.front()));
+                    queue_.pop_front();
+                }
+            }
+            for (auto& message : batch) {
+                if (!IsValid(message.packet) ||
+                    !limiter_.Admit(message.device_id, Packet::kTelemetry, message.packet.timestamp() * 1000))
+                    continue;
+                auto&           stripe = stripes_[std::hash<std::string>{}(message.device_id) % stripes_.size()];
+                std::lock_guard lock(stripe.mutex);
+                auto            it = stripe.shadows.find(message.device_id);
+                if (it == stripe.shadows.end())
+                    it = stripe.shadows.emplace(message.device_id, Shadow()).first;
+                UpdateShadow(it->second, message.packet);
+            }
+            {
+                std::lock_guard lock(mutex_);
+                pending_ -= batch.size();
+                if (pending_ == 0)
+                    done_.notify_all();
+            }
+            batch.clear();
+        }
+    }
+
+    DeviceRateLimiter        limiter_;
+    std::array<Stripe, 64>   stripes_;
+    std::mutex               mutex_;
+    std::condition_variable  queued_;
+    std::condition_variable  done_;
+    std::deque<Message>      queue_;
+    size_t                   pending_ = 0;
+    bool                     stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+// One ingest thread feeds kPackets per iteration, workers = state.range(0)
+static void BM_ShardExecutor_Sharded(benchmark::State& state)
+{
+    const auto&          traffic = GetTraffic();
+    const size_t         shards = state.range(0);
+    ShardExecutorOptions options;
+    options.shards = shards;
+    ShardExecutor executor(options, [shards](size_t) { return std::make_unique<DeviceShardHandler>(shards); });
+    auto&         producer = executor.AddProducer();
+    Packet        packet;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kPackets; ++i) {
+            packet = traffic.packets[i];
+            producer.Submit(traffic.device_ids[i], packet);
+        }
+        executor.Drain();
+    }
+    state.SetItemsProcessed(state.iterations() * kPackets);
+}
+BENCHMARK(BM_ShardExecutor_Sharded)->Arg(1)->Arg(2)->Arg(8)->Arg(16)->Arg(32)->UseRealTime();
+
+static void BM_ShardExecutor_SharedStatePool(benchmark::State& state)
+{
+    const auto&     traffic = GetTraffic();
+    SharedStatePool pool(state.range(0));
+    Packet          packet;
+    for (auto _ : state) {
+        for (size_t i = 0; i < kPackets; ++i) {
+            packet = traffic.packets[i];
+            pool.Submit(traffic.device_ids[i], packet);
+        }
+        pool.Drain();
+    }
+    state.SetItemsProcessed(state.iterations() * kPackets);
+}
+BENCHMARK(BM_ShardExecutor_SharedStatePool)->Arg(1)->Arg(2)->Arg(8)->Arg(16)->Arg(32)->UseRealTime();
@@ -0,0 +1,174 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/hot_path_metrics.h"
+#include "iot_scale/cpp/src/telemetry_sink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Ingest-side cost of persisting telemetry packets: TelemetrySink on
+// io_uring and on its thread-pool fallback against a blocking write() of
+// every record on the ingest thread. Reports per-record latency quantiles
+// as seen by the ingest thread.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+constexpr size_t kFiles = 16;
+
+std::string GetPath(size_t file)
+{
+    return (std::filesystem::temp_directory_path() / ("bike_proto_sink_bench_" + std::to_string(file))).string();
+}
+
+Packet MakeTelemetry(uint64_t i)
+{
+    Packet packet;
+    packet.set_version(0x00010000);
+    packet.set_timestamp(1700000000 + i);
+    auto *payload = packet.mutable_telemetry()->mutable_payload();
+    payload->set_battery_level(i % 100);
+    payload->set_voltage(3700 + i % 500);
+    payload->mutable_location()->set_lat(55.75f + (i % 1000) * 1e-5f);
+    payload->mutable_location()->set_lon(37.61f + (i % 1000) * 1e-5f);
+    payload->mutable_location()->set_utc_time_ms((1700000000 + i) * 1000);
+    return packet;
+}
+
+/// Packets cycled by one benchmark thread
+std::vector<Packet> MakePackets(uint64_t first)
+{
+    std::vector<Packet> packets;
+    for (uint64_t i = 0; i < 1024; ++i)
+        packets.push_back(MakeTelemetry(first + i));
+    return packets;
+}
+
+/// Sink shared by the threads of one benchmark run
+std::unique_ptr<TelemetrySink> sink;
+std::vector<uint32_t>          files;
+
+void ReportLatency(benchmark::State& state, const metrics::Histogram& latency)
+{
+    const auto avg = benchmark::Counter::kAvgThreads;
+    state.counters["p50_ns"] = benchmark::Counter(latency.GetQuantile(0.5), avg);
+    state.counters["p99_ns"] = benchmark::Counter(latency.GetQuantile(0.99), avg);
+    state.counters["p999_ns"] = benchmark::Counter(latency.GetQuantile(0.999), avg);
+}
+
+void RunSink(benchmark::State& state, TelemetrySinkOptions::Backend backend)
+{
+    if (state.thread_index() == 0) {
+        TelemetrySinkOptions options;
+        options.backend = backend;
+        sink = std::make_unique<TelemetrySink>(options);
+        for (size_t i = 0; i < kFiles; ++i) {
+            std::filesystem::remove(GetPath(i));
+            files.push_back(sink->Open(GetPath(i)));
+        }
+    }
+    metrics::Histogram latency;
+    const auto         packets = MakePackets(static_cast<uint64_t>(state.thread_index()) << 32);
+    uint64_t           i = 0;
+    uint64_t           rnd = state.thread_index() + 1;
+    size_t             bytes = 0;
+    for (auto _ : state) {
+        const Packet &packet = packets[i++ % packets.size()];
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        const uint32_t file = files[(rnd >> 33) % kFiles];
+
+        const auto start = std::chrono::steady_clock::now();
+        // Under backpressure the record is dropped, as the ingest would
+        if (sink->WritePacket(file, packet))
+            bytes += packet.GetCachedSize() + 1;
+        latency.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                        .count());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    ReportLatency(state, latency);
+    if (state.thread_index() == 0) {
+        sink->Flush();
+        const auto stats = sink->GetStats();
+        state.counters["rejected"] = static_cast<double>(stats.rejected);
+        state.counters["writes"] = static_cast<double>(stats.submitted);
+        if (backend == TelemetrySinkOptions::Backend::AUTO &&
+            sink->GetBackend() != TelemetrySinkOptions::Backend::IO_URING)
+            state.SkipWithError("io_uring is not available");
+        sink.reset();
+        files.clear();
+    }
+}
+
+/// Descriptors shared by the threads of one BlockingWrite run
+std::vector<int> fds;
+
+}  // namespace
+
+// TelemetrySink on io_uring: buffers of all files go out in one submission
+static void BM_TelemetrySink_Uring(benchmark::State& state)
+{
+    RunSink(state, TelemetrySinkOptions::Backend::AUTO);
+}
+BENCHMARK(BM_TelemetrySink_Uring)->ThreadRange(1, 4)->UseRealTime();
+
+// TelemetrySink with pwrite from the background threads
+static void BM_TelemetrySink_ThreadPool(benchmark::State& state)
+{
+    RunSink(state, TelemetrySinkOptions::Backend::THREAD_POOL);
+}
+BENCHMARK(BM_TelemetrySink_ThreadPool)->ThreadRange(1, 4)->UseRealTime();
+
+// Baseline: every record is written with write() on the ingest thread
+static void BM_TelemetrySink_BlockingWrite(benchmark::State& state)
+{
+    if (state.thread_index() == 0) {
+        for (size_t i = 0; i < kFiles; ++i) {
+            std::filesystem::remove(GetPath(i));
+            fds.push_back(::open(GetPath(i).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644));
+        }
+    }
+    metrics::Histogram latency;
+    const auto         packets = MakePackets(static_cast<uint64_t>(state.thread_index()) << 32);
+    uint64_t           i = 0;
+    uint64_t           rnd = state.thread_index() + 1;
+    size_t             bytes = 0;
+    std::string        record;
+    for (auto _ : state) {
+        const Packet &packet = packets[i++ % packets.size()];
+        rnd = rnd * 6364136223846793005ULL + 1442695040888963407ULL;
+        const int fd = fds[(rnd >> 33) % kFiles];
+
+        const auto start = std::chrono::steady_clock::now();
+        record.clear();
+        google::protobuf::io::StringOutputStream stream(&record);
+        {
+            google::protobuf::io::CodedOutputStream output(&stream);
+            output.WriteVarint32(static_cast<uint32_t>(packet.ByteSizeLong()));
+            packet.SerializeWithCachedSizes(&output);
+        }
+        // O_APPEND keeps each record in one piece between threads
+        bytes += ::write(fd, record.data(), record.size());
+        latency.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                        .count());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    ReportLatency(state, latency);
+    if (state.thread_index() == 0) {
+        for (const int fd : fds)
+            ::close(fd);
+        fds.clear();
+    }
+}
+BENCHMARK(BM_TelemetrySink_BlockingWrite)->ThreadRange(1, 4)->UseRealTime();
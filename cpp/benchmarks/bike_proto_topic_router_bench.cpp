@@ -0,0 +1,121 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/device_topics.h"
+#include "iot_scale/cpp/src/topic_router.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Routing of inbound device topics: compiled TopicRouter against
+// splitting the topic into levels (what the Go services do with
+// strings.Split) and against the hand-written ParseDeviceTopic, which
+// knows the three device topic shapes and supports no wildcards. Topics come
+// from a fleet of 2^20 devices, 90% telemetry and 10% status, and are
+// visited in a scattered order.
+
+namespace {
+
+using namespace iot::backend::proto;
+
+const std::vector<std::string> &GetTopics()
+{
+    static const std::vector<std::string> kTopics = [] {
+        constexpr size_t kCount = 1 << 20;
+        std::vector<std::string> topics;
+        topics.reserve(kCount);
+        uint64_t state = 1;
+        for (size_t i = 0; i < kCount; ++i) {
+            // LCG: the order of devices is scattered over the fleet
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            const uint64_t imei = 860000000000000ULL + (state >> 33) % kCount;
+            const auto     kind = i % 10 == 0 ? DeviceTopicKind::STATUS : DeviceTopicKind::TELEMETRY;
+            topics.push_back(MakeDeviceTopic(std::to_string(imei), kind));
+        }
+        return topics;
+    }();
+    return kTopics;
+}
+
+}  // namespace
+
+static void BM_TopicRouter_Route(benchmark::State& state)
+{
+    const auto  router = TopicRouter::MakeDeviceTopicRouter();
+    const auto &topics = GetTopics();
+    size_t      index = 0;
+    for (auto _ : state) {
+        auto match = router.Route(topics[index]);
+        benchmark::DoNotOptimize(match);
+        index = (index + 1) & (topics.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouter_Route);
+
+// Router with wildcard fallbacks and per-device exact routes for 1000
+// devices: lookups go through binary search and backtracking
+static void BM_TopicRouter_RouteMixed(benchmark::State& state)
+{
+    std::vector<TopicRoute> routes = {
+        {"$devices/{device_id}/events/telemetry", 0},
+        {"$devices/{device_id}/events/status", 1},
+        {"$devices/{device_id}/#", 2},
+        {"#", 3},
+    };
+    for (uint64_t i = 0; i < 1000; ++i)
+        routes.push_back({MakeDeviceTopic(std::to_string(860000000000000ULL + i * 1000), DeviceTopicKind::TELEMETRY), 4});
+    const TopicRouter router(routes);
+
+    const auto &topics = GetTopics();
+    size_t      index = 0;
+    for (auto _ : state) {
+        auto match = router.Route(topics[index]);
+        benchmark::DoNotOptimize(match);
+        index = (index + 1) & (topics.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouter_RouteMixed);
+
+static void BM_TopicRouter_ParseDeviceTopic(benchmark::State& state)
+{
+    const auto &topics = GetTopics();
+    size_t      index = 0;
+    for (auto _ : state) {
+        auto topic = ParseDeviceTopic(topics[index]);
+        benchmark::DoNotOptimize(topic);
+        index = (index + 1) & (topics.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouter_ParseDeviceTopic);
+
+static void BM_TopicRouter_SplitLevels(benchmark::State& state)
+{
+    const auto &topics = GetTopics();
+    size_t      index = 0;
+    for (auto _ : state) {
+        const std::string_view topic = topics[index];
+        std::vector<std::string_view> levels;
+        for (size_t begin = 0; begin <= topic.size();) {
+            const size_t end = std::min(topic.find('/', begin), topic.size());
+            levels.push_back(topic.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        int handler = -1;
+        if (levels.size() == 4 && levels[0] == "$devices") {
+            if (levels[2] == "events" && levels[3] == "telemetry")
+                handler = 1;
+            else if (levels[2] == "events" && levels[3] == "status")
+                handler = 2;
+            else if (levels[2] == "commands" && levels[3] == "command")
+                handler = 0;
+        }
+        benchmark::DoNotOptimize(handler);
+        benchmark::DoNotOptimize(levels.data());
+        index = (index + 1) & (topics.size() - 1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TopicRouter_SplitLevels);
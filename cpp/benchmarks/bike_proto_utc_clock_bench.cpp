@@ -0,0 +1,37 @@
+#include <benchmark/benchmark.h>
+
+#include "iot_scale/cpp/src/helpers.h"
+#include "iot_scale/cpp/src/utc_clock.h"
+
+static void BM_UtcClock_System(benchmark::State& state)
+{
+    const iot::backend::proto::SystemUtcClock clock;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(clock.NowMs());
+    }
+}
+BENCHMARK(BM_UtcClock_System)->ThreadRange(1, 8);
+
+static void BM_UtcClock_Coarse(benchmark::State& state)
+{
+    static const iot::backend::proto::CoarseUtcClock clock;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(clock.NowMs());
+    }
+}
+BENCHMARK(BM_UtcClock_Coarse)->ThreadRange(1, 8);
+
+static void BM_UtcClock_MakePacket(benchmark::State& state)
+{
+    static const iot::backend::proto::CoarseUtcClock coarse;
+    const bool use_coarse = state.range(0) != 0;
+    if (use_coarse)
+        iot::backend::proto::SetDefaultClock(&coarse);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::helpers::MakePacket(std::chrono::seconds(300)));
+    }
+
+    iot::backend::proto::SetDefaultClock(nullptr);
+}
+BENCHMARK(BM_UtcClock_MakePacket)->ArgName("coarse")->Arg(0)->Arg(1);
@@ -0,0 +1,40 @@
+#include <benchmark/benchmark.h>
+
+#include "bike_proto_corpus.h"
+
+#include "iot_scale/cpp/src/packet_validator.h"
+
+static void BM_IsValid(benchmark::State& state)
+{
+    const auto& [name, packet] = iot::backend::proto::bench::GetCorpus()[state.range(0)];
+    if (!iot::backend::proto::IsValid(packet)) {
+        state.SkipWithError("Corpus packet is not valid");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::IsValid(packet));
+    }
+    state.SetLabel(name);
+}
+BENCHMARK(BM_IsValid)->Apply(iot::backend::proto::bench::CorpusArgs);
+
+static void BM_IsValid_Invalid(benchmark::State& state)
+{
+    // Packet without payload: validation ends with an exception inside IsValid
+    auto packet = iot::backend::proto::helpers::MakePacket();
+    packet.set_timestamp(1707425629);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::IsValid(packet));
+    }
+}
+BENCHMARK(BM_IsValid_Invalid);
+
+static void BM_IsExpired(benchmark::State& state)
+{
+    const auto packet = iot::backend::proto::bench::MakeSetParams();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(iot::backend::proto::IsExpired(packet));
+    }
+}
+BENCHMARK(BM_IsExpired);
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Compare two google-benchmark JSON reports and fail on slowdowns.
+
+Usage:
+    bike_proto_bench --benchmark_format=json --benchmark_out=baseline.json \
+        --benchmark_repetitions=5
+    ... change the code, rebuild ...
+    bike_proto_bench --benchmark_format=json --benchmark_out=current.json \
+        --benchmark_repetitions=5
+    compare_benchmarks.py baseline.json current.json --threshold 0.10
+
+With repetitions the median aggregate is compared, otherwise the single run.
+Exit code is 1 if any benchmark got slower than the threshold, 0 otherwise.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path, metric):
+    with open(path) as f:
+        report = json.load(f)
+
+    runs = {}
+    medians = {}
+    for bench in report.get('benchmarks', []):
+        if bench.get('error_occurred'):
+            continue
+        name = bench.get('run_name', bench['name'])
+        if bench.get('run_type') == 'aggregate':
+            if bench.get('aggregate_name') == 'median':
+                medians[name] = bench[metric]
+        else:
+            runs.setdefault(name, bench[metric])
+
+    runs.update(medians)
+    return runs
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('baseline')
+    parser.add_argument('current')
+    parser.add_argument('--threshold', type=float, default=0.10,
+                        help='allowed relative slowdown (default: 0.10)')
+    parser.add_argument('--metric', choices=['cpu_time', 'real_time'],
+                        default='cpu_time')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+
+    regressions = []
+    width = max((len(name) for name in current), default=10)
+    print('%-*s %14s %14s %9s' % (width, 'benchmark', 'baseline', 'current', 'change'))
+    for name, value in current.items():
+        if name not in baseline:
+            print('%-*s %14s %14.1f %9s' % (width, name, '-', value, 'new'))
+            continue
+        base = baseline[name]
+        change = (value - base) / base if base else 0.0
+        mark = ''
+        if change > args.threshold:
+            regressions.append(name)
+            mark = '  <-- slower'
+        print('%-*s %14.1f %14.1f %+8.1f%%%s' % (width, name, base, value, change * 100, mark))
+
+    for name in baseline:
+        if name not in current:
+            print('%-*s %14.1f %14s %9s' % (width, name, baseline[name], '-', 'removed'))
+
+    if regressions:
+        print('\n%d benchmark(s) slower than %.0f%%:' % (len(regressions), args.threshold * 100))
+        for name in regressions:
+            print('  ' + name)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,117 @@
+#include "iot_scale/cpp/src/hot_path_metrics.h"
+#include "iot_scale/cpp/src/traffic_replay.h"
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr char kUsage[] = R"(Replays a JSON lines traffic capture through ProtocolConverter.
+
+Usage: bike_proto_replay [options] <capture.jsonl>
+  --transport T        json | binary: format of the lines (default json)
+  --threads N          worker threads (default 1)
+  --speed X            0 - as fast as possible, 1 - real time, 10 - 10x faster (default 0)
+  --max-gap-ms N       compress pauses longer than N ms, 0 - keep (default 0)
+  --sink S             validate | count (default validate)
+  --metrics            enable hot path metrics and print them after the run
+)";
+
+void WritePercentiles(const iot::backend::proto::metrics::Histogram &histogram)
+{
+    std::cout << "p50 " << histogram.GetQuantile(0.5) << ", p99 " << histogram.GetQuantile(0.99)
+              << ", max " << histogram.GetQuantile(1) << '\n';
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    using namespace iot::backend::proto;
+
+    ReplayOptions options;
+    std::string   sink_name = "validate";
+    std::string   path;
+    bool          print_metrics = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                std::cout << kUsage;
+                return 0;
+            }
+            if (arg == "--metrics") {
+                print_metrics = true;
+                continue;
+            }
+            if (arg.rfind("--", 0) != 0) {
+                path = arg;
+                continue;
+            }
+            if (i + 1 == argc)
+                throw std::invalid_argument("Missing value for " + arg);
+            const std::string value = argv[++i];
+
+            if (arg == "--transport") {
+                if (value == "json")
+                    options.transport = ProtocolConverter::TransportDataType::JSON;
+                else if (value == "binary")
+                    options.transport = ProtocolConverter::TransportDataType::BINARY;
+                else
+                    throw std::invalid_argument("Unknown transport: " + value);
+            } else if (arg == "--threads") {
+                options.threads = std::stoul(value);
+            } else if (arg == "--speed") {
+                options.speed = std::stod(value);
+            } else if (arg == "--max-gap-ms") {
+                options.max_gap = std::chrono::milliseconds(std::stoull(value));
+            } else if (arg == "--sink") {
+                sink_name = value;
+            } else {
+                throw std::invalid_argument("Unknown option: " + arg);
+            }
+        }
+        if (path.empty())
+            throw std::invalid_argument("Capture file is not set");
+
+        ValidatingSink validating;
+        CountingSink   counting;
+        ReplaySink    *sink = nullptr;
+        if (sink_name == "validate")
+            sink = &validating;
+        else if (sink_name == "count")
+            sink = &counting;
+        else
+            throw std::invalid_argument("Unknown sink: " + sink_name);
+
+        metrics::SetEnabled(print_metrics);
+        const auto report = TrafficReplay(options).ReplayFile(path, *sink);
+
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "lines:      " << report.lines << " (errors " << report.errors << ")\n";
+        std::cout << "elapsed:    " << std::chrono::duration<double>(report.elapsed).count() << " s\n";
+        std::cout << "throughput: " << report.GetPacketsPerSecond() << " packets/s\n";
+        if (options.speed > 0) {
+            std::cout << "lag, ns:    ";
+            WritePercentiles(report.lag_ns);
+        }
+        if (sink == &validating) {
+            std::cout << "valid:      " << validating.GetValidCount() << ", invalid "
+                      << validating.GetInvalidCount() << '\n';
+        } else {
+            for (const auto what : {Packet::kCommand, Packet::kCommandResult, Packet::kTelemetry,
+                                    Packet::kRequest, Packet::kResponse, Packet::kNotification}) {
+                std::cout << std::setw(16) << std::left << std::string(metrics::ToString(what)) + ":"
+                          << counting.GetCount(what) << '\n';
+            }
+        }
+        if (print_metrics)
+            std::cout << '\n' << metrics::Collect().ToText();
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n\n" << kUsage;
+        return 1;
+    }
+}
@@ -0,0 +1,99 @@
+#include "iot_scale/cpp/src/fleet_simulator.h"
+#include "iot_scale/cpp/src/hot_path_metrics.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr char kUsage[] = R"(Fleet traffic simulator: synthesizes device traffic and drives it through
+ProtocolConverter and IsValid, then reports throughput and latency.
+
+Usage: bike_proto_simulator [options]
+  --devices N          simulated devices (default 100000)
+  --threads N          worker threads, devices are split between them (default 1)
+  --transport T        json | binary (default binary)
+  --period-ms N        telemetry period of a device in simulated time (default 10000)
+  --results R          share of CommandResult packets, 0..1 (default 0.05)
+  --rate N             total packets per second, 0 - as fast as possible (default 0)
+  --duration-s N       run time in seconds (default 10)
+  --packets N          stop after N packets, 0 - no limit (default 0)
+  --seed N             model seed (default 1)
+  --metrics            enable hot path metrics and print them after the run
+)";
+
+uint64_t ParseNumber(const char *name, const char *value)
+{
+    try {
+        size_t     pos = 0;
+        const auto result = std::stoull(value, &pos);
+        if (pos == std::strlen(value))
+            return result;
+    } catch (const std::exception &) {
+    }
+    throw std::invalid_argument(std::string("Bad value for ") + name + ": " + value);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    using namespace iot::backend::proto;
+
+    FleetSimulatorOptions options;
+    bool                  print_metrics = false;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--help" || arg == "-h") {
+                std::cout << kUsage;
+                return 0;
+            }
+            if (arg == "--metrics") {
+                print_metrics = true;
+                continue;
+            }
+            if (i + 1 == argc)
+                throw std::invalid_argument("Missing value for " + arg);
+            const char *value = argv[++i];
+
+            if (arg == "--devices") {
+                options.device_count = ParseNumber(arg.c_str(), value);
+            } else if (arg == "--threads") {
+                options.threads = ParseNumber(arg.c_str(), value);
+            } else if (arg == "--transport") {
+                if (std::strcmp(value, "json") == 0)
+                    options.transport = ProtocolConverter::TransportDataType::JSON;
+                else if (std::strcmp(value, "binary") == 0)
+                    options.transport = ProtocolConverter::TransportDataType::BINARY;
+                else
+                    throw std::invalid_argument(std::string("Unknown transport: ") + value);
+            } else if (arg == "--period-ms") {
+                options.telemetry_period = std::chrono::milliseconds(ParseNumber(arg.c_str(), value));
+            } else if (arg == "--results") {
+                options.command_result_ratio = std::stod(value);
+            } else if (arg == "--rate") {
+                options.packets_per_second = ParseNumber(arg.c_str(), value);
+            } else if (arg == "--duration-s") {
+                options.duration = std::chrono::seconds(ParseNumber(arg.c_str(), value));
+            } else if (arg == "--packets") {
+                options.packet_limit = ParseNumber(arg.c_str(), value);
+            } else if (arg == "--seed") {
+                options.seed = ParseNumber(arg.c_str(), value);
+            } else {
+                throw std::invalid_argument("Unknown option: " + arg);
+            }
+        }
+
+        metrics::SetEnabled(print_metrics);
+        const auto report = RunFleetSimulation(options);
+        std::cout << report.ToText();
+        if (print_metrics)
+            std::cout << '\n' << metrics::Collect().ToText();
+        return report.invalid == 0 ? 0 : 2;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n\n" << kUsage;
+        return 1;
+    }
+}
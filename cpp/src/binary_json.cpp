@@ -0,0 +1,503 @@
+#include "binary_json.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+using google::protobuf::Descriptor;
+using google::protobuf::FieldDescriptor;
+
+enum WireType : uint32_t {
+    VARINT = 0,
+    FIXED64 = 1,
+    LENGTH_DELIMITED = 2,
+    START_GROUP = 3,
+    END_GROUP = 4,
+    FIXED32 = 5,
+};
+
+[[noreturn]] void ThrowMalformed()
+{
+    throw std::invalid_argument("BinaryToJson: malformed binary message");
+}
+
+/// Пишет в буфер, пока хватает места, и считает размер
+class Writer {
+  public:
+    explicit Writer(std::span<char> out) : out_(out) {}
+
+    void Put(char c)
+    {
+        if (size_ < out_.size())
+            out_[size_] = c;
+        ++size_;
+    }
+
+    void Put(std::string_view text)
+    {
+        if (size_ + text.size() <= out_.size())
+            std::memcpy(out_.data() + size_, text.data(), text.size());
+        size_ += text.size();
+    }
+
+    template <class T>
+    void PutNumber(T value)
+    {
+        char       buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        Put(std::string_view(buffer, result.ptr - buffer));
+    }
+
+    [[nodiscard]] size_t Size() const { return size_; }
+
+  private:
+    std::span<char> out_;
+    size_t          size_ = 0;
+};
+
+class Reader {
+  public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    [[nodiscard]] bool AtEnd() const { return position_ == data_.size(); }
+
+    uint64_t Varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (AtEnd())
+                ThrowMalformed();
+            const auto byte = static_cast<uint8_t>(data_[position_++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        ThrowMalformed();
+    }
+
+    uint64_t Fixed(size_t size)
+    {
+        const auto bytes = Bytes(size);
+        uint64_t   value = 0;
+        for (size_t i = 0; i < size; ++i)
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+        return value;
+    }
+
+    std::string_view Bytes(uint64_t size)
+    {
+        if (size > data_.size() - position_)
+            ThrowMalformed();
+        const auto bytes = data_.substr(position_, size);
+        position_ += size;
+        return bytes;
+    }
+
+    std::string_view LengthDelimited() { return Bytes(Varint()); }
+
+    /// Тег следующего поля, 0 в конце данных
+    [[nodiscard]] uint64_t PeekTag() const
+    {
+        Reader copy = *this;
+        return copy.AtEnd() ? 0 : copy.Varint();
+    }
+
+    void Skip(uint64_t tag)
+    {
+        switch (tag & 7) {
+            case VARINT:
+                Varint();
+                break;
+            case FIXED64:
+                Bytes(8);
+                break;
+            case LENGTH_DELIMITED:
+                LengthDelimited();
+                break;
+            case START_GROUP:
+                for (uint64_t inner = Varint(); inner != ((tag & ~uint64_t{7}) | END_GROUP); inner = Varint())
+                    Skip(inner);
+                break;
+            case FIXED32:
+                Bytes(4);
+                break;
+            default:
+                ThrowMalformed();
+        }
+    }
+
+  private:
+    std::string_view data_;
+    size_t           position_ = 0;
+};
+
+// Как util/internal/json_escaping.cc: управляющие символы, кавычка,
+// обратная косая черта, < и > (для встраивания в HTML) и невидимые символы
+// Unicode пишутся как \uXXXX
+bool NeedsEscape(uint32_t cp)
+{
+    if (cp < 0x20 || cp == '"' || cp == '\\' || cp == '<' || cp == '>' || (cp >= 0x7F && cp < 0xA0))
+        return true;
+    return cp == 0xAD || (cp >= 0x600 && cp <= 0x603) || cp == 0x6DD || cp == 0x70F || cp == 0x17B4 ||
+           cp == 0x17B5 || (cp >= 0x200B && cp <= 0x200F) || (cp >= 0x2028 && cp <= 0x202E) ||
+           (cp >= 0x2060 && cp <= 0x2064) || (cp >= 0x206A && cp <= 0x206F) || cp == 0xFEFF ||
+           (cp >= 0xFFF9 && cp <= 0xFFFB) || (cp >= 0x1D173 && cp <= 0x1D17A) ||
+           cp == 0xE0001 || (cp >= 0xE0020 && cp <= 0xE007F);
+}
+
+void PutUnicodeEscape(uint32_t unit, Writer &writer)
+{
+    constexpr char kHex[] = "0123456789abcdef";
+    const char     escape[] = {'\\', 'u', kHex[(unit >> 12) & 0xF], kHex[(unit >> 8) & 0xF], kHex[(unit >> 4) & 0xF],
+                               kHex[unit & 0xF]};
+    writer.Put(std::string_view(escape, sizeof(escape)));
+}
+
+void PutEscaped(uint32_t cp, Writer &writer)
+{
+    switch (cp) {
+        case '\b':
+            return writer.Put("\\b");
+        case '\t':
+            return writer.Put("\\t");
+        case '\n':
+            return writer.Put("\\n");
+        case '\f':
+            return writer.Put("\\f");
+        case '\r':
+            return writer.Put("\\r");
+        case '"':
+            return writer.Put("\\\"");
+        case '\\':
+            return writer.Put("\\\\");
+    }
+    if (cp >= 0x10000) {
+        cp -= 0x10000;
+        PutUnicodeEscape(0xD800 + (cp >> 10), writer);
+        PutUnicodeEscape(0xDC00 + (cp & 0x3FF), writer);
+    } else {
+        PutUnicodeEscape(cp, writer);
+    }
+}
+
+/// Длина последовательности UTF-8 по первому байту, 0 - недопустимый байт
+size_t Utf8Length(uint8_t lead)
+{
+    if (lead < 0x80)
+        return 1;
+    if (lead < 0xC0)
+        return 0;
+    if (lead < 0xE0)
+        return 2;
+    if (lead < 0xF0)
+        return 3;
+    return lead < 0xF8 ? 4 : 0;
+}
+
+void PutString(std::string_view text, Writer &writer)
+{
+    // Недопустимые последовательности UTF-8 (вместе с байтом, на котором
+    // это обнаружилось) и незаконченная последовательность в конце
+    // пропускаются, как при выводе строк в MessageToJsonString
+    writer.Put('"');
+    size_t plain = 0;  // Начало байт, которые копируются как есть
+    size_t i = 0;
+    while (i < text.size()) {
+        const auto lead = static_cast<uint8_t>(text[i]);
+        if (lead >= 0x20 && lead < 0x7F && !NeedsEscape(lead)) {
+            ++i;
+            continue;
+        }
+        writer.Put(text.substr(plain, i - plain));
+
+        const size_t length = Utf8Length(lead);
+        uint32_t     cp = length == 1 ? lead : lead & (0x7F >> length);
+        size_t       read = 1;
+        bool         valid = length != 0;
+        while (valid && read < length && i + read < text.size()) {
+            const auto next = static_cast<uint8_t>(text[i + read++]);
+            cp = (cp << 6) | (next & 0x3F);
+            valid = (next & 0xC0) == 0x80;
+        }
+        // Суррогаты и значения за пределами Unicode тоже пропускаются
+        if (valid && read == length && (cp < 0xD800 || cp > 0xDFFF) && cp <= 0x10FFFF) {
+            if (NeedsEscape(cp))
+                PutEscaped(cp, writer);
+            else
+                writer.Put(text.substr(i, length));
+        }
+        i += read;
+        plain = i;
+    }
+    writer.Put(text.substr(plain, i - plain));
+    writer.Put('"');
+}
+
+void PutBase64(std::string_view data, Writer &writer)
+{
+    constexpr char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    writer.Put('"');
+    for (size_t i = 0; i < data.size(); i += 3) {
+        const size_t rest = std::min<size_t>(3, data.size() - i);
+        uint32_t     value = static_cast<uint8_t>(data[i]) << 16;
+        if (rest > 1)
+            value |= static_cast<uint8_t>(data[i + 1]) << 8;
+        if (rest > 2)
+            value |= static_cast<uint8_t>(data[i + 2]);
+        writer.Put(kAlphabet[value >> 18]);
+        writer.Put(kAlphabet[(value >> 12) & 0x3F]);
+        writer.Put(rest > 1 ? kAlphabet[(value >> 6) & 0x3F] : '=');
+        writer.Put(rest > 2 ? kAlphabet[value & 0x3F] : '=');
+    }
+    writer.Put('"');
+}
+
+// Как FloatAsString/DoubleAsString в protobuf: кратчайшее из FLT_DIG
+// (DBL_DIG) и FLT_DIG + 3 (DBL_DIG + 2) знаков, которое читается обратно
+// в то же значение. Не конечные значения пишутся строками.
+void PutFloating(double value, bool is_float, Writer &writer)
+{
+    if (std::isnan(value))
+        return writer.Put("\"NaN\"");
+    if (std::isinf(value))
+        return writer.Put(value > 0 ? "\"Infinity\"" : "\"-Infinity\"");
+
+    // to_chars с точностью форматирует как printf("%.*g")
+    char  buffer[32];
+    char *end = buffer;
+    if (is_float) {
+        const auto single = static_cast<float>(value);
+        float      parsed = 0;
+        end = std::to_chars(buffer, buffer + sizeof(buffer), single, std::chars_format::general, FLT_DIG).ptr;
+        std::from_chars(buffer, end, parsed);
+        if (parsed != single)
+            end = std::to_chars(buffer, buffer + sizeof(buffer), single, std::chars_format::general, FLT_DIG + 3).ptr;
+    } else {
+        double parsed = 0;
+        end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, DBL_DIG).ptr;
+        std::from_chars(buffer, end, parsed);
+        if (parsed != value)
+            end = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, DBL_DIG + 2).ptr;
+    }
+    writer.Put(std::string_view(buffer, end - buffer));
+}
+
+void PutMessage(const Descriptor &descriptor, std::string_view binary, Writer &writer);
+
+/// Значение поля. Ключи map всегда пишутся строками (quoted).
+void PutValue(const FieldDescriptor &field, uint64_t tag, Reader &reader, Writer &writer, bool quoted = false)
+{
+    const auto put_integer = [&](auto value, bool as_string) {
+        if (as_string || quoted)
+            writer.Put('"');
+        writer.PutNumber(value);
+        if (as_string || quoted)
+            writer.Put('"');
+    };
+    const auto expect = [&](uint32_t wire_type) {
+        if ((tag & 7) != wire_type)
+            ThrowMalformed();
+    };
+
+    switch (field.type()) {
+        case FieldDescriptor::TYPE_DOUBLE: {
+            expect(FIXED64);
+            const uint64_t bits = reader.Fixed(8);
+            double         value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return PutFloating(value, false, writer);
+        }
+        case FieldDescriptor::TYPE_FLOAT: {
+            expect(FIXED32);
+            const auto bits = static_cast<uint32_t>(reader.Fixed(4));
+            float      value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return PutFloating(value, true, writer);
+        }
+        case FieldDescriptor::TYPE_INT64:
+            expect(VARINT);
+            return put_integer(static_cast<int64_t>(reader.Varint()), true);
+        case FieldDescriptor::TYPE_UINT64:
+            expect(VARINT);
+            return put_integer(reader.Varint(), true);
+        case FieldDescriptor::TYPE_INT32:
+            expect(VARINT);
+            return put_integer(static_cast<int32_t>(reader.Varint()), false);
+        case FieldDescriptor::TYPE_FIXED64:
+            expect(FIXED64);
+            return put_integer(reader.Fixed(8), true);
+        case FieldDescriptor::TYPE_FIXED32:
+            expect(FIXED32);
+            return put_integer(static_cast<uint32_t>(reader.Fixed(4)), false);
+        case FieldDescriptor::TYPE_SFIXED64:
+            expect(FIXED64);
+            return put_integer(static_cast<int64_t>(reader.Fixed(8)), true);
+        case FieldDescriptor::TYPE_SFIXED32:
+            expect(FIXED32);
+            return put_integer(static_cast<int32_t>(reader.Fixed(4)), false);
+        case FieldDescriptor::TYPE_UINT32:
+            expect(VARINT);
+            return put_integer(static_cast<uint32_t>(reader.Varint()), false);
+        case FieldDescriptor::TYPE_SINT32: {
+            expect(VARINT);
+            const auto value = static_cast<uint32_t>(reader.Varint());
+            return put_integer(static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1)), false);
+        }
+        case FieldDescriptor::TYPE_SINT64: {
+            expect(VARINT);
+            const uint64_t value = reader.Varint();
+            return put_integer(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)), true);
+        }
+        case FieldDescriptor::TYPE_BOOL:
+            expect(VARINT);
+            return writer.Put(quoted ? (reader.Varint() ? "\"true\"" : "\"false\"")
+                                     : (reader.Varint() ? "true" : "false"));
+        case FieldDescriptor::TYPE_ENUM: {
+            expect(VARINT);
+            const auto value = static_cast<int32_t>(reader.Varint());
+            if (const auto *known = field.enum_type()->FindValueByNumber(value))
+                return PutString(known->name(), writer);
+            return put_integer(value, false);
+        }
+        case FieldDescriptor::TYPE_STRING:
+            expect(LENGTH_DELIMITED);
+            return PutString(reader.LengthDelimited(), writer);
+        case FieldDescriptor::TYPE_BYTES:
+            expect(LENGTH_DELIMITED);
+            return PutBase64(reader.LengthDelimited(), writer);
+        case FieldDescriptor::TYPE_MESSAGE:
+            expect(LENGTH_DELIMITED);
+            return PutMessage(*field.message_type(), reader.LengthDelimited(), writer);
+        case FieldDescriptor::TYPE_GROUP:
+            break;
+    }
+    ThrowMalformed();
+}
+
+/// Элемент map пишется, только если в нём есть значение; ключ по
+/// умолчанию, если его нет
+void PutMapEntry(const FieldDescriptor &field, std::string_view binary, bool &first, Writer &writer)
+{
+    const auto &key_field = *field.message_type()->map_key();
+    const auto &value_field = *field.message_type()->map_value();
+    Reader      reader(binary);
+    Reader      key(std::string_view{});
+    uint64_t    key_tag = 0;
+    while (!reader.AtEnd()) {
+        const uint64_t tag = reader.Varint();
+        if ((tag >> 3) == 1) {
+            key = reader;
+            key_tag = tag;
+            reader.Skip(tag);
+        } else if ((tag >> 3) == 2) {
+            if (!first)
+                writer.Put(',');
+            first = false;
+            if (key_tag != 0) {
+                PutValue(key_field, key_tag, key, writer, true);
+            } else if (key_field.type() == FieldDescriptor::TYPE_STRING) {
+                writer.Put("\"\"");
+            } else if (key_field.type() == FieldDescriptor::TYPE_BOOL) {
+                writer.Put("\"false\"");
+            } else {
+                writer.Put("\"0\"");
+            }
+            writer.Put(':');
+            PutValue(value_field, tag, reader, writer);
+        } else {
+            reader.Skip(tag);
+        }
+    }
+}
+
+/// Тип значения в упакованном (packed) повторяющемся поле
+uint32_t PackedWireType(const FieldDescriptor &field)
+{
+    switch (field.type()) {
+        case FieldDescriptor::TYPE_DOUBLE:
+        case FieldDescriptor::TYPE_FIXED64:
+        case FieldDescriptor::TYPE_SFIXED64:
+            return FIXED64;
+        case FieldDescriptor::TYPE_FLOAT:
+        case FieldDescriptor::TYPE_FIXED32:
+        case FieldDescriptor::TYPE_SFIXED32:
+            return FIXED32;
+        default:
+            return VARINT;
+    }
+}
+
+void PutRepeated(const FieldDescriptor &field, uint64_t tag, Reader &reader, Writer &writer)
+{
+    // Повторяющееся поле выводится одним массивом из идущих подряд значений
+    // с тем же тегом, map - одним объектом
+    writer.Put(field.is_map() ? '{' : '[');
+    bool first = true;
+    for (;;) {
+        if (field.is_map()) {
+            PutMapEntry(field, reader.LengthDelimited(), first, writer);
+        } else if ((tag & 7) == LENGTH_DELIMITED && field.is_packable()) {
+            Reader         packed(reader.LengthDelimited());
+            const uint64_t element_tag = (tag & ~uint64_t{7}) | PackedWireType(field);
+            while (!packed.AtEnd()) {
+                if (!first)
+                    writer.Put(',');
+                first = false;
+                PutValue(field, element_tag, packed, writer);
+            }
+        } else {
+            if (!first)
+                writer.Put(',');
+            first = false;
+            PutValue(field, tag, reader, writer);
+        }
+        if (reader.PeekTag() != tag)
+            break;
+        reader.Varint();
+    }
+    writer.Put(field.is_map() ? '}' : ']');
+}
+
+void PutMessage(const Descriptor &descriptor, std::string_view binary, Writer &writer)
+{
+    writer.Put('{');
+    Reader reader(binary);
+    bool   first = true;
+    while (!reader.AtEnd()) {
+        const uint64_t tag = reader.Varint();
+        const auto    *field = descriptor.FindFieldByNumber(static_cast<int>(tag >> 3));
+        if (!field) {
+            reader.Skip(tag);
+            continue;
+        }
+        if (!first)
+            writer.Put(',');
+        first = false;
+        PutString(field->json_name(), writer);
+        writer.Put(':');
+        if (field->is_repeated())
+            PutRepeated(*field, tag, reader, writer);
+        else
+            PutValue(*field, tag, reader, writer);
+    }
+    writer.Put('}');
+}
+
+}  // namespace
+
+size_t BinaryToJson(const Descriptor &descriptor, std::string_view binary, std::span<char> out)
+{
+    Writer writer(out);
+    PutMessage(descriptor, binary, writer);
+    return writer.Size();
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <google/protobuf/descriptor.h>
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace iot::backend::proto {
+
+/// Переводит бинарное представление сообщения descriptor в JSON, байт в
+/// байт как google::protobuf::util::MessageToJsonString с настройками по
+/// умолчанию (он сам сериализует сообщение и переводит бинарный вид), но
+/// без выделений памяти. Неизвестные поля пропускаются.
+///
+/// Возвращает размер JSON и пишет его в out, если он помещается; иначе
+/// содержимое out не определено (пустой out - только подсчёт размера).
+/// std::invalid_argument, если binary не разбирается.
+size_t BinaryToJson(const google::protobuf::Descriptor &descriptor, std::string_view binary, std::span<char> out);
+
+}  // namespace iot::backend::proto
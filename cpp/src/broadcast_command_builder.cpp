@@ -0,0 +1,315 @@
+#include "broadcast_command_builder.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "chain_id.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace iot::backend::proto {
+
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+
+constexpr uint8_t MakeTag(int field_number, WireFormatLite::WireType type)
+{
+    return static_cast<uint8_t>((field_number << 3) | type);
+}
+
+// Номера полей Packet и Command, см. packet.proto и command.proto
+constexpr uint8_t kVersionTag = MakeTag(Packet::kVersionFieldNumber, WireFormatLite::WIRETYPE_VARINT);
+constexpr uint8_t kTimestampTag = MakeTag(Packet::kTimestampFieldNumber, WireFormatLite::WIRETYPE_VARINT);
+constexpr uint8_t kValidUntilTag = MakeTag(Packet::kValidUntilFieldNumber, WireFormatLite::WIRETYPE_VARINT);
+constexpr uint8_t kCommandTag = MakeTag(Packet::kCommandFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+constexpr uint8_t kChainIdTag = MakeTag(Command::kChainIdFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+constexpr uint8_t kPayloadTag = MakeTag(Command::kPayloadFieldNumber, WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+size_t VarintSize(uint64_t value)
+{
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+char *WriteVarint(char *out, uint64_t value)
+{
+    while (value >= 0x80) {
+        *out++ = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+// Заголовок пакета без chain_id: три varint поля Packet и теги с длинами
+// command, chain_id и payload
+constexpr size_t kMaxFixedHeader = 6 * (1 + 10);
+// Заголовки с chain_id до этой длины собираются на стеке
+constexpr size_t kStackHeader = 256;
+// Меньше устройств на поток не окупает запуск потока
+constexpr size_t kMinDevicesPerThread = 4096;
+
+// Тот же алфавит и то же дополнение, что у helpers::ToBase64
+constexpr char kBase64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Размер data кратен 3: дополнение не нужно
+void AppendBase64(std::string &out, std::string_view data)
+{
+    const size_t offset = out.size();
+    out.resize(offset + data.size() / 3 * 4);
+    char *dst = out.data() + offset;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        const uint32_t value = static_cast<uint8_t>(data[i]) << 16 | static_cast<uint8_t>(data[i + 1]) << 8 |
+                               static_cast<uint8_t>(data[i + 2]);
+        *dst++ = kBase64Alphabet[value >> 18];
+        *dst++ = kBase64Alphabet[(value >> 12) & 63];
+        *dst++ = kBase64Alphabet[(value >> 6) & 63];
+        *dst++ = kBase64Alphabet[value & 63];
+    }
+}
+
+void AppendNumber(std::string &out, uint64_t value)
+{
+    char       buffer[20];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+// Символы, которые MessageToJsonString выводит без экранирования.
+// Для остальных chain_id идём медленным путём, чтобы не повторять
+// правила экранирования protobuf.
+bool IsJsonSafe(std::string_view value)
+{
+    for (const char c : value) {
+        const bool safe = (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+                          (c >= 'A' && c <= 'Z') || c == '-' || c == '_' ||
+                          c == '.' || c == ':';
+        if (!safe)
+            return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+BroadcastCommandBuilder::BroadcastCommandBuilder(
+    ProtocolConverter::TransportDataType type,
+    const CommandPayload                &payload,
+    std::optional<std::chrono::seconds>  valid_period_s,
+    uint32_t                             version)
+    : type_(type),
+      valid_period_s_(valid_period_s),
+      version_(version),
+      payload_(payload)
+{
+    if (type_ == ProtocolConverter::TransportDataType::BINARY) {
+        // Порядок элементов map в бинарном виде не определён, фиксируем его,
+        // чтобы все устройства получили одинаковые байты payload
+        {
+            google::protobuf::io::StringOutputStream stream(&encoded_payload_);
+            google::protobuf::io::CodedOutputStream  output(&stream);
+            output.SetSerializationDeterministic(true);
+            if (!payload_.SerializeToCodedStream(&output)) {
+                throw std::invalid_argument(
+                    "google::protobuf::Message.SerializeToCodedStream failed");
+            }
+        }
+        for (size_t skip = 0; skip < payload_base64_.size(); ++skip) {
+            payload_base64_[skip] = helpers::ToBase64(
+                std::string_view(encoded_payload_).substr(std::min(skip, encoded_payload_.size())));
+        }
+    } else {
+        encoded_payload_ = helpers::ProtoPacketToJson(payload_);
+    }
+}
+
+std::string BroadcastCommandBuilder::Build(std::string_view chain_id,
+                                           uint64_t         timestamp) const
+{
+    if (type_ == ProtocolConverter::TransportDataType::BINARY)
+        return BuildBinary(chain_id, timestamp);
+
+    if (!IsJsonSafe(chain_id))
+        return BuildSlow(chain_id, timestamp);
+    return BuildJson(chain_id, timestamp);
+}
+
+size_t BroadcastCommandBuilder::WriteHeader(char *out, std::string_view chain_id, uint64_t timestamp) const
+{
+    // Поля пишем в порядке номеров, как это делает SerializeToArray.
+    // Поля proto3 без optional со значением по умолчанию не сериализуются.
+    size_t command_size = 1 + VarintSize(encoded_payload_.size()) +
+                          encoded_payload_.size();
+    if (!chain_id.empty())
+        command_size += 1 + VarintSize(chain_id.size()) + chain_id.size();
+
+    char *const begin = out;
+    if (version_ != 0) {
+        *out++ = static_cast<char>(kVersionTag);
+        out = WriteVarint(out, version_);
+    }
+    if (timestamp != 0) {
+        *out++ = static_cast<char>(kTimestampTag);
+        out = WriteVarint(out, timestamp);
+    }
+    if (valid_period_s_) {
+        *out++ = static_cast<char>(kValidUntilTag);
+        out = WriteVarint(out, timestamp + valid_period_s_->count());
+    }
+
+    *out++ = static_cast<char>(kCommandTag);
+    out = WriteVarint(out, command_size);
+    if (!chain_id.empty()) {
+        *out++ = static_cast<char>(kChainIdTag);
+        out = WriteVarint(out, chain_id.size());
+        std::memcpy(out, chain_id.data(), chain_id.size());
+        out += chain_id.size();
+    }
+    *out++ = static_cast<char>(kPayloadTag);
+    out = WriteVarint(out, encoded_payload_.size());
+    return static_cast<size_t>(out - begin);
+}
+
+std::string BroadcastCommandBuilder::BuildBinary(std::string_view chain_id,
+                                                 uint64_t timestamp) const
+{
+    std::array<char, kStackHeader> stack;
+    std::string                    heap;
+    char                          *header = stack.data();
+    // +2 байта payload для выравнивания, см. ниже
+    if (kMaxFixedHeader + chain_id.size() + 2 > stack.size()) {
+        heap.resize(kMaxFixedHeader + chain_id.size() + 2);
+        header = heap.data();
+    }
+    size_t size = WriteHeader(header, chain_id, timestamp);
+
+    // base64 кодирует тройки байт: если дополнить заголовок первыми байтами
+    // payload до кратного трём размера, base64 остатка payload уже посчитан
+    // в конструкторе, и на устройство кодируется только заголовок
+    const size_t skip = std::min((3 - size % 3) % 3, encoded_payload_.size());
+    std::memcpy(header + size, encoded_payload_.data(), skip);
+    size += skip;
+    // Payload короче выравнивания: весь пакет уже в header
+    if (size % 3 != 0)
+        return helpers::ToBase64(std::string_view(header, size));
+
+    std::string out;
+    out.reserve(size / 3 * 4 + payload_base64_[skip].size());
+    AppendBase64(out, std::string_view(header, size));
+    out.append(payload_base64_[skip]);
+    return out;
+}
+
+std::string BroadcastCommandBuilder::BuildJson(std::string_view chain_id,
+                                               uint64_t         timestamp) const
+{
+    // Формат повторяет MessageToJsonString: поля в порядке номеров,
+    // uint64 в кавычках, lowerCamelCase имена, поля по умолчанию опущены.
+    std::string out;
+    out.reserve(96 + chain_id.size() + encoded_payload_.size());
+
+    out.push_back('{');
+    const auto append_separator = [&out]() {
+        if (out.size() > 1)
+            out.push_back(',');
+    };
+
+    if (version_ != 0) {
+        out.append("\"version\":");
+        AppendNumber(out, version_);
+    }
+    if (timestamp != 0) {
+        append_separator();
+        out.append("\"timestamp\":\"");
+        AppendNumber(out, timestamp);
+        out.push_back('"');
+    }
+    if (valid_period_s_) {
+        append_separator();
+        out.append("\"validUntil\":\"");
+        AppendNumber(out, timestamp + valid_period_s_->count());
+        out.push_back('"');
+    }
+
+    append_separator();
+    out.append("\"command\":{");
+    if (!chain_id.empty()) {
+        out.append("\"chainId\":\"");
+        out.append(chain_id);
+        out.append("\",");
+    }
+    out.append("\"payload\":");
+    out.append(encoded_payload_);
+    out.append("}}");
+    return out;
+}
+
+std::string BroadcastCommandBuilder::BuildSlow(std::string_view chain_id,
+                                               uint64_t         timestamp) const
+{
+    Packet packet;
+    packet.set_version(version_);
+    packet.set_timestamp(timestamp);
+    if (valid_period_s_)
+        packet.set_valid_until(timestamp + valid_period_s_->count());
+    auto *command = packet.mutable_command();
+    command->set_chain_id(std::string(chain_id));
+    *command->mutable_payload() = payload_;
+    return ProtocolConverter(type_).Serialize(packet);
+}
+
+std::vector<BroadcastCommandBuilder::Message>
+BroadcastCommandBuilder::BuildForFleet(const std::vector<std::string> &device_ids,
+                                       size_t threads) const
+{
+    const auto timestamp = helpers::GetCurrentUtcTimestamp();
+
+    std::vector<Message> result(device_ids.size());
+    const auto build_range = [&](size_t begin, size_t end) {
+        char chain_id[ChainId::kStringSize];
+        for (size_t i = begin; i < end; ++i) {
+            ChainId::Generate().FormatTo(chain_id);
+            result[i].chain_id.assign(chain_id, sizeof(chain_id));
+            result[i].data = Build(result[i].chain_id, timestamp);
+        }
+    };
+
+    // Потоков не больше ядер и не меньше kMinDevicesPerThread устройств на
+    // поток: иначе запуск потоков и их борьба за ядро дороже самой сборки
+    threads = std::min({threads, static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency())),
+                        device_ids.size() / kMinDevicesPerThread});
+    threads = std::max<size_t>(1, threads);
+    if (threads == 1) {
+        build_range(0, device_ids.size());
+        return result;
+    }
+
+    const size_t chunk = (device_ids.size() + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t begin = 0; begin < device_ids.size(); begin += chunk) {
+        workers.emplace_back(build_range, begin,
+                             std::min(begin + chunk, device_ids.size()));
+    }
+    for (auto &worker : workers)
+        worker.join();
+    return result;
+}
+
+ProtocolConverter::TransportDataType BroadcastCommandBuilder::GetType() const
+{
+    return type_;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "protocol_converter.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Сборка одной и той же команды для большого числа устройств.
+///
+/// Обычный путь helpers::MakeCommand + ProtocolConverter::Serialize на каждое
+/// устройство заново строит Packet и сериализует общий CommandPayload.
+/// Здесь payload сериализуется один раз в конструкторе, а на устройство
+/// в готовый шаблон подставляются только chain_id, timestamp и valid_until.
+/// Результат побайтово совпадает с обычным путём для того же пакета
+/// (с точностью до порядка элементов map в BINARY: у protobuf он не
+/// определён, здесь payload сериализуется детерминированно).
+class BroadcastCommandBuilder {
+  public:
+    struct Message {
+        std::string chain_id;
+        std::string data;  // Сериализованный пакет, готовый к публикации
+    };
+
+    BroadcastCommandBuilder(ProtocolConverter::TransportDataType type,
+                            const CommandPayload                &payload,
+                            std::optional<std::chrono::seconds>  valid_period_s,
+                            uint32_t version = 0x10000);
+
+    /// Сериализует пакет команды с заданными chain_id и timestamp.
+    /// valid_until = timestamp + valid_period_s, если срок задан.
+    [[nodiscard]] std::string Build(std::string_view chain_id,
+                                    uint64_t         timestamp) const;
+
+    /// Собирает по сообщению на устройство с новыми chain_id и общим текущим
+    /// timestamp. threads > 1 распределяет работу между потоками, если ядер
+    /// и устройств достаточно, чтобы это окупилось.
+    /// Порядок результата совпадает с порядком device_ids.
+    [[nodiscard]] std::vector<Message>
+    BuildForFleet(const std::vector<std::string> &device_ids,
+                  size_t                          threads = 1) const;
+
+    [[nodiscard]] ProtocolConverter::TransportDataType GetType() const;
+
+  private:
+    /// Пишет поля пакета до байтов payload; возвращает их размер
+    size_t      WriteHeader(char *out, std::string_view chain_id, uint64_t timestamp) const;
+    /// Пакет в base64
+    std::string BuildBinary(std::string_view chain_id, uint64_t timestamp) const;
+    std::string BuildJson(std::string_view chain_id, uint64_t timestamp) const;
+    std::string BuildSlow(std::string_view chain_id, uint64_t timestamp) const;
+
+    const ProtocolConverter::TransportDataType type_;
+    const std::optional<std::chrono::seconds>  valid_period_s_;
+    const uint32_t                             version_;
+    const CommandPayload                       payload_;
+
+    /// Заранее сериализованный CommandPayload (binary или json)
+    std::string encoded_payload_;
+    /// BINARY: base64 от encoded_payload_ без первых 0, 1 и 2 байт
+    std::array<std::string, 3> payload_base64_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,202 @@
+#include "chain_id.h"
+#include "utc_clock.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace iot::backend::proto {
+
+namespace {
+
+// xoshiro256**: быстрый PRNG некриптографического качества.
+// Уникальность UUID обеспечивают время и 62 случайных бита, а не стойкость
+// генератора, поэтому std::random_device нужен только для инициализации.
+class Xoshiro256 {
+  public:
+    Xoshiro256()
+    {
+        std::random_device device;
+        uint64_t           seed =
+            (static_cast<uint64_t>(device()) << 32) ^ device() ^
+            static_cast<uint64_t>(
+                std::chrono::steady_clock::now().time_since_epoch().count());
+        for (auto &value : state_)
+            value = SplitMix64(seed);
+    }
+
+    uint64_t operator()()
+    {
+        const uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+        const uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = Rotl(state_[3], 45);
+        return result;
+    }
+
+  private:
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t SplitMix64(uint64_t &x)
+    {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    uint64_t state_[4];
+};
+
+struct GeneratorState {
+    Xoshiro256 random;
+    uint64_t   last_ms = 0;
+    uint16_t   counter = 0;
+};
+
+constexpr uint16_t kCounterMask = 0x0FFF;
+
+int HexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// 16 байт -> 32 hex символа
+void ToHex(const uint8_t *bytes, char *out)
+{
+#if defined(__SSE2__)
+    const __m128i input =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), mask);
+    const __m128i low = _mm_and_si128(input, mask);
+
+    // Полубайты по порядку: старший, младший, старший, ...
+    const __m128i first = _mm_unpacklo_epi8(high, low);
+    const __m128i second = _mm_unpackhi_epi8(high, low);
+
+    // '0' + n для n < 10, 'a' + n - 10 иначе
+    const auto to_ascii = [](__m128i nibbles) {
+        const __m128i is_letter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+        const __m128i offset = _mm_add_epi8(
+            _mm_set1_epi8('0'),
+            _mm_and_si128(is_letter, _mm_set1_epi8('a' - '0' - 10)));
+        return _mm_add_epi8(nibbles, offset);
+    };
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), to_ascii(first));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), to_ascii(second));
+#else
+    static constexpr char kDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < ChainId::kSize; ++i) {
+        out[2 * i] = kDigits[bytes[i] >> 4];
+        out[2 * i + 1] = kDigits[bytes[i] & 0x0F];
+    }
+#endif
+}
+
+}  // namespace
+
+ChainId ChainId::Generate()
+{
+    thread_local GeneratorState state;
+
+    uint64_t now_ms = GetDefaultClock().NowMs();
+    if (now_ms > state.last_ms) {
+        state.last_ms = now_ms;
+        // Случайное начало со старшим битом 0 оставляет запас для инкрементов
+        state.counter = static_cast<uint16_t>(state.random() & (kCounterMask >> 1));
+    } else {
+        // Часы не сдвинулись (или пошли назад): продолжаем счётчик,
+        // при переполнении занимаем следующую миллисекунду
+        if (++state.counter > kCounterMask) {
+            ++state.last_ms;
+            state.counter = 0;
+        }
+        now_ms = state.last_ms;
+    }
+
+    const uint64_t random = state.random();
+
+    Bytes bytes;
+    for (int i = 0; i < 6; ++i)
+        bytes[i] = static_cast<uint8_t>(now_ms >> (40 - 8 * i));
+    bytes[6] = static_cast<uint8_t>(0x70 | (state.counter >> 8));
+    bytes[7] = static_cast<uint8_t>(state.counter);
+    for (int i = 0; i < 8; ++i)
+        bytes[8 + i] = static_cast<uint8_t>(random >> (56 - 8 * i));
+    bytes[8] = static_cast<uint8_t>(0x80 | (bytes[8] & 0x3F));  // variant 10
+
+    return ChainId(bytes);
+}
+
+std::optional<ChainId> ChainId::Parse(std::string_view text)
+{
+    const bool with_dashes = text.size() == kStringSize;
+    if (!with_dashes && text.size() != 2 * kSize)
+        return std::nullopt;
+
+    Bytes  bytes;
+    size_t pos = 0;
+    for (size_t i = 0; i < kSize; ++i) {
+        if (with_dashes && (pos == 8 || pos == 13 || pos == 18 || pos == 23)) {
+            if (text[pos] != '-')
+                return std::nullopt;
+            ++pos;
+        }
+        const int high = HexValue(text[pos]);
+        const int low = HexValue(text[pos + 1]);
+        if (high < 0 || low < 0)
+            return std::nullopt;
+        bytes[i] = static_cast<uint8_t>((high << 4) | low);
+        pos += 2;
+    }
+    return ChainId(bytes);
+}
+
+void ChainId::FormatTo(char *out) const
+{
+    char hex[2 * kSize];
+    ToHex(bytes_.data(), hex);
+
+    std::memcpy(out, hex, 8);
+    out[8] = '-';
+    std::memcpy(out + 9, hex + 8, 4);
+    out[13] = '-';
+    std::memcpy(out + 14, hex + 12, 4);
+    out[18] = '-';
+    std::memcpy(out + 19, hex + 16, 4);
+    out[23] = '-';
+    std::memcpy(out + 24, hex + 20, 12);
+}
+
+std::string ChainId::ToString() const
+{
+    std::string result(kStringSize, '\0');
+    FormatTo(result.data());
+    return result;
+}
+
+uint64_t ChainId::GetTimestampMs() const
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 6; ++i)
+        value = (value << 8) | bytes_[i];
+    return value;
+}
+
+}  // namespace iot::backend::proto
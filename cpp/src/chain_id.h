@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace iot::backend::proto {
+
+/// Бинарный идентификатор цепочки команд (UUID, 16 байт).
+///
+/// Generate() выдаёт UUIDv7 (RFC 9562): старшие 48 бит - unix время в мс,
+/// далее 12-битный счётчик внутри миллисекунды и 62 случайных бита.
+/// Поэтому идентификаторы одного потока строго возрастают, а
+/// идентификаторы разных потоков упорядочены по времени с точностью до мс -
+/// их удобно использовать как ключ в хранилище.
+///
+/// Текстовый вид - стандартный UUID в нижнем регистре, 36 символов.
+class ChainId {
+  public:
+    static constexpr size_t kSize = 16;
+    static constexpr size_t kStringSize = 36;
+
+    using Bytes = std::array<uint8_t, kSize>;
+
+    /// Нулевой (nil) идентификатор
+    constexpr ChainId() = default;
+    explicit constexpr ChainId(const Bytes &bytes) : bytes_(bytes) {}
+
+    /// Новый UUIDv7. Не блокируется, состояние генератора своё у каждого потока.
+    static ChainId Generate();
+
+    /// Разбирает UUID в виде xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx или
+    /// 32 hex символа без дефисов (регистр не важен).
+    static std::optional<ChainId> Parse(std::string_view text);
+
+    /// Пишет ровно kStringSize символов в out (без завершающего нуля)
+    void FormatTo(char *out) const;
+    [[nodiscard]] std::string ToString() const;
+
+    /// Время генерации для UUIDv7, мс с начала эпохи
+    [[nodiscard]] uint64_t GetTimestampMs() const;
+    [[nodiscard]] uint8_t  GetVersion() const { return bytes_[6] >> 4; }
+    [[nodiscard]] bool     IsNil() const { return *this == ChainId(); }
+
+    [[nodiscard]] const Bytes &GetBytes() const { return bytes_; }
+
+    constexpr auto operator<=>(const ChainId &) const = default;
+
+  private:
+    Bytes bytes_{};
+};
+
+}  // namespace iot::backend::proto
+
+template <>
+struct std::hash<iot::backend::proto::ChainId> {
+    size_t operator()(const iot::backend::proto::ChainId &id) const noexcept
+    {
+        // Младшие 8 байт UUIDv7 случайны, этого достаточно для хэша
+        const auto &bytes = id.GetBytes();
+        uint64_t    value = 0;
+        for (size_t i = 8; i < iot::backend::proto::ChainId::kSize; ++i)
+            value = (value << 8) | bytes[i];
+        return static_cast<size_t>(value ^ (value >> 29));
+    }
+};
@@ -0,0 +1,46 @@
+#include "checksum.h"
+
+#include <cstring>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+
+uint64_t Load64(const char *data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t Mix(uint64_t a, uint64_t b)
+{
+    const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+}  // namespace
+
+uint64_t Checksum64(const void *data, size_t size, uint64_t seed)
+{
+    const char *bytes = static_cast<const char *>(data);
+    // Четыре независимые цепочки по 16 байт перекрывают задержку умножения
+    uint64_t lanes[4] = {seed, seed ^ kMultiplier, seed + kMultiplier, ~seed};
+    size_t   offset = 0;
+    for (; offset + 64 <= size; offset += 64) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            const char *chunk = bytes + offset + lane * 16;
+            lanes[lane] = Mix(Load64(chunk) ^ lanes[lane], Load64(chunk + 8) ^ kMultiplier);
+        }
+    }
+    uint64_t hash = Mix(lanes[0] ^ lanes[1], lanes[2] ^ lanes[3] ^ kMultiplier);
+    for (; offset + 8 <= size; offset += 8)
+        hash = Mix(Load64(bytes + offset) ^ hash, kMultiplier);
+    uint64_t tail = 0;
+    std::memcpy(&tail, bytes + offset, size - offset);
+    return Mix(tail ^ hash, size ^ kMultiplier);
+}
+
+}  // namespace iot::backend::proto
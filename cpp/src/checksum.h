@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace iot::backend::proto {
+
+/// 64-битный хеш байтов, не зависящий от сборки и платформы (в отличие от
+/// std::hash): годится для контрольных сумм и индексов в файлах, которые
+/// читает другой процесс. Не криптографический, обрабатывает около 16 байт
+/// за такт.
+[[nodiscard]] uint64_t Checksum64(const void *data, size_t size, uint64_t seed = 0);
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,242 @@
+#include "command_coalescer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+std::optional<uint64_t> MinValidUntil(std::optional<uint64_t> lhs,
+                                      const Packet           &packet)
+{
+    if (!packet.has_valid_until())
+        return lhs;
+    if (!lhs)
+        return packet.valid_until();
+    return std::min(*lhs, packet.valid_until());
+}
+
+template <class Map>
+void KeepOnly(Map *map, const std::vector<std::string> &keys)
+{
+    for (auto it = map->begin(); it != map->end();) {
+        if (std::find(keys.begin(), keys.end(), it->first) == keys.end()) {
+            it = map->erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}  // namespace
+
+CommandCoalescer::CommandCoalescer(std::chrono::milliseconds window, std::chrono::seconds max_awaiting)
+    : window_ms_(static_cast<uint64_t>(window.count()))
+    , max_awaiting_s_(static_cast<uint64_t>(max_awaiting.count()))
+{
+}
+
+CommandCoalescer::Kind CommandCoalescer::GetKind(const Packet &packet)
+{
+    const auto &payload = packet.command().payload();
+    if (payload.has_set_params())
+        return Kind::SET_PARAMS;
+    if (payload.has_get_params())
+        return Kind::GET_PARAMS;
+    return Kind::OTHER;
+}
+
+std::string CommandCoalescer::MakeKey(std::string_view device_id, Kind kind)
+{
+    std::string key(device_id);
+    key.push_back('\0');
+    key.push_back(kind == Kind::SET_PARAMS ? 's' : 'g');
+    return key;
+}
+
+void CommandCoalescer::Add(std::string_view device_id,
+                           Packet           packet,
+                           uint64_t         now_ms)
+{
+    if (!packet.has_command()) {
+        throw std::invalid_argument(
+            "CommandCoalescer accepts only packets with Command inside");
+    }
+
+    // Сохраняем порядок команд устройства: команда другого вида сначала
+    // выталкивает накопленное, чтобы, например, GetParams не обогнал SetParams
+    const auto kind = GetKind(packet);
+    for (const auto other : {Kind::SET_PARAMS, Kind::GET_PARAMS}) {
+        if (other == kind)
+            continue;
+        const auto it = pending_.find(MakeKey(device_id, other));
+        if (it != pending_.end()) {
+            passthrough_.push_back(Build(std::move(it->second)));
+            pending_.erase(it);
+        }
+    }
+
+    if (kind == Kind::OTHER) {
+        std::vector<std::string> chain_ids{packet.command().chain_id()};
+        passthrough_.push_back(OutgoingCommand{
+            std::string(device_id), std::move(packet), std::move(chain_ids)});
+        return;
+    }
+
+    auto [it, inserted] = pending_.try_emplace(MakeKey(device_id, kind));
+    Pending &pending = it->second;
+    if (inserted) {
+        pending.device_id = std::string(device_id);
+        pending.kind = kind;
+        pending.opened_ms = now_ms;
+    }
+
+    Source source{packet.command().chain_id(), {}};
+    const auto &payload = packet.command().payload();
+    if (kind == Kind::SET_PARAMS) {
+        for (const auto &[name, value] : payload.set_params().params()) {
+            (*pending.set_params.mutable_params())[name] = value;
+            source.params.push_back(name);
+        }
+    } else {
+        for (const auto &name : payload.get_params().param()) {
+            const auto &merged = pending.get_params.param();
+            if (std::find(merged.begin(), merged.end(), name) == merged.end())
+                pending.get_params.add_param(name);
+            source.params.push_back(name);
+        }
+    }
+
+    pending.valid_until = MinValidUntil(pending.valid_until, packet);
+    pending.sources.push_back(std::move(source));
+    if (inserted)
+        pending.first = std::move(packet);
+}
+
+CommandCoalescer::OutgoingCommand CommandCoalescer::Build(Pending &&pending)
+{
+    OutgoingCommand result;
+    result.device_id = std::move(pending.device_id);
+    for (const auto &source : pending.sources)
+        result.source_chain_ids.push_back(source.chain_id);
+
+    // Одиночную команду отправляем без изменений, под исходным chain_id
+    if (pending.sources.size() == 1) {
+        result.packet = std::move(pending.first);
+        return result;
+    }
+
+    const auto chain_id = helpers::GenerateChainId();
+    result.packet = helpers::MakeCommand(std::nullopt, chain_id);
+    result.packet.set_version(pending.first.version());
+    if (pending.valid_until)
+        result.packet.set_valid_until(*pending.valid_until);
+
+    auto *payload = result.packet.mutable_command()->mutable_payload();
+    if (pending.kind == Kind::SET_PARAMS) {
+        payload->mutable_set_params()->Swap(&pending.set_params);
+    } else {
+        payload->mutable_get_params()->Swap(&pending.get_params);
+    }
+
+    awaiting_[chain_id] = Awaiting{result.device_id, std::move(pending.sources), pending.valid_until,
+                                   pending.opened_ms / 1000};
+    return result;
+}
+
+std::vector<CommandCoalescer::OutgoingCommand>
+CommandCoalescer::Flush(uint64_t now_ms)
+{
+    std::vector<OutgoingCommand> result = std::move(passthrough_);
+    passthrough_.clear();
+
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (now_ms >= it->second.opened_ms + window_ms_) {
+            result.push_back(Build(std::move(it->second)));
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return result;
+}
+
+std::vector<CommandCoalescer::OutgoingCommand> CommandCoalescer::FlushAll()
+{
+    std::vector<OutgoingCommand> result = std::move(passthrough_);
+    passthrough_.clear();
+
+    for (auto &[key, pending] : pending_)
+        result.push_back(Build(std::move(pending)));
+    pending_.clear();
+    return result;
+}
+
+std::vector<Packet> CommandCoalescer::FanOut(const Packet &command_result)
+{
+    if (!command_result.has_command_result())
+        throw std::invalid_argument("Packet has no CommandResult inside");
+
+    const auto it = awaiting_.find(command_result.command_result().chain_id());
+    if (it == awaiting_.end())
+        return {command_result};
+
+    std::vector<Packet> result;
+    result.reserve(it->second.sources.size());
+    for (const auto &source : it->second.sources) {
+        Packet &packet = result.emplace_back(command_result);
+        auto   *cmd_result = packet.mutable_command_result();
+        cmd_result->set_chain_id(source.chain_id);
+
+        if (!cmd_result->has_payload())
+            continue;
+        auto *payload = cmd_result->mutable_payload();
+        if (payload->has_get_params()) {
+            KeepOnly(payload->mutable_get_params()->mutable_values(),
+                     source.params);
+            KeepOnly(payload->mutable_get_params()->mutable_errors(),
+                     source.params);
+        } else if (payload->has_set_params()) {
+            KeepOnly(payload->mutable_set_params()->mutable_errors(),
+                     source.params);
+        }
+    }
+
+    awaiting_.erase(it);
+    return result;
+}
+
+void CommandCoalescer::DropExpired(uint64_t now_s)
+{
+    for (auto it = awaiting_.begin(); it != awaiting_.end();) {
+        const auto &awaiting = it->second;
+        const bool  expired = awaiting.valid_until ? *awaiting.valid_until < now_s
+                                                   : awaiting.opened_s + max_awaiting_s_ < now_s;
+        if (expired) {
+            it = awaiting_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CommandCoalescer::Forget(std::string_view device_id)
+{
+    std::erase_if(awaiting_, [device_id](const auto &item) { return item.second.device_id == device_id; });
+}
+
+size_t CommandCoalescer::PendingCount() const
+{
+    size_t count = passthrough_.size();
+    for (const auto &[key, pending] : pending_)
+        count += pending.sources.size();
+    return count;
+}
+
+size_t CommandCoalescer::AwaitingResultCount() const
+{
+    return awaiting_.size();
+}
+
+}  // namespace iot::backend::proto
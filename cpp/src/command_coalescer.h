@@ -0,0 +1,112 @@
+#pragma once
+
+#include "helpers.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Склеивает команды CmdSetParams/CmdGetParams, отправленные одному
+/// устройству в пределах короткого окна, в одну команду:
+/// - CmdSetParams::params объединяются, при совпадении ключей побеждает
+///   последняя запись;
+/// - CmdGetParams::param объединяются без повторов.
+/// Остальные команды проходят как есть. Команда другого вида выталкивает
+/// накопленное для устройства, так что порядок команд устройства сохраняется.
+/// Единственный CommandResult на склеенную команду раздаётся обратно на
+/// chain_id всех исходных команд через FanOut().
+///
+/// Класс не потокобезопасный: предполагается один экземпляр на поток отправки.
+class CommandCoalescer {
+  public:
+    /// Команда, готовая к сериализации и отправке на устройство
+    struct OutgoingCommand {
+        std::string device_id;
+        Packet      packet;
+        /// chain_id исходных команд, вошедших в packet (в порядке поступления)
+        std::vector<std::string> source_chain_ids;
+    };
+
+    /// Склеенная команда без valid_until забывается через max_awaiting после
+    /// открытия окна, если результата так и не было (см. DropExpired)
+    explicit CommandCoalescer(std::chrono::milliseconds window,
+                              std::chrono::seconds      max_awaiting = std::chrono::hours(1));
+
+    /// Ставит команду в очередь. Пакет обязан содержать Command, иначе
+    /// бросается std::invalid_argument.
+    void Add(std::string_view device_id,
+             Packet           packet,
+             uint64_t         now_ms = helpers::GetCurrentUtcTimestampMs());
+
+    /// Возвращает команды, окно склейки которых истекло к моменту now_ms.
+    [[nodiscard]] std::vector<OutgoingCommand>
+    Flush(uint64_t now_ms = helpers::GetCurrentUtcTimestampMs());
+
+    /// Возвращает все накопленные команды независимо от окна.
+    [[nodiscard]] std::vector<OutgoingCommand> FlushAll();
+
+    /// Раздаёт результат склеенной команды на chain_id исходных команд.
+    /// Для CmdResultGetParams/CmdResultSetParams каждый получатель видит только
+    /// свои параметры. Если chain_id результата не относится к склеенной
+    /// команде, возвращается сам результат без изменений.
+    [[nodiscard]] std::vector<Packet> FanOut(const Packet &command_result);
+
+    /// Забывает склеенные команды, срок жизни которых (valid_until) истёк
+    /// к моменту now_s: результата по ним уже не будет. Команды без
+    /// valid_until забываются через max_awaiting.
+    void DropExpired(uint64_t now_s = helpers::GetCurrentUtcTimestamp());
+
+    /// Забывает склеенные команды устройства, ожидающие результата
+    /// (например, устройство удалено или ушло из сети)
+    void Forget(std::string_view device_id);
+
+    [[nodiscard]] size_t PendingCount() const;
+    [[nodiscard]] size_t AwaitingResultCount() const;
+
+  private:
+    enum class Kind { SET_PARAMS, GET_PARAMS, OTHER };
+
+    struct Source {
+        std::string              chain_id;
+        std::vector<std::string> params;
+    };
+
+    struct Pending {
+        std::string         device_id;
+        Kind                kind = Kind::OTHER;
+        uint64_t            opened_ms = 0;
+        Packet              first;
+        std::vector<Source> sources;
+        CmdSetParams        set_params;
+        CmdGetParams        get_params;
+        std::optional<uint64_t> valid_until;
+    };
+
+    struct Awaiting {
+        std::string             device_id;
+        std::vector<Source>     sources;
+        std::optional<uint64_t> valid_until;
+        /// Открытие окна склейки, секунды
+        uint64_t                opened_s = 0;
+    };
+
+    static Kind GetKind(const Packet &packet);
+    static std::string MakeKey(std::string_view device_id, Kind kind);
+
+    OutgoingCommand Build(Pending &&pending);
+
+    const uint64_t                            window_ms_;
+    const uint64_t                            max_awaiting_s_;
+    std::unordered_map<std::string, Pending>  pending_;
+    std::unordered_map<std::string, Awaiting> awaiting_;
+    /// Команды, которые не склеиваются, отдаются при ближайшем Flush
+    std::vector<OutgoingCommand> passthrough_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,385 @@
+#include "command_wal.h"
+
+#include "checksum.h"
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr char     kCommandRecord = 'C';
+constexpr char     kAcknowledgeRecord = 'A';
+constexpr uint64_t kRecordSeed = 0x57414C5245434F52ULL;
+constexpr char     kSegmentPrefix[] = "commands-";
+constexpr char     kSegmentSuffix[] = ".wal";
+
+using google::protobuf::io::CodedOutputStream;
+
+[[noreturn]] void ThrowError(const char *action, const std::string &path)
+{
+    throw std::runtime_error(std::string(action) + " failed for " + path + ": " + std::strerror(errno));
+}
+
+uint32_t ChecksumRecord(std::string_view body)
+{
+    return static_cast<uint32_t>(Checksum64(body.data(), body.size(), kRecordSeed));
+}
+
+/// Varint из data начиная с offset; nullopt, если он оборван
+std::optional<uint32_t> ReadVarint(std::string_view data, size_t &offset)
+{
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && offset < data.size(); shift += 7) {
+        const auto byte = static_cast<uint8_t>(data[offset++]);
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    return std::nullopt;
+}
+
+/// Тело следующей записи; nullopt для оборванной или испорченной записи
+std::optional<std::string_view> ReadRecord(std::string_view data, size_t &offset)
+{
+    const auto size = ReadVarint(data, offset);
+    if (!size || data.size() - offset < sizeof(uint32_t) + *size)
+        return std::nullopt;
+    uint32_t checksum;
+    std::memcpy(&checksum, data.data() + offset, sizeof(checksum));
+    const std::string_view body = data.substr(offset + sizeof(checksum), *size);
+    if (body.empty() || checksum != ChecksumRecord(body))
+        return std::nullopt;
+    offset += sizeof(checksum) + *size;
+    return body;
+}
+
+/// Номер сегмента по имени файла или nullopt для чужого файла
+std::optional<uint64_t> ParseSegmentName(const std::string &name)
+{
+    const size_t prefix = sizeof(kSegmentPrefix) - 1;
+    const size_t suffix = sizeof(kSegmentSuffix) - 1;
+    if (name.size() <= prefix + suffix || name.compare(0, prefix, kSegmentPrefix) != 0 ||
+        name.compare(name.size() - suffix, suffix, kSegmentSuffix) != 0)
+        return std::nullopt;
+    uint64_t number = 0;
+    for (size_t i = prefix; i < name.size() - suffix; ++i) {
+        if (name[i] < '0' || name[i] > '9')
+            return std::nullopt;
+        number = number * 10 + (name[i] - '0');
+    }
+    return number;
+}
+
+void SyncDirectory(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        ThrowError("open", path);
+    const int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0)
+        ThrowError("fsync", path);
+}
+
+}  // namespace
+
+CommandWal::CommandWal(CommandWalOptions options) : options_(std::move(options))
+{
+    std::filesystem::create_directories(options_.directory);
+    Recover();
+    const uint64_t number = segments_.empty() ? 1 : segments_.back().number + 1;
+    segments_.push_back({number});
+    OpenSegment(number);
+    // Сегменты, в которых после чтения не осталось команд
+    while (segments_.size() > 1 && segments_.front().pending == 0) {
+        std::filesystem::remove(GetSegmentPath(segments_.front().number));
+        segments_.pop_front();
+    }
+}
+
+CommandWal::~CommandWal()
+{
+    // Подтверждения, ещё лежащие в буфере
+    try {
+        std::unique_lock lock(mutex_);
+        if (!failed_)
+            WaitDurable(lock, buffered_sequence_);
+    } catch (const std::exception &) {
+        // Потерянные подтверждения дадут только повторную отправку
+    }
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+std::string CommandWal::GetSegmentPath(uint64_t number) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%020llu%s", kSegmentPrefix, static_cast<unsigned long long>(number),
+                  kSegmentSuffix);
+    return options_.directory + "/" + name;
+}
+
+void CommandWal::Recover()
+{
+    std::vector<uint64_t> numbers;
+    for (const auto &file : std::filesystem::directory_iterator(options_.directory)) {
+        if (const auto number = ParseSegmentName(file.path().filename().string()))
+            numbers.push_back(*number);
+    }
+    std::sort(numbers.begin(), numbers.end());
+
+    for (const uint64_t number : numbers) {
+        segments_.push_back({number});
+        const MappedFile       file(GetSegmentPath(number), MappedFile::Access::SEQUENTIAL);
+        const std::string_view data = file.GetData();
+        size_t                 offset = 0;
+        // Чтение сегмента останавливается на первой неполной записи: дальше
+        // в нём ничего не было записано целиком
+        while (const auto body = ReadRecord(data, offset)) {
+            if ((*body)[0] == kAcknowledgeRecord) {
+                if (const auto it = pending_.find(body->substr(1)); it != pending_.end()) {
+                    Release(it->second);
+                    pending_.erase(it);
+                }
+                continue;
+            }
+            size_t     position = 1;
+            const auto id_size = ReadVarint(*body, position);
+            if ((*body)[0] != kCommandRecord || !id_size || body->size() - position < *id_size)
+                continue;
+            Recovered recovered{number, {std::string(body->substr(position, *id_size)), Packet()}};
+            const std::string_view packet = body->substr(position + *id_size);
+            if (!recovered.command.packet.ParseFromArray(packet.data(), static_cast<int>(packet.size())))
+                continue;
+            const Packet &parsed = recovered.command.packet;
+            if (!parsed.has_command() || parsed.command().chain_id().empty())
+                continue;
+            const Entry entry{number, parsed.has_valid_until() ? parsed.valid_until() : 0};
+            auto [it, inserted] = pending_.try_emplace(parsed.command().chain_id(), entry);
+            if (!inserted) {
+                Release(it->second);
+                it->second = entry;
+            }
+            ++segments_.back().pending;
+            recovered_.push_back(std::move(recovered));
+        }
+    }
+}
+
+void CommandWal::OpenSegment(uint64_t number)
+{
+    if (fd_ >= 0) {
+        if (options_.sync && ::fdatasync(fd_) != 0)
+            ThrowError("fdatasync", GetSegmentPath(file_segment_));
+        ::close(std::exchange(fd_, -1));
+    }
+    const std::string path = GetSegmentPath(number);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        ThrowError("open", path);
+    file_segment_ = number;
+    // Новый файл переживёт падение машины, только если на диске и запись
+    // каталога
+    if (options_.sync)
+        SyncDirectory(options_.directory);
+}
+
+void CommandWal::AppendRecord(char type, std::string_view body)
+{
+    if (segment_size_ >= options_.segment_bytes) {
+        segments_.push_back({segments_.back().number + 1});
+        segment_size_ = 0;
+    }
+    if (batches_.empty() || batches_.back().segment != segments_.back().number)
+        batches_.push_back({segments_.back().number, {}});
+
+    std::string   &data = batches_.back().data;
+    const auto     size = static_cast<uint32_t>(body.size() + 1);
+    const size_t   start = data.size();
+    data.resize(start + CodedOutputStream::VarintSize32(size) + sizeof(uint32_t));
+    auto *end = CodedOutputStream::WriteVarint32ToArray(size, reinterpret_cast<uint8_t *>(data.data() + start));
+    const size_t checksum_offset = reinterpret_cast<char *>(end) - data.data();
+    data.push_back(type);
+    data.append(body);
+    const uint32_t checksum = ChecksumRecord(std::string_view(data).substr(checksum_offset + sizeof(uint32_t)));
+    std::memcpy(data.data() + checksum_offset, &checksum, sizeof(checksum));
+
+    segment_size_ += data.size() - start;
+    ++buffered_sequence_;
+}
+
+void CommandWal::WaitDurable(std::unique_lock<std::mutex> &lock, uint64_t sequence)
+{
+    while (durable_sequence_ < sequence) {
+        if (failed_)
+            throw std::runtime_error("Command WAL is unusable after an I/O error");
+        if (syncing_) {
+            synced_.wait(lock);
+            continue;
+        }
+
+        // Этот поток пишет всё накопленное, включая записи других потоков
+        syncing_ = true;
+        std::vector<Batch> batches;
+        batches.swap(batches_);
+        const uint64_t target = buffered_sequence_;
+        lock.unlock();
+        try {
+            for (const Batch &batch : batches) {
+                if (batch.segment != file_segment_)
+                    OpenSegment(batch.segment);
+                const char *data = batch.data.data();
+                size_t      size = batch.data.size();
+                while (size > 0) {
+                    const ssize_t written = ::write(fd_, data, size);
+                    if (written < 0) {
+                        if (errno == EINTR)
+                            continue;
+                        ThrowError("write", GetSegmentPath(file_segment_));
+                    }
+                    data += written;
+                    size -= static_cast<size_t>(written);
+                }
+            }
+            if (options_.sync && ::fdatasync(fd_) != 0)
+                ThrowError("fdatasync", GetSegmentPath(file_segment_));
+        } catch (...) {
+            lock.lock();
+            syncing_ = false;
+            failed_ = true;
+            synced_.notify_all();
+            throw;
+        }
+        lock.lock();
+        syncing_ = false;
+        durable_sequence_ = target;
+        sync_count_ += options_.sync;
+        synced_.notify_all();
+    }
+}
+
+void CommandWal::Append(std::string_view device_id, const Packet &packet)
+{
+    if (!packet.has_command() || packet.command().chain_id().empty())
+        throw std::invalid_argument("WAL record must contain a command with chain_id");
+
+    // Сериализация - вне блокировки
+    std::string body;
+    uint8_t     varint[5];
+    const auto *end = CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(device_id.size()), varint);
+    body.append(reinterpret_cast<const char *>(varint), end - varint);
+    body.append(device_id);
+    if (!packet.AppendToString(&body))
+        throw std::invalid_argument("google::protobuf::Message.AppendToString failed");
+
+    std::unique_lock lock(mutex_);
+    if (failed_)
+        throw std::runtime_error("Command WAL is unusable after an I/O error");
+    AppendRecord(kCommandRecord, body);
+    const Entry entry{segments_.back().number, packet.has_valid_until() ? packet.valid_until() : 0};
+    auto [it, inserted] = pending_.try_emplace(packet.command().chain_id(), entry);
+    if (!inserted) {
+        Release(it->second);
+        it->second = entry;
+    }
+    ++segments_.back().pending;
+    WaitDurable(lock, buffered_sequence_);
+}
+
+bool CommandWal::Acknowledge(std::string_view chain_id)
+{
+    std::lock_guard lock(mutex_);
+    const auto      it = pending_.find(chain_id);
+    if (it == pending_.end())
+        return false;
+    Release(it->second);
+    pending_.erase(it);
+    if (!failed_)
+        AppendRecord(kAcknowledgeRecord, chain_id);
+    return true;
+}
+
+void CommandWal::DropExpired(uint64_t now_s)
+{
+    std::lock_guard lock(mutex_);
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (it->second.valid_until != 0 && it->second.valid_until < now_s) {
+            Release(it->second);
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::vector<PendingCommand> CommandWal::TakeRecovered(uint64_t now_s)
+{
+    std::lock_guard                 lock(mutex_);
+    std::vector<PendingCommand>     commands;
+    std::unordered_set<std::string> taken;
+    for (auto &recovered : recovered_) {
+        const std::string chain_id = recovered.command.packet.command().chain_id();
+        const auto         it = pending_.find(chain_id);
+        // Подтверждена, перезаписана более поздней записью или уже отдана
+        if (it == pending_.end() || it->second.segment != recovered.segment || !taken.insert(chain_id).second)
+            continue;
+        if (it->second.valid_until != 0 && it->second.valid_until < now_s) {
+            Release(it->second);
+            pending_.erase(it);
+            continue;
+        }
+        commands.push_back(std::move(recovered.command));
+    }
+    recovered_.clear();
+    return commands;
+}
+
+void CommandWal::Release(const Entry &entry)
+{
+    for (auto &segment : segments_) {
+        if (segment.number == entry.segment) {
+            --segment.pending;
+            break;
+        }
+    }
+    // Текущий сегмент не удаляется, даже если в нём нет команд
+    while (segments_.size() > 1 && segments_.front().pending == 0) {
+        std::error_code error;
+        std::filesystem::remove(GetSegmentPath(segments_.front().number), error);
+        segments_.pop_front();
+    }
+}
+
+size_t CommandWal::GetPendingCount() const
+{
+    std::lock_guard lock(mutex_);
+    return pending_.size();
+}
+
+size_t CommandWal::GetSegmentCount() const
+{
+    std::lock_guard lock(mutex_);
+    return segments_.size();
+}
+
+uint64_t CommandWal::GetSyncCount() const
+{
+    std::lock_guard lock(mutex_);
+    return sync_count_;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "command_result.pb.h"
+#include "packet.pb.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct CommandWalOptions {
+    /// Каталог сегментов; создаётся, если его нет
+    std::string directory;
+    /// Размер, после которого следующая запись открывает новый сегмент
+    size_t      segment_bytes = 64 << 20;
+    /// false - без fdatasync: записи переживают падение процесса, но не
+    /// машины
+    bool        sync = true;
+};
+
+/// Команда, принятая к отправке и ещё не получившая CommandResult
+struct PendingCommand {
+    std::string device_id;
+    Packet      packet;
+};
+
+/// Журнал предзаписи (WAL) исходящих команд: команда, принятая сервисом,
+/// не теряется при его падении, пока на неё не пришёл CommandResult или не
+/// истёк её valid_until.
+///
+/// Журнал - последовательность сегментов commands-<номер>.wal в каталоге.
+/// Запись - длина (varint), контрольная сумма и тело: id устройства и
+/// Packet в бинарном виде либо chain_id подтверждённой команды. Append
+/// возвращается, когда запись на диске. fdatasync общий для всех потоков
+/// (group commit): пока один поток синхронизирует файл, записи остальных
+/// копятся в буфере и уходят на диск следующим fdatasync одной пачкой.
+/// Поэтому число синхронизаций растёт с числом одновременно пишущих
+/// потоков намного медленнее, чем число записей.
+///
+/// Сегменты удаляются с начала журнала, когда все их команды подтверждены
+/// или просрочены. При открытии журнал читается целиком: незавершённая
+/// запись в конце (падение посреди записи) отбрасывается, команды без
+/// подтверждения отдаёт TakeRecovered, новые записи идут в новый сегмент.
+///
+/// Методы можно вызывать из разных потоков.
+class CommandWal {
+  public:
+    /// std::runtime_error при ошибке ввода-вывода
+    explicit CommandWal(CommandWalOptions options);
+    ~CommandWal();
+
+    CommandWal(const CommandWal &) = delete;
+    CommandWal &operator=(const CommandWal &) = delete;
+
+    /// Пишет команду и ждёт, пока она будет на диске. Пакет обязан содержать
+    /// Command с непустым chain_id, иначе std::invalid_argument.
+    /// std::runtime_error при ошибке ввода-вывода (и для всех последующих
+    /// вызовов: журнал после неё не используется).
+    void Append(std::string_view device_id, const Packet &packet);
+
+    /// Отмечает команду chain_id выполненной. Запись о подтверждении не
+    /// ждёт диска: если она потеряется, команда после рестарта будет
+    /// отправлена повторно. false, если такой команды нет в журнале.
+    bool Acknowledge(std::string_view chain_id);
+    bool Acknowledge(const CommandResult &result) { return Acknowledge(result.chain_id()); }
+
+    /// Забывает команды, valid_until которых прошёл к моменту now_s
+    void DropExpired(uint64_t now_s);
+
+    /// Команды, найденные в журнале при открытии и не просроченные к
+    /// моменту now_s, в порядке записи. Отдаются один раз; просроченные
+    /// забываются.
+    [[nodiscard]] std::vector<PendingCommand> TakeRecovered(uint64_t now_s);
+
+    [[nodiscard]] size_t   GetPendingCount() const;
+    [[nodiscard]] size_t   GetSegmentCount() const;
+    /// Число выполненных fdatasync
+    [[nodiscard]] uint64_t GetSyncCount() const;
+
+  private:
+    struct Segment {
+        uint64_t number;
+        /// Команды сегмента без подтверждения
+        size_t   pending = 0;
+    };
+
+    struct Entry {
+        uint64_t segment;
+        uint64_t valid_until;  // 0 - без срока
+    };
+
+    /// Записи одного сегмента, ещё не отданные write
+    struct Batch {
+        uint64_t    segment;
+        std::string data;
+    };
+
+    struct Recovered {
+        uint64_t       segment;
+        PendingCommand command;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    void Recover();
+    /// Дописывает запись в буфер текущего сегмента, открывая новый, если
+    /// текущий заполнен; под mutex_
+    void AppendRecord(char type, std::string_view body);
+    /// Пишет буфер и синхронизирует файл, пока записи до sequence не на
+    /// диске; под mutex_ (отпускается на время ввода-вывода)
+    void WaitDurable(std::unique_lock<std::mutex> &lock, uint64_t sequence);
+    /// Снимает команду с учёта сегмента и удаляет освободившиеся сегменты
+    /// с начала журнала; под mutex_
+    void Release(const Entry &entry);
+    /// Закрывает текущий файл и открывает сегмент number
+    void OpenSegment(uint64_t number);
+    [[nodiscard]] std::string GetSegmentPath(uint64_t number) const;
+
+    const CommandWalOptions options_;
+
+    mutable std::mutex      mutex_;
+    std::condition_variable synced_;
+    /// Сегменты от старого к новому; последний - текущий
+    std::deque<Segment>     segments_;
+    /// Размер текущего сегмента вместе с буфером
+    size_t                  segment_size_ = 0;
+    std::vector<Batch>      batches_;
+    /// Номер последней записи в batches_ и последней записи на диске
+    uint64_t                buffered_sequence_ = 0;
+    uint64_t                durable_sequence_ = 0;
+    /// Один поток пишет и синхронизирует, остальные ждут его
+    bool                    syncing_ = false;
+    bool                    failed_ = false;
+    uint64_t                sync_count_ = 0;
+    /// Открытый сегмент; меняет только синхронизирующий поток
+    int                     fd_ = -1;
+    uint64_t                file_segment_ = 0;
+
+    std::unordered_map<std::string, Entry, StringHash, std::equal_to<>> pending_;
+    std::vector<Recovered>                                              recovered_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,229 @@
+#include "configure_cache.h"
+
+#include <google/protobuf/util/message_differencer.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace iot::backend::proto {
+
+namespace {
+
+// FNV-1a: стабилен между запусками и платформами, в отличие от std::hash
+class StableHasher {
+  public:
+    void Add(std::string_view data)
+    {
+        AddSize(data.size());
+        for (const char c : data) {
+            hash_ ^= static_cast<unsigned char>(c);
+            hash_ *= kPrime;
+        }
+    }
+
+    void AddSize(size_t size)
+    {
+        for (int i = 0; i < 8; ++i) {
+            hash_ ^= (size >> (i * 8)) & 0xFF;
+            hash_ *= kPrime;
+        }
+    }
+
+    [[nodiscard]] uint64_t Get() const { return hash_; }
+
+  private:
+    static constexpr uint64_t kPrime = 0x100000001b3ULL;
+    uint64_t                  hash_ = 0xcbf29ce484222325ULL;
+};
+
+template <class Map>
+std::vector<typename Map::const_pointer> SortedItems(const Map &map)
+{
+    std::vector<typename Map::const_pointer> items;
+    items.reserve(map.size());
+    for (const auto &item : map)
+        items.push_back(&item);
+    std::sort(items.begin(), items.end(),
+              [](auto lhs, auto rhs) { return lhs->first < rhs->first; });
+    return items;
+}
+
+bool IsSameState(const CmdConfigure::StateDescription &lhs,
+                 const CmdConfigure::StateDescription &rhs)
+{
+    const auto &lhs_params = lhs.state_params();
+    const auto &rhs_params = rhs.state_params();
+    if (lhs_params.size() != rhs_params.size())
+        return false;
+    for (const auto &[name, value] : lhs_params) {
+        const auto it = rhs_params.find(name);
+        if (it == rhs_params.end() || it->second != value)
+            return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+uint64_t HashConfigure(const CmdConfigure &configure)
+{
+    StableHasher hasher;
+    hasher.Add(configure.state_name());
+    hasher.AddSize(configure.states_size());
+    for (const auto *state : SortedItems(configure.states())) {
+        hasher.Add(state->first);
+        const auto &params = state->second.state_params();
+        hasher.AddSize(params.size());
+        for (const auto *param : SortedItems(params)) {
+            hasher.Add(param->first);
+            hasher.Add(param->second);
+        }
+    }
+    return hasher.Get();
+}
+
+std::optional<CmdConfigure> DiffConfigure(const CmdConfigure &acknowledged,
+                                          const CmdConfigure &target)
+{
+    for (const auto &[name, state] : acknowledged.states()) {
+        if (target.states().find(name) == target.states().end())
+            return std::nullopt;
+    }
+
+    CmdConfigure delta;
+    if (acknowledged.state_name() != target.state_name())
+        delta.set_state_name(target.state_name());
+
+    for (const auto &[name, state] : target.states()) {
+        const auto it = acknowledged.states().find(name);
+        if (it == acknowledged.states().end() || !IsSameState(it->second, state))
+            (*delta.mutable_states())[name] = state;
+    }
+    return delta;
+}
+
+ConfigureCache::ConfigureCache(std::chrono::seconds max_sent)
+    : max_sent_s_(static_cast<uint64_t>(max_sent.count()))
+{
+}
+
+ConfigureCache::Plan ConfigureCache::MakePlan(std::string_view    device_id,
+                                              const CmdConfigure &target) const
+{
+    Plan plan;
+    plan.hash = HashConfigure(target);
+
+    const auto it = acknowledged_.find(std::string(device_id));
+    if (it == acknowledged_.end()) {
+        plan.configure = target;
+        return plan;
+    }
+
+    const Entry &acked = *it->second;
+    // Сравниваем и содержимое: совпадение 64-битного хэша само по себе
+    // не гарантирует совпадение конфигураций
+    if (acked.hash == plan.hash &&
+        google::protobuf::util::MessageDifferencer::Equals(acked.configure,
+                                                           target)) {
+        plan.action = Plan::Action::SKIP;
+        return plan;
+    }
+
+    auto delta = DiffConfigure(acked.configure, target);
+    if (delta) {
+        plan.action = Plan::Action::DELTA;
+        plan.configure = std::move(*delta);
+    } else {
+        plan.configure = target;
+    }
+    return plan;
+}
+
+ConfigureCache::EntryPtr ConfigureCache::Intern(const CmdConfigure &configure)
+{
+    // Амортизированно: слоты, освободившиеся с прошлой чистки, не
+    // накапливаются
+    if (store_.size() >= sweep_at_) {
+        SweepStore();
+        sweep_at_ = std::max<size_t>(64, store_.size() * 2);
+    }
+    const auto hash = HashConfigure(configure);
+    auto      &slot = store_[hash];
+    if (auto entry = slot.lock()) {
+        if (google::protobuf::util::MessageDifferencer::Equals(entry->configure,
+                                                               configure))
+            return entry;
+        // Коллизия хэша: не переиспользуем, храним отдельную копию
+        return std::make_shared<const Entry>(Entry{hash, configure});
+    }
+
+    auto entry = std::make_shared<const Entry>(Entry{hash, configure});
+    slot = entry;
+    return entry;
+}
+
+void ConfigureCache::SweepStore()
+{
+    std::erase_if(store_, [](const auto &item) { return item.second.expired(); });
+}
+
+void ConfigureCache::MarkSent(std::string_view        chain_id,
+                              std::string_view        device_id,
+                              const CmdConfigure     &target,
+                              std::optional<uint64_t> valid_until,
+                              uint64_t                now_s)
+{
+    sent_[std::string(chain_id)] = Sent{std::string(device_id), Intern(target), valid_until, now_s};
+}
+
+bool ConfigureCache::OnCommandResult(const CommandResult &result)
+{
+    const auto it = sent_.find(result.chain_id());
+    if (it == sent_.end())
+        return false;
+
+    const bool success = result.result() == RESULT_SUCCESS;
+    if (success)
+        acknowledged_[it->second.device_id] = std::move(it->second.entry);
+    sent_.erase(it);
+    return success;
+}
+
+void ConfigureCache::SetAcknowledged(std::string_view    device_id,
+                                     const CmdConfigure &configure)
+{
+    acknowledged_[std::string(device_id)] = Intern(configure);
+}
+
+void ConfigureCache::DropExpired(uint64_t now_s)
+{
+    std::erase_if(sent_, [&](const auto &item) {
+        const Sent &sent = item.second;
+        return sent.valid_until ? *sent.valid_until < now_s : sent.sent_s + max_sent_s_ < now_s;
+    });
+    SweepStore();
+}
+
+void ConfigureCache::Forget(std::string_view device_id)
+{
+    acknowledged_.erase(std::string(device_id));
+    std::erase_if(sent_, [device_id](const auto &item) { return item.second.device_id == device_id; });
+}
+
+std::optional<uint64_t>
+ConfigureCache::GetAcknowledgedHash(std::string_view device_id) const
+{
+    const auto it = acknowledged_.find(std::string(device_id));
+    if (it == acknowledged_.end())
+        return std::nullopt;
+    return it->second->hash;
+}
+
+size_t ConfigureCache::UniqueConfigCount() const
+{
+    return static_cast<size_t>(
+        std::count_if(store_.begin(), store_.end(),
+                      [](const auto &item) { return !item.second.expired(); }));
+}
+
+}  // namespace iot::backend::proto
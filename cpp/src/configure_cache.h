@@ -0,0 +1,116 @@
+#pragma once
+
+#include "command.pb.h"
+#include "command_result.pb.h"
+#include "helpers.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace iot::backend::proto {
+
+/// Канонический хэш CmdConfigure: не зависит от порядка элементов в map
+/// (состояния и параметры сортируются по ключу перед хэшированием).
+uint64_t HashConfigure(const CmdConfigure &configure);
+
+/// Минимальная разница между конфигурациями: состояния, которые появились или
+/// изменились в target, плюс state_name, если он поменялся.
+/// Если из target пропало состояние, выразить это частичным CmdConfigure
+/// нельзя, поэтому возвращается std::nullopt и нужно слать target целиком.
+std::optional<CmdConfigure> DiffConfigure(const CmdConfigure &acknowledged,
+                                          const CmdConfigure &target);
+
+/// Хранит последнюю подтверждённую устройством конфигурацию и решает, что
+/// именно отправлять при очередной раскатке. Одинаковые конфигурации хранятся
+/// в одном экземпляре (content-addressed), так что на 100k устройств с одной
+/// конфигурацией приходится одна копия CmdConfigure.
+///
+/// Класс не потокобезопасный.
+class ConfigureCache {
+  public:
+    struct Plan {
+        enum class Action {
+            SKIP,   // Устройство уже подтвердило ровно такую конфигурацию
+            FULL,   // Нужно отправить target целиком
+            DELTA,  // Достаточно отправить configure с изменившимися state
+        };
+
+        Action       action = Action::FULL;
+        uint64_t     hash = 0;  // Хэш target
+        CmdConfigure configure; // Пусто для SKIP
+    };
+
+    /// Отправленная команда без valid_until забывается через max_sent, если
+    /// результата так и не было (см. DropExpired)
+    explicit ConfigureCache(std::chrono::seconds max_sent = std::chrono::hours(1));
+
+    /// Решает, что отправлять устройству, чтобы оно пришло к target
+    [[nodiscard]] Plan MakePlan(std::string_view    device_id,
+                                const CmdConfigure &target) const;
+
+    /// Запоминает отправленную команду: после успешного CommandResult с этим
+    /// chain_id устройству будет засчитана конфигурация target.
+    /// valid_until - срок жизни команды (Packet::valid_until), если он есть.
+    void MarkSent(std::string_view        chain_id,
+                  std::string_view        device_id,
+                  const CmdConfigure     &target,
+                  std::optional<uint64_t> valid_until = std::nullopt,
+                  uint64_t                now_s = helpers::GetCurrentUtcTimestamp());
+
+    /// Обрабатывает результат команды. Возвращает true, если результат
+    /// относится к отправленной конфигурации и она подтверждена.
+    bool OnCommandResult(const CommandResult &result);
+
+    /// Явно задаёт подтверждённую конфигурацию (например, при старте сервиса)
+    void SetAcknowledged(std::string_view device_id, const CmdConfigure &configure);
+
+    /// Забывает отправленные команды, срок жизни которых истёк к моменту
+    /// now_s (без valid_until - через max_sent): результата по ним уже не
+    /// будет. Заодно чистит хранилище от неиспользуемых конфигураций.
+    void DropExpired(uint64_t now_s = helpers::GetCurrentUtcTimestamp());
+
+    /// Забывает подтверждённую конфигурацию и отправленные команды устройства
+    void Forget(std::string_view device_id);
+
+    [[nodiscard]] std::optional<uint64_t>
+    GetAcknowledgedHash(std::string_view device_id) const;
+
+    /// Количество уникальных конфигураций в хранилище
+    [[nodiscard]] size_t UniqueConfigCount() const;
+    /// Слоты хранилища, включая ещё не вычищенные освободившиеся
+    [[nodiscard]] size_t StoreSlotCount() const { return store_.size(); }
+
+  private:
+    struct Entry {
+        uint64_t     hash = 0;
+        CmdConfigure configure;
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    struct Sent {
+        std::string             device_id;
+        EntryPtr                entry;
+        std::optional<uint64_t> valid_until;
+        uint64_t                sent_s = 0;
+    };
+
+    EntryPtr Intern(const CmdConfigure &configure);
+    /// Удаляет слоты конфигураций, на которые никто не ссылается: каждый
+    /// слот держит всю выделенную make_shared память
+    void SweepStore();
+
+    const uint64_t max_sent_s_;
+    /// Размер store_, при котором Intern вызовет SweepStore
+    size_t         sweep_at_ = 64;
+
+    std::unordered_map<uint64_t, std::weak_ptr<const Entry>> store_;
+    std::unordered_map<std::string, EntryPtr>                acknowledged_;
+    std::unordered_map<std::string, Sent>                    sent_;
+};
+
+}  // namespace iot::backend::proto
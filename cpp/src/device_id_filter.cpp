@@ -0,0 +1,175 @@
+#include "device_id_filter.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+// Доля занятых позиций, под которую заводятся корзины. Cuckoo filter с 4
+// позициями в корзине вставляет почти всегда до ~95% заполнения.
+constexpr double kTargetLoad = 0.9;
+// Длина цепочки вытеснений, после которой вставка считается неудачной
+constexpr size_t kMaxKicks = 500;
+constexpr size_t kBatch = 16;
+
+}  // namespace
+
+DeviceIdFilter::DeviceIdFilter(size_t capacity)
+{
+    size_t buckets = 1;
+    while (buckets * kSlots * kTargetLoad < capacity)
+        buckets <<= 1;
+    mask_ = buckets - 1;
+    buckets_ = std::make_unique<std::atomic<uint64_t>[]>(buckets);
+    for (size_t i = 0; i < buckets; ++i)
+        buckets_[i].store(0, std::memory_order_relaxed);
+}
+
+size_t DeviceIdFilter::FindFreeSlot(size_t bucket) const
+{
+    const uint64_t word = buckets_[bucket].load(std::memory_order_relaxed);
+    for (size_t slot = 0; slot < kSlots; ++slot) {
+        if (GetSlot(word, slot) == 0)
+            return slot;
+    }
+    return kSlots;
+}
+
+void DeviceIdFilter::Store(size_t bucket, size_t slot, uint16_t fingerprint)
+{
+    // Слово корзины меняет только писатель под write_mutex_
+    const uint64_t word = buckets_[bucket].load(std::memory_order_relaxed);
+    buckets_[bucket].store(SetSlot(word, slot, fingerprint), std::memory_order_release);
+}
+
+void DeviceIdFilter::MayContainBatch(const std::string_view *device_ids, size_t count, bool *results) const
+{
+    uint64_t hashes[kBatch];
+    for (size_t begin = 0; begin < count; begin += kBatch) {
+        const size_t size = std::min(kBatch, count - begin);
+        for (size_t i = 0; i < size; ++i) {
+            hashes[i] = Hash(device_ids[begin + i]);
+            const size_t first = hashes[i] & mask_;
+            __builtin_prefetch(&buckets_[first]);
+            __builtin_prefetch(&buckets_[GetAlternate(first, GetFingerprint(hashes[i]))]);
+        }
+        for (size_t i = 0; i < size; ++i)
+            results[begin + i] = MayContainHash(hashes[i]);
+    }
+}
+
+bool DeviceIdFilter::Insert(std::string_view device_id)
+{
+    std::lock_guard lock(write_mutex_);
+    const uint64_t  hash = Hash(device_id);
+    const uint16_t  fingerprint = GetFingerprint(hash);
+    const size_t    first = hash & mask_;
+    const size_t    second = GetAlternate(first, fingerprint);
+    for (const size_t bucket : {first, second}) {
+        if (const size_t slot = FindFreeSlot(bucket); slot < kSlots) {
+            Store(bucket, slot, fingerprint);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Сначала ищется цепочка вытеснений до корзины со свободной позицией,
+    // таблица при этом не меняется. Затем отпечатки сдвигаются по цепочке с
+    // конца: каждый сначала копируется в свою вторую корзину и только потом
+    // затирается следующим, так что читатели его не теряют.
+    struct Step {
+        size_t   bucket;
+        size_t   slot;
+        uint16_t fingerprint;
+    };
+    std::vector<Step> path;
+    random_ = random_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    size_t bucket = (random_ >> 33) % 2 == 0 ? first : second;
+    for (size_t depth = 0; depth < kMaxKicks; ++depth) {
+        random_ = random_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        // Позиция, ещё не входящая в цепочку: повторное вытеснение той же
+        // позиции испортило бы сдвиг
+        size_t slot = kSlots;
+        for (size_t attempt = 0; attempt < kSlots && slot == kSlots; ++attempt) {
+            const size_t candidate = ((random_ >> 33) + attempt) % kSlots;
+            const bool   used = std::any_of(path.begin(), path.end(), [&](const Step &step) {
+                return step.bucket == bucket && step.slot == candidate;
+            });
+            if (!used)
+                slot = candidate;
+        }
+        if (slot == kSlots)
+            return false;
+
+        const uint16_t victim = GetSlot(buckets_[bucket].load(std::memory_order_relaxed), slot);
+        path.push_back({bucket, slot, victim});
+        const size_t next = GetAlternate(bucket, victim);
+        if (const size_t free_slot = FindFreeSlot(next); free_slot < kSlots) {
+            const uint64_t moves = moves_.load(std::memory_order_relaxed);
+            moves_.store(moves + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            Store(next, free_slot, victim);
+            for (size_t k = path.size() - 1; k > 0; --k)
+                Store(path[k].bucket, path[k].slot, path[k - 1].fingerprint);
+            Store(path[0].bucket, path[0].slot, fingerprint);
+            moves_.store(moves + 2, std::memory_order_release);
+            size_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        bucket = next;
+    }
+    return false;
+}
+
+bool DeviceIdFilter::Remove(std::string_view device_id)
+{
+    std::lock_guard lock(write_mutex_);
+    const uint64_t  hash = Hash(device_id);
+    const uint16_t  fingerprint = GetFingerprint(hash);
+    const size_t    first = hash & mask_;
+    for (const size_t bucket : {first, GetAlternate(first, fingerprint)}) {
+        const uint64_t word = buckets_[bucket].load(std::memory_order_relaxed);
+        for (size_t slot = 0; slot < kSlots; ++slot) {
+            if (GetSlot(word, slot) == fingerprint) {
+                Store(bucket, slot, 0);
+                size_.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+DeviceIdFilterHolder::DeviceIdFilterHolder(size_t capacity)
+    : writable_(new DeviceIdFilter(capacity)), current_(std::unique_ptr<const DeviceIdFilter>(writable_))
+{
+}
+
+bool DeviceIdFilterHolder::Insert(std::string_view device_id)
+{
+    // Указатель меняется только под write_mutex_
+    std::lock_guard lock(write_mutex_);
+    return writable_->Insert(device_id);
+}
+
+bool DeviceIdFilterHolder::Remove(std::string_view device_id)
+{
+    std::lock_guard lock(write_mutex_);
+    return writable_->Remove(device_id);
+}
+
+void DeviceIdFilterHolder::Rebuild(const std::vector<std::string> &device_ids, size_t capacity)
+{
+    std::lock_guard lock(write_mutex_);
+    auto            filter = std::make_unique<DeviceIdFilter>(std::max(capacity, device_ids.size()));
+    for (const auto &device_id : device_ids) {
+        if (!filter->Insert(device_id))
+            throw std::runtime_error("Device id filter overflow on rebuild");
+    }
+    writable_ = filter.get();
+    current_.Publish(std::move(filter));
+}
+
+}  // namespace iot::backend::proto
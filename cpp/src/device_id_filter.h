@@ -0,0 +1,194 @@
+#pragma once
+
+#include "rcu.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Фильтр зарегистрированных id устройств (cuckoo filter): "точно нет" или
+/// "возможно есть". Проверяется сразу после маршрутизации топика
+/// (TopicMatch::device_id), до Deserialize: пакеты для чужих id
+/// отбрасываются без разбора и без поиска в реестре.
+///
+/// Корзина - 4 отпечатка по 16 бит в одном 64-битном слове, у id две
+/// корзины. Проверка - хеш id и два слова, отпечаток ищется в слове сразу
+/// по всем 4 позициям. Доля ложных "возможно есть" около 8 / 2^16, ложных
+/// "нет" не бывает.
+///
+/// Чтение не берёт блокировок и идёт параллельно с изменениями: слова
+/// корзин атомарны, при вытеснении отпечаток сначала записывается в новую
+/// корзину и только потом затирается в старой, а цепочка вытеснений
+/// окружена счётчиком перемещений (seqlock), по которому читатель
+/// перепроверяет отрицательный ответ. Так читатель всегда видит каждый
+/// вставленный id. Insert и Remove сериализуются между собой.
+class DeviceIdFilter {
+  public:
+    /// capacity - ожидаемое число id; корзин заводится с запасом, степень
+    /// двойки
+    explicit DeviceIdFilter(size_t capacity);
+
+    DeviceIdFilter(const DeviceIdFilter &) = delete;
+    DeviceIdFilter &operator=(const DeviceIdFilter &) = delete;
+
+    [[nodiscard]] static uint64_t Hash(std::string_view device_id)
+    {
+        // Слова по 8 байт, хвост - словами с перекрытием; id устройств
+        // обычно 15-36 байт
+        const char *data = device_id.data();
+        size_t      size = device_id.size();
+        uint64_t    hash = Mix(size ^ kSeed, kMultiplier);
+        for (; size > 16; data += 16, size -= 16)
+            hash = Mix(Load64(data) ^ hash, Load64(data + 8) ^ kMultiplier);
+        uint64_t a = 0;
+        uint64_t b = 0;
+        if (size >= 8) {
+            a = Load64(data);
+            b = Load64(data + size - 8);
+        } else if (size >= 4) {
+            a = Load32(data);
+            b = Load32(data + size - 4);
+        } else if (size > 0) {
+            a = (uint64_t{static_cast<uint8_t>(data[0])} << 16) |
+                (uint64_t{static_cast<uint8_t>(data[size / 2])} << 8) | static_cast<uint8_t>(data[size - 1]);
+        }
+        return Mix(a ^ hash, b ^ kMultiplier);
+    }
+
+    [[nodiscard]] bool MayContain(std::string_view device_id) const { return MayContainHash(Hash(device_id)); }
+
+    [[nodiscard]] bool MayContainHash(uint64_t hash) const
+    {
+        const uint16_t fingerprint = GetFingerprint(hash);
+        const size_t   first = hash & mask_;
+        const size_t   second = GetAlternate(first, fingerprint);
+        for (;;) {
+            const uint64_t moves = moves_.load(std::memory_order_acquire);
+            if (HasFingerprint(buckets_[first].load(std::memory_order_acquire), fingerprint) ||
+                HasFingerprint(buckets_[second].load(std::memory_order_acquire), fingerprint))
+                return true;
+            // Отпечаток мог переехать из второй корзины в первую между
+            // чтениями: "нет" верно, только если перемещений не было
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (moves % 2 == 0 && moves_.load(std::memory_order_relaxed) == moves)
+                return false;
+        }
+    }
+
+    /// MayContain для пачки id: корзины всех id запрашиваются из памяти
+    /// заранее, и промахи кэша перекрываются
+    void MayContainBatch(const std::string_view *device_ids, size_t count, bool *results) const;
+
+    /// false, если для id не нашлось места: фильтр нужно перестроить с
+    /// большей ёмкостью. Повторная вставка того же id добавляет копию.
+    bool Insert(std::string_view device_id);
+    /// Удаляет одну копию id. Удалять можно только вставленные id, иначе
+    /// может пропасть отпечаток другого id с тем же отпечатком и корзиной.
+    bool Remove(std::string_view device_id);
+
+    /// Число вставленных отпечатков
+    [[nodiscard]] size_t GetSize() const { return size_.load(std::memory_order_relaxed); }
+    [[nodiscard]] size_t GetBucketCount() const { return mask_ + 1; }
+    [[nodiscard]] size_t GetMemoryBytes() const { return GetBucketCount() * sizeof(uint64_t); }
+
+  private:
+    static constexpr size_t   kSlots = 4;
+    static constexpr uint64_t kSeed = 0x2D358DCCAA6C78A5ULL;
+    static constexpr uint64_t kMultiplier = 0x8BB84B93962EACC9ULL;
+    static constexpr uint64_t kLanes = 0x0001000100010001ULL;
+    static constexpr uint64_t kHighBits = 0x8000800080008000ULL;
+
+    static uint64_t Load64(const char *data)
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    static uint64_t Load32(const char *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    static uint64_t Mix(uint64_t a, uint64_t b)
+    {
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+    }
+
+    /// Отпечаток не бывает нулевым: 0 - пустая позиция
+    static uint16_t GetFingerprint(uint64_t hash)
+    {
+        const auto fingerprint = static_cast<uint16_t>(hash >> 48);
+        return fingerprint == 0 ? 1 : fingerprint;
+    }
+    /// Вторая корзина вычисляется из первой и отпечатка и наоборот
+    [[nodiscard]] size_t GetAlternate(size_t bucket, uint16_t fingerprint) const
+    {
+        return (bucket ^ (fingerprint * 0x5BD1E995ULL)) & mask_;
+    }
+    /// Есть ли 16-битная позиция, равная fingerprint
+    static bool HasFingerprint(uint64_t bucket, uint16_t fingerprint)
+    {
+        const uint64_t diff = bucket ^ (fingerprint * kLanes);
+        return ((diff - kLanes) & ~diff & kHighBits) != 0;
+    }
+    static uint16_t GetSlot(uint64_t bucket, size_t slot) { return static_cast<uint16_t>(bucket >> (slot * 16)); }
+    static uint64_t SetSlot(uint64_t bucket, size_t slot, uint16_t fingerprint)
+    {
+        return (bucket & ~(uint64_t{0xFFFF} << (slot * 16))) | (uint64_t{fingerprint} << (slot * 16));
+    }
+
+    /// Свободная позиция корзины или kSlots
+    [[nodiscard]] size_t FindFreeSlot(size_t bucket) const;
+    void Store(size_t bucket, size_t slot, uint16_t fingerprint);
+
+    size_t                                 mask_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+    std::atomic<size_t>                    size_{0};
+    /// Нечётный, пока выполняется цепочка вытеснений
+    std::atomic<uint64_t>                  moves_{0};
+    std::mutex                             write_mutex_;
+    /// Состояние генератора для выбора вытесняемой позиции
+    uint64_t random_ = 1;
+};
+
+/// Текущий DeviceIdFilter с заменой без остановки читателей. Читатель
+/// берёт текущий фильтр внутри rcu::ReadLock на пачку пакетов и проверяет
+/// id без блокировок и счётчиков ссылок; Rebuild строит новый фильтр по
+/// полному списку id и публикует его одной заменой указателя, старый
+/// удаляется, когда из секций вышли все читатели, которые могли его видеть.
+class DeviceIdFilterHolder {
+  public:
+    explicit DeviceIdFilterHolder(size_t capacity = 0);
+
+    /// Текущий фильтр; действителен до конца секции lock
+    [[nodiscard]] const DeviceIdFilter *Get(const rcu::ReadLock &lock) const { return current_.Get(lock); }
+
+    /// Изменения текущего фильтра; false из Insert означает, что нужен
+    /// Rebuild
+    bool Insert(std::string_view device_id);
+    bool Remove(std::string_view device_id);
+
+    /// Новый фильтр на max(capacity, ids.size()) id из ids. Insert и Remove
+    /// ждут окончания перестройки, читатели - нет. std::runtime_error, если
+    /// id не поместились.
+    void Rebuild(const std::vector<std::string> &device_ids, size_t capacity = 0);
+
+  private:
+    /// Сериализует изменения и перестройку
+    std::mutex                   write_mutex_;
+    /// Тот же объект, что опубликован в current_, для Insert и Remove;
+    /// меняется под write_mutex_
+    DeviceIdFilter              *writable_;
+    rcu::Pointer<DeviceIdFilter> current_;
+};
+
+}  // namespace iot::backend::proto
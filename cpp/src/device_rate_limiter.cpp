@@ -0,0 +1,157 @@
+#include "device_rate_limiter.h"
+
+#include "device_id_filter.h"
+#include "device_topics.h"
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+
+// Слово корзины: младшие 40 бит - время последнего пополнения в мс от
+// start_ms_, старшие 24 - нехватка токенов. Нулевое слово - полная корзина.
+constexpr uint32_t kTimeBits = 40;
+constexpr uint64_t kTimeMask = (uint64_t{1} << kTimeBits) - 1;
+// Токен в единицах корзины
+constexpr uint64_t kToken = 256;
+// Длина поиска места для устройства, после которой таблица считается полной
+constexpr size_t   kMaxProbes = 64;
+
+}  // namespace
+
+Packet::WhatCase PeekPacketType(std::string_view payload)
+{
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t *>(payload.data()),
+                                                 static_cast<int>(payload.size()));
+    // #ADD_NEW_PACKET Поля oneof what - сообщения с номерами от command до
+    // notification; новый тип вне этого диапазона станет WHAT_NOT_SET и не
+    // будет ограничиваться. Остальное (version, timestamp, valid_until)
+    // пропускается.
+    while (const uint32_t tag = input.ReadTag()) {
+        const int number = WireFormatLite::GetTagFieldNumber(tag);
+        if (number >= Packet::kCommandFieldNumber && number <= Packet::kNotificationFieldNumber) {
+            if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+                return Packet::WHAT_NOT_SET;
+            return static_cast<Packet::WhatCase>(number);
+        }
+        if (!WireFormatLite::SkipField(&input, tag))
+            return Packet::WHAT_NOT_SET;
+    }
+    return Packet::WHAT_NOT_SET;
+}
+
+DeviceRateLimiter::DeviceRateLimiter(DeviceRateLimiterOptions options, uint64_t now_ms) : start_ms_(now_ms)
+{
+    limit_index_.fill(-1);
+    for (const auto &limit : options.limits) {
+        const auto what = static_cast<size_t>(limit.what);
+        if (what >= kWhatCount || limit_index_[what] >= 0)
+            throw std::invalid_argument("Duplicate or unknown packet type in rate limits");
+        if (limit.burst == 0 || limit.burst > kMaxBurst || !(limit.per_second > 0))
+            throw std::invalid_argument("Rate limit needs burst in [1, 65535] and positive per_second");
+        Limit converted;
+        converted.capacity = limit.burst * kToken;
+        converted.per_second = std::max<uint64_t>(1, std::llround(limit.per_second * kToken));
+        converted.fill_ms = (converted.capacity * 1000 + converted.per_second - 1) / converted.per_second;
+        limit_index_[what] = static_cast<int8_t>(limits_.size());
+        limits_.push_back(converted);
+    }
+
+    size_t slots = 1;
+    while (slots < options.max_devices * 2)
+        slots <<= 1;
+    mask_ = slots - 1;
+    stride_ = 1 + limits_.size();
+    slots_ = std::make_unique<std::atomic<uint64_t>[]>(slots * stride_);
+    for (size_t i = 0; i < slots * stride_; ++i)
+        slots_[i].store(0, std::memory_order_relaxed);
+}
+
+std::atomic<uint64_t> *DeviceRateLimiter::FindBuckets(std::string_view device_id)
+{
+    // 0 - свободное место
+    const uint64_t hash = std::max<uint64_t>(DeviceIdFilter::Hash(device_id), 1);
+    size_t         index = hash & mask_;
+    for (size_t probe = 0; probe < kMaxProbes; ++probe, index = (index + 1) & mask_) {
+        std::atomic<uint64_t> &key = slots_[index * stride_];
+        uint64_t               current = key.load(std::memory_order_acquire);
+        if (current == 0) {
+            if (key.compare_exchange_strong(current, hash, std::memory_order_acq_rel)) {
+                device_count_.fetch_add(1, std::memory_order_relaxed);
+                return &key + 1;
+            }
+            // current - ключ, занявший место раньше нас
+        }
+        if (current == hash)
+            return &key + 1;
+    }
+    return nullptr;
+}
+
+bool DeviceRateLimiter::Admit(std::string_view topic, std::string_view payload, uint64_t now_ms)
+{
+    const auto device_topic = ParseDeviceTopic(topic);
+    if (!device_topic)
+        return true;
+    return Admit(device_topic->device_id, PeekPacketType(payload), now_ms);
+}
+
+bool DeviceRateLimiter::Admit(std::string_view device_id, Packet::WhatCase what, uint64_t now_ms)
+{
+    const auto type = static_cast<size_t>(what);
+    if (type >= kWhatCount || limit_index_[type] < 0)
+        return true;
+    std::atomic<uint64_t> *buckets = FindBuckets(device_id);
+    if (!buckets) {
+        untracked_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const Limit           &limit = limits_[limit_index_[type]];
+    std::atomic<uint64_t> &bucket = buckets[limit_index_[type]];
+    const uint64_t         now = std::min(now_ms > start_ms_ ? now_ms - start_ms_ : 0, kTimeMask);
+    uint64_t               word = bucket.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t       time = word & kTimeMask;
+        uint64_t       deficit = word >> kTimeBits;
+        // Часы разных потоков могут немного расходиться
+        const uint64_t elapsed = now > time ? now - time : 0;
+        const uint64_t refill = elapsed >= limit.fill_ms ? deficit : std::min(deficit, elapsed * limit.per_second / 1000);
+        deficit -= refill;
+        // Время сдвигается, только если что-то пополнилось: иначе частые
+        // пакеты при медленном пополнении не дали бы ему накопиться
+        if (refill > 0 || deficit == 0)
+            time = now;
+        if (deficit + kToken > limit.capacity) {
+            dropped_[type].fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        const uint64_t updated = ((deficit + kToken) << kTimeBits) | time;
+        if (bucket.compare_exchange_weak(word, updated, std::memory_order_relaxed))
+            return true;
+    }
+}
+
+uint64_t DeviceRateLimiter::GetDroppedCount(Packet::WhatCase what) const
+{
+    const auto type = static_cast<size_t>(what);
+    return type < kWhatCount ? dropped_[type].load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t DeviceRateLimiter::GetDroppedCount() const
+{
+    uint64_t total = 0;
+    for (const auto &dropped : dropped_)
+        total += dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+}  // namespace iot::backend::proto
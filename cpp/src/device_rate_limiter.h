@@ -0,0 +1,109 @@
+#pragma once
+
+#include "packet.pb.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Тип пакета по полям верхнего уровня, без разбора вложенных сообщений.
+/// WHAT_NOT_SET для пакета без типа или с испорченной разметкой.
+[[nodiscard]] Packet::WhatCase PeekPacketType(std::string_view payload);
+
+struct DeviceRateLimit {
+    /// WHAT_NOT_SET - пакеты, тип которых не определился
+    Packet::WhatCase what = Packet::WHAT_NOT_SET;
+    /// Сколько пакетов подряд устройство может прислать после паузы,
+    /// от 1 до kMaxBurst
+    uint32_t         burst = 0;
+    /// Пакетов в секунду в среднем
+    double           per_second = 0;
+};
+
+struct DeviceRateLimiterOptions {
+    /// Типы без лимита пропускаются всегда
+    std::vector<DeviceRateLimit> limits;
+    /// Ожидаемое число устройств; таблица заводится с двойным запасом
+    size_t                       max_devices = 1 << 20;
+};
+
+/// Ограничение частоты пакетов каждого устройства на входе, до разбора
+/// пакета: устройство, зациклившееся на перезагрузке, не отнимает время
+/// разбора у остальных.
+///
+/// На устройство и тип пакета - корзина токенов (token bucket) в одном
+/// 64-битном слове: время последнего пополнения в мс и нехватка токенов в
+/// 1/256 токена. Пакет принимается одним compare-and-swap слова, отказ не
+/// пишет ничего. Корзины устройства лежат подряд рядом с его ключом в
+/// таблице с открытой адресацией, ключ - 64-битный хеш id, который
+/// занимается тоже compare-and-swap. Глобальных блокировок нет, таблица
+/// не растёт и устройства из неё не удаляются: около (1 + число лимитов) *
+/// 16 байт на ожидаемое устройство.
+///
+/// Если для устройства не нашлось места (таблица переполнена), его
+/// пакеты пропускаются без ограничения и учитываются в GetUntrackedCount.
+///
+/// Методы можно вызывать из разных потоков.
+class DeviceRateLimiter {
+  public:
+    static constexpr uint32_t kMaxBurst = 65535;
+
+    /// std::invalid_argument для повторного типа, burst вне [1, kMaxBurst]
+    /// и неположительного per_second. now_ms - начало отсчёта; время
+    /// хранится в 40 битах, то есть около 34 лет.
+    DeviceRateLimiter(DeviceRateLimiterOptions options, uint64_t now_ms);
+
+    DeviceRateLimiter(const DeviceRateLimiter &) = delete;
+    DeviceRateLimiter &operator=(const DeviceRateLimiter &) = delete;
+
+    /// Пакет payload из топика topic. Топики не устройств не ограничиваются.
+    /// false - пакет надо отбросить.
+    bool Admit(std::string_view topic, std::string_view payload, uint64_t now_ms);
+    /// То же по уже известным id устройства и типу пакета
+    bool Admit(std::string_view device_id, Packet::WhatCase what, uint64_t now_ms);
+
+    /// Отброшенные пакеты типа what
+    [[nodiscard]] uint64_t GetDroppedCount(Packet::WhatCase what) const;
+    [[nodiscard]] uint64_t GetDroppedCount() const;
+    /// Устройства в таблице
+    [[nodiscard]] size_t   GetDeviceCount() const { return device_count_.load(std::memory_order_relaxed); }
+    /// Пакеты, пропущенные без ограничения из-за переполнения таблицы
+    [[nodiscard]] uint64_t GetUntrackedCount() const { return untracked_.load(std::memory_order_relaxed); }
+
+  private:
+    // #ADD_NEW_PACKET Новый тип должен быть последним полем oneof what,
+    // иначе поправь kWhatCount (и PeekPacketType)
+    static constexpr size_t kWhatCount = Packet::kNotification + 1;
+
+    struct Limit {
+        /// Ёмкость корзины, 1/256 токена
+        uint64_t capacity = 0;
+        /// Пополнение за секунду, 1/256 токена
+        uint64_t per_second = 0;
+        /// За сколько мс пустая корзина наполняется целиком
+        uint64_t fill_ms = 0;
+    };
+
+    /// Корзины устройства; nullptr, если места нет
+    std::atomic<uint64_t> *FindBuckets(std::string_view device_id);
+
+    uint64_t                       start_ms_;
+    std::vector<Limit>             limits_;
+    /// Номер лимита для типа пакета, -1 - без лимита
+    std::array<int8_t, kWhatCount> limit_index_;
+    /// Слов на устройство: ключ и корзины
+    size_t                         stride_;
+    size_t                         mask_;
+
+    std::unique_ptr<std::atomic<uint64_t>[]>        slots_;
+    std::atomic<size_t>                             device_count_{0};
+    std::atomic<uint64_t>                           untracked_{0};
+    std::array<std::atomic<uint64_t>, kWhatCount>   dropped_{};
+};
+
+}  // namespace iot::backend::proto
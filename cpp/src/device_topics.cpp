@@ -0,0 +1,53 @@
+#include "device_topics.h"
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr std::string_view kPrefix = "$devices/";
+
+std::string_view GetSuffix(DeviceTopicKind kind)
+{
+    switch (kind) {
+        case DeviceTopicKind::TELEMETRY:
+            return "/events/telemetry";
+        case DeviceTopicKind::STATUS:
+            return "/events/status";
+        case DeviceTopicKind::COMMAND:
+            break;
+    }
+    return "/commands/command";
+}
+
+}  // namespace
+
+std::string MakeDeviceTopic(std::string_view device_id, DeviceTopicKind kind)
+{
+    const auto  suffix = GetSuffix(kind);
+    std::string topic;
+    topic.reserve(kPrefix.size() + device_id.size() + suffix.size());
+    topic += kPrefix;
+    topic += device_id;
+    topic += suffix;
+    return topic;
+}
+
+std::optional<DeviceTopic> ParseDeviceTopic(std::string_view topic)
+{
+    if (topic.substr(0, kPrefix.size()) != kPrefix)
+        return std::nullopt;
+    topic.remove_prefix(kPrefix.size());
+
+    const size_t slash = topic.find('/');
+    if (slash == 0 || slash == std::string_view::npos)
+        return std::nullopt;
+
+    const auto suffix = topic.substr(slash);
+    for (const auto kind : {DeviceTopicKind::COMMAND, DeviceTopicKind::TELEMETRY, DeviceTopicKind::STATUS}) {
+        if (suffix == GetSuffix(kind))
+            return DeviceTopic{topic.substr(0, slash), kind};
+    }
+    return std::nullopt;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+/*
+ * Топики Yandex IoT Core, через которые ходит протокол:
+ *   $devices/{id}/commands/command - команды бэкенда устройству,
+ *   $devices/{id}/events/telemetry - телеметрия устройства,
+ *   $devices/{id}/events/status    - результаты команд и прочие ответы.
+ */
+namespace iot::backend::proto {
+
+enum class DeviceTopicKind {
+    COMMAND,
+    TELEMETRY,
+    STATUS,
+};
+
+struct DeviceTopic {
+    std::string_view device_id;
+    DeviceTopicKind  kind = DeviceTopicKind::COMMAND;
+};
+
+/// Подписка бэкенда на события всех устройств
+inline constexpr std::string_view kAllDeviceEventsFilter = "$devices/+/events/#";
+
+[[nodiscard]] std::string MakeDeviceTopic(std::string_view device_id, DeviceTopicKind kind);
+
+/// Разбирает топик устройства; device_id ссылается на topic.
+/// nullopt для топиков другого вида и пустого id.
+[[nodiscard]] std::optional<DeviceTopic> ParseDeviceTopic(std::string_view topic);
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,345 @@
+#include "fleet_simulator.h"
+
+#include "chain_id.h"
+#include "packet_validator.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Центр Москвы, велосипеды расставлены в квадрате ±kStartSpread градусов
+constexpr double kStartLat = 55.7522;
+constexpr double kStartLon = 37.6156;
+constexpr double kStartSpread = 0.15;
+constexpr double kMetersPerDegree = 111320;
+constexpr double kPi = 3.14159265358979323846;
+
+// Расход заряда: на километр пути и на час стоянки; зарядка на стоянке
+constexpr float kDrainPerKm = 1.2f;
+constexpr float kDrainPerIdleHour = 0.05f;
+constexpr float kChargePerHour = 40;
+constexpr float kChargeBelow = 15;
+
+constexpr double kCommandFailureRate = 0.03;
+
+uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+std::string MakeImei(size_t device)
+{
+    // 15 цифр, как у настоящих IMEI; префикс условный
+    std::string imei = "86949204" + std::string(7, '0');
+    auto value = std::to_string(device % 10000000);
+    imei.replace(imei.size() - value.size(), value.size(), value);
+    return imei;
+}
+
+void SetSensor(google::protobuf::Map<iot::backend::proto::TProtoStringType,
+                                     iot::backend::proto::TProtoStringType> &sensors,
+               const char *name, double value, int precision)
+{
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                                      std::chars_format::fixed, precision);
+    sensors[name].assign(buffer, result.ptr);
+}
+
+void WritePercentiles(std::ostream &out, const iot::backend::proto::metrics::Histogram &histogram)
+{
+    out << "p50 " << histogram.GetQuantile(0.5) << ", p90 " << histogram.GetQuantile(0.9)
+        << ", p99 " << histogram.GetQuantile(0.99) << ", p99.9 " << histogram.GetQuantile(0.999)
+        << ", max " << histogram.GetQuantile(1) << '\n';
+}
+
+void Merge(iot::backend::proto::FleetSimulatorReport       &to,
+           const iot::backend::proto::FleetSimulatorReport &from)
+{
+    to.packets += from.packets;
+    to.telemetry += from.telemetry;
+    to.command_results += from.command_results;
+    to.invalid += from.invalid;
+    to.bytes += from.bytes;
+    to.encode_ns.Merge(from.encode_ns);
+    to.decode_ns.Merge(from.decode_ns);
+}
+
+void RunThread(const iot::backend::proto::FleetSimulatorOptions &options,
+               size_t                                             first_device,
+               size_t                                             device_count,
+               uint64_t                                           packet_limit,
+               std::chrono::nanoseconds                           interval,
+               std::chrono::steady_clock::time_point              deadline,
+               iot::backend::proto::FleetSimulatorReport         &report)
+{
+    using namespace iot::backend::proto;
+    using Clock = std::chrono::steady_clock;
+
+    FleetModel              model(device_count, options.seed, first_device);
+    const ProtocolConverter converter(options.transport);
+
+    // Пакеты и буфер переиспользуются, как в настоящем цикле приёма
+    Packet      outgoing;
+    Packet      incoming;
+    std::string buffer;
+    char        chain_id[ChainId::kStringSize];
+
+    uint64_t   random_state = options.seed ^ (first_device * 0xD1B54A32D192ED03ull);
+    const auto result_threshold = static_cast<uint64_t>(
+        std::clamp(options.command_result_ratio, 0.0, 1.0) * static_cast<double>(UINT64_MAX));
+
+    auto next_send = Clock::now();
+
+    size_t cursor = 0;
+    for (uint64_t i = 0; packet_limit == 0 || i < packet_limit; ++i) {
+        if (options.duration.count() != 0 && (i & 63) == 0 && Clock::now() >= deadline)
+            break;
+        if (interval.count() != 0) {
+            next_send += interval;
+            if (next_send > Clock::now())
+                std::this_thread::sleep_until(next_send);
+        }
+
+        const auto start = Clock::now();
+        const bool is_result = SplitMix64(random_state) < result_threshold;
+        if (is_result) {
+            ChainId::Generate().FormatTo(chain_id);
+            model.MakeCommandResult(std::string_view(chain_id, sizeof(chain_id)), outgoing);
+        } else {
+            model.MakeTelemetry(cursor, options.telemetry_period, outgoing);
+            cursor = cursor + 1 == device_count ? 0 : cursor + 1;
+        }
+        buffer.clear();
+        converter.SerializeTo(outgoing, buffer);
+        const auto encoded = Clock::now();
+
+        converter.Deserialize(buffer, incoming);
+        const bool valid = IsValid(incoming);
+        const auto decoded = Clock::now();
+
+        ++report.packets;
+        ++(is_result ? report.command_results : report.telemetry);
+        report.invalid += !valid;
+        report.bytes += buffer.size();
+        report.encode_ns.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(encoded - start).count());
+        report.decode_ns.Add(std::chrono::duration_cast<std::chrono::nanoseconds>(decoded - encoded).count());
+    }
+}
+
+}  // namespace
+
+namespace iot::backend::proto {
+
+FleetModel::FleetModel(size_t device_count, uint64_t seed, size_t first_device)
+    : random_state_(seed ^ (first_device * 0x9E3779B97F4A7C15ull))
+{
+    devices_.resize(device_count);
+    for (size_t i = 0; i < device_count; ++i) {
+        auto &device = devices_[i];
+        // Начальное состояние зависит только от номера устройства и seed
+        uint64_t state = seed ^ ((first_device + i) * 0xBF58476D1CE4E5B9ull);
+        const auto uniform = [&state](double from, double to) {
+            return from + (to - from) * static_cast<double>(SplitMix64(state) >> 11) * 0x1.0p-53;
+        };
+
+        device.imei = MakeImei(first_device + i);
+        device.lat = kStartLat + uniform(-kStartSpread, kStartSpread);
+        device.lon = kStartLon + uniform(-kStartSpread, kStartSpread);
+        device.heading_deg = static_cast<float>(uniform(0, 360));
+        device.battery = static_cast<float>(uniform(20, 100));
+        device.gsm_signal_level = static_cast<float>(uniform(40, 95));
+        device.odometer_m = static_cast<uint64_t>(uniform(0, 2000000));
+        device.phase_left = std::chrono::milliseconds(static_cast<int64_t>(uniform(0, 3600000)));
+    }
+}
+
+uint64_t FleetModel::NextRandom()
+{
+    return SplitMix64(random_state_);
+}
+
+double FleetModel::Uniform(double from, double to)
+{
+    return from + (to - from) * static_cast<double>(NextRandom() >> 11) * 0x1.0p-53;
+}
+
+double FleetModel::Normal()
+{
+    // Бокс-Мюллер; 1 - u исключает log(0)
+    const double u = 1 - Uniform(0, 1);
+    const double v = Uniform(0, 1);
+    return std::sqrt(-2 * std::log(u)) * std::cos(2 * kPi * v);
+}
+
+void FleetModel::Advance(SimulatedDevice &device, std::chrono::milliseconds dt)
+{
+    const double hours = std::chrono::duration<double, std::ratio<3600>>(dt).count();
+
+    device.phase_left -= dt;
+    if (device.phase_left <= 0ms) {
+        if (device.locked && !device.charging) {
+            // Поездка 3-30 минут
+            device.locked = false;
+            device.cruise_speed_kmh = static_cast<float>(Uniform(10, 22));
+            device.phase_left = std::chrono::milliseconds(static_cast<int64_t>(Uniform(3, 30) * 60000));
+        } else if (!device.locked) {
+            // Стоянка 5-60 минут
+            device.locked = true;
+            device.phase_left = std::chrono::milliseconds(static_cast<int64_t>(Uniform(5, 60) * 60000));
+        } else {
+            device.phase_left = 0ms;
+        }
+    }
+
+    if (device.locked) {
+        device.speed_kmh = 0;
+        if (device.battery < kChargeBelow)
+            device.charging = true;
+        if (device.charging) {
+            device.battery = std::min(100.f, device.battery + static_cast<float>(kChargePerHour * hours));
+            if (device.battery >= 100)
+                device.charging = false;
+        } else {
+            device.battery = std::max(0.f, device.battery - static_cast<float>(kDrainPerIdleHour * hours));
+        }
+    } else {
+        device.speed_kmh = std::max(0.f, device.cruise_speed_kmh + static_cast<float>(Normal() * 2));
+        device.heading_deg = std::fmod(device.heading_deg + static_cast<float>(Normal() * 15) + 360.f, 360.f);
+
+        const double meters = device.speed_kmh * hours * 1000;
+        const double heading = device.heading_deg * kPi / 180;
+        device.lat += meters * std::cos(heading) / kMetersPerDegree;
+        device.lon += meters * std::sin(heading) / (kMetersPerDegree * std::cos(device.lat * kPi / 180));
+        device.odometer_m += static_cast<uint64_t>(meters);
+        device.battery = std::max(0.f, device.battery - static_cast<float>(kDrainPerKm * meters / 1000));
+        // Разряженный велосипед завершает поездку
+        if (device.battery < kChargeBelow / 2)
+            device.phase_left = 0ms;
+    }
+
+    device.gsm_signal_level = std::clamp(device.gsm_signal_level + static_cast<float>(Normal() * 3), 5.f, 99.f);
+}
+
+void FleetModel::MakeTelemetry(size_t index, std::chrono::milliseconds dt, Packet &packet)
+{
+    auto &device = devices_[index];
+    Advance(device, dt);
+
+    helpers::MakePacket(packet);
+    auto &payload = *packet.mutable_telemetry()->mutable_payload();
+    payload.set_battery_level(static_cast<uint32_t>(device.battery));
+    payload.set_speed_kmh(device.speed_kmh);
+    // Напряжение в В * 100: 33.00 В у пустой батареи, 42.00 В у полной
+    payload.set_voltage(3300 + static_cast<uint32_t>(device.battery * 9));
+    payload.set_gsm_signal_level(static_cast<uint32_t>(device.gsm_signal_level));
+    payload.set_charging(device.charging);
+    payload.set_locked(device.locked);
+
+    auto &location = *payload.mutable_location();
+    location.set_lat(static_cast<float>(device.lat));
+    location.set_lon(static_cast<float>(device.lon));
+    location.set_utc_time_ms(helpers::GetCurrentUtcTimestampMs());
+    location.set_satellites_amount(static_cast<uint32_t>(Uniform(6, 15)));
+    location.set_hdop(static_cast<float>(Uniform(0.6, 2.5)));
+    location.set_altitude_meters(static_cast<uint32_t>(Uniform(120, 180)));
+    location.set_valid(true);
+    location.set_speed(device.speed_kmh);
+
+    auto &sensors = *payload.mutable_sensors();
+    sensors["imei"] = device.imei;
+    sensors["odometer_m"] = std::to_string(device.odometer_m);
+    SetSensor(sensors, "Tyre pressure", Uniform(1.9, 2.3), 1);
+    SetSensor(sensors, "temperature", Uniform(15, 35), 1);
+}
+
+void FleetModel::MakeCommandResult(std::string_view chain_id, Packet &packet)
+{
+    // Логнормальное время выполнения: медиана 300 мс, длинный хвост
+    const auto execution_ms = static_cast<int32_t>(
+        std::min(60000.0, std::exp(std::log(300.0) + 0.6 * Normal())));
+    const auto delivery_s = static_cast<int32_t>(Uniform(0, 3));
+
+    if (Uniform(0, 1) < kCommandFailureRate) {
+        helpers::MakeCommandResultError(packet, chain_id, RESULT_FAILED, STATUS_UNAVAILABLE,
+                                        "Device is busy", std::nullopt, delivery_s,
+                                        execution_ms);
+    } else {
+        helpers::MakeCommandResultSuccess(packet, chain_id, std::nullopt, delivery_s,
+                                          execution_ms);
+    }
+}
+
+double FleetSimulatorReport::GetPacketsPerSecond() const
+{
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(packets) / seconds : 0;
+}
+
+std::string FleetSimulatorReport::ToText() const
+{
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << "packets:             " << packets << " (telemetry " << telemetry
+        << ", command_result " << command_results << ")\n";
+    out << "invalid:             " << invalid << '\n';
+    out << "elapsed:             " << seconds << " s\n";
+    out << "throughput:          " << GetPacketsPerSecond() << " packets/s, "
+        << (seconds > 0 ? static_cast<double>(bytes) / seconds / (1 << 20) : 0) << " MiB/s\n";
+    out << "encode, ns:          ";
+    WritePercentiles(out, encode_ns);
+    out << "decode+validate, ns: ";
+    WritePercentiles(out, decode_ns);
+    return out.str();
+}
+
+FleetSimulatorReport RunFleetSimulation(const FleetSimulatorOptions &options)
+{
+    if (options.device_count == 0)
+        throw std::invalid_argument("Fleet simulation needs at least one device");
+
+    size_t threads = std::clamp<size_t>(options.threads, 1, options.device_count);
+    if (options.packet_limit)
+        threads = std::min<size_t>(threads, options.packet_limit);
+    std::vector<FleetSimulatorReport> reports(threads);
+    std::vector<std::thread>          workers;
+
+    // Каждый поток выдаёт свою долю общего потока пакетов
+    const auto interval = options.packets_per_second
+                              ? std::chrono::nanoseconds(1s) * static_cast<int64_t>(threads) /
+                                    static_cast<int64_t>(options.packets_per_second)
+                              : std::chrono::nanoseconds(0);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + options.duration;
+    size_t     first_device = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        const size_t devices = options.device_count / threads + (t < options.device_count % threads);
+        const uint64_t limit =
+            options.packet_limit ? options.packet_limit / threads + (t < options.packet_limit % threads) : 0;
+        workers.emplace_back(RunThread, std::cref(options), first_device, devices, limit,
+                             interval, deadline, std::ref(reports[t]));
+        first_device += devices;
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    FleetSimulatorReport report;
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    for (const auto &thread_report : reports)
+        Merge(report, thread_report);
+    return report;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "hot_path_metrics.h"
+#include "protocol_converter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Состояние одного симулируемого велосипеда
+struct SimulatedDevice {
+    std::string imei;
+    double      lat = 0;
+    double      lon = 0;
+    /// Курс, градусы от направления на север по часовой стрелке
+    float    heading_deg = 0;
+    float    speed_kmh = 0;
+    float    cruise_speed_kmh = 0;
+    /// Заряд батареи, %
+    float    battery = 100;
+    float    gsm_signal_level = 80;
+    uint64_t odometer_m = 0;
+    bool     locked = true;
+    bool     charging = false;
+    /// Сколько ещё длится текущая поездка или стоянка
+    std::chrono::milliseconds phase_left{0};
+};
+
+/// Детерминированная (при одинаковом seed) модель парка велосипедов:
+/// стоянки чередуются с поездками, в поездке велосипед едет со случайно
+/// меняющимся курсом и тратит заряд пропорционально пробегу, разряженный
+/// велосипед на стоянке заряжается. Модель не потокобезопасна: для
+/// нескольких потоков нужны отдельные экземпляры со своими устройствами.
+class FleetModel {
+  public:
+    /// Устройства с номерами [first_device, first_device + device_count):
+    /// их imei и начальное состояние зависят только от номера и seed
+    FleetModel(size_t device_count, uint64_t seed, size_t first_device = 0);
+
+    [[nodiscard]] size_t GetDeviceCount() const { return devices_.size(); }
+    [[nodiscard]] const SimulatedDevice &GetDevice(size_t device) const
+    {
+        return devices_[device];
+    }
+
+    /// Продвигает устройство на dt модельного времени и заполняет packet
+    /// его телеметрией (прежнее содержимое packet заменяется)
+    void MakeTelemetry(size_t device, std::chrono::milliseconds dt, Packet &packet);
+
+    /// Ответ устройства на команду chain_id: успех с реалистичным
+    /// cmd_execution_time_ms (логнормальное распределение, медиана ~300 мс)
+    /// или, изредка, ошибка
+    void MakeCommandResult(std::string_view chain_id, Packet &packet);
+
+  private:
+    void Advance(SimulatedDevice &device, std::chrono::milliseconds dt);
+
+    /// splitmix64
+    uint64_t NextRandom();
+    /// Равномерно на [from, to)
+    double Uniform(double from, double to);
+    /// Стандартное нормальное распределение
+    double Normal();
+
+    std::vector<SimulatedDevice> devices_;
+    uint64_t                     random_state_;
+};
+
+struct FleetSimulatorOptions {
+    size_t device_count = 100000;
+    size_t threads = 1;
+    ProtocolConverter::TransportDataType transport =
+        ProtocolConverter::TransportDataType::BINARY;
+    /// Период телеметрии устройства в модельном времени
+    std::chrono::milliseconds telemetry_period{10000};
+    /// Доля пакетов CommandResult среди всех пакетов
+    double command_result_ratio = 0.05;
+    /// Ограничение суммарного потока пакетов в секунду, 0 - без ограничения
+    uint64_t packets_per_second = 0;
+    /// Прогон заканчивается по времени или по числу пакетов (0 - не ограничено)
+    std::chrono::milliseconds duration{10000};
+    uint64_t                  packet_limit = 0;
+    uint64_t                  seed = 1;
+};
+
+struct FleetSimulatorReport {
+    uint64_t packets = 0;
+    uint64_t telemetry = 0;
+    uint64_t command_results = 0;
+    /// Пакеты, не прошедшие IsValid после разбора
+    uint64_t invalid = 0;
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed{0};
+
+    /// Сторона устройства: сборка пакета и ProtocolConverter::SerializeTo
+    metrics::Histogram encode_ns;
+    /// Сторона бэкенда: ProtocolConverter::Deserialize и IsValid
+    metrics::Histogram decode_ns;
+
+    [[nodiscard]] double GetPacketsPerSecond() const;
+    [[nodiscard]] std::string ToText() const;
+};
+
+/// Гоняет трафик парка через ProtocolConverter и IsValid в options.threads
+/// потоках: каждый поток симулирует свою часть устройств, сериализует их
+/// пакеты как устройство и разбирает и проверяет их как бэкенд.
+[[nodiscard]] FleetSimulatorReport RunFleetSimulation(const FleetSimulatorOptions &options);
+
+}  // namespace iot::backend::proto
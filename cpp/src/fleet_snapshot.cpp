@@ -0,0 +1,447 @@
+#include "fleet_snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr uint8_t kUnknownFlag = 0xFF;
+constexpr float   kUnknownFloat = std::numeric_limits<float>::quiet_NaN();
+
+enum class ColumnKind : uint8_t { FLOAT, FLAG, TIME };
+
+ColumnKind GetKind(FleetColumn column)
+{
+    if (column <= FleetColumn::GSM_SIGNAL_LEVEL)
+        return ColumnKind::FLOAT;
+    if (column <= FleetColumn::LOCKED)
+        return ColumnKind::FLAG;
+    return ColumnKind::TIME;
+}
+
+// Номер колонки среди колонок своего типа
+size_t GetSlot(FleetColumn column)
+{
+    switch (GetKind(column)) {
+        case ColumnKind::FLOAT:
+            return static_cast<size_t>(column);
+        case ColumnKind::FLAG:
+            return static_cast<size_t>(column) - static_cast<size_t>(FleetColumn::CHARGING);
+        case ColumnKind::TIME:
+            return static_cast<size_t>(column) - static_cast<size_t>(FleetColumn::LAST_SEEN_S);
+    }
+    return 0;
+}
+
+template <FleetCompare Op, class T>
+inline bool Compare(T value, T bound)
+{
+    switch (Op) {
+        case FleetCompare::LESS:
+            return value < bound;
+        case FleetCompare::LESS_EQUAL:
+            return value <= bound;
+        case FleetCompare::GREATER:
+            return value > bound;
+        case FleetCompare::GREATER_EQUAL:
+            return value >= bound;
+        case FleetCompare::EQUAL:
+            return value == bound;
+        case FleetCompare::NOT_EQUAL:
+            return value != bound;
+    }
+    return false;
+}
+
+// Маска блока из 64 значений float; NaN не удовлетворяет ни одному условию
+template <FleetCompare Op>
+uint64_t EvalFloats(const float *data, float bound)
+{
+    uint64_t word = 0;
+#if defined(__SSE2__)
+    const __m128 bounds = _mm_set1_ps(bound);
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; i += 4) {
+        const __m128 values = _mm_loadu_ps(data + i);
+        __m128       mask;
+        switch (Op) {
+            case FleetCompare::LESS:
+                mask = _mm_cmplt_ps(values, bounds);
+                break;
+            case FleetCompare::LESS_EQUAL:
+                mask = _mm_cmple_ps(values, bounds);
+                break;
+            case FleetCompare::GREATER:
+                mask = _mm_cmpgt_ps(values, bounds);
+                break;
+            case FleetCompare::GREATER_EQUAL:
+                mask = _mm_cmpge_ps(values, bounds);
+                break;
+            case FleetCompare::EQUAL:
+                mask = _mm_cmpeq_ps(values, bounds);
+                break;
+            case FleetCompare::NOT_EQUAL:
+                // cmpneq истинно для NaN
+                mask = _mm_and_ps(_mm_cmpneq_ps(values, bounds), _mm_cmpord_ps(values, values));
+                break;
+        }
+        word |= static_cast<uint64_t>(_mm_movemask_ps(mask)) << i;
+    }
+#else
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; ++i) {
+        const bool match = Op == FleetCompare::NOT_EQUAL ? !std::isnan(data[i]) && data[i] != bound
+                                                         : Compare<Op>(data[i], bound);
+        word |= static_cast<uint64_t>(match) << i;
+    }
+#endif
+    return word;
+}
+
+// Маска блока из 64 значений uint32
+template <FleetCompare Op>
+uint64_t EvalTimes(const uint32_t *data, uint32_t bound)
+{
+    uint64_t word = 0;
+#if defined(__SSE2__)
+    // В SSE2 есть только знаковые сравнения: сдвиг диапазона на 2^31
+    const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    const __m128i bounds = _mm_xor_si128(_mm_set1_epi32(static_cast<int>(bound)), bias);
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; i += 4) {
+        const __m128i values =
+            _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)), bias);
+        __m128i mask;
+        bool    invert = false;
+        switch (Op) {
+            case FleetCompare::LESS:
+                mask = _mm_cmplt_epi32(values, bounds);
+                break;
+            case FleetCompare::LESS_EQUAL:
+                mask = _mm_cmpgt_epi32(values, bounds);
+                invert = true;
+                break;
+            case FleetCompare::GREATER:
+                mask = _mm_cmpgt_epi32(values, bounds);
+                break;
+            case FleetCompare::GREATER_EQUAL:
+                mask = _mm_cmplt_epi32(values, bounds);
+                invert = true;
+                break;
+            case FleetCompare::EQUAL:
+                mask = _mm_cmpeq_epi32(values, bounds);
+                break;
+            case FleetCompare::NOT_EQUAL:
+                mask = _mm_cmpeq_epi32(values, bounds);
+                invert = true;
+                break;
+        }
+        const auto bits = static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(mask)));
+        word |= (invert ? bits ^ 0xF : bits) << i;
+    }
+#else
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; ++i)
+        word |= static_cast<uint64_t>(Compare<Op>(data[i], bound)) << i;
+#endif
+    return word;
+}
+
+// Маска блока из 64 флагов: строки со значением 0 (zero) и 1 (one)
+uint64_t EvalFlags(const uint8_t *data, bool zero, bool one)
+{
+    uint64_t word = 0;
+#if defined(__SSE2__)
+    const __m128i zeros = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(1);
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; i += 16) {
+        const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i       mask = _mm_setzero_si128();
+        if (zero)
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(values, zeros));
+        if (one)
+            mask = _mm_or_si128(mask, _mm_cmpeq_epi8(values, ones));
+        word |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(mask))) << i;
+    }
+#else
+    for (size_t i = 0; i < FleetSnapshot::kBlockRows; ++i)
+        word |= static_cast<uint64_t>((zero && data[i] == 0) || (one && data[i] == 1)) << i;
+#endif
+    return word;
+}
+
+#define FLEET_DISPATCH(Name, Type)                                                                                     \
+    uint64_t Name##Dispatch(FleetCompare op, const Type *data, Type bound)                                             \
+    {                                                                                                                  \
+        switch (op) {                                                                                                  \
+            case FleetCompare::LESS:                                                                                   \
+                return Name<FleetCompare::LESS>(data, bound);                                                          \
+            case FleetCompare::LESS_EQUAL:                                                                             \
+                return Name<FleetCompare::LESS_EQUAL>(data, bound);                                                    \
+            case FleetCompare::GREATER:                                                                                \
+                return Name<FleetCompare::GREATER>(data, bound);                                                       \
+            case FleetCompare::GREATER_EQUAL:                                                                          \
+                return Name<FleetCompare::GREATER_EQUAL>(data, bound);                                                 \
+            case FleetCompare::EQUAL:                                                                                  \
+                return Name<FleetCompare::EQUAL>(data, bound);                                                         \
+            case FleetCompare::NOT_EQUAL:                                                                              \
+                return Name<FleetCompare::NOT_EQUAL>(data, bound);                                                     \
+        }                                                                                                              \
+        return 0;                                                                                                      \
+    }
+
+FLEET_DISPATCH(EvalFloats, float)
+FLEET_DISPATCH(EvalTimes, uint32_t)
+
+#undef FLEET_DISPATCH
+
+}  // namespace
+
+size_t FleetSelection::Count() const
+{
+    size_t count = 0;
+    for (const uint64_t word : words_)
+        count += __builtin_popcountll(word);
+    return count;
+}
+
+FleetSelection &FleetSelection::operator&=(const FleetSelection &other)
+{
+    if (other.size_ != size_)
+        throw std::invalid_argument("Fleet selections of different sizes");
+    for (size_t i = 0; i < words_.size(); ++i)
+        words_[i] &= other.words_[i];
+    return *this;
+}
+
+FleetSelection &FleetSelection::operator|=(const FleetSelection &other)
+{
+    if (other.size_ != size_)
+        throw std::invalid_argument("Fleet selections of different sizes");
+    for (size_t i = 0; i < words_.size(); ++i)
+        words_[i] |= other.words_[i];
+    return *this;
+}
+
+struct FleetSnapshot::CompiledPredicate {
+    ColumnKind   kind;
+    size_t       slot;
+    FleetCompare op;
+    float        float_bound = 0;
+    uint32_t     time_bound = 0;
+    /// Для флагов: подходят ли значения 0 и 1
+    bool zero = false;
+    bool one = false;
+};
+
+uint32_t FleetSnapshot::Update(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload)
+{
+    auto it = index_.find(device_id);
+    if (it == index_.end()) {
+        const auto row = static_cast<uint32_t>(ids_.size());
+        if (row % kBlockRows == 0) {
+            for (auto &column : floats_)
+                column.resize(row + kBlockRows, kUnknownFloat);
+            for (auto &column : flags_)
+                column.resize(row + kBlockRows, kUnknownFlag);
+            for (auto &column : times_)
+                column.resize(row + kBlockRows, 0);
+        }
+        it = index_.emplace(std::string(device_id), row).first;
+        ids_.push_back(&it->first);
+    }
+    const uint32_t row = it->second;
+
+    const auto set_float = [&](FleetColumn column, float value) { floats_[GetSlot(column)][row] = value; };
+    if (payload.has_battery_level())
+        set_float(FleetColumn::BATTERY_LEVEL, static_cast<float>(payload.battery_level()));
+    if (payload.has_voltage())
+        set_float(FleetColumn::VOLTAGE, static_cast<float>(payload.voltage()));
+    if (payload.has_speed_kmh())
+        set_float(FleetColumn::SPEED_KMH, payload.speed_kmh());
+    if (payload.has_location()) {
+        set_float(FleetColumn::LAT, payload.location().lat());
+        set_float(FleetColumn::LON, payload.location().lon());
+    }
+    if (payload.has_gsm_signal_level()) {
+        set_float(FleetColumn::GSM_SIGNAL_LEVEL, static_cast<float>(payload.gsm_signal_level()));
+        if (payload.gsm_signal_level() > 0)
+            times_[GetSlot(FleetColumn::GSM_SEEN_S)][row] = static_cast<uint32_t>(time_s);
+    }
+    if (payload.has_charging())
+        flags_[GetSlot(FleetColumn::CHARGING)][row] = payload.charging();
+    if (payload.has_locked())
+        flags_[GetSlot(FleetColumn::LOCKED)][row] = payload.locked();
+    times_[GetSlot(FleetColumn::LAST_SEEN_S)][row] = static_cast<uint32_t>(time_s);
+    return row;
+}
+
+int64_t FleetSnapshot::FindRow(std::string_view device_id) const
+{
+    const auto it = index_.find(device_id);
+    return it == index_.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+double FleetSnapshot::GetValue(FleetColumn column, uint32_t row) const
+{
+    const size_t slot = GetSlot(column);
+    switch (GetKind(column)) {
+        case ColumnKind::FLOAT:
+            return floats_[slot][row];
+        case ColumnKind::FLAG:
+            return flags_[slot][row] == kUnknownFlag ? std::numeric_limits<double>::quiet_NaN() : flags_[slot][row];
+        case ColumnKind::TIME:
+            return times_[slot][row];
+    }
+    return 0;
+}
+
+std::vector<FleetSnapshot::CompiledPredicate>
+FleetSnapshot::Compile(const std::vector<FleetPredicate> &predicates) const
+{
+    std::vector<CompiledPredicate> compiled;
+    compiled.reserve(predicates.size());
+    for (const auto &predicate : predicates) {
+        CompiledPredicate &result = compiled.emplace_back();
+        result.kind = GetKind(predicate.column);
+        result.slot = GetSlot(predicate.column);
+        result.op = predicate.op;
+        const double value = predicate.value;
+        switch (result.kind) {
+            case ColumnKind::FLOAT:
+                if (std::isnan(value))
+                    throw std::invalid_argument("NaN in fleet predicate");
+                result.float_bound = static_cast<float>(value);
+                break;
+            case ColumnKind::TIME:
+                if (!(value >= 0 && value <= UINT32_MAX) || value != std::floor(value))
+                    throw std::invalid_argument("Time in fleet predicate is not uint32 seconds");
+                result.time_bound = static_cast<uint32_t>(value);
+                break;
+            case ColumnKind::FLAG: {
+                if (value != 0 && value != 1)
+                    throw std::invalid_argument("Flag in fleet predicate is not 0 or 1");
+                // Флаг принимает два значения: условие - это набор подходящих
+                const bool bound = value == 1;
+                for (const bool flag : {false, true}) {
+                    const bool match = [&] {
+                        switch (predicate.op) {
+                            case FleetCompare::LESS:
+                                return flag < bound;
+                            case FleetCompare::LESS_EQUAL:
+                                return flag <= bound;
+                            case FleetCompare::GREATER:
+                                return flag > bound;
+                            case FleetCompare::GREATER_EQUAL:
+                                return flag >= bound;
+                            case FleetCompare::EQUAL:
+                                return flag == bound;
+                            case FleetCompare::NOT_EQUAL:
+                                return flag != bound;
+                        }
+                        return false;
+                    }();
+                    (flag ? result.one : result.zero) = match;
+                }
+                break;
+            }
+        }
+    }
+    return compiled;
+}
+
+uint64_t FleetSnapshot::EvalBlock(const CompiledPredicate &predicate, size_t first_row) const
+{
+    switch (predicate.kind) {
+        case ColumnKind::FLOAT:
+            return EvalFloatsDispatch(predicate.op, floats_[predicate.slot].data() + first_row, predicate.float_bound);
+        case ColumnKind::TIME:
+            return EvalTimesDispatch(predicate.op, times_[predicate.slot].data() + first_row, predicate.time_bound);
+        case ColumnKind::FLAG:
+            return EvalFlags(flags_[predicate.slot].data() + first_row, predicate.zero, predicate.one);
+    }
+    return 0;
+}
+
+void FleetSnapshot::Filter(
+    const std::vector<FleetPredicate> &predicates, FleetSelection &selection, size_t begin, size_t end) const
+{
+    if (selection.GetSize() != GetSize())
+        throw std::invalid_argument("Fleet selection does not match the snapshot");
+    if (begin % kBlockRows != 0 || (end % kBlockRows != 0 && end != GetSize()) || begin > end || end > GetSize())
+        throw std::invalid_argument("Fleet filter range is not aligned to blocks");
+
+    FilterRange(Compile(predicates), selection, begin, end);
+}
+
+void FleetSnapshot::FilterRange(
+    const std::vector<CompiledPredicate> &compiled, FleetSelection &selection, size_t begin, size_t end) const
+{
+    auto &words = selection.GetWords();
+    for (size_t first_row = begin; first_row < end; first_row += kBlockRows) {
+        // Строки-заполнители последнего блока не выбираются
+        const size_t rows = std::min(kBlockRows, end - first_row);
+        uint64_t     word = rows == kBlockRows ? ~uint64_t{0} : (uint64_t{1} << rows) - 1;
+        for (const auto &predicate : compiled) {
+            word &= EvalBlock(predicate, first_row);
+            if (word == 0)
+                break;
+        }
+        words[first_row / kBlockRows] = word;
+    }
+}
+
+FleetSelection FleetSnapshot::Filter(const std::vector<FleetPredicate> &predicates) const
+{
+    FleetSelection selection(GetSize());
+    Filter(predicates, selection, 0, GetSize());
+    return selection;
+}
+
+FleetSelection FleetSnapshot::ParallelFilter(const std::vector<FleetPredicate> &predicates, size_t threads) const
+{
+    FleetSelection selection(GetSize());
+    const size_t   blocks = (GetSize() + kBlockRows - 1) / kBlockRows;
+    // Потоков не больше ядер и не меньше kMinBlocksPerThread блоков на
+    // поток: иначе запуск потоков и их борьба за ядро дороже скана
+    threads = std::min({threads, static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency())),
+                        blocks / kMinBlocksPerThread});
+    threads = std::max<size_t>(1, threads);
+    if (threads == 1) {
+        Filter(predicates, selection, 0, GetSize());
+        return selection;
+    }
+
+    // Условия приводятся до запуска потоков: исключение в потоке завершило
+    // бы процесс
+    const auto compiled = Compile(predicates);
+    // Потоки пишут в разные слова маски
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    const auto range = [&](size_t thread) {
+        const size_t begin = blocks * thread / threads * kBlockRows;
+        const size_t end = std::min(GetSize(), blocks * (thread + 1) / threads * kBlockRows);
+        FilterRange(compiled, selection, begin, end);
+    };
+    for (size_t thread = 1; thread < threads; ++thread)
+        workers.emplace_back(range, thread);
+    range(0);
+    for (auto &worker : workers)
+        worker.join();
+    return selection;
+}
+
+std::vector<double> FleetSnapshot::Project(const FleetSelection &selection, FleetColumn column) const
+{
+    std::vector<double> values;
+    values.reserve(selection.Count());
+    selection.ForEach([&](size_t row) { values.push_back(GetValue(column, static_cast<uint32_t>(row))); });
+    return values;
+}
+
+}  // namespace iot::backend::proto
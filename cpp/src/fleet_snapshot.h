@@ -0,0 +1,154 @@
+#pragma once
+
+#include "telemetry_payload.pb.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Колонки FleetSnapshot
+enum class FleetColumn : uint8_t {
+    // float, NaN - значение неизвестно
+    BATTERY_LEVEL,
+    VOLTAGE,
+    SPEED_KMH,
+    LAT,
+    LON,
+    GSM_SIGNAL_LEVEL,
+    // 0 или 1, 0xFF - значение неизвестно
+    CHARGING,
+    LOCKED,
+    // Секунды UTC
+    LAST_SEEN_S,
+    /// Последний пакет с gsm_signal_level > 0, 0 - такого не было
+    GSM_SEEN_S,
+};
+
+enum class FleetCompare : uint8_t {
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL,
+};
+
+/// Условие "column op value". Устройства с неизвестным значением колонки
+/// условию не удовлетворяют, в том числе NOT_EQUAL.
+struct FleetPredicate {
+    FleetColumn  column;
+    FleetCompare op;
+    double       value;
+};
+
+/// Битовая маска строк снимка
+class FleetSelection {
+  public:
+    explicit FleetSelection(size_t size = 0) : size_(size), words_((size + 63) / 64, 0) {}
+
+    [[nodiscard]] size_t GetSize() const { return size_; }
+    [[nodiscard]] size_t Count() const;
+    [[nodiscard]] bool   Test(size_t row) const { return (words_[row / 64] >> (row % 64)) & 1; }
+
+    /// Размеры должны совпадать
+    FleetSelection &operator&=(const FleetSelection &other);
+    FleetSelection &operator|=(const FleetSelection &other);
+
+    /// func(row) для выбранных строк по возрастанию
+    template <class Func>
+    void ForEach(Func &&func) const
+    {
+        for (size_t i = 0; i < words_.size(); ++i) {
+            for (uint64_t word = words_[i]; word != 0; word &= word - 1)
+                func(i * 64 + __builtin_ctzll(word));
+        }
+    }
+
+    [[nodiscard]] std::vector<uint64_t>       &GetWords() { return words_; }
+    [[nodiscard]] const std::vector<uint64_t> &GetWords() const { return words_; }
+
+  private:
+    size_t                size_;
+    std::vector<uint64_t> words_;
+};
+
+/// Состояние парка по колонкам (struct of arrays): последние пришедшие
+/// значения типизированных полей TelemetryPayload и время пакетов, строка
+/// на устройство.
+///
+/// Filter проверяет конъюнкцию условий блоками по 64 строки: каждое условие
+/// сравнивает 4 (float, uint32) или 16 (флаги) значений колонки за
+/// инструкцию SSE2 и даёт слово маски, следующие условия блока не
+/// проверяются, если слово уже нулевое. Колонки выровнены по блокам, так что
+/// диапазоны блоков независимы и сканируются параллельно (ParallelFilter).
+///
+/// Update не потокобезопасен, константные методы можно вызывать
+/// одновременно из разных потоков.
+class FleetSnapshot {
+  public:
+    static constexpr size_t kBlockRows = 64;
+
+    /// Строка устройства: новое устройство добавляется в конец. Поля,
+    /// отсутствующие в payload, сохраняют прошлые значения.
+    uint32_t Update(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload);
+
+    [[nodiscard]] size_t           GetSize() const { return ids_.size(); }
+    [[nodiscard]] std::string_view GetDeviceId(uint32_t row) const { return *ids_[row]; }
+    /// Строка устройства или -1
+    [[nodiscard]] int64_t FindRow(std::string_view device_id) const;
+    /// Значение колонки, NaN для неизвестного
+    [[nodiscard]] double GetValue(FleetColumn column, uint32_t row) const;
+
+    /// Строки, удовлетворяющие всем условиям (пустой список - все строки).
+    /// std::invalid_argument для значения, которое не представимо в типе
+    /// колонки (например, флаг не 0 и не 1).
+    [[nodiscard]] FleetSelection Filter(const std::vector<FleetPredicate> &predicates) const;
+    /// То же для строк [begin, end) в уже созданную маску размера GetSize():
+    /// begin и end кратны kBlockRows (end может быть равен GetSize()), и
+    /// слова маски вне диапазона не меняются. std::invalid_argument для
+    /// других границ.
+    void Filter(const std::vector<FleetPredicate> &predicates, FleetSelection &selection, size_t begin, size_t end) const;
+    /// Filter диапазонами блоков в threads потоках, если ядер и строк
+    /// достаточно, чтобы это окупилось
+    [[nodiscard]] FleetSelection ParallelFilter(const std::vector<FleetPredicate> &predicates, size_t threads) const;
+
+    /// Значения колонки для выбранных строк по возрастанию строк, NaN для
+    /// неизвестных
+    [[nodiscard]] std::vector<double> Project(const FleetSelection &selection, FleetColumn column) const;
+
+  private:
+    /// Меньше блоков (по kBlockRows строк) на поток не окупает его запуск
+    static constexpr size_t kMinBlocksPerThread = 1024;
+    static constexpr size_t kFloatColumns = 6;
+    static constexpr size_t kFlagColumns = 2;
+    static constexpr size_t kTimeColumns = 2;
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    /// Условие, приведённое к типу колонки
+    struct CompiledPredicate;
+    [[nodiscard]] std::vector<CompiledPredicate> Compile(const std::vector<FleetPredicate> &predicates) const;
+    [[nodiscard]] uint64_t EvalBlock(const CompiledPredicate &predicate, size_t first_row) const;
+    /// Filter по уже приведённым условиям и проверенному диапазону; не
+    /// бросает исключений, поэтому вызывается из потоков ParallelFilter
+    void FilterRange(const std::vector<CompiledPredicate> &compiled, FleetSelection &selection, size_t begin,
+                     size_t end) const;
+
+    /// Колонки дополнены до целого числа блоков неизвестными значениями
+    std::vector<float>    floats_[kFloatColumns];
+    std::vector<uint8_t>  flags_[kFlagColumns];
+    std::vector<uint32_t> times_[kTimeColumns];
+
+    /// Ключи index_ по строкам
+    std::vector<const std::string *> ids_;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> index_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,404 @@
+#include "fleet_state_file.h"
+
+#include "checksum.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr char     kMagic[8] = {'I', 'O', 'T', 'F', 'L', 'E', 'E', 'T'};
+constexpr uint64_t kHeaderSeed = 0x6A09E667F3BCC908ULL;
+constexpr uint64_t kTablesSeed = 0xBB67AE8584CAA73BULL;
+constexpr uint64_t kBlockSeed = 0x3C6EF372FE94F82BULL;
+constexpr uint64_t kIndexSeed = 0xA54FF53A5F1D36F1ULL;
+constexpr size_t   kAlignment = 64;
+
+struct FileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t size;
+    uint32_t block_rows;
+    uint32_t index_bits;
+    uint64_t created_s;
+    /// Сумма контрольных сумм блоков и индекса
+    uint64_t tables_checksum;
+    uint64_t reserved;
+    /// Сумма предыдущих полей
+    uint64_t header_checksum;
+};
+
+static_assert(sizeof(FileHeader) == kAlignment);
+
+/// Смещения частей файла
+struct Layout {
+    size_t checksums;
+    size_t index;
+    size_t records;
+    size_t file_size;
+};
+
+size_t AlignUp(size_t value)
+{
+    return (value + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+size_t GetBlockCount(size_t size)
+{
+    return (size + DeviceStateSnapshot::kBlockRows - 1) / DeviceStateSnapshot::kBlockRows;
+}
+
+Layout GetLayout(size_t size, uint32_t index_bits)
+{
+    Layout layout;
+    layout.checksums = sizeof(FileHeader);
+    layout.index = AlignUp(layout.checksums + GetBlockCount(size) * sizeof(uint64_t));
+    layout.records = AlignUp(layout.index + (size_t{1} << index_bits) * sizeof(uint64_t));
+    layout.file_size = layout.records + size * sizeof(DeviceState);
+    return layout;
+}
+
+uint64_t HashDeviceId(std::string_view device_id)
+{
+    return Checksum64(device_id.data(), device_id.size(), kIndexSeed);
+}
+
+uint64_t ChecksumHeader(const FileHeader &header)
+{
+    return Checksum64(&header, offsetof(FileHeader, header_checksum), kHeaderSeed);
+}
+
+uint64_t ChecksumBlock(const DeviceState *records, size_t count, size_t block)
+{
+    return Checksum64(records, count * sizeof(DeviceState), kBlockSeed ^ block);
+}
+
+uint64_t ChecksumTables(const uint64_t *checksums, size_t blocks, const uint64_t *index, size_t slots)
+{
+    return Checksum64(index, slots * sizeof(uint64_t), Checksum64(checksums, blocks * sizeof(uint64_t), kTablesSeed));
+}
+
+[[noreturn]] void ThrowError(const char *action, const std::string &path)
+{
+    throw std::runtime_error(std::string(action) + " failed for " + path + ": " + std::strerror(errno));
+}
+
+[[noreturn]] void ThrowCorrupt(const std::string &path, const char *reason)
+{
+    throw std::runtime_error("Fleet state file " + path + " is not usable: " + reason);
+}
+
+/// Файл, который удаляется, если его не довели до rename
+class TempFile {
+  public:
+    explicit TempFile(std::string path) : path_(std::move(path))
+    {
+        fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            ThrowError("open", path_);
+    }
+
+    ~TempFile()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        if (!committed_)
+            ::unlink(path_.c_str());
+    }
+
+    void Write(const void *data, size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        while (size > 0) {
+            const ssize_t written = ::write(fd_, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                ThrowError("write", path_);
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    void PadTo(size_t offset, size_t &position)
+    {
+        static constexpr char kZeros[kAlignment] = {};
+        Write(kZeros, offset - position);
+        position = offset;
+    }
+
+    void Commit(const std::string &path)
+    {
+        if (::fdatasync(fd_) != 0)
+            ThrowError("fdatasync", path_);
+        if (::close(std::exchange(fd_, -1)) != 0)
+            ThrowError("close", path_);
+        if (::rename(path_.c_str(), path.c_str()) != 0)
+            ThrowError("rename", path_);
+        committed_ = true;
+    }
+
+  private:
+    std::string path_;
+    int         fd_ = -1;
+    bool        committed_ = false;
+};
+
+}  // namespace
+
+DeviceStateTable::DeviceStateTable(const FleetStateFile &file)
+{
+    const size_t size = file.GetSize();
+    index_.reserve(size);
+    for (size_t block = 0; block < file.GetBlockCount(); ++block) {
+        const DeviceState *records = file.GetBlock(block);
+        const size_t       count = std::min(DeviceStateSnapshot::kBlockRows, size - size_);
+        auto               copy = std::make_shared<Block>();
+        std::copy_n(records, count, copy->begin());
+        blocks_.push_back(std::move(copy));
+        for (size_t i = 0; i < count; ++i)
+            index_.emplace(records[i].GetDeviceId(), static_cast<uint32_t>(size_ + i));
+        size_ += count;
+    }
+}
+
+uint32_t DeviceStateTable::GetRow(std::string_view device_id)
+{
+    if (const auto it = index_.find(device_id); it != index_.end())
+        return it->second;
+    if (device_id.size() > DeviceState::kMaxDeviceIdSize)
+        throw std::invalid_argument("Device id is too long for fleet state");
+    const auto row = static_cast<uint32_t>(size_++);
+    if (row % DeviceStateSnapshot::kBlockRows == 0)
+        blocks_.push_back(std::make_shared<Block>());
+    index_.emplace(std::string(device_id), row);
+    DeviceState &state = GetMutable(row);
+    state.device_id_size = static_cast<uint8_t>(device_id.size());
+    std::memcpy(state.device_id, device_id.data(), device_id.size());
+    return row;
+}
+
+DeviceState &DeviceStateTable::GetMutable(uint32_t row)
+{
+    auto &block = blocks_[row / DeviceStateSnapshot::kBlockRows];
+    // Блок держит снимок: копия уходит таблице, снимку остаётся оригинал.
+    // Счётчик могут уменьшать только потоки со снимками, так что лишней
+    // будет в худшем случае копия, но не запись в чужой блок.
+    if (block.use_count() > 1)
+        block = std::make_shared<Block>(*block);
+    return (*block)[row % DeviceStateSnapshot::kBlockRows];
+}
+
+uint32_t DeviceStateTable::UpdateTelemetry(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload)
+{
+    const uint32_t row = GetRow(device_id);
+    DeviceState   &state = GetMutable(row);
+    if (payload.has_battery_level())
+        state.battery_level = static_cast<float>(payload.battery_level());
+    if (payload.has_voltage())
+        state.voltage = static_cast<float>(payload.voltage());
+    if (payload.has_speed_kmh())
+        state.speed_kmh = payload.speed_kmh();
+    if (payload.has_location()) {
+        state.lat = payload.location().lat();
+        state.lon = payload.location().lon();
+    }
+    if (payload.has_gsm_signal_level()) {
+        state.gsm_signal_level = static_cast<float>(payload.gsm_signal_level());
+        if (payload.gsm_signal_level() > 0)
+            state.gsm_seen_s = static_cast<uint32_t>(time_s);
+    }
+    if (payload.has_charging())
+        state.charging = payload.charging();
+    if (payload.has_locked())
+        state.locked = payload.locked();
+    state.last_seen_s = static_cast<uint32_t>(time_s);
+    return row;
+}
+
+void DeviceStateTable::SetCommandChainId(std::string_view device_id, const ChainId &chain_id)
+{
+    GetMutable(GetRow(device_id)).command_chain_id = chain_id;
+}
+
+void DeviceStateTable::SetResultChainId(std::string_view device_id, const ChainId &chain_id)
+{
+    GetMutable(GetRow(device_id)).result_chain_id = chain_id;
+}
+
+void DeviceStateTable::SetConfigHash(std::string_view device_id, uint64_t config_hash)
+{
+    GetMutable(GetRow(device_id)).config_hash = config_hash;
+}
+
+const DeviceState *DeviceStateTable::Find(std::string_view device_id) const
+{
+    const auto it = index_.find(device_id);
+    if (it == index_.end())
+        return nullptr;
+    return &(*blocks_[it->second / DeviceStateSnapshot::kBlockRows])[it->second % DeviceStateSnapshot::kBlockRows];
+}
+
+DeviceStateSnapshot DeviceStateTable::TakeSnapshot() const
+{
+    DeviceStateSnapshot snapshot;
+    snapshot.blocks_.assign(blocks_.begin(), blocks_.end());
+    snapshot.size_ = size_;
+    return snapshot;
+}
+
+void WriteFleetStateFile(const DeviceStateSnapshot &snapshot, const std::string &path, uint64_t created_s)
+{
+    const size_t size = snapshot.GetSize();
+    const size_t blocks = GetBlockCount(size);
+    uint32_t     index_bits = 0;
+    while ((size_t{1} << index_bits) < size + size / 2 + 1)
+        ++index_bits;
+    const size_t slots = size_t{1} << index_bits;
+
+    std::vector<uint64_t> checksums(blocks);
+    std::vector<uint64_t> index(slots, 0);
+    for (size_t block = 0; block < blocks; ++block) {
+        const size_t first = block * DeviceStateSnapshot::kBlockRows;
+        const size_t count = std::min(DeviceStateSnapshot::kBlockRows, size - first);
+        const auto  &records = snapshot.GetBlock(block);
+        checksums[block] = ChecksumBlock(records.data(), count, block);
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t hash = HashDeviceId(records[i].GetDeviceId());
+            size_t         slot = hash & (slots - 1);
+            while (index[slot] != 0)
+                slot = (slot + 1) & (slots - 1);
+            index[slot] = (hash & 0xFFFFFFFF00000000ULL) | (first + i + 1);
+        }
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = FleetStateFile::kVersion;
+    header.record_size = sizeof(DeviceState);
+    header.size = size;
+    header.block_rows = DeviceStateSnapshot::kBlockRows;
+    header.index_bits = index_bits;
+    header.created_s = created_s;
+    header.tables_checksum = ChecksumTables(checksums.data(), blocks, index.data(), slots);
+    header.header_checksum = ChecksumHeader(header);
+
+    const Layout layout = GetLayout(size, index_bits);
+    TempFile     file(path + ".tmp");
+    size_t       position = 0;
+    file.Write(&header, sizeof(header));
+    file.Write(checksums.data(), blocks * sizeof(uint64_t));
+    position = sizeof(header) + blocks * sizeof(uint64_t);
+    file.PadTo(layout.index, position);
+    file.Write(index.data(), slots * sizeof(uint64_t));
+    position += slots * sizeof(uint64_t);
+    file.PadTo(layout.records, position);
+    for (size_t block = 0; block < blocks; ++block) {
+        const size_t count = std::min(DeviceStateSnapshot::kBlockRows, size - block * DeviceStateSnapshot::kBlockRows);
+        file.Write(snapshot.GetBlock(block).data(), count * sizeof(DeviceState));
+    }
+    file.Commit(path);
+}
+
+FleetStateFile::FleetStateFile(const std::string &path) : file_(path, MappedFile::Access::RANDOM)
+{
+    const std::string_view data = file_.GetData();
+    if (data.size() < sizeof(FileHeader))
+        ThrowCorrupt(path, "truncated header");
+    FileHeader header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        ThrowCorrupt(path, "unknown format");
+    if (header.header_checksum != ChecksumHeader(header))
+        ThrowCorrupt(path, "header checksum mismatch");
+    if (header.version != kVersion || header.record_size != sizeof(DeviceState) ||
+        header.block_rows != DeviceStateSnapshot::kBlockRows)
+        ThrowCorrupt(path, "unsupported version");
+    if (header.index_bits >= 40 || header.size >= (uint64_t{1} << header.index_bits))
+        ThrowCorrupt(path, "bad index size");
+    const Layout layout = GetLayout(header.size, header.index_bits);
+    if (layout.file_size != data.size())
+        ThrowCorrupt(path, "file size mismatch");
+
+    size_ = header.size;
+    created_s_ = header.created_s;
+    // mmap выровнен по странице, части файла - по kAlignment
+    checksums_ = reinterpret_cast<const uint64_t *>(data.data() + layout.checksums);
+    index_ = reinterpret_cast<const uint64_t *>(data.data() + layout.index);
+    index_mask_ = (uint64_t{1} << header.index_bits) - 1;
+    records_ = reinterpret_cast<const DeviceState *>(data.data() + layout.records);
+    if (header.tables_checksum != ChecksumTables(checksums_, GetBlockCount(), index_, index_mask_ + 1))
+        ThrowCorrupt(path, "index checksum mismatch");
+
+    blocks_ = std::make_unique<std::atomic<uint8_t>[]>(GetBlockCount());
+    for (size_t block = 0; block < GetBlockCount(); ++block)
+        blocks_[block].store(UNCHECKED, std::memory_order_relaxed);
+}
+
+bool FleetStateFile::CheckBlock(size_t block) const
+{
+    const uint8_t state = blocks_[block].load(std::memory_order_acquire);
+    if (state != UNCHECKED)
+        return state == VALID;
+    const size_t first = block * DeviceStateSnapshot::kBlockRows;
+    const size_t count = std::min(DeviceStateSnapshot::kBlockRows, size_ - first);
+    const bool   valid = ChecksumBlock(records_ + first, count, block) == checksums_[block];
+    blocks_[block].store(valid ? VALID : CORRUPT, std::memory_order_release);
+    return valid;
+}
+
+const DeviceState *FleetStateFile::GetBlock(size_t block) const
+{
+    if (block >= GetBlockCount())
+        throw std::out_of_range("Fleet state block is out of range");
+    if (!CheckBlock(block))
+        throw std::runtime_error("Fleet state block " + std::to_string(block) + " is corrupt");
+    return records_ + block * DeviceStateSnapshot::kBlockRows;
+}
+
+const DeviceState &FleetStateFile::Get(size_t row) const
+{
+    if (row >= size_)
+        throw std::out_of_range("Fleet state row is out of range");
+    return GetBlock(row / DeviceStateSnapshot::kBlockRows)[row % DeviceStateSnapshot::kBlockRows];
+}
+
+const DeviceState *FleetStateFile::Find(std::string_view device_id) const
+{
+    const uint64_t hash = HashDeviceId(device_id);
+    const uint64_t tag = hash & 0xFFFFFFFF00000000ULL;
+    for (uint64_t slot = hash & index_mask_;; slot = (slot + 1) & index_mask_) {
+        const uint64_t entry = index_[slot];
+        if (entry == 0)
+            return nullptr;
+        // Запись читается только при совпадении старших бит хеша
+        if ((entry & 0xFFFFFFFF00000000ULL) != tag)
+            continue;
+        const DeviceState &state = Get((entry & 0xFFFFFFFFULL) - 1);
+        if (state.GetDeviceId() == device_id)
+            return &state;
+    }
+}
+
+std::vector<size_t> FleetStateFile::Validate() const
+{
+    std::vector<size_t> corrupt;
+    for (size_t block = 0; block < GetBlockCount(); ++block) {
+        if (!CheckBlock(block))
+            corrupt.push_back(block);
+    }
+    return corrupt;
+}
+
+}  // namespace iot::backend::proto
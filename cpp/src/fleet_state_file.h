@@ -0,0 +1,179 @@
+#pragma once
+
+#include "chain_id.h"
+#include "mapped_file.h"
+#include "telemetry_payload.pb.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Последнее известное состояние устройства: то, что после рестарта
+/// сервиса иначе восстанавливается переигрыванием телеметрии. Запись
+/// фиксированного размера без указателей, в файле снимка лежит как есть.
+struct DeviceState {
+    static constexpr size_t kMaxDeviceIdSize = 47;
+    static constexpr uint8_t kUnknownFlag = 0xFF;
+
+    [[nodiscard]] std::string_view GetDeviceId() const { return {device_id, device_id_size}; }
+
+    uint8_t  device_id_size = 0;
+    char     device_id[kMaxDeviceIdSize]{};
+    // NaN - значение неизвестно
+    float    battery_level = std::numeric_limits<float>::quiet_NaN();
+    float    voltage = std::numeric_limits<float>::quiet_NaN();
+    float    speed_kmh = std::numeric_limits<float>::quiet_NaN();
+    float    lat = std::numeric_limits<float>::quiet_NaN();
+    float    lon = std::numeric_limits<float>::quiet_NaN();
+    float    gsm_signal_level = std::numeric_limits<float>::quiet_NaN();
+    // Секунды UTC, 0 - не было
+    uint32_t last_seen_s = 0;
+    uint32_t gsm_seen_s = 0;
+    // 0 или 1, kUnknownFlag - значение неизвестно
+    uint8_t  charging = kUnknownFlag;
+    uint8_t  locked = kUnknownFlag;
+    uint8_t  reserved[6]{};
+    /// HashConfigure подтверждённой конфигурации, 0 - неизвестна
+    uint64_t config_hash = 0;
+    /// Последняя отправленная команда и последний пришедший CommandResult
+    ChainId  command_chain_id;
+    ChainId  result_chain_id;
+};
+
+static_assert(sizeof(DeviceState) == 128);
+
+/// Неизменяемый снимок DeviceStateTable. Делит блоки записей с таблицей,
+/// поэтому снимается за время, пропорциональное числу блоков, и может
+/// писаться в файл из другого потока, пока таблица меняется.
+class DeviceStateSnapshot {
+  public:
+    static constexpr size_t kBlockRows = 1024;
+    using Block = std::array<DeviceState, kBlockRows>;
+
+    [[nodiscard]] size_t             GetSize() const { return size_; }
+    [[nodiscard]] const DeviceState &Get(size_t row) const { return (*blocks_[row / kBlockRows])[row % kBlockRows]; }
+    /// Записи блока; последний блок заполнен частично
+    [[nodiscard]] const Block &GetBlock(size_t block) const { return *blocks_[block]; }
+
+  private:
+    friend class DeviceStateTable;
+
+    std::vector<std::shared_ptr<const Block>> blocks_;
+    size_t                                    size_ = 0;
+};
+
+class FleetStateFile;
+
+/// Состояние парка в памяти, строка на устройство. Блоки записей
+/// копируются при записи (copy-on-write): изменение блока, который держит
+/// снимок, сначала копирует блок, и снимок остаётся прежним.
+///
+/// Класс не потокобезопасный; снимки можно читать из любых потоков.
+class DeviceStateTable {
+  public:
+    DeviceStateTable() = default;
+    /// Состояние из файла снимка с проверкой всех блоков; std::runtime_error,
+    /// если файл испорчен
+    explicit DeviceStateTable(const FleetStateFile &file);
+
+    /// Поля, отсутствующие в payload, сохраняют прошлые значения.
+    /// std::invalid_argument для id длиннее DeviceState::kMaxDeviceIdSize.
+    uint32_t UpdateTelemetry(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload);
+    void     SetCommandChainId(std::string_view device_id, const ChainId &chain_id);
+    void     SetResultChainId(std::string_view device_id, const ChainId &chain_id);
+    void     SetConfigHash(std::string_view device_id, uint64_t config_hash);
+
+    [[nodiscard]] size_t             GetSize() const { return size_; }
+    /// nullptr для неизвестного устройства; указатель действителен до
+    /// следующего изменения таблицы
+    [[nodiscard]] const DeviceState *Find(std::string_view device_id) const;
+
+    [[nodiscard]] DeviceStateSnapshot TakeSnapshot() const;
+
+  private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    /// Строка устройства, новое устройство добавляется в конец
+    uint32_t     GetRow(std::string_view device_id);
+    /// Запись строки для изменения
+    DeviceState &GetMutable(uint32_t row);
+
+    using Block = DeviceStateSnapshot::Block;
+
+    /// Блок таблицы изменяется на месте, только пока его не держит снимок
+    std::vector<std::shared_ptr<Block>>                                     blocks_;
+    size_t                                                                  size_ = 0;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> index_;
+};
+
+/// Пишет снимок в path атомарно: во временный файл рядом, fdatasync и
+/// rename, так что в path всегда лежит целый файл. Долгая операция, её
+/// место - фоновый поток; std::runtime_error при ошибке ввода-вывода.
+void WriteFleetStateFile(const DeviceStateSnapshot &snapshot, const std::string &path, uint64_t created_s);
+
+/// Файл снимка состояния парка, отображённый в память: устройства ищутся
+/// сразу после открытия, без загрузки и разбора.
+///
+/// Формат (порядок байт little-endian): заголовок с версией и контрольной
+/// суммой, контрольные суммы блоков записей, хеш-индекс id -> строка с
+/// открытой адресацией и сами записи DeviceState. Конструктор проверяет
+/// заголовок, суммы и индекс (единицы МБ на миллион устройств), блок записей
+/// проверяется при первом обращении к нему. Так рестарт не ждёт чтения
+/// всего файла, а испорченный блок не выдаётся за состояние.
+///
+/// Константные методы можно вызывать одновременно из разных потоков.
+class FleetStateFile {
+  public:
+    static constexpr uint32_t kVersion = 1;
+
+    /// std::runtime_error для нечитаемого файла, чужого формата или версии
+    /// и испорченных заголовка или индекса
+    explicit FleetStateFile(const std::string &path);
+
+    [[nodiscard]] size_t   GetSize() const { return size_; }
+    [[nodiscard]] uint64_t GetCreatedS() const { return created_s_; }
+    [[nodiscard]] size_t   GetBlockCount() const
+    {
+        return (size_ + DeviceStateSnapshot::kBlockRows - 1) / DeviceStateSnapshot::kBlockRows;
+    }
+
+    /// nullptr для неизвестного устройства. std::runtime_error, если блок
+    /// записи испорчен.
+    [[nodiscard]] const DeviceState *Find(std::string_view device_id) const;
+    /// Запись строки row < GetSize(); std::runtime_error, если блок испорчен
+    [[nodiscard]] const DeviceState &Get(size_t row) const;
+    /// Записи блока (все, кроме последнего, полные) с проверкой
+    [[nodiscard]] const DeviceState *GetBlock(size_t block) const;
+
+    /// Проверяет все ещё не проверенные блоки; номера испорченных
+    [[nodiscard]] std::vector<size_t> Validate() const;
+
+  private:
+    enum BlockState : uint8_t { UNCHECKED, VALID, CORRUPT };
+
+    [[nodiscard]] bool CheckBlock(size_t block) const;
+
+    MappedFile           file_;
+    size_t               size_ = 0;
+    uint64_t             created_s_ = 0;
+    const uint64_t      *checksums_ = nullptr;
+    /// Слот индекса: старшие 32 бита хеша id и номер строки + 1, 0 - пусто
+    const uint64_t      *index_ = nullptr;
+    uint64_t             index_mask_ = 0;
+    const DeviceState   *records_ = nullptr;
+    /// BlockState блоков; гонка двух проверок одного блока безвредна
+    std::unique_ptr<std::atomic<uint8_t>[]> blocks_;
+};
+
+}  // namespace iot::backend::proto
@@ -1,4 +1,5 @@
 #include "helpers.h"
+#include "utc_clock.h"
 
 #include <chrono>
 
@@ -29,26 +30,26 @@ using namespace iot::backend::proto;
  * Moreover, this clock is unsupported by GCC now.
  *
  * Since we're working with C++20 it was decided to use the first approach.
+ *
+ * The clock itself is pluggable (see utc_clock.h): SystemUtcClock reads
+ * system_clock on every call, CoarseUtcClock serves a cached value for hot
+ * paths and FakeUtcClock is for tests.
  */
 uint64_t GetCurrentUtcTimestamp()
 {
-    auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch());
-    return timestamp.count();
+    return GetDefaultClock().NowS();
 }
 
 uint64_t GetCurrentUtcTimestampMs()
 {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-               std::chrono::system_clock::now().time_since_epoch())
-        .count();
+    return GetDefaultClock().NowMs();
 }
 
-Packet MakePacket(std::optional<std::chrono::seconds> valid_period_s)
+void MakePacket(Packet &packet, std::optional<std::chrono::seconds> valid_period_s)
 {
     const auto current_timestamp = GetCurrentUtcTimestamp();
 
-    Packet packet;
+    packet.Clear();
     packet.set_version(0x10000);
     packet.set_timestamp(current_timestamp);
 
@@ -56,25 +57,40 @@ Packet MakePacket(std::optional<std::chrono::seconds> valid_period_s)
         const auto valid_until = packet.timestamp() + valid_period_s->count();
         packet.set_valid_until(valid_until);
     }
+}
 
+Packet MakePacket(std::optional<std::chrono::seconds> valid_period_s)
+{
+    Packet packet;
+    MakePacket(packet, valid_period_s);
     return packet;
 }
 
-Packet MakeCommandResultPacket(
+void MakeCommandResultPacket(
+    Packet &packet,
     std::string_view chain_id,
     std::optional<std::string_view> prev_chain_id,
     int32_t cmd_delivery_time_s,
     int32_t cmd_execution_time_ms)
 {
-    auto  packet = MakePacket();
+    MakePacket(packet);
     auto *result = packet.mutable_command_result();
-    result->set_chain_id(chain_id.data());
+    result->set_chain_id(chain_id.data(), chain_id.size());
     result->set_cmd_delivery_time(cmd_delivery_time_s);
     result->set_cmd_execution_time_ms(cmd_execution_time_ms);
-    if (prev_chain_id) result->set_prev_chain_id(prev_chain_id->data());
-    return packet;
+    if (prev_chain_id) result->set_prev_chain_id(prev_chain_id->data(), prev_chain_id->size());
 }
 
+void MakeCommandResultSuccess(
+    Packet &packet,
+    std::string_view chain_id,
+    std::optional<std::string_view> prev_chain_id,
+    int32_t cmd_delivery_time_s,
+    int32_t cmd_execution_time_ms)
+{
+    MakeCommandResultPacket(packet, chain_id, prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
+    packet.mutable_command_result()->set_result(iot::backend::proto::RESULT_SUCCESS);
+}
 
 Packet MakeCommandResultSuccess(
     std::string_view chain_id,
@@ -82,11 +98,28 @@ Packet MakeCommandResultSuccess(
     int32_t cmd_delivery_time_s,
     int32_t cmd_execution_time_ms)
 {
-    auto packet = MakeCommandResultPacket(chain_id, prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
-    packet.mutable_command_result()->set_result(iot::backend::proto::RESULT_SUCCESS);
+    Packet packet;
+    MakeCommandResultSuccess(packet, chain_id, prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
     return packet;
 }
 
+void MakeCommandResultError(Packet                         &packet,
+                            std::string_view                chain_id,
+                            iot::backend::proto::ResultCode resultCode,
+                            iot::backend::proto::ErrorCode  errorCode,
+                            std::string_view                message,
+                            std::optional<std::string_view> prev_chain_id,
+                            int32_t                         cmd_delivery_time_s,
+                            int32_t                         cmd_execution_time_ms)
+{
+    MakeCommandResultPacket(packet, chain_id, prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
+    auto *result = packet.mutable_command_result();
+    result->set_result(resultCode);
+    auto *description = result->mutable_error_description();
+    description->set_status(errorCode);
+    description->set_message(message.data(), message.size());
+}
+
 Packet MakeCommandResultError(std::string_view                chain_id,
                               iot::backend::proto::ResultCode resultCode,
                               iot::backend::proto::ErrorCode  errorCode,
@@ -95,12 +128,9 @@ Packet MakeCommandResultError(std::string_view                chain_id,
                               int32_t                         cmd_delivery_time_s,
                               int32_t                         cmd_execution_time_ms)
 {
-    auto packet = MakeCommandResultPacket(chain_id, prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
-    auto *result = packet.mutable_command_result();
-    result->set_result(resultCode);
-    auto *description = result->mutable_error_description();
-    description->set_status(errorCode);
-    description->set_message(message.data());
+    Packet packet;
+    MakeCommandResultError(packet, chain_id, resultCode, errorCode, message,
+                           prev_chain_id, cmd_delivery_time_s, cmd_execution_time_ms);
     return packet;
 }
 
@@ -13,11 +13,11 @@
 namespace iot::backend::proto::helpers {
 
 /// Generate unique chain identity
-/// Right now it is implemented as UUID generation
+/// Right now it is implemented as UUIDv7 generation, see ChainId
 std::string GenerateChainId();
 
 /// Returns current timestamp in protocol specific format (UTC, seconds since
-/// epoch)
+/// epoch). The time source is GetDefaultClock() from utc_clock.h
 uint64_t GetCurrentUtcTimestamp();
 uint64_t GetCurrentUtcTimestampMs();
 
@@ -48,6 +48,30 @@ iot::backend::proto::Packet MakeCommandResultError(
     int32_t                         cmd_delivery_time_s,
     int32_t                         cmd_execution_time_ms);
 
+/// The same as above, but fill the given packet in place (previous content is
+/// cleared). Useful together with PacketPool to reuse packet memory
+void MakePacket(iot::backend::proto::Packet        &packet,
+                std::optional<std::chrono::seconds> valid_period_s = std::nullopt);
+
+void MakeCommand(iot::backend::proto::Packet        &packet,
+                 std::optional<std::chrono::seconds> valid_period_s,
+                 std::string_view                    chain_id);
+
+void MakeCommandResultSuccess(iot::backend::proto::Packet    &packet,
+                              std::string_view                chain_id,
+                              std::optional<std::string_view> prev_chain_id,
+                              int32_t cmd_delivery_time_s,
+                              int32_t cmd_execution_time_ms);
+
+void MakeCommandResultError(iot::backend::proto::Packet    &packet,
+                            std::string_view                chain_id,
+                            iot::backend::proto::ResultCode resultCode,
+                            iot::backend::proto::ErrorCode  errorCode,
+                            std::string_view                message,
+                            std::optional<std::string_view> prev_chain_id,
+                            int32_t                         cmd_delivery_time_s,
+                            int32_t cmd_execution_time_ms);
+
 /// Convert C++ ProtoPacket into std::string json
 template <class PacketT>
 TJsonPacket ProtoPacketToJson(const PacketT &packet)
@@ -86,37 +110,53 @@ TBinaryPacket ProtoPacketToBinary(const PacketT &packet)
     return data;
 }
 
-/// Convert std::string json into C++ ProtoPacket
+/// Convert std::string json into C++ ProtoPacket (in place, previous content
+/// of proto_packet is replaced)
 template <class PacketT>
-PacketT JsonToProtoPacket(const TJsonPacket &json_string)
+void JsonToProtoPacket(const TJsonPacket &json_string, PacketT &proto_packet)
 {
-    PacketT proto_packet;
-
     auto l1 = json_string.size();
     auto l2 = strlen(json_string.c_str());
 
-    const auto status = google::protobuf::util::JsonStringToMessage(
-        TProtoStringType(json_string), &proto_packet);
+    proto_packet.Clear();
+    // No TProtoStringType copy here: JsonStringToMessage takes a string view
+    const auto status =
+        google::protobuf::util::JsonStringToMessage(json_string, &proto_packet);
 
     if (!status.ok() || (l1 != l2)) {
         throw std::invalid_argument(
             "google::protobuf::util::JsonStringToMessage failed: '{}'" +
             status.ToString());
     }
-
-    return proto_packet;
 }
 
-/// Convert std::string with binary data into C++ ProtoPacket
+/// Convert std::string json into C++ ProtoPacket
 template <class PacketT>
-PacketT BinaryToProtoPacket(const TBinaryPacket &binary_string)
+PacketT JsonToProtoPacket(const TJsonPacket &json_string)
 {
     PacketT proto_packet;
+    JsonToProtoPacket(json_string, proto_packet);
+    return proto_packet;
+}
 
-    if (!proto_packet.ParseFromString(TProtoStringType(binary_string))) {
+/// Convert std::string with binary data into C++ ProtoPacket (in place,
+/// previous content of proto_packet is replaced)
+template <class PacketT>
+void BinaryToProtoPacket(const TBinaryPacket &binary_string,
+                         PacketT             &proto_packet)
+{
+    if (!proto_packet.ParseFromArray(binary_string.data(),
+                                     static_cast<int>(binary_string.size()))) {
         throw std::runtime_error("Wrong packet format");
     }
+}
 
+/// Convert std::string with binary data into C++ ProtoPacket
+template <class PacketT>
+PacketT BinaryToProtoPacket(const TBinaryPacket &binary_string)
+{
+    PacketT proto_packet;
+    BinaryToProtoPacket(binary_string, proto_packet);
     return proto_packet;
 }
 
@@ -1,10 +1,8 @@
 #include "helpers.h"
 
-#include <string>
+#include "chain_id.h"
 
-#include <boost/uuid/uuid.hpp>
-#include <boost/uuid/random_generator.hpp>
-#include <boost/uuid/uuid_io.hpp>
+#include <string>
 
 #include <library/cpp/string_utils/base64/base64.h>
 
@@ -12,9 +10,7 @@ namespace iot::backend::proto::helpers {
 
 std::string GenerateChainId()
 {
-    thread_local boost::uuids::random_generator uuid_gen;
-    const boost::uuids::uuid                    id = uuid_gen();
-    return to_string(id);
+    return ChainId::Generate().ToString();
 }
 
 std::string ToBase64(std::string_view data)
@@ -27,12 +23,20 @@ std::string FromBase64(std::string_view base64_data)
     return Base64DecodeUneven(TStringBuf{base64_data});
 }
 
+void MakeCommand(Packet                             &packet,
+                 std::optional<std::chrono::seconds> valid_period_s,
+                 std::string_view                    chain_id)
+{
+    MakePacket(packet, valid_period_s);
+    proto::Command *cmd = packet.mutable_command();
+    cmd->set_chain_id(chain_id.data(), chain_id.size());
+}
+
 Packet MakeCommand(std::optional<std::chrono::seconds> valid_period_s,
                    std::string_view                    chain_id)
 {
-    Packet          packet = MakePacket(valid_period_s);
-    proto::Command *cmd = packet.mutable_command();
-    cmd->set_chain_id(chain_id.data());
+    Packet packet;
+    MakeCommand(packet, valid_period_s, chain_id);
     return packet;
 }
 
@@ -0,0 +1,412 @@
+#include "hot_path_metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <mutex>
+
+namespace iot::backend::proto::metrics {
+
+namespace {
+
+using detail::kChannelCount;
+using detail::kKeyCount;
+using detail::kTransportCount;
+using detail::kWhatCount;
+
+}  // namespace
+
+namespace detail {
+
+struct LatencySlot {
+    std::atomic<uint64_t>                                      sum_ns{0};
+    std::array<std::atomic<uint64_t>, Histogram::kBucketCount> buckets{};
+
+    void AddTo(Entry &entry) const
+    {
+        entry.latency_sum_ns += sum_ns.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            if (const auto value = buckets[i].load(std::memory_order_relaxed))
+                entry.latency_ns.Add(Histogram::GetBucketUpperBound(i), value);
+        }
+    }
+
+    void Clear()
+    {
+        sum_ns.store(0, std::memory_order_relaxed);
+        for (auto &bucket : buckets)
+            bucket.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct LatencySlots : std::array<LatencySlot, kWhatCount> {};
+
+ThreadMetrics::~ThreadMetrics()
+{
+    for (auto &channel : latency)
+        delete channel.load(std::memory_order_relaxed);
+}
+
+}  // namespace detail
+
+namespace {
+
+struct Registry {
+    std::mutex                            mutex;
+    std::vector<detail::ThreadMetrics *>  threads;
+    /// Метрики завершившихся потоков
+    std::vector<Entry> retired = std::vector<Entry>(kKeyCount);
+};
+
+// Не разрушается при выходе: потоки могут завершаться позже статиков
+Registry &GetRegistry()
+{
+    static auto *registry = new Registry();
+    return *registry;
+}
+
+void AddThread(const detail::ThreadMetrics &metrics, std::vector<Entry> &entries)
+{
+    for (size_t key = 0; key < kKeyCount; ++key) {
+        entries[key].count += metrics.count[key].load(std::memory_order_relaxed);
+        entries[key].failures += metrics.failures[key].load(std::memory_order_relaxed);
+        entries[key].bytes += metrics.bytes[key].load(std::memory_order_relaxed);
+    }
+    for (size_t channel = 0; channel < kChannelCount; ++channel) {
+        const auto *slots = metrics.latency[channel].load(std::memory_order_acquire);
+        if (!slots)
+            continue;
+        for (size_t what = 0; what < kWhatCount; ++what)
+            (*slots)[what].AddTo(entries[channel * kWhatCount + what]);
+    }
+}
+
+// Операция может выполняться в деструкторе другого thread_local объекта
+// уже после разрушения метрик потока - тогда она не учитывается
+thread_local bool metrics_destroyed = false;
+
+struct ThreadHolder {
+    ThreadHolder()
+    {
+        auto &registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        registry.threads.push_back(&metrics);
+    }
+
+    ~ThreadHolder()
+    {
+        auto &registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        AddThread(metrics, registry.retired);
+        std::erase(registry.threads, &metrics);
+        detail::thread_metrics = nullptr;
+        metrics_destroyed = true;
+    }
+
+    detail::ThreadMetrics metrics;
+};
+
+std::string Labels(const Entry &entry)
+{
+    std::string result = "operation=\"";
+    result += ToString(entry.operation);
+    result += "\",transport=\"";
+    result += ToString(entry.transport);
+    result += "\",what=\"";
+    result += ToString(entry.what);
+    result += '"';
+    return result;
+}
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+}  // namespace
+
+const char *ToString(Operation operation)
+{
+    switch (operation) {
+        case Operation::SERIALIZE:
+            return "serialize";
+        case Operation::DESERIALIZE:
+            return "deserialize";
+        case Operation::VALIDATE:
+            return "validate";
+    }
+    return "unknown";
+}
+
+const char *ToString(Transport transport)
+{
+    switch (transport) {
+        case Transport::NONE:
+            return "none";
+        case Transport::JSON:
+            return "json";
+        case Transport::BINARY:
+            return "binary";
+    }
+    return "unknown";
+}
+
+const char *ToString(Packet::WhatCase what)
+{
+    // #ADD_NEW_PACKET
+    switch (what) {
+        case Packet::kCommand:
+            return "command";
+        case Packet::kCommandResult:
+            return "command_result";
+        case Packet::kTelemetry:
+            return "telemetry";
+        case Packet::kRequest:
+            return "request";
+        case Packet::kResponse:
+            return "response";
+        case Packet::kNotification:
+            return "notification";
+        case Packet::WHAT_NOT_SET:
+            return "not_set";
+    }
+    return "unknown";
+}
+
+size_t Histogram::GetBucket(uint64_t value)
+{
+    if (value < kSubBuckets)
+        return value;
+    const uint32_t exponent = std::bit_width(value) - 1;
+    if (exponent >= kMaxExponent)
+        return kBucketCount - 1;
+    const uint64_t sub = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t bucket)
+{
+    if (bucket < kSubBuckets)
+        return bucket;
+    const uint32_t exponent = bucket / kSubBuckets + kSubBucketBits - 1;
+    const uint64_t sub = bucket % kSubBuckets;
+    const uint32_t shift = exponent - kSubBucketBits;
+    return ((kSubBuckets + sub + 1) << shift) - 1;
+}
+
+void Histogram::Add(uint64_t value, uint64_t count)
+{
+    buckets_[GetBucket(value)] += count;
+}
+
+void Histogram::Merge(const Histogram &other)
+{
+    for (size_t i = 0; i < kBucketCount; ++i)
+        buckets_[i] += other.buckets_[i];
+}
+
+uint64_t Histogram::GetCount() const
+{
+    uint64_t count = 0;
+    for (const auto value : buckets_)
+        count += value;
+    return count;
+}
+
+uint64_t Histogram::GetQuantile(double q) const
+{
+    const uint64_t count = GetCount();
+    if (count == 0)
+        return 0;
+    const auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank)
+            return GetBucketUpperBound(i);
+    }
+    return GetBucketUpperBound(kBucketCount - 1);
+}
+
+const Entry *Snapshot::Find(Operation        operation,
+                            Transport        transport,
+                            Packet::WhatCase what) const
+{
+    for (const auto &entry : entries) {
+        if (entry.operation == operation && entry.transport == transport &&
+            entry.what == what)
+            return &entry;
+    }
+    return nullptr;
+}
+
+std::string Snapshot::ToText() const
+{
+    std::string result;
+    const auto counter = [&](const char *name, auto field) {
+        result += "# TYPE ";
+        result += name;
+        result += " counter\n";
+        for (const auto &entry : entries) {
+            result += name;
+            result += '{' + Labels(entry) + "} ";
+            result += std::to_string(entry.*field);
+            result += '\n';
+        }
+    };
+    counter("iot_proto_packets_total", &Entry::count);
+    counter("iot_proto_packet_failures_total", &Entry::failures);
+    counter("iot_proto_packet_bytes_total", &Entry::bytes);
+
+    result += "# TYPE iot_proto_latency_ns summary\n";
+    for (const auto &entry : entries) {
+        const auto labels = Labels(entry);
+        for (const double q : kQuantiles) {
+            auto quantile = std::to_string(q);
+            quantile.erase(quantile.find_last_not_of('0') + 1);
+            result += "iot_proto_latency_ns{" + labels + ",quantile=\"" +
+                      quantile + "\"} " +
+                      std::to_string(entry.latency_ns.GetQuantile(q)) + '\n';
+        }
+        result += "iot_proto_latency_ns_sum{" + labels + "} " +
+                  std::to_string(entry.latency_sum_ns) + '\n';
+        result += "iot_proto_latency_ns_count{" + labels + "} " +
+                  std::to_string(entry.latency_ns.GetCount()) + '\n';
+    }
+    return result;
+}
+
+std::string Snapshot::ToJson() const
+{
+    std::string result = "{\"latency_sample_rate\":" +
+                         std::to_string(latency_sample_rate) + ",\"entries\":[";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto &entry = entries[i];
+        if (i != 0)
+            result += ',';
+        result += "{\"operation\":\"";
+        result += ToString(entry.operation);
+        result += "\",\"transport\":\"";
+        result += ToString(entry.transport);
+        result += "\",\"what\":\"";
+        result += ToString(entry.what);
+        result += "\",\"count\":" + std::to_string(entry.count) +
+                  ",\"failures\":" + std::to_string(entry.failures) +
+                  ",\"bytes\":" + std::to_string(entry.bytes) +
+                  ",\"latency_ns\":{\"samples\":" +
+                  std::to_string(entry.latency_ns.GetCount()) +
+                  ",\"sum\":" + std::to_string(entry.latency_sum_ns) +
+                  ",\"p50\":" + std::to_string(entry.latency_ns.GetQuantile(0.5)) +
+                  ",\"p90\":" + std::to_string(entry.latency_ns.GetQuantile(0.9)) +
+                  ",\"p99\":" + std::to_string(entry.latency_ns.GetQuantile(0.99)) +
+                  ",\"buckets\":[";
+        // Только непустые корзины: [верхняя граница, количество]
+        bool first = true;
+        const auto &buckets = entry.latency_ns.GetBuckets();
+        for (size_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            if (buckets[bucket] == 0)
+                continue;
+            if (!first)
+                result += ',';
+            first = false;
+            result += '[' + std::to_string(Histogram::GetBucketUpperBound(bucket)) +
+                      ',' + std::to_string(buckets[bucket]) + ']';
+        }
+        result += "]}}";
+    }
+    result += "]}";
+    return result;
+}
+
+void SetEnabled(bool enabled)
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsEnabled()
+{
+    return kCompiledIn && detail::enabled.load(std::memory_order_relaxed);
+}
+
+void SetLatencySampleRate(uint32_t rate)
+{
+    detail::sample_mask.store(std::bit_ceil(std::max<uint32_t>(rate, 1)) - 1,
+                              std::memory_order_relaxed);
+}
+
+uint32_t GetLatencySampleRate()
+{
+    return detail::sample_mask.load(std::memory_order_relaxed) + 1;
+}
+
+Snapshot Collect()
+{
+    std::vector<Entry> entries;
+    {
+        auto &registry = GetRegistry();
+        std::lock_guard lock(registry.mutex);
+        entries = registry.retired;
+        for (const auto *thread : registry.threads)
+            AddThread(*thread, entries);
+    }
+
+    Snapshot snapshot;
+    snapshot.latency_sample_rate = GetLatencySampleRate();
+    for (size_t key = 0; key < kKeyCount; ++key) {
+        auto &entry = entries[key];
+        if (entry.count == 0)
+            continue;
+        const size_t channel = key / kWhatCount;
+        entry.operation = static_cast<Operation>(channel / kTransportCount);
+        entry.transport = static_cast<Transport>(channel % kTransportCount);
+        entry.what = static_cast<Packet::WhatCase>(key % kWhatCount);
+        snapshot.entries.push_back(std::move(entry));
+    }
+    return snapshot;
+}
+
+void Reset()
+{
+    auto &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.retired.assign(kKeyCount, Entry{});
+    for (auto *thread : registry.threads) {
+        for (size_t key = 0; key < kKeyCount; ++key) {
+            thread->count[key].store(0, std::memory_order_relaxed);
+            thread->failures[key].store(0, std::memory_order_relaxed);
+            thread->bytes[key].store(0, std::memory_order_relaxed);
+        }
+        for (auto &channel : thread->latency) {
+            if (auto *slots = channel.load(std::memory_order_acquire)) {
+                for (auto &slot : *slots)
+                    slot.Clear();
+            }
+        }
+    }
+}
+
+namespace detail {
+
+ThreadMetrics *InitThreadMetrics()
+{
+    if (metrics_destroyed)
+        return nullptr;
+    thread_local ThreadHolder holder;
+    thread_metrics = &holder.metrics;
+    return thread_metrics;
+}
+
+void RecordLatency(ThreadMetrics &metrics, size_t key, uint64_t latency_ns)
+{
+    auto &channel = metrics.latency[key / kWhatCount];
+    auto *slots = channel.load(std::memory_order_acquire);
+    if (!slots) {
+        slots = new LatencySlots();
+        channel.store(slots, std::memory_order_release);
+    }
+    auto &slot = (*slots)[key % kWhatCount];
+    Increment(slot.sum_ns, latency_ns);
+    Increment(slot.buckets[Histogram::GetBucket(latency_ns)], 1);
+}
+
+}  // namespace detail
+
+}  // namespace iot::backend::proto::metrics
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "packet.pb.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Метрики горячего пути: сколько пакетов каждого типа (Packet::what_case) и
+ * какого объёма прошло через ProtocolConverter::Serialize/SerializeTo/
+ * Deserialize и IsValid, и сколько это заняло времени.
+ *
+ * Включаются явно через SetEnabled(true). Пока выключены, цена - одна
+ * relaxed загрузка флага на операцию. Сборка с -DIOT_PROTO_NO_METRICS
+ * убирает инструментирование целиком.
+ *
+ * Каждый поток пишет в свои счётчики без синхронизации, Collect() складывает
+ * счётчики всех потоков (в том числе завершившихся). Счётчики и объём
+ * точные, а время измеряется у каждой GetLatencySampleRate()-й операции
+ * потока: два вызова steady_clock на каждую операцию стоили бы заметной
+ * доли времени IsValid.
+ */
+namespace iot::backend::proto::metrics {
+
+#if defined(IOT_PROTO_NO_METRICS)
+inline constexpr bool kCompiledIn = false;
+#else
+inline constexpr bool kCompiledIn = true;
+#endif
+
+enum class Operation : uint8_t { SERIALIZE, DESERIALIZE, VALIDATE };
+
+/// NONE - для операций без транспорта (IsValid)
+enum class Transport : uint8_t { NONE, JSON, BINARY };
+
+[[nodiscard]] const char *ToString(Operation operation);
+[[nodiscard]] const char *ToString(Transport transport);
+/// "command", "telemetry", ... и "not_set"
+[[nodiscard]] const char *ToString(Packet::WhatCase what);
+
+/// Лог-линейная гистограмма: каждая степень двойки делится на
+/// kSubBuckets равных корзин, т.е. относительная ошибка не больше 25%.
+/// Значения от 2^kMaxExponent попадают в последнюю корзину.
+class Histogram {
+  public:
+    static constexpr uint32_t kSubBucketBits = 2;
+    static constexpr uint32_t kSubBuckets = 1u << kSubBucketBits;
+    static constexpr uint32_t kMaxExponent = 40;
+    static constexpr size_t   kBucketCount =
+        (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    [[nodiscard]] static size_t GetBucket(uint64_t value);
+    /// Наибольшее значение, попадающее в корзину
+    [[nodiscard]] static uint64_t GetBucketUpperBound(size_t bucket);
+
+    void Add(uint64_t value, uint64_t count = 1);
+    void Merge(const Histogram &other);
+
+    [[nodiscard]] uint64_t GetCount() const;
+    /// Верхняя граница корзины, в которую попадает квантиль q из [0, 1];
+    /// 0 для пустой гистограммы
+    [[nodiscard]] uint64_t GetQuantile(double q) const;
+
+    [[nodiscard]] const std::array<uint64_t, kBucketCount> &GetBuckets() const
+    {
+        return buckets_;
+    }
+
+  private:
+    std::array<uint64_t, kBucketCount> buckets_{};
+};
+
+/// Сумма метрик всех потоков по одному ключу (операция, транспорт, тип)
+struct Entry {
+    Operation        operation = Operation::SERIALIZE;
+    Transport        transport = Transport::NONE;
+    Packet::WhatCase what = Packet::WHAT_NOT_SET;
+
+    uint64_t count = 0;
+    /// Исключение при (де)сериализации или IsValid() == false
+    uint64_t failures = 0;
+    /// Размер сообщения на транспорте; для IsValid не считается
+    uint64_t  bytes = 0;
+    /// Сумма и распределение измеренных (см. GetLatencySampleRate) времён
+    uint64_t  latency_sum_ns = 0;
+    Histogram latency_ns;
+};
+
+struct Snapshot {
+    uint32_t latency_sample_rate = 1;
+    /// Только ключи с ненулевым count, в порядке операция/транспорт/тип
+    std::vector<Entry> entries;
+
+    [[nodiscard]] const Entry *Find(Operation        operation,
+                                    Transport        transport,
+                                    Packet::WhatCase what) const;
+
+    /// Текстовый формат Prometheus (counter и summary в наносекундах)
+    [[nodiscard]] std::string ToText() const;
+    [[nodiscard]] std::string ToJson() const;
+};
+
+void SetEnabled(bool enabled);
+[[nodiscard]] bool IsEnabled();
+
+/// Время измеряется у каждой rate-й операции потока; rate округляется
+/// вверх до степени двойки, 1 - измерять всё
+void SetLatencySampleRate(uint32_t rate);
+inline constexpr uint32_t kDefaultLatencySampleRate = 64;
+[[nodiscard]] uint32_t GetLatencySampleRate();
+
+[[nodiscard]] Snapshot Collect();
+
+/// Обнуляет метрики всех потоков. Записи, идущие в других потоках
+/// одновременно с Reset(), могут частично уцелеть.
+void Reset();
+
+namespace detail {
+
+inline std::atomic<bool>     enabled{false};
+inline std::atomic<uint32_t> sample_mask{kDefaultLatencySampleRate - 1};
+
+inline constexpr size_t kOperationCount = 3;
+inline constexpr size_t kTransportCount = 3;
+inline constexpr size_t kChannelCount = kOperationCount * kTransportCount;
+inline constexpr size_t kWhatCount = Packet::kNotification + 1;
+inline constexpr size_t kKeyCount = kChannelCount * kWhatCount;
+
+/// Индекс ключа (операция, транспорт, тип) в счётчиках ThreadMetrics
+inline size_t GetKey(Operation operation, Transport transport, Packet::WhatCase what)
+{
+    const auto what_index = static_cast<size_t>(what);
+    return (static_cast<size_t>(operation) * kTransportCount + static_cast<size_t>(transport)) * kWhatCount +
+           (what_index < kWhatCount ? what_index : 0);
+}
+
+// Пишет только поток-владелец, поэтому хватает relaxed load + store вместо
+// атомарного сложения; Collect() в другом потоке видит согласованные слова
+inline void Increment(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct LatencySlots;
+
+/// Точные счётчики лежат прямо в структуре и увеличиваются inline на
+/// каждой операции; гистограммы времени создаются по каналам (операция +
+/// транспорт) при первом замере: поток, который только валидирует пакеты,
+/// не держит гистограммы сериализации.
+struct ThreadMetrics {
+    ~ThreadMetrics();
+
+    std::array<std::atomic<uint64_t>, kKeyCount>           count{};
+    std::array<std::atomic<uint64_t>, kKeyCount>           failures{};
+    std::array<std::atomic<uint64_t>, kKeyCount>           bytes{};
+    std::array<std::atomic<LatencySlots *>, kChannelCount> latency{};
+};
+
+// Инициализируются константой, поэтому обращение к ним в горячем пути
+// обходится без проверки инициализации thread_local
+inline thread_local ThreadMetrics *thread_metrics = nullptr;
+inline thread_local uint32_t       thread_operations = 0;
+
+/// Создаёт метрики текущего потока; nullptr, если поток уже завершается
+/// и они разрушены
+ThreadMetrics *InitThreadMetrics();
+
+/// Время операции с ключом key; вызывается только для замеренных
+/// (см. GetLatencySampleRate) операций
+void RecordLatency(ThreadMetrics &metrics, size_t key, uint64_t latency_ns);
+
+}  // namespace detail
+
+/// Инструментирование одной операции:
+///
+///     metrics::OperationTimer timer(Operation::DESERIALIZE, Transport::JSON);
+///     ... // при исключении операция учитывается как неудачная
+///     timer.Finish(packet.what_case(), buffer.size());
+class OperationTimer {
+  public:
+    OperationTimer(Operation operation, Transport transport) noexcept
+    {
+        if constexpr (kCompiledIn) {
+            if (detail::enabled.load(std::memory_order_relaxed)) {
+                metrics_ = detail::thread_metrics ? detail::thread_metrics
+                                                  : detail::InitThreadMetrics();
+                operation_ = operation;
+                transport_ = transport;
+                const uint32_t mask = detail::sample_mask.load(std::memory_order_relaxed);
+                if (metrics_ && (detail::thread_operations++ & mask) == 0)
+                    start_ = std::chrono::steady_clock::now();
+            }
+        }
+    }
+
+    ~OperationTimer()
+    {
+        if constexpr (kCompiledIn) {
+            if (metrics_)
+                Finish(Packet::WHAT_NOT_SET, 0, false);
+        }
+    }
+
+    OperationTimer(const OperationTimer &) = delete;
+    OperationTimer &operator=(const OperationTimer &) = delete;
+
+    void Finish(Packet::WhatCase what, uint64_t bytes, bool ok = true) noexcept
+    {
+        if constexpr (kCompiledIn) {
+            if (!metrics_)
+                return;
+            const size_t key = detail::GetKey(operation_, transport_, what);
+            detail::Increment(metrics_->count[key], 1);
+            if (!ok)
+                detail::Increment(metrics_->failures[key], 1);
+            if (bytes != 0)
+                detail::Increment(metrics_->bytes[key], bytes);
+            if (start_ != std::chrono::steady_clock::time_point{}) {
+                const auto latency = std::chrono::steady_clock::now() - start_;
+                detail::RecordLatency(
+                    *metrics_, key,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+            }
+            metrics_ = nullptr;
+        }
+    }
+
+  private:
+    detail::ThreadMetrics                *metrics_ = nullptr;
+    Operation                             operation_ = Operation::SERIALIZE;
+    Transport                             transport_ = Transport::NONE;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace iot::backend::proto::metrics
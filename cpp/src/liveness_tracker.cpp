@@ -0,0 +1,244 @@
+#include "liveness_tracker.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr size_t kSlotBits = 6;
+
+static_assert(LivenessTracker::kSlots == size_t{1} << kSlotBits);
+
+}  // namespace
+
+LivenessTracker::LivenessTracker(LivenessOptions options, uint64_t now_ms)
+    : options_(std::move(options)),
+      start_ms_(now_ms),
+      tick_ms_(options_.tick.count() > 0 ? static_cast<uint64_t>(options_.tick.count()) : 0)
+{
+    if (tick_ms_ == 0)
+        throw std::invalid_argument("Liveness tick must be positive");
+    if (options_.default_interval.count() <= 0)
+        throw std::invalid_argument("Default report interval must be positive");
+    if (options_.missed_reports == 0)
+        throw std::invalid_argument("missed_reports must be positive");
+
+    // Профиль 0: все отчёты с интервалами по умолчанию
+    InternProfile(std::vector<uint64_t>(options_.reports.size(), 0));
+}
+
+uint32_t LivenessTracker::InternProfile(std::vector<uint64_t> intervals_ms)
+{
+    if (const auto it = profile_index_.find(intervals_ms); it != profile_index_.end())
+        return it->second;
+
+    uint64_t interval_ms = 0;
+    for (const uint64_t value : intervals_ms) {
+        if (value != 0 && (interval_ms == 0 || value < interval_ms))
+            interval_ms = value;
+    }
+    if (interval_ms == 0)
+        interval_ms = std::chrono::duration_cast<std::chrono::milliseconds>(options_.default_interval).count();
+
+    const auto index = static_cast<uint32_t>(profiles_.size());
+    profiles_.push_back({intervals_ms, interval_ms});
+    profile_index_.emplace(std::move(intervals_ms), index);
+    return index;
+}
+
+LivenessTracker::Device &LivenessTracker::GetOrAdd(std::string_view device_id)
+{
+    auto it = devices_.find(device_id);
+    if (it == devices_.end()) {
+        it = devices_.emplace(std::string(device_id), Device{}).first;
+        it->second.id = &it->first;
+    }
+    return it->second;
+}
+
+uint64_t LivenessTracker::GetDeadlineMs(const Device &device) const
+{
+    return device.last_seen_ms + profiles_[device.profile].interval_ms * options_.missed_reports;
+}
+
+uint16_t LivenessTracker::GetBucket(uint64_t deadline_tick) const
+{
+    // Уровень k подходит, если до ячейки дедлайна меньше kSlots ячеек этого
+    // уровня: она будет переложена (или сработает) не позже дедлайна
+    for (size_t level = 0; level < kLevels; ++level) {
+        const size_t shift = level * kSlotBits;
+        if ((deadline_tick >> shift) - (current_tick_ >> shift) < kSlots)
+            return static_cast<uint16_t>(level * kSlots + ((deadline_tick >> shift) & (kSlots - 1)));
+    }
+    // Дальше горизонта колеса: последняя ячейка верхнего уровня, при
+    // перекладывании дедлайн снова уйдёт наверх
+    const size_t shift = (kLevels - 1) * kSlotBits;
+    return static_cast<uint16_t>((kLevels - 1) * kSlots + (((current_tick_ >> shift) - 1) & (kSlots - 1)));
+}
+
+void LivenessTracker::Link(Device &device, uint16_t bucket)
+{
+    device.bucket = bucket;
+    device.prev = nullptr;
+    device.next = heads_[bucket];
+    if (device.next)
+        device.next->prev = &device;
+    heads_[bucket] = &device;
+    if (bucket < kExpiring)
+        occupied_[bucket / kSlots] |= uint64_t{1} << (bucket % kSlots);
+    ++scheduled_;
+}
+
+void LivenessTracker::Unlink(Device &device)
+{
+    const uint16_t bucket = device.bucket;
+    if (device.prev)
+        device.prev->next = device.next;
+    else
+        heads_[bucket] = device.next;
+    if (device.next)
+        device.next->prev = device.prev;
+    if (bucket < kExpiring && !heads_[bucket])
+        occupied_[bucket / kSlots] &= ~(uint64_t{1} << (bucket % kSlots));
+    device.bucket = kUnscheduled;
+    --scheduled_;
+}
+
+void LivenessTracker::Reschedule(Device &device)
+{
+    const uint64_t deadline_ms = GetDeadlineMs(device);
+    // Дедлайн срабатывает на первом тике, начало которого не раньше него
+    uint64_t deadline_tick = deadline_ms > start_ms_ ? (deadline_ms - start_ms_ + tick_ms_ - 1) / tick_ms_ : 0;
+    // Текущий тик уже обработан
+    deadline_tick = std::max(deadline_tick, current_tick_ + 1);
+    device.deadline_tick = deadline_tick;
+
+    const uint16_t bucket = GetBucket(deadline_tick);
+    if (bucket == device.bucket)
+        return;
+    if (device.bucket != kUnscheduled)
+        Unlink(device);
+    Link(device, bucket);
+}
+
+bool LivenessTracker::OnPacket(std::string_view device_id, uint64_t now_ms)
+{
+    Device    &device = GetOrAdd(device_id);
+    const bool returned = device.reported;
+    device.reported = false;
+    device.last_seen_ms = std::max(device.last_seen_ms, now_ms);
+    Reschedule(device);
+    return returned;
+}
+
+void LivenessTracker::ApplySetParams(std::string_view device_id, const CmdSetParams &set_params)
+{
+    Device     &device = GetOrAdd(device_id);
+    const auto &reports = options_.reports;
+    auto        intervals_ms = profiles_[device.profile].intervals_ms;
+    bool        changed = false;
+    for (const auto &[name, value] : set_params.params()) {
+        const auto report = std::find(reports.begin(), reports.end(), name);
+        if (report == reports.end())
+            continue;
+        uint64_t   seconds = 0;
+        const auto result = std::from_chars(value.data(), value.data() + value.size(), seconds);
+        if (result.ec != std::errc() || result.ptr != value.data() + value.size() || seconds > UINT32_MAX)
+            continue;
+        uint64_t &interval_ms = intervals_ms[report - reports.begin()];
+        changed |= interval_ms != seconds * 1000;
+        interval_ms = seconds * 1000;
+    }
+    if (!changed)
+        return;
+
+    device.profile = InternProfile(std::move(intervals_ms));
+    if (device.bucket != kUnscheduled)
+        Reschedule(device);
+}
+
+void LivenessTracker::Cascade(size_t level)
+{
+    const size_t bucket = level * kSlots + ((current_tick_ >> (level * kSlotBits)) & (kSlots - 1));
+    Device      *device = heads_[bucket];
+    heads_[bucket] = nullptr;
+    occupied_[level] &= ~(uint64_t{1} << (bucket % kSlots));
+    while (device) {
+        Device *next = device->next;
+        --scheduled_;
+        Link(*device, GetBucket(device->deadline_tick));
+        device = next;
+    }
+}
+
+size_t LivenessTracker::Advance(uint64_t now_ms, const OfflineCallback &on_offline)
+{
+    const uint64_t target_tick = now_ms > start_ms_ ? (now_ms - start_ms_) / tick_ms_ : 0;
+    size_t         events = 0;
+    while (current_tick_ < target_tick) {
+        // Следующий тик с дедлайнами на нижнем уровне в пределах его оборота
+        // либо начало следующего оборота, где перекладываются верхние уровни
+        const size_t   slot = current_tick_ & (kSlots - 1);
+        const uint64_t rest = slot + 1 < kSlots ? occupied_[0] >> (slot + 1) : 0;
+        const uint64_t next_tick = rest != 0 ? current_tick_ + 1 + __builtin_ctzll(rest) : (current_tick_ | (kSlots - 1)) + 1;
+        if (next_tick > target_tick) {
+            current_tick_ = target_tick;
+            break;
+        }
+        current_tick_ = next_tick;
+
+        // Сверху вниз: запись может спуститься за один тик на несколько уровней
+        size_t levels = 1;
+        while (levels < kLevels && (current_tick_ & ((uint64_t{1} << (levels * kSlotBits)) - 1)) == 0)
+            ++levels;
+        for (size_t level = levels - 1; level > 0; --level)
+            Cascade(level);
+
+        const size_t bucket = current_tick_ & (kSlots - 1);
+        if (!heads_[bucket])
+            continue;
+        // Ячейка переносится в отдельный список: callback может переставлять
+        // и удалять устройства, в том числе ещё не обработанные
+        heads_[kExpiring] = heads_[bucket];
+        heads_[bucket] = nullptr;
+        occupied_[0] &= ~(uint64_t{1} << bucket);
+        for (Device *device = heads_[kExpiring]; device; device = device->next)
+            device->bucket = kExpiring;
+
+        while (Device *device = heads_[kExpiring]) {
+            Unlink(*device);
+            device->reported = true;
+            ++events;
+            on_offline({*device->id, device->last_seen_ms, GetDeadlineMs(*device)});
+        }
+    }
+    return events;
+}
+
+void LivenessTracker::Forget(std::string_view device_id)
+{
+    const auto it = devices_.find(device_id);
+    if (it == devices_.end())
+        return;
+    if (it->second.bucket != kUnscheduled)
+        Unlink(it->second);
+    devices_.erase(it);
+}
+
+bool LivenessTracker::IsOnline(std::string_view device_id) const
+{
+    const auto it = devices_.find(device_id);
+    return it != devices_.end() && it->second.bucket != kUnscheduled;
+}
+
+std::chrono::milliseconds LivenessTracker::GetInterval(std::string_view device_id) const
+{
+    const auto     it = devices_.find(device_id);
+    const uint32_t profile = it == devices_.end() ? 0 : it->second.profile;
+    return std::chrono::milliseconds(profiles_[profile].interval_ms);
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "command.pb.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct LivenessOptions {
+    /// Разрешение дедлайнов: событие приходит в первый Advance не раньше
+    /// чем через tick после дедлайна
+    std::chrono::milliseconds tick{1000};
+    /// Имена периодических отчётов (params/reports.json, см. LoadParamNames).
+    /// Интервал отчёта задаётся CmdSetParams с таким именем параметра,
+    /// значение - секунды, "0" выключает отчёт.
+    std::vector<std::string> reports;
+    /// Интервал устройства без включённых отчётов
+    std::chrono::seconds default_interval{300};
+    /// Сколько интервалов подряд можно пропустить до события
+    uint32_t missed_reports = 2;
+};
+
+struct LivenessEvent {
+    /// Ссылается на строку трекера: действительна до Forget этого
+    /// устройства (в том числе из обратного вызова) или разрушения трекера
+    std::string_view device_id;
+    uint64_t         last_seen_ms = 0;
+    uint64_t         deadline_ms = 0;
+};
+
+/// Отслеживает устройства, переставшие присылать отчёты, без обхода парка.
+///
+/// Каждое устройство ждёт следующего отчёта до last_seen + интервал *
+/// missed_reports, где интервал - наименьший из включённых интервалов
+/// отчётов. Дедлайны лежат в иерархическом колесе таймеров: kLevels уровней
+/// по kSlots ячеек, ячейка уровня k охватывает kSlots^k тиков. Ячейки -
+/// интрузивные двусвязные списки записей устройств, поэтому OnPacket -
+/// одна перестановка в колесе за O(1), а Advance тратит O(1) на сработавший
+/// дедлайн и на переложенную с верхнего уровня запись (запись в пределах
+/// горизонта колеса перекладывается не больше kLevels - 1 раз). Пустые ячейки пропускаются
+/// по битовым маскам занятости.
+///
+/// На устройство хранятся строка id и запись фиксированного размера:
+/// интервалы отчётов не копируются в устройство, а хранятся один раз для
+/// каждого различного набора (профиля). Не потокобезопасен.
+class LivenessTracker {
+  public:
+    static constexpr size_t kLevels = 4;
+    static constexpr size_t kSlots = 64;
+
+    /// std::invalid_argument для нулевых tick, default_interval или
+    /// missed_reports. now_ms - начало отсчёта тиков.
+    LivenessTracker(LivenessOptions options, uint64_t now_ms);
+
+    /// Пакет от устройства: новое устройство начинает отслеживаться,
+    /// дедлайн известного переносится. true, если устройство было
+    /// объявлено пропавшим и снова на связи.
+    bool OnPacket(std::string_view device_id, uint64_t now_ms);
+
+    /// Интервалы отчётов, применённые устройством (CmdSetParams, на который
+    /// пришёл успешный CommandResult). Параметры, не являющиеся отчётами, и
+    /// значения, которые не являются числом секунд, пропускаются. Дедлайн
+    /// отслеживаемого устройства пересчитывается от последнего пакета.
+    void ApplySetParams(std::string_view device_id, const CmdSetParams &set_params);
+
+    using OfflineCallback = std::function<void(const LivenessEvent &)>;
+
+    /// Срабатывают дедлайны, наступившие к now_ms. Устройство, о котором
+    /// сообщено, не отслеживается до следующего пакета. Из callback можно
+    /// вызывать OnPacket и ApplySetParams. Возвращает количество событий.
+    size_t Advance(uint64_t now_ms, const OfflineCallback &on_offline);
+
+    /// Удаляет устройство вместе с его дедлайном
+    void Forget(std::string_view device_id);
+
+    /// Устройство известно и не объявлено пропавшим
+    [[nodiscard]] bool IsOnline(std::string_view device_id) const;
+    /// Текущий интервал отчётов устройства (default_interval для неизвестного)
+    [[nodiscard]] std::chrono::milliseconds GetInterval(std::string_view device_id) const;
+
+    [[nodiscard]] size_t GetDeviceCount() const { return devices_.size(); }
+    /// Устройства с дедлайном в колесе
+    [[nodiscard]] size_t GetScheduledCount() const { return scheduled_; }
+    /// Различные наборы интервалов отчётов
+    [[nodiscard]] size_t GetProfileCount() const { return profiles_.size(); }
+
+  private:
+    /// Ячейка, которую сейчас обрабатывает Advance
+    static constexpr uint16_t kExpiring = kLevels * kSlots;
+    static constexpr uint16_t kUnscheduled = kExpiring + 1;
+
+    /// Лежит в узле devices_ рядом с id: поиск устройства по пакету - это
+    /// и доступ к его записи
+    struct Device {
+        /// Ключ узла devices_
+        const std::string *id = nullptr;
+        Device            *next = nullptr;
+        Device            *prev = nullptr;
+        uint64_t           last_seen_ms = 0;
+        uint64_t           deadline_tick = 0;
+        uint32_t           profile = 0;
+        uint16_t           bucket = kUnscheduled;
+        /// О пропаже уже сообщено
+        bool reported = false;
+    };
+
+    /// Интервалы отчётов в порядке options_.reports, мс; 0 - отчёт выключен
+    struct Profile {
+        std::vector<uint64_t> intervals_ms;
+        uint64_t              interval_ms = 0;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    Device  &GetOrAdd(std::string_view device_id);
+    uint32_t InternProfile(std::vector<uint64_t> intervals_ms);
+    /// Ставит дедлайн по last_seen_ms и профилю, переставляя запись в колесе
+    void Reschedule(Device &device);
+    /// Ячейка для дедлайна относительно текущего тика
+    [[nodiscard]] uint16_t GetBucket(uint64_t deadline_tick) const;
+    void Link(Device &device, uint16_t bucket);
+    void Unlink(Device &device);
+    /// Перекладывает ячейку уровня level, которая начинается на текущем тике
+    void Cascade(size_t level);
+    [[nodiscard]] uint64_t GetDeadlineMs(const Device &device) const;
+
+    LivenessOptions options_;
+    uint64_t        start_ms_;
+    uint64_t        tick_ms_;
+    /// Последний обработанный тик
+    uint64_t        current_tick_ = 0;
+    size_t          scheduled_ = 0;
+
+    std::unordered_map<std::string, Device, StringHash, std::equal_to<>> devices_;
+
+    std::vector<Profile>                      profiles_;
+    std::map<std::vector<uint64_t>, uint32_t> profile_index_;
+
+    /// Головы списков: kLevels * kSlots ячеек и kExpiring
+    Device  *heads_[kLevels * kSlots + 1] = {};
+    uint64_t occupied_[kLevels] = {};
+};
+
+}  // namespace iot::backend::proto
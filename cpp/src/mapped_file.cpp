@@ -0,0 +1,99 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace iot::backend::proto {
+
+namespace {
+
+[[noreturn]] void ThrowError(const char *action, const std::string &path)
+{
+    throw std::runtime_error(std::string(action) + " failed for " + path + ": " +
+                             std::strerror(errno));
+}
+
+int ToAdvice(MappedFile::Access access)
+{
+    switch (access) {
+        case MappedFile::Access::SEQUENTIAL:
+            return MADV_SEQUENTIAL;
+        case MappedFile::Access::RANDOM:
+            return MADV_RANDOM;
+        case MappedFile::Access::NORMAL:
+            break;
+    }
+    return MADV_NORMAL;
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string &path, Access access)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        ThrowError("open", path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        ThrowError("fstat", path);
+    }
+
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ != 0) {
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            const int error = errno;
+            data_ = nullptr;
+            size_ = 0;
+            ::close(fd);
+            errno = error;
+            ThrowError("mmap", path);
+        }
+        // Подсказка необязательна, ошибку игнорируем
+        ::madvise(data_, size_, ToAdvice(access));
+    }
+    // Отображение остаётся действительным и после закрытия файла
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    Unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0))
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+void MappedFile::Unmap()
+{
+    if (data_)
+        ::munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace iot::backend::proto {
+
+/// Файл, отображённый в память только для чтения. Пустой файл не
+/// отображается, GetData() для него пуст. Ошибки открытия и отображения -
+/// std::runtime_error.
+class MappedFile {
+  public:
+    /// Подсказки ядру о порядке чтения (madvise)
+    enum class Access { NORMAL, SEQUENTIAL, RANDOM };
+
+    explicit MappedFile(const std::string &path, Access access = Access::NORMAL);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    [[nodiscard]] std::string_view GetData() const
+    {
+        return {static_cast<const char *>(data_), size_};
+    }
+    [[nodiscard]] size_t GetSize() const { return size_; }
+
+  private:
+    void Unmap();
+
+    void  *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+}  // namespace iot::backend::proto
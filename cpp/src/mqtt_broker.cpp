@@ -0,0 +1,631 @@
+#include "mqtt_broker.h"
+
+#include "mqtt_codec.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr size_t kReadChunk = 64 * 1024;
+constexpr int    kMaxEvents = 256;
+
+[[noreturn]] void ThrowError(const char *action)
+{
+    throw std::runtime_error(std::string(action) + " failed: " + std::strerror(errno));
+}
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+bool IsWildcard(std::string_view filter)
+{
+    return filter.find_first_of("+#") != std::string_view::npos;
+}
+
+// Счётчики пишет только поток брокера
+void Bump(std::atomic<uint64_t> &counter, uint64_t value = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+struct LoopbackMqttBroker::Impl {
+    struct Connection {
+        int         fd = -1;
+        std::string in;
+        std::string out;
+        std::string client_id;
+        /// Фильтр и выданный QoS
+        std::vector<std::pair<std::string, uint8_t>> subscriptions;
+        uint16_t next_packet_id = 0;
+        bool     connected = false;
+        /// Есть неотправленные данные, соединение в dirty
+        bool dirty = false;
+        /// Подписка на EPOLLOUT
+        bool writing = false;
+        bool closing = false;
+        bool close_after_flush = false;
+    };
+
+    struct Subscriber {
+        Connection *connection = nullptr;
+        uint8_t     qos = 0;
+    };
+
+    struct WildcardSubscriber {
+        std::string filter;
+        Subscriber  subscriber;
+    };
+
+    explicit Impl(const MqttBrokerOptions &options) : options(options), read_buffer(kReadChunk) {}
+    ~Impl() { Stop(); }
+
+    void Open();
+    void Stop();
+    void Run();
+
+    void Accept();
+    void Read(Connection &connection);
+    size_t Process(Connection &connection, std::string_view data);
+    void HandlePacket(Connection &connection, const mqtt::FixedHeader &header, std::string_view body);
+    void OnConnect(Connection &connection, const mqtt::Connect &connect);
+    void OnPublish(Connection &connection, const mqtt::Publish &publish);
+    void OnSubscribe(Connection &connection, const mqtt::Subscribe &subscribe);
+    void OnUnsubscribe(Connection &connection, const mqtt::Unsubscribe &unsubscribe);
+
+    void AddTarget(const Subscriber &subscriber);
+    void AddSubscription(Connection &connection, std::string_view filter, uint8_t qos);
+    void RemoveSubscription(Connection &connection, std::string_view filter);
+
+    void MarkDirty(Connection &connection);
+    void Flush(Connection &connection);
+    void SetWriting(Connection &connection, bool writing);
+    void CloseAfterFlush(Connection &connection);
+    void Close(Connection &connection);
+    void Destroy(Connection &connection);
+
+    const MqttBrokerOptions &options;
+
+    int         listen_fd = -1;
+    int         epoll_fd = -1;
+    int         wake_fd = -1;
+    uint16_t    port = 0;
+    std::thread thread;
+
+    std::unordered_map<int, std::unique_ptr<Connection>>                           connections;
+    std::unordered_map<std::string, Connection *, StringHash, std::equal_to<>>     clients;
+    std::unordered_map<std::string, std::vector<Subscriber>, StringHash, std::equal_to<>> exact;
+    std::vector<WildcardSubscriber> wildcard;
+
+    std::vector<Connection *> dirty;
+    std::vector<Connection *> closing;
+    /// Получатели текущей публикации
+    std::vector<Subscriber> targets;
+    std::vector<char>       read_buffer;
+    uint64_t                anonymous_clients = 0;
+
+    std::atomic<uint64_t> connections_count{0};
+    std::atomic<uint64_t> publishes_received{0};
+    std::atomic<uint64_t> messages_delivered{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> protocol_errors{0};
+};
+
+void LoopbackMqttBroker::Impl::Open()
+{
+    listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        ThrowError("socket");
+    const int enable = 1;
+    ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+        ThrowError("bind");
+    if (::listen(listen_fd, SOMAXCONN) != 0)
+        ThrowError("listen");
+    socklen_t size = sizeof(address);
+    if (::getsockname(listen_fd, reinterpret_cast<sockaddr *>(&address), &size) != 0)
+        ThrowError("getsockname");
+    port = ntohs(address.sin_port);
+
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+        ThrowError("epoll_create1");
+    wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+        ThrowError("eventfd");
+
+    // Слушающий сокет и eventfd помечаются адресами своих дескрипторов,
+    // соединения - адресами Connection
+    for (int *fd : {&listen_fd, &wake_fd}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, *fd, &event) != 0)
+            ThrowError("epoll_ctl");
+    }
+
+    thread = std::thread([this] { Run(); });
+}
+
+void LoopbackMqttBroker::Impl::Stop()
+{
+    if (thread.joinable()) {
+        const uint64_t value = 1;
+        (void)!::write(wake_fd, &value, sizeof(value));
+        thread.join();
+    }
+
+    for (auto &[fd, connection] : connections)
+        ::close(fd);
+    dirty.clear();
+    closing.clear();
+    connections.clear();
+    clients.clear();
+    exact.clear();
+    wildcard.clear();
+    for (int *fd : {&listen_fd, &epoll_fd, &wake_fd}) {
+        if (*fd >= 0)
+            ::close(*fd);
+        *fd = -1;
+    }
+}
+
+void LoopbackMqttBroker::Impl::Run()
+{
+    epoll_event events[kMaxEvents];
+    bool        stop = false;
+    while (!stop) {
+        const int count = ::epoll_wait(epoll_fd, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            void *tag = events[i].data.ptr;
+            if (tag == &wake_fd) {
+                stop = true;
+            } else if (tag == &listen_fd) {
+                Accept();
+            } else {
+                auto &connection = *static_cast<Connection *>(tag);
+                if (connection.closing)
+                    continue;
+                if (events[i].events & EPOLLOUT)
+                    MarkDirty(connection);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    Read(connection);
+            }
+        }
+
+        // Всё, что накопилось за пачку событий, уходит одним send на соединение
+        for (Connection *connection : dirty) {
+            connection->dirty = false;
+            if (!connection->closing)
+                Flush(*connection);
+        }
+        dirty.clear();
+
+        for (Connection *connection : closing)
+            Destroy(*connection);
+        closing.clear();
+    }
+}
+
+void LoopbackMqttBroker::Impl::Accept()
+{
+    while (true) {
+        const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+            return;
+        const int enable = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = connection.get();
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections.emplace(fd, std::move(connection));
+    }
+}
+
+void LoopbackMqttBroker::Impl::Read(Connection &connection)
+{
+    // Один recv на событие: epoll работает по уровню, так что остаток
+    // прочитается в следующей пачке, а соединения обслуживаются по очереди
+    const ssize_t size = ::recv(connection.fd, read_buffer.data(), read_buffer.size(), 0);
+    if (size == 0) {
+        Close(connection);
+        return;
+    }
+    if (size < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            Close(connection);
+        return;
+    }
+    Bump(bytes_received, size);
+
+    // Без хвоста от прошлого чтения пакеты разбираются прямо из read_buffer
+    const std::string_view chunk(read_buffer.data(), size);
+    if (connection.in.empty()) {
+        const size_t consumed = Process(connection, chunk);
+        if (!connection.closing)
+            connection.in.assign(chunk.substr(consumed));
+    } else {
+        connection.in += chunk;
+        const size_t consumed = Process(connection, connection.in);
+        if (!connection.closing)
+            connection.in.erase(0, consumed);
+    }
+}
+
+size_t LoopbackMqttBroker::Impl::Process(Connection &connection, std::string_view data)
+{
+    size_t position = 0;
+    try {
+        while (!connection.closing && !connection.close_after_flush) {
+            const auto header = mqtt::ParseFixedHeader(data.substr(position));
+            if (!header)
+                break;
+            if (header->remaining_length > options.max_packet_size)
+                throw std::invalid_argument("MQTT packet exceeds max_packet_size");
+            const size_t size = header->header_size + header->remaining_length;
+            if (data.size() - position < size)
+                break;
+            HandlePacket(connection,
+                         *header,
+                         data.substr(position + header->header_size, header->remaining_length));
+            position += size;
+        }
+    } catch (const std::invalid_argument &) {
+        // Ответы на предыдущие пакеты всё же отправляются
+        Bump(protocol_errors);
+        CloseAfterFlush(connection);
+    }
+    return position;
+}
+
+void LoopbackMqttBroker::Impl::HandlePacket(Connection              &connection,
+                                            const mqtt::FixedHeader &header,
+                                            std::string_view         body)
+{
+    if (!connection.connected && header.type != mqtt::PacketType::CONNECT)
+        throw std::invalid_argument("MQTT session must start with CONNECT");
+
+    switch (header.type) {
+        case mqtt::PacketType::CONNECT:
+            OnConnect(connection, mqtt::ParseConnect(body));
+            break;
+        case mqtt::PacketType::PUBLISH:
+            OnPublish(connection, mqtt::ParsePublish(header.flags, body));
+            break;
+        case mqtt::PacketType::PUBACK:
+            // Доставка QoS 1 не переотправляется, подтверждать нечего
+            (void)mqtt::ParsePacketId(body);
+            break;
+        case mqtt::PacketType::SUBSCRIBE:
+            OnSubscribe(connection, mqtt::ParseSubscribe(body));
+            break;
+        case mqtt::PacketType::UNSUBSCRIBE:
+            OnUnsubscribe(connection, mqtt::ParseUnsubscribe(body));
+            break;
+        case mqtt::PacketType::PINGREQ:
+            mqtt::AppendPingresp(connection.out);
+            MarkDirty(connection);
+            break;
+        case mqtt::PacketType::DISCONNECT:
+            Close(connection);
+            break;
+        default:
+            throw std::invalid_argument("Unsupported MQTT packet type");
+    }
+}
+
+void LoopbackMqttBroker::Impl::OnConnect(Connection &connection, const mqtt::Connect &connect)
+{
+    if (connection.connected)
+        throw std::invalid_argument("Repeated MQTT CONNECT");
+    if (!connect.IsSupportedProtocol()) {
+        mqtt::AppendConnack(connection.out, false, mqtt::kConnectBadProtocol);
+        CloseAfterFlush(connection);
+        return;
+    }
+
+    std::string client_id(connect.client_id);
+    if (client_id.empty()) {
+        if (!connect.clean_session) {
+            mqtt::AppendConnack(connection.out, false, mqtt::kConnectBadClientId);
+            CloseAfterFlush(connection);
+            return;
+        }
+        client_id = "anonymous-" + std::to_string(++anonymous_clients);
+    }
+    if (const auto it = clients.find(client_id); it != clients.end())
+        Close(*it->second);
+
+    connection.client_id = std::move(client_id);
+    connection.connected = true;
+    clients.emplace(connection.client_id, &connection);
+    Bump(connections_count);
+
+    // Сессии не сохраняются: session present всегда 0
+    mqtt::AppendConnack(connection.out, false, mqtt::kConnectAccepted);
+    MarkDirty(connection);
+}
+
+void LoopbackMqttBroker::Impl::OnPublish(Connection &connection, const mqtt::Publish &publish)
+{
+    if (!mqtt::IsValidTopicName(publish.topic))
+        throw std::invalid_argument("Invalid MQTT topic name");
+    if (publish.qos > 1)
+        throw std::invalid_argument("MQTT QoS 2 is not supported");
+    Bump(publishes_received);
+
+    targets.clear();
+    if (const auto it = exact.find(publish.topic); it != exact.end()) {
+        for (const auto &subscriber : it->second)
+            AddTarget(subscriber);
+    }
+    for (const auto &subscriber : wildcard) {
+        if (mqtt::TopicMatches(subscriber.filter, publish.topic))
+            AddTarget(subscriber.subscriber);
+    }
+
+    for (const auto &target : targets) {
+        Connection &subscriber = *target.connection;
+        if (subscriber.closing)
+            continue;
+        const uint8_t qos = std::min(publish.qos, target.qos);
+        uint16_t      packet_id = 0;
+        if (qos > 0) {
+            if (++subscriber.next_packet_id == 0)
+                subscriber.next_packet_id = 1;
+            packet_id = subscriber.next_packet_id;
+        }
+        mqtt::AppendPublish(subscriber.out, publish.topic, publish.payload, qos, packet_id);
+        Bump(messages_delivered);
+        if (subscriber.out.size() > options.max_output_buffer)
+            Close(subscriber);
+        else
+            MarkDirty(subscriber);
+    }
+
+    if (publish.qos > 0) {
+        mqtt::AppendPuback(connection.out, publish.packet_id);
+        MarkDirty(connection);
+    }
+}
+
+void LoopbackMqttBroker::Impl::OnSubscribe(Connection &connection, const mqtt::Subscribe &subscribe)
+{
+    std::vector<uint8_t> return_codes;
+    return_codes.reserve(subscribe.filters.size());
+    for (const auto &[filter, qos] : subscribe.filters) {
+        if (!mqtt::IsValidTopicFilter(filter)) {
+            return_codes.push_back(mqtt::kSubscribeFailure);
+            continue;
+        }
+        const uint8_t granted = std::min<uint8_t>(qos, 1);
+        AddSubscription(connection, filter, granted);
+        return_codes.push_back(granted);
+    }
+    mqtt::AppendSuback(connection.out, subscribe.packet_id, return_codes);
+    MarkDirty(connection);
+}
+
+void LoopbackMqttBroker::Impl::OnUnsubscribe(Connection &connection, const mqtt::Unsubscribe &unsubscribe)
+{
+    for (const auto filter : unsubscribe.filters)
+        RemoveSubscription(connection, filter);
+    mqtt::AppendUnsuback(connection.out, unsubscribe.packet_id);
+    MarkDirty(connection);
+}
+
+void LoopbackMqttBroker::Impl::AddTarget(const Subscriber &subscriber)
+{
+    // Пересекающиеся подписки одного клиента дают одну доставку с большим QoS
+    for (auto &target : targets) {
+        if (target.connection == subscriber.connection) {
+            target.qos = std::max(target.qos, subscriber.qos);
+            return;
+        }
+    }
+    targets.push_back(subscriber);
+}
+
+void LoopbackMqttBroker::Impl::AddSubscription(Connection &connection, std::string_view filter, uint8_t qos)
+{
+    RemoveSubscription(connection, filter);
+    connection.subscriptions.emplace_back(filter, qos);
+    if (IsWildcard(filter)) {
+        wildcard.push_back({std::string(filter), {&connection, qos}});
+        return;
+    }
+    auto it = exact.find(filter);
+    if (it == exact.end())
+        it = exact.emplace(std::string(filter), std::vector<Subscriber>()).first;
+    it->second.push_back({&connection, qos});
+}
+
+void LoopbackMqttBroker::Impl::RemoveSubscription(Connection &connection, std::string_view filter)
+{
+    const auto own = std::find_if(connection.subscriptions.begin(),
+                                  connection.subscriptions.end(),
+                                  [filter](const auto &subscription) { return subscription.first == filter; });
+    if (own == connection.subscriptions.end())
+        return;
+    connection.subscriptions.erase(own);
+
+    if (IsWildcard(filter)) {
+        std::erase_if(wildcard, [&](const WildcardSubscriber &subscriber) {
+            return subscriber.subscriber.connection == &connection && subscriber.filter == filter;
+        });
+        return;
+    }
+    const auto it = exact.find(filter);
+    if (it == exact.end())
+        return;
+    std::erase_if(it->second, [&](const Subscriber &subscriber) { return subscriber.connection == &connection; });
+    if (it->second.empty())
+        exact.erase(it);
+}
+
+void LoopbackMqttBroker::Impl::MarkDirty(Connection &connection)
+{
+    if (!connection.dirty) {
+        connection.dirty = true;
+        dirty.push_back(&connection);
+    }
+}
+
+void LoopbackMqttBroker::Impl::Flush(Connection &connection)
+{
+    size_t sent = 0;
+    while (sent < connection.out.size()) {
+        const ssize_t size = ::send(connection.fd,
+                                    connection.out.data() + sent,
+                                    connection.out.size() - sent,
+                                    MSG_NOSIGNAL);
+        if (size > 0) {
+            sent += size;
+            continue;
+        }
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        Close(connection);
+        return;
+    }
+    Bump(bytes_sent, sent);
+    connection.out.erase(0, sent);
+
+    if (!connection.out.empty()) {
+        SetWriting(connection, true);
+        return;
+    }
+    if (connection.close_after_flush) {
+        Close(connection);
+        return;
+    }
+    SetWriting(connection, false);
+}
+
+void LoopbackMqttBroker::Impl::SetWriting(Connection &connection, bool writing)
+{
+    if (connection.writing == writing)
+        return;
+    connection.writing = writing;
+    epoll_event event{};
+    event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.ptr = &connection;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void LoopbackMqttBroker::Impl::CloseAfterFlush(Connection &connection)
+{
+    connection.close_after_flush = true;
+    MarkDirty(connection);
+}
+
+void LoopbackMqttBroker::Impl::Close(Connection &connection)
+{
+    if (connection.closing)
+        return;
+    connection.closing = true;
+    closing.push_back(&connection);
+
+    // Подписки снимаются сразу, чтобы публикации той же пачки событий уже
+    // не попадали в закрываемое соединение
+    while (!connection.subscriptions.empty()) {
+        const std::string filter = connection.subscriptions.back().first;
+        RemoveSubscription(connection, filter);
+    }
+    if (const auto it = clients.find(connection.client_id);
+        it != clients.end() && it->second == &connection)
+        clients.erase(it);
+}
+
+void LoopbackMqttBroker::Impl::Destroy(Connection &connection)
+{
+    const int fd = connection.fd;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections.erase(fd);
+}
+
+LoopbackMqttBroker::LoopbackMqttBroker(MqttBrokerOptions options) : options_(options) {}
+
+LoopbackMqttBroker::~LoopbackMqttBroker() = default;
+
+void LoopbackMqttBroker::Start()
+{
+    if (impl_)
+        throw std::runtime_error("LoopbackMqttBroker is already started");
+    auto impl = std::make_unique<Impl>(options_);
+    impl->Open();
+    impl_ = std::move(impl);
+}
+
+void LoopbackMqttBroker::Stop()
+{
+    if (impl_)
+        impl_->Stop();
+}
+
+uint16_t LoopbackMqttBroker::GetPort() const
+{
+    return impl_ ? impl_->port : 0;
+}
+
+MqttBrokerStats LoopbackMqttBroker::GetStats() const
+{
+    MqttBrokerStats stats;
+    if (!impl_)
+        return stats;
+    stats.connections = impl_->connections_count.load(std::memory_order_relaxed);
+    stats.publishes_received = impl_->publishes_received.load(std::memory_order_relaxed);
+    stats.messages_delivered = impl_->messages_delivered.load(std::memory_order_relaxed);
+    stats.bytes_received = impl_->bytes_received.load(std::memory_order_relaxed);
+    stats.bytes_sent = impl_->bytes_sent.load(std::memory_order_relaxed);
+    stats.protocol_errors = impl_->protocol_errors.load(std::memory_order_relaxed);
+    return stats;
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace iot::backend::proto {
+
+struct MqttBrokerOptions {
+    /// 0 - любой свободный порт, см. LoopbackMqttBroker::GetPort
+    uint16_t port = 0;
+    /// Пакет длиннее (без фиксированного заголовка) закрывает соединение
+    size_t max_packet_size = 1 << 20;
+    /// Подписчик, у которого столько неотправленных байт, отключается
+    size_t max_output_buffer = 64 << 20;
+};
+
+struct MqttBrokerStats {
+    uint64_t connections = 0;
+    uint64_t publishes_received = 0;
+    uint64_t messages_delivered = 0;
+    uint64_t bytes_received = 0;
+    uint64_t bytes_sent = 0;
+    /// Соединения, закрытые из-за некорректных пакетов
+    uint64_t protocol_errors = 0;
+};
+
+/// Замена облачного MQTT брокера для локальных end-to-end тестов и
+/// бенчмарков: MQTT 3.1.1 поверх TCP на 127.0.0.1, один поток с циклом epoll.
+///
+/// Поддерживается подмножество, которого хватает протоколу:
+///   - PUBLISH с QoS 0 и 1: PUBACK отправителю, доставка подписчикам с
+///     QoS = min(QoS публикации, QoS подписки). QoS 2 закрывает соединение;
+///   - SUBSCRIBE/UNSUBSCRIBE с '+' и '#', точные фильтры ищутся по хешу;
+///   - только clean session: подписки живут до отключения, retained
+///     сообщения и will не хранятся, QoS 1 не переотправляется, keep alive
+///     не отслеживается;
+///   - повторный CONNECT с тем же client id отключает прежнее соединение.
+///
+/// Ответы соединениям копятся в буферах и отправляются после обработки
+/// всей пачки событий epoll, так что конвейер публикаций уходит
+/// подписчику одним send.
+class LoopbackMqttBroker {
+  public:
+    explicit LoopbackMqttBroker(MqttBrokerOptions options = {});
+    ~LoopbackMqttBroker();
+
+    LoopbackMqttBroker(const LoopbackMqttBroker &) = delete;
+    LoopbackMqttBroker &operator=(const LoopbackMqttBroker &) = delete;
+
+    /// Открывает порт и запускает поток брокера; std::runtime_error, если
+    /// порт занят. Брокер запускается один раз.
+    void Start();
+    /// Закрывает все соединения и останавливает поток; статистика остаётся
+    void Stop();
+
+    [[nodiscard]] uint16_t        GetPort() const;
+    [[nodiscard]] MqttBrokerStats GetStats() const;
+
+  private:
+    struct Impl;
+
+    const MqttBrokerOptions options_;
+    std::unique_ptr<Impl>   impl_;
+};
+
+}  // namespace iot::backend::proto
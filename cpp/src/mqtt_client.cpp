@@ -0,0 +1,265 @@
+#include "mqtt_client.h"
+
+#include "mqtt_codec.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace iot::backend::proto {
+
+namespace {
+
+constexpr size_t kReadChunk = 64 * 1024;
+
+[[noreturn]] void ThrowError(const char *action)
+{
+    throw std::runtime_error(std::string(action) + " failed: " + std::strerror(errno));
+}
+
+}  // namespace
+
+MqttClient::MqttClient(uint16_t port, std::string client_id, std::chrono::milliseconds timeout)
+    : client_id_(std::move(client_id))
+    , timeout_(timeout)
+    , read_buffer_(kReadChunk)
+{
+    fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+        ThrowError("socket");
+    try {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+            ThrowError("connect");
+        const int enable = 1;
+        ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        out_.clear();
+        mqtt::AppendConnect(out_, client_id_, 0);
+        Send(out_);
+        WaitFor([this] { return connack_received_; }, "CONNACK");
+        if (connack_code_ != mqtt::kConnectAccepted)
+            throw std::runtime_error("MQTT connection refused with code " + std::to_string(connack_code_));
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+MqttClient::~MqttClient()
+{
+    if (fd_ >= 0)
+        ::close(fd_);
+}
+
+uint8_t MqttClient::Subscribe(std::string_view filter, uint8_t qos)
+{
+    const uint16_t packet_id = NextPacketId();
+    acked_packet_id_ = 0;
+    out_.clear();
+    mqtt::AppendSubscribe(out_, packet_id, {{filter, qos}});
+    Send(out_);
+    WaitFor([this, packet_id] { return acked_packet_id_ == packet_id; }, "SUBACK");
+
+    if (suback_codes_.size() != 1 || suback_codes_[0] == mqtt::kSubscribeFailure)
+        throw std::runtime_error("MQTT subscription to " + std::string(filter) + " is rejected");
+    return suback_codes_[0];
+}
+
+void MqttClient::Unsubscribe(std::string_view filter)
+{
+    const uint16_t packet_id = NextPacketId();
+    acked_packet_id_ = 0;
+    out_.clear();
+    mqtt::AppendUnsubscribe(out_, packet_id, {filter});
+    Send(out_);
+    WaitFor([this, packet_id] { return acked_packet_id_ == packet_id; }, "UNSUBACK");
+}
+
+void MqttClient::Publish(std::string_view topic, std::string_view payload, uint8_t qos)
+{
+    out_.clear();
+    mqtt::AppendPublish(out_, topic, payload, qos, qos > 0 ? NextPacketId() : 0);
+    Send(out_);
+    if (qos > 0)
+        ++pending_acks_;
+}
+
+void MqttClient::WaitForAcks()
+{
+    WaitFor([this] { return pending_acks_ == 0; }, "PUBACK");
+}
+
+bool MqttClient::Receive(MqttMessage &message, std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (messages_.empty()) {
+        if (!Poll(deadline))
+            return false;
+    }
+    std::swap(message, messages_.front());
+    messages_.pop_front();
+    return true;
+}
+
+void MqttClient::Ping()
+{
+    const uint64_t pings = pings_;
+    out_.clear();
+    mqtt::AppendPingreq(out_);
+    Send(out_);
+    WaitFor([this, pings] { return pings_ != pings; }, "PINGRESP");
+}
+
+void MqttClient::Disconnect()
+{
+    if (fd_ < 0)
+        return;
+    out_.clear();
+    mqtt::AppendDisconnect(out_);
+    (void)::send(fd_, out_.data(), out_.size(), MSG_NOSIGNAL);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+void MqttClient::Send(std::string_view data)
+{
+    if (fd_ < 0)
+        throw std::runtime_error("MQTT client is disconnected");
+    while (!data.empty()) {
+        const ssize_t size = ::send(fd_, data.data(), data.size(), MSG_NOSIGNAL);
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            ThrowError("send");
+        }
+        data.remove_prefix(size);
+    }
+}
+
+bool MqttClient::Poll(Deadline deadline)
+{
+    if (fd_ < 0)
+        throw std::runtime_error("MQTT client is disconnected");
+
+    // Сначала пробуем прочитать без ожидания: в конвейере данные обычно
+    // уже пришли, и poll был бы лишним системным вызовом
+    ssize_t size = ::recv(fd_, read_buffer_.data(), read_buffer_.size(), MSG_DONTWAIT);
+    while (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0)
+            return false;
+        pollfd descriptor{fd_, POLLIN, 0};
+        const int ready = ::poll(&descriptor, 1, static_cast<int>(left.count()));
+        if (ready < 0 && errno != EINTR)
+            ThrowError("poll");
+        if (ready <= 0)
+            continue;
+        size = ::recv(fd_, read_buffer_.data(), read_buffer_.size(), MSG_DONTWAIT);
+    }
+    if (size == 0)
+        throw std::runtime_error("MQTT connection is closed by broker");
+    if (size < 0)
+        ThrowError("recv");
+
+    const std::string_view chunk(read_buffer_.data(), size);
+    std::string_view       data = chunk;
+    if (!in_.empty()) {
+        in_ += chunk;
+        data = in_;
+    }
+
+    size_t position = 0;
+    try {
+        while (const auto header = mqtt::ParseFixedHeader(data.substr(position))) {
+            const size_t packet_size = header->header_size + header->remaining_length;
+            if (data.size() - position < packet_size)
+                break;
+            HandlePacket(static_cast<uint8_t>(data[position]),
+                         data.substr(position + header->header_size, header->remaining_length));
+            position += packet_size;
+        }
+    } catch (const std::invalid_argument &error) {
+        throw std::runtime_error(std::string("Malformed MQTT packet from broker: ") + error.what());
+    }
+
+    if (in_.empty())
+        in_.assign(chunk.substr(position));
+    else
+        in_.erase(0, position);
+    return true;
+}
+
+void MqttClient::HandlePacket(uint8_t first_byte, std::string_view body)
+{
+    switch (static_cast<mqtt::PacketType>(first_byte >> 4)) {
+        case mqtt::PacketType::CONNACK:
+            connack_code_ = mqtt::ParseConnack(body);
+            connack_received_ = true;
+            break;
+        case mqtt::PacketType::PUBLISH: {
+            const auto publish = mqtt::ParsePublish(first_byte & 0x0F, body);
+            if (publish.qos > 1)
+                throw std::runtime_error("MQTT QoS 2 is not supported");
+            auto &message = messages_.emplace_back();
+            message.topic = publish.topic;
+            message.payload = publish.payload;
+            message.qos = publish.qos;
+            if (publish.qos > 0) {
+                out_.clear();
+                mqtt::AppendPuback(out_, publish.packet_id);
+                Send(out_);
+            }
+            break;
+        }
+        case mqtt::PacketType::PUBACK:
+            (void)mqtt::ParsePacketId(body);
+            if (pending_acks_ > 0)
+                --pending_acks_;
+            break;
+        case mqtt::PacketType::SUBACK: {
+            auto suback = mqtt::ParseSuback(body);
+            suback_codes_ = std::move(suback.return_codes);
+            acked_packet_id_ = suback.packet_id;
+            break;
+        }
+        case mqtt::PacketType::UNSUBACK:
+            acked_packet_id_ = mqtt::ParsePacketId(body);
+            break;
+        case mqtt::PacketType::PINGRESP:
+            ++pings_;
+            break;
+        default:
+            throw std::runtime_error("Unexpected MQTT packet from broker");
+    }
+}
+
+template <class TDone>
+void MqttClient::WaitFor(TDone done, const char *what)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (!done()) {
+        if (!Poll(deadline))
+            throw std::runtime_error(std::string("Timed out waiting for MQTT ") + what);
+    }
+}
+
+uint16_t MqttClient::NextPacketId()
+{
+    if (++next_packet_id_ == 0)
+        next_packet_id_ = 1;
+    return next_packet_id_;
+}
+
+}  // namespace iot::backend::proto
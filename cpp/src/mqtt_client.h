@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct MqttMessage {
+    std::string topic;
+    std::string payload;
+    uint8_t     qos = 0;
+};
+
+/// Простой блокирующий MQTT 3.1.1 клиент для тестов и бенчмарков с
+/// LoopbackMqttBroker: одно соединение с 127.0.0.1, clean session, QoS 0 и 1.
+/// Входящие QoS 1 подтверждаются автоматически. Не потокобезопасен.
+///
+/// Ошибки соединения и протокола, а также истечение timeout при ожидании
+/// ответа брокера - std::runtime_error.
+class MqttClient {
+  public:
+    /// Подключается и ждёт CONNACK
+    MqttClient(uint16_t                  port,
+               std::string               client_id,
+               std::chrono::milliseconds timeout = std::chrono::seconds(5));
+    ~MqttClient();
+
+    MqttClient(const MqttClient &) = delete;
+    MqttClient &operator=(const MqttClient &) = delete;
+
+    [[nodiscard]] const std::string &GetClientId() const { return client_id_; }
+
+    /// Ждёт SUBACK и возвращает выданный QoS; std::runtime_error, если
+    /// брокер отклонил фильтр
+    uint8_t Subscribe(std::string_view filter, uint8_t qos);
+    /// Ждёт UNSUBACK
+    void Unsubscribe(std::string_view filter);
+
+    /// Отправляет PUBLISH, не дожидаясь PUBACK (см. WaitForAcks)
+    void Publish(std::string_view topic, std::string_view payload, uint8_t qos = 0);
+    /// Ждёт PUBACK на все отправленные публикации QoS 1
+    void WaitForAcks();
+    [[nodiscard]] size_t GetPendingAcks() const { return pending_acks_; }
+
+    /// Следующее входящее сообщение. false, если за timeout ничего не
+    /// пришло. Строки message переиспользуются.
+    bool Receive(MqttMessage &message, std::chrono::milliseconds timeout);
+
+    /// PINGREQ и ожидание PINGRESP
+    void Ping();
+    /// DISCONNECT и закрытие соединения
+    void Disconnect();
+
+  private:
+    using Deadline = std::chrono::steady_clock::time_point;
+
+    void Send(std::string_view data);
+    /// Читает из сокета и разбирает пришедшие пакеты; false, если до
+    /// deadline ничего не пришло
+    bool Poll(Deadline deadline);
+    void HandlePacket(uint8_t first_byte, std::string_view body);
+    template <class TDone>
+    void WaitFor(TDone done, const char *what);
+
+    uint16_t NextPacketId();
+
+    int                             fd_ = -1;
+    const std::string               client_id_;
+    const std::chrono::milliseconds timeout_;
+
+    std::string       in_;
+    std::string       out_;
+    std::vector<char> read_buffer_;
+
+    std::deque<MqttMessage> messages_;
+    uint16_t                next_packet_id_ = 0;
+    size_t                  pending_acks_ = 0;
+    bool                    connack_received_ = false;
+    uint8_t                 connack_code_ = 0;
+    /// Packet id последнего SUBACK или UNSUBACK
+    uint16_t             acked_packet_id_ = 0;
+    std::vector<uint8_t> suback_codes_;
+    uint64_t             pings_ = 0;
+};
+
+}  // namespace iot::backend::proto
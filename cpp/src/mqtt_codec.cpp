@@ -0,0 +1,401 @@
+#include "mqtt_codec.h"
+
+#include <stdexcept>
+
+namespace iot::backend::proto::mqtt {
+
+namespace {
+
+constexpr std::string_view kProtocolName = "MQTT";
+constexpr uint8_t          kProtocolLevel = 4;
+
+// Последовательное чтение полей тела пакета
+class Reader {
+  public:
+    explicit Reader(std::string_view data) : data_(data) {}
+
+    uint8_t ReadU8()
+    {
+        Require(1);
+        const auto value = static_cast<uint8_t>(data_[pos_]);
+        pos_ += 1;
+        return value;
+    }
+
+    uint16_t ReadU16()
+    {
+        Require(2);
+        const auto value = static_cast<uint16_t>(
+            (static_cast<uint8_t>(data_[pos_]) << 8) | static_cast<uint8_t>(data_[pos_ + 1]));
+        pos_ += 2;
+        return value;
+    }
+
+    std::string_view ReadString()
+    {
+        const size_t size = ReadU16();
+        Require(size);
+        const auto value = data_.substr(pos_, size);
+        pos_ += size;
+        return value;
+    }
+
+    std::string_view ReadRest()
+    {
+        const auto value = data_.substr(pos_);
+        pos_ = data_.size();
+        return value;
+    }
+
+    [[nodiscard]] bool Empty() const { return pos_ == data_.size(); }
+
+  private:
+    void Require(size_t size) const
+    {
+        if (data_.size() - pos_ < size)
+            throw std::invalid_argument("MQTT packet is truncated");
+    }
+
+    std::string_view data_;
+    size_t           pos_ = 0;
+};
+
+void AppendFixedHeader(std::string &out, PacketType type, uint8_t flags, size_t remaining_length)
+{
+    if (remaining_length > kMaxRemainingLength)
+        throw std::invalid_argument("MQTT packet is too large");
+    out += static_cast<char>((static_cast<uint8_t>(type) << 4) | flags);
+    do {
+        uint8_t byte = remaining_length & 0x7F;
+        remaining_length >>= 7;
+        if (remaining_length != 0)
+            byte |= 0x80;
+        out += static_cast<char>(byte);
+    } while (remaining_length != 0);
+}
+
+void AppendU16(std::string &out, uint16_t value)
+{
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value & 0xFF);
+}
+
+void AppendString(std::string &out, std::string_view value)
+{
+    if (value.size() > UINT16_MAX)
+        throw std::invalid_argument("MQTT string is too long");
+    AppendU16(out, static_cast<uint16_t>(value.size()));
+    out += value;
+}
+
+uint16_t ReadPacketId(Reader &reader)
+{
+    const uint16_t packet_id = reader.ReadU16();
+    if (packet_id == 0)
+        throw std::invalid_argument("MQTT packet id can't be zero");
+    return packet_id;
+}
+
+// Флаги фиксированного заголовка, обязательные для типа пакета
+bool HasValidFlags(PacketType type, uint8_t flags)
+{
+    switch (type) {
+        case PacketType::PUBLISH:
+            return ((flags >> 1) & 0x03) != 0x03;
+        case PacketType::PUBREL:
+        case PacketType::SUBSCRIBE:
+        case PacketType::UNSUBSCRIBE:
+            return flags == 0x02;
+        default:
+            return flags == 0;
+    }
+}
+
+}  // namespace
+
+std::optional<FixedHeader> ParseFixedHeader(std::string_view data)
+{
+    if (data.size() < 2)
+        return std::nullopt;
+
+    FixedHeader header;
+    const auto  first = static_cast<uint8_t>(data[0]);
+    const auto  type = first >> 4;
+    if (type < static_cast<uint8_t>(PacketType::CONNECT) ||
+        type > static_cast<uint8_t>(PacketType::DISCONNECT))
+        throw std::invalid_argument("Unknown MQTT packet type");
+    header.type = static_cast<PacketType>(type);
+    header.flags = first & 0x0F;
+    if (!HasValidFlags(header.type, header.flags))
+        throw std::invalid_argument("Invalid MQTT fixed header flags");
+
+    size_t multiplier = 1;
+    for (size_t i = 1; i <= 4; ++i) {
+        if (i >= data.size())
+            return std::nullopt;
+        const auto byte = static_cast<uint8_t>(data[i]);
+        header.remaining_length += (byte & 0x7F) * multiplier;
+        if ((byte & 0x80) == 0) {
+            header.header_size = i + 1;
+            return header;
+        }
+        multiplier <<= 7;
+    }
+    throw std::invalid_argument("Malformed MQTT remaining length");
+}
+
+bool Connect::IsSupportedProtocol() const
+{
+    return protocol_level == kProtocolLevel;
+}
+
+Connect ParseConnect(std::string_view body)
+{
+    Reader  reader(body);
+    Connect connect;
+    if (reader.ReadString() != kProtocolName)
+        throw std::invalid_argument("Unknown MQTT protocol name");
+    connect.protocol_level = reader.ReadU8();
+
+    const uint8_t flags = reader.ReadU8();
+    if (flags & 0x01)
+        throw std::invalid_argument("Reserved MQTT CONNECT flag is set");
+    connect.clean_session = flags & 0x02;
+    connect.keep_alive_s = reader.ReadU16();
+    connect.client_id = reader.ReadString();
+
+    // Will, username и password не используются, но должны быть корректны
+    if (flags & 0x04) {
+        (void)reader.ReadString();
+        (void)reader.ReadString();
+    }
+    if (flags & 0x80)
+        (void)reader.ReadString();
+    if (flags & 0x40)
+        (void)reader.ReadString();
+    return connect;
+}
+
+Publish ParsePublish(uint8_t flags, std::string_view body)
+{
+    Reader  reader(body);
+    Publish publish;
+    publish.qos = (flags >> 1) & 0x03;
+    publish.dup = flags & 0x08;
+    publish.retain = flags & 0x01;
+    publish.topic = reader.ReadString();
+    if (publish.qos > 0)
+        publish.packet_id = ReadPacketId(reader);
+    publish.payload = reader.ReadRest();
+    return publish;
+}
+
+Subscribe ParseSubscribe(std::string_view body)
+{
+    Reader    reader(body);
+    Subscribe subscribe;
+    subscribe.packet_id = ReadPacketId(reader);
+    while (!reader.Empty()) {
+        const auto    filter = reader.ReadString();
+        const uint8_t qos = reader.ReadU8();
+        if (qos > 2)
+            throw std::invalid_argument("Invalid MQTT SUBSCRIBE QoS");
+        subscribe.filters.emplace_back(filter, qos);
+    }
+    if (subscribe.filters.empty())
+        throw std::invalid_argument("MQTT SUBSCRIBE without topic filters");
+    return subscribe;
+}
+
+Unsubscribe ParseUnsubscribe(std::string_view body)
+{
+    Reader      reader(body);
+    Unsubscribe unsubscribe;
+    unsubscribe.packet_id = ReadPacketId(reader);
+    while (!reader.Empty())
+        unsubscribe.filters.push_back(reader.ReadString());
+    if (unsubscribe.filters.empty())
+        throw std::invalid_argument("MQTT UNSUBSCRIBE without topic filters");
+    return unsubscribe;
+}
+
+Suback ParseSuback(std::string_view body)
+{
+    Reader reader(body);
+    Suback suback;
+    suback.packet_id = ReadPacketId(reader);
+    const auto codes = reader.ReadRest();
+    suback.return_codes.assign(codes.begin(), codes.end());
+    return suback;
+}
+
+uint8_t ParseConnack(std::string_view body)
+{
+    Reader reader(body);
+    (void)reader.ReadU8();
+    return reader.ReadU8();
+}
+
+uint16_t ParsePacketId(std::string_view body)
+{
+    Reader reader(body);
+    return ReadPacketId(reader);
+}
+
+void AppendConnect(std::string &out, std::string_view client_id, uint16_t keep_alive_s, bool clean_session)
+{
+    AppendFixedHeader(out, PacketType::CONNECT, 0, 2 + kProtocolName.size() + 4 + 2 + client_id.size());
+    AppendString(out, kProtocolName);
+    out += static_cast<char>(kProtocolLevel);
+    out += static_cast<char>(clean_session ? 0x02 : 0x00);
+    AppendU16(out, keep_alive_s);
+    AppendString(out, client_id);
+}
+
+void AppendConnack(std::string &out, bool session_present, uint8_t return_code)
+{
+    AppendFixedHeader(out, PacketType::CONNACK, 0, 2);
+    out += static_cast<char>(session_present ? 0x01 : 0x00);
+    out += static_cast<char>(return_code);
+}
+
+void AppendPublish(std::string     &out,
+                   std::string_view topic,
+                   std::string_view payload,
+                   uint8_t          qos,
+                   uint16_t         packet_id,
+                   bool             retain)
+{
+    if (qos > 1)
+        throw std::invalid_argument("Only MQTT QoS 0 and 1 are supported");
+    const size_t size = 2 + topic.size() + (qos > 0 ? 2 : 0) + payload.size();
+    AppendFixedHeader(out, PacketType::PUBLISH, static_cast<uint8_t>((qos << 1) | (retain ? 1 : 0)), size);
+    AppendString(out, topic);
+    if (qos > 0)
+        AppendU16(out, packet_id);
+    out += payload;
+}
+
+void AppendPuback(std::string &out, uint16_t packet_id)
+{
+    AppendFixedHeader(out, PacketType::PUBACK, 0, 2);
+    AppendU16(out, packet_id);
+}
+
+void AppendSubscribe(std::string                                             &out,
+                     uint16_t                                                 packet_id,
+                     const std::vector<std::pair<std::string_view, uint8_t>> &filters)
+{
+    size_t size = 2;
+    for (const auto &[filter, qos] : filters)
+        size += 2 + filter.size() + 1;
+    AppendFixedHeader(out, PacketType::SUBSCRIBE, 0x02, size);
+    AppendU16(out, packet_id);
+    for (const auto &[filter, qos] : filters) {
+        AppendString(out, filter);
+        out += static_cast<char>(qos);
+    }
+}
+
+void AppendSuback(std::string &out, uint16_t packet_id, const std::vector<uint8_t> &return_codes)
+{
+    AppendFixedHeader(out, PacketType::SUBACK, 0, 2 + return_codes.size());
+    AppendU16(out, packet_id);
+    out.append(return_codes.begin(), return_codes.end());
+}
+
+void AppendUnsubscribe(std::string &out, uint16_t packet_id, const std::vector<std::string_view> &filters)
+{
+    size_t size = 2;
+    for (const auto filter : filters)
+        size += 2 + filter.size();
+    AppendFixedHeader(out, PacketType::UNSUBSCRIBE, 0x02, size);
+    AppendU16(out, packet_id);
+    for (const auto filter : filters)
+        AppendString(out, filter);
+}
+
+void AppendUnsuback(std::string &out, uint16_t packet_id)
+{
+    AppendFixedHeader(out, PacketType::UNSUBACK, 0, 2);
+    AppendU16(out, packet_id);
+}
+
+void AppendPingreq(std::string &out)
+{
+    AppendFixedHeader(out, PacketType::PINGREQ, 0, 0);
+}
+
+void AppendPingresp(std::string &out)
+{
+    AppendFixedHeader(out, PacketType::PINGRESP, 0, 0);
+}
+
+void AppendDisconnect(std::string &out)
+{
+    AppendFixedHeader(out, PacketType::DISCONNECT, 0, 0);
+}
+
+bool IsValidTopicName(std::string_view topic)
+{
+    return !topic.empty() && topic.size() <= UINT16_MAX &&
+           topic.find_first_of(std::string_view("+#\0", 3)) == std::string_view::npos;
+}
+
+bool IsValidTopicFilter(std::string_view filter)
+{
+    if (filter.empty() || filter.size() > UINT16_MAX ||
+        filter.find('\0') != std::string_view::npos)
+        return false;
+
+    size_t begin = 0;
+    while (true) {
+        const size_t end = filter.find('/', begin);
+        const auto   level = filter.substr(begin, end == std::string_view::npos ? end : end - begin);
+        if (level.find('+') != std::string_view::npos && level != "+")
+            return false;
+        if (level.find('#') != std::string_view::npos &&
+            (level != "#" || end != std::string_view::npos))
+            return false;
+        if (end == std::string_view::npos)
+            return true;
+        begin = end + 1;
+    }
+}
+
+bool TopicMatches(std::string_view filter, std::string_view topic)
+{
+    if (!filter.empty() && (filter[0] == '+' || filter[0] == '#') &&
+        !topic.empty() && topic[0] == '$')
+        return false;
+
+    size_t filter_pos = 0;
+    size_t topic_pos = 0;
+    while (true) {
+        const size_t filter_end = filter.find('/', filter_pos);
+        const auto   filter_level = filter.substr(
+            filter_pos, filter_end == std::string_view::npos ? filter_end : filter_end - filter_pos);
+        // '#' совпадает и с оставшимися уровнями, и с их отсутствием
+        if (filter_level == "#")
+            return true;
+
+        const size_t topic_end = topic.find('/', topic_pos);
+        const auto   topic_level = topic.substr(
+            topic_pos, topic_end == std::string_view::npos ? topic_end : topic_end - topic_pos);
+        if (filter_level != "+" && filter_level != topic_level)
+            return false;
+
+        const bool filter_done = filter_end == std::string_view::npos;
+        const bool topic_done = topic_end == std::string_view::npos;
+        if (filter_done || topic_done) {
+            if (filter_done && topic_done)
+                return true;
+            // "sport/#" совпадает с "sport"
+            return topic_done && filter.substr(filter_end + 1) == "#";
+        }
+        filter_pos = filter_end + 1;
+        topic_pos = topic_end + 1;
+    }
+}
+
+}  // namespace iot::backend::proto::mqtt
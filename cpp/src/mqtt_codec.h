@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/*
+ * Кодирование и разбор пакетов MQTT 3.1.1 (OASIS Standard, 2014) в объёме,
+ * нужном LoopbackMqttBroker и MqttClient: QoS 0 и 1, без will и
+ * username/password (поля CONNECT пропускаются при разборе).
+ *
+ * Append* дописывают пакет в конец out. Parse* принимают тело пакета
+ * (после фиксированного заголовка), возвращают string_view на его данные и
+ * бросают std::invalid_argument для некорректного пакета.
+ */
+namespace iot::backend::proto::mqtt {
+
+enum class PacketType : uint8_t {
+    CONNECT = 1,
+    CONNACK = 2,
+    PUBLISH = 3,
+    PUBACK = 4,
+    PUBREC = 5,
+    PUBREL = 6,
+    PUBCOMP = 7,
+    SUBSCRIBE = 8,
+    SUBACK = 9,
+    UNSUBSCRIBE = 10,
+    UNSUBACK = 11,
+    PINGREQ = 12,
+    PINGRESP = 13,
+    DISCONNECT = 14,
+};
+
+/// Наибольшая длина пакета без фиксированного заголовка по спецификации
+inline constexpr size_t kMaxRemainingLength = 268435455;
+
+/// CONNACK return codes
+inline constexpr uint8_t kConnectAccepted = 0x00;
+inline constexpr uint8_t kConnectBadProtocol = 0x01;
+inline constexpr uint8_t kConnectBadClientId = 0x02;
+/// SUBACK return code для отклонённой подписки
+inline constexpr uint8_t kSubscribeFailure = 0x80;
+
+struct FixedHeader {
+    PacketType type = PacketType::CONNECT;
+    uint8_t    flags = 0;
+    size_t     remaining_length = 0;
+    /// Размер самого фиксированного заголовка, 2-5 байт
+    size_t header_size = 0;
+};
+
+/// Заголовок пакета в начале data; nullopt, если данных пока недостаточно
+[[nodiscard]] std::optional<FixedHeader> ParseFixedHeader(std::string_view data);
+
+struct Connect {
+    std::string_view client_id;
+    uint8_t          protocol_level = 0;
+    bool             clean_session = true;
+    uint16_t         keep_alive_s = 0;
+    /// Имя протокола "MQTT" и уровень 4
+    [[nodiscard]] bool IsSupportedProtocol() const;
+};
+
+struct Publish {
+    std::string_view topic;
+    std::string_view payload;
+    uint8_t          qos = 0;
+    bool             retain = false;
+    bool             dup = false;
+    /// Только для QoS > 0
+    uint16_t packet_id = 0;
+};
+
+struct Subscribe {
+    uint16_t packet_id = 0;
+    /// Фильтр и запрошенный QoS
+    std::vector<std::pair<std::string_view, uint8_t>> filters;
+};
+
+struct Unsubscribe {
+    uint16_t                      packet_id = 0;
+    std::vector<std::string_view> filters;
+};
+
+struct Suback {
+    uint16_t             packet_id = 0;
+    std::vector<uint8_t> return_codes;
+};
+
+[[nodiscard]] Connect     ParseConnect(std::string_view body);
+[[nodiscard]] Publish     ParsePublish(uint8_t flags, std::string_view body);
+[[nodiscard]] Subscribe   ParseSubscribe(std::string_view body);
+[[nodiscard]] Unsubscribe ParseUnsubscribe(std::string_view body);
+[[nodiscard]] Suback      ParseSuback(std::string_view body);
+/// CONNACK: return code
+[[nodiscard]] uint8_t ParseConnack(std::string_view body);
+/// PUBACK, UNSUBACK: packet id
+[[nodiscard]] uint16_t ParsePacketId(std::string_view body);
+
+void AppendConnect(std::string     &out,
+                   std::string_view client_id,
+                   uint16_t         keep_alive_s,
+                   bool             clean_session = true);
+void AppendConnack(std::string &out, bool session_present, uint8_t return_code);
+void AppendPublish(std::string     &out,
+                   std::string_view topic,
+                   std::string_view payload,
+                   uint8_t          qos,
+                   uint16_t         packet_id = 0,
+                   bool             retain = false);
+void AppendPuback(std::string &out, uint16_t packet_id);
+void AppendSubscribe(std::string                                             &out,
+                     uint16_t                                                 packet_id,
+                     const std::vector<std::pair<std::string_view, uint8_t>> &filters);
+void AppendSuback(std::string &out, uint16_t packet_id, const std::vector<uint8_t> &return_codes);
+void AppendUnsubscribe(std::string                         &out,
+                       uint16_t                             packet_id,
+                       const std::vector<std::string_view> &filters);
+void AppendUnsuback(std::string &out, uint16_t packet_id);
+void AppendPingreq(std::string &out);
+void AppendPingresp(std::string &out);
+void AppendDisconnect(std::string &out);
+
+/// Имя топика для PUBLISH: непустое, без '+' и '#'
+[[nodiscard]] bool IsValidTopicName(std::string_view topic);
+/// Фильтр подписки: '+' занимает уровень целиком, '#' - только последний уровень
+[[nodiscard]] bool IsValidTopicFilter(std::string_view filter);
+/// Соответствие топика фильтру. Фильтры, начинающиеся с '+' или '#', не
+/// совпадают с топиками на '$' (в том числе "$devices/...").
+[[nodiscard]] bool TopicMatches(std::string_view filter, std::string_view topic);
+
+}  // namespace iot::backend::proto::mqtt
@@ -0,0 +1,120 @@
+#include "packet_pool.h"
+
+#include <google/protobuf/arena.h>
+
+#include <memory>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/*
+ * Packet::Clear() для oneof удаляет вложенное сообщение (Command, Telemetry и
+ * т.д.), а в нём и лежат все данные пакета. Поэтому просто Clear() почти ничего
+ * не экономит: на следующем пакете дерево сообщений выделяется заново.
+ *
+ * Вместо этого каждый слот пула держит свою protobuf Arena с начальным блоком
+ * внутри слота. При возврате в пул Arena::Reset() освобождает всё, кроме
+ * начального блока, и пакет создаётся в нём заново. Для вызывающего кода
+ * семантика та же, что у Clear(): из Acquire() приходит пустой пакет.
+ */
+struct PacketPool::Slot {
+    Slot()
+        : arena(MakeOptions(initial_block, sizeof(initial_block))),
+          packet(google::protobuf::Arena::CreateMessage<Packet>(&arena))
+    {
+    }
+
+    void Reset()
+    {
+        arena.Reset();
+        packet = google::protobuf::Arena::CreateMessage<Packet>(&arena);
+    }
+
+    static google::protobuf::ArenaOptions MakeOptions(char *block, size_t size)
+    {
+        google::protobuf::ArenaOptions options;
+        options.initial_block = block;
+        options.initial_block_size = size;
+        return options;
+    }
+
+    alignas(std::max_align_t) char initial_block[kSlotBlockSize];
+    google::protobuf::Arena arena;
+    Packet                 *packet;
+};
+
+namespace {
+
+// Пакет может вернуться в пул из деструктора другого thread_local объекта
+// уже после разрушения пула - тогда его нужно просто удалить
+thread_local bool pool_destroyed = false;
+
+struct ThreadPool {
+    ~ThreadPool() { pool_destroyed = true; }
+
+    std::vector<std::unique_ptr<PacketPool::Slot>> free;
+    size_t max_free_count = PacketPool::kDefaultMaxFreeCount;
+};
+
+ThreadPool &GetThreadPool()
+{
+    thread_local ThreadPool pool;
+    return pool;
+}
+
+}  // namespace
+
+PooledPacket PacketPool::Acquire()
+{
+    auto &pool = GetThreadPool();
+    if (pool.free.empty())
+        return PooledPacket(new Slot());
+
+    Slot *slot = pool.free.back().release();
+    pool.free.pop_back();
+    return PooledPacket(slot);
+}
+
+void PacketPool::Release(Slot *slot)
+{
+    std::unique_ptr<Slot> holder(slot);
+    if (pool_destroyed)
+        return;
+
+    auto &pool = GetThreadPool();
+    if (pool.free.size() >= pool.max_free_count)
+        return;
+
+    holder->Reset();
+    pool.free.push_back(std::move(holder));
+}
+
+Packet *PacketPool::GetPacket(Slot *slot)
+{
+    return slot->packet;
+}
+
+size_t PacketPool::GetFreeCount()
+{
+    return GetThreadPool().free.size();
+}
+
+size_t PacketPool::GetMaxFreeCount()
+{
+    return GetThreadPool().max_free_count;
+}
+
+void PacketPool::SetMaxFreeCount(size_t count)
+{
+    auto &pool = GetThreadPool();
+    pool.max_free_count = count;
+    if (pool.free.size() > count)
+        pool.free.resize(count);
+}
+
+void PacketPool::Trim()
+{
+    GetThreadPool().free.clear();
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "packet.pb.h"
+
+#include <cstddef>
+
+namespace iot::backend::proto {
+
+class PooledPacket;
+
+/// Пул переиспользуемых Packet, свой у каждого потока: Acquire и возврат
+/// не требуют синхронизации. Заполнять пакеты на месте можно через
+/// перегрузки helpers::Make*(Packet&, ...) и
+/// ProtocolConverter::Deserialize(buffer, Packet&).
+///
+/// Пул потока хранит не больше GetMaxFreeCount() свободных пакетов, лишние
+/// удаляются. Свободные пакеты удаляются при завершении потока.
+class PacketPool {
+  public:
+    static constexpr size_t kDefaultMaxFreeCount = 256;
+    /// Память слота под пакет; пакеты крупнее берут память из кучи
+    static constexpr size_t kSlotBlockSize = 4096;
+
+    /// Пустой пакет из пула текущего потока или новый
+    [[nodiscard]] static PooledPacket Acquire();
+
+    /// Количество свободных пакетов в пуле текущего потока
+    [[nodiscard]] static size_t GetFreeCount();
+
+    [[nodiscard]] static size_t GetMaxFreeCount();
+    /// Ограничение на свободные пакеты в пуле текущего потока
+    static void SetMaxFreeCount(size_t count);
+
+    /// Удаляет все свободные пакеты текущего потока
+    static void Trim();
+
+    /// Деталь реализации, см. packet_pool.cpp
+    struct Slot;
+
+  private:
+    friend class PooledPacket;
+    static void    Release(Slot *slot);
+    static Packet *GetPacket(Slot *slot);
+};
+
+/// RAII владелец пакета из PacketPool. При разрушении пакет очищается
+/// с сохранением выделенной памяти и возвращается в пул того потока,
+/// в котором разрушается handle. Поэтому handle можно передавать между
+/// потоками.
+///
+/// Пакет живёт в protobuf Arena слота пула: std::move(*handle) в обычный
+/// Packet копирует содержимое, а не перемещает его.
+class PooledPacket {
+  public:
+    PooledPacket() = default;
+    ~PooledPacket() { Reset(); }
+
+    PooledPacket(PooledPacket &&other) noexcept
+        : slot_(other.slot_), packet_(other.packet_)
+    {
+        other.slot_ = nullptr;
+        other.packet_ = nullptr;
+    }
+
+    PooledPacket &operator=(PooledPacket &&other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            slot_ = other.slot_;
+            packet_ = other.packet_;
+            other.slot_ = nullptr;
+            other.packet_ = nullptr;
+        }
+        return *this;
+    }
+
+    PooledPacket(const PooledPacket &) = delete;
+    PooledPacket &operator=(const PooledPacket &) = delete;
+
+    Packet &operator*() const { return *packet_; }
+    Packet *operator->() const { return packet_; }
+    [[nodiscard]] Packet *Get() const { return packet_; }
+    explicit operator bool() const { return packet_ != nullptr; }
+
+    /// Досрочно возвращает пакет в пул
+    void Reset()
+    {
+        if (slot_) {
+            PacketPool::Release(slot_);
+            slot_ = nullptr;
+            packet_ = nullptr;
+        }
+    }
+
+  private:
+    friend class PacketPool;
+    explicit PooledPacket(PacketPool::Slot *slot)
+        : slot_(slot), packet_(PacketPool::GetPacket(slot))
+    {
+    }
+
+    PacketPool::Slot *slot_ = nullptr;
+    Packet           *packet_ = nullptr;
+};
+
+}  // namespace iot::backend::proto
@@ -9,7 +9,9 @@
 #include "telemetry_validator.h"
 #include "notification_validator.h"
 
+#include "hot_path_metrics.h"
 #include "packet_visitor.h"
+#include "utc_clock.h"
 
 namespace {
 
@@ -32,11 +34,8 @@ bool ValidatePayloadDependent(const iot::backend::proto::Packet &packet)
     IOT_PROTO_TYPED_PACKET_VISITOR(IsValid, bool) validator;
     return validator(packet);
 }
-}  // namespace
-
-namespace iot::backend::proto {
 
-bool IsValid(const Packet &packet)
+bool ValidatePacket(const iot::backend::proto::Packet &packet)
 {
     // Protocol version can't be zero or 0xFFFFFFFF;
     const auto proto_version = packet.version();
@@ -64,5 +63,27 @@ bool IsValid(const Packet &packet)
         return false;
     }
 }
+}  // namespace
+
+namespace iot::backend::proto {
+
+bool IsValid(const Packet &packet)
+{
+    metrics::OperationTimer timer(metrics::Operation::VALIDATE,
+                                  metrics::Transport::NONE);
+    const bool valid = ValidatePacket(packet);
+    timer.Finish(packet.what_case(), 0, valid);
+    return valid;
+}
+
+bool IsExpired(const Packet &packet, uint64_t now_s)
+{
+    return packet.has_valid_until() && packet.valid_until() < now_s;
+}
+
+bool IsExpired(const Packet &packet)
+{
+    return IsExpired(packet, GetDefaultClock().NowS());
+}
 
 }  // namespace iot::backend::proto
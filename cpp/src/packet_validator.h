@@ -6,4 +6,9 @@ namespace iot::backend::proto {
 
 bool IsValid(const Packet &packet);
 
+/// Пакет просрочен, если valid_until задан и уже прошёл к моменту now_s
+bool IsExpired(const Packet &packet, uint64_t now_s);
+/// То же относительно часов по умолчанию (см. utc_clock.h)
+bool IsExpired(const Packet &packet);
+
 }
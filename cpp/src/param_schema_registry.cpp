@@ -0,0 +1,69 @@
+#include "param_schema_registry.h"
+
+#include "params_files.h"
+
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+ParamSchema::ParamSchema(std::vector<std::string> options, std::vector<std::string> reports, uint64_t version)
+    : options_(std::move(options))
+    , reports_(std::move(reports))
+    , option_index_(BuildIndex(options_))
+    , report_index_(BuildIndex(reports_))
+    , sensors_(SensorSchema::FromOptions(options_))
+    , version_(version)
+{
+}
+
+ParamSchema::Index ParamSchema::BuildIndex(const std::vector<std::string> &names)
+{
+    Index index;
+    index.reserve(names.size());
+    for (uint32_t i = 0; i < names.size(); ++i) {
+        if (!index.emplace(names[i], i).second)
+            throw std::invalid_argument("Duplicate parameter name: " + names[i]);
+    }
+    return index;
+}
+
+bool ParamSchema::IsValid(const CmdSetParams &set_params) const
+{
+    for (const auto &[name, value] : set_params.params()) {
+        if (!IsOption(name))
+            return false;
+    }
+    return true;
+}
+
+bool ParamSchema::IsValid(const CmdGetParams &get_params) const
+{
+    for (const auto &name : get_params.param()) {
+        if (!IsOption(name))
+            return false;
+    }
+    return true;
+}
+
+ParamSchemaRegistry::ParamSchemaRegistry(std::string options_path, std::string reports_path)
+    : options_path_(std::move(options_path))
+    , reports_path_(std::move(reports_path))
+    , schema_(Load(1))
+{
+}
+
+std::unique_ptr<const ParamSchema> ParamSchemaRegistry::Load(uint64_t version) const
+{
+    return std::make_unique<const ParamSchema>(LoadParamNames(options_path_), LoadParamNames(reports_path_), version);
+}
+
+void ParamSchemaRegistry::Reload()
+{
+    std::lock_guard lock(reload_mutex_);
+    const uint64_t  version = version_.load(std::memory_order_relaxed) + 1;
+    // Новая версия строится до публикации: при ошибке читатели её не видят
+    schema_.Publish(Load(version));
+    version_.store(version, std::memory_order_relaxed);
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "command_payload.pb.h"
+#include "rcu.h"
+#include "sensor_record.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Одна версия множества параметров и отчётов (params/options.json и
+/// params/reports.json). Неизменяема: читается без блокировок.
+class ParamSchema {
+  public:
+    /// std::invalid_argument для повторяющихся имён
+    ParamSchema(std::vector<std::string> options, std::vector<std::string> reports, uint64_t version);
+
+    /// Номер параметра в словаре (порядок options.json)
+    [[nodiscard]] std::optional<uint32_t> FindOption(std::string_view name) const
+    {
+        return Find(option_index_, name);
+    }
+    /// Номер отчёта (порядок reports.json)
+    [[nodiscard]] std::optional<uint32_t> FindReport(std::string_view name) const
+    {
+        return Find(report_index_, name);
+    }
+    [[nodiscard]] bool IsOption(std::string_view name) const { return option_index_.contains(name); }
+    [[nodiscard]] bool IsReport(std::string_view name) const { return report_index_.contains(name); }
+
+    /// Все параметры команды известны
+    [[nodiscard]] bool IsValid(const CmdSetParams &set_params) const;
+    [[nodiscard]] bool IsValid(const CmdGetParams &get_params) const;
+
+    [[nodiscard]] const std::vector<std::string> &GetOptions() const { return options_; }
+    [[nodiscard]] const std::vector<std::string> &GetReports() const { return reports_; }
+    /// Типы значений TelemetryPayload.sensors по этой версии options.json;
+    /// номера полей из другой версии не подходят
+    [[nodiscard]] const SensorSchema &GetSensors() const { return sensors_; }
+    /// Номер загрузки, с 1
+    [[nodiscard]] uint64_t GetVersion() const { return version_; }
+
+  private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    using Index = std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>>;
+
+    static Index BuildIndex(const std::vector<std::string> &names);
+    static std::optional<uint32_t> Find(const Index &index, std::string_view name)
+    {
+        const auto it = index.find(name);
+        return it != index.end() ? std::optional<uint32_t>(it->second) : std::nullopt;
+    }
+
+    std::vector<std::string> options_;
+    std::vector<std::string> reports_;
+    Index                    option_index_;
+    Index                    report_index_;
+    SensorSchema             sensors_;
+    uint64_t                 version_;
+};
+
+/// Текущая схема параметров с перезагрузкой файлов без рестарта сервиса.
+///
+/// Читатели на горячем пути (проверка имён параметров, словари ключей,
+/// расписание отчётов) берут текущую версию внутри rcu::ReadLock: без
+/// блокировок и счётчиков ссылок, указатель действителен до конца секции.
+/// Reload строит новую версию сбоку и публикует её одной заменой
+/// указателя; старая удаляется, когда из секций вышли все читатели,
+/// которые могли её видеть.
+class ParamSchemaRegistry {
+  public:
+    /// Загружает файлы; std::runtime_error, если они не читаются
+    ParamSchemaRegistry(std::string options_path, std::string reports_path);
+
+    ParamSchemaRegistry(const ParamSchemaRegistry &) = delete;
+    ParamSchemaRegistry &operator=(const ParamSchemaRegistry &) = delete;
+
+    /// Текущая версия; действительна до конца секции lock
+    [[nodiscard]] const ParamSchema *Get(const rcu::ReadLock &lock) const { return schema_.Get(lock); }
+
+    /// Перечитывает файлы. std::runtime_error (и std::invalid_argument для
+    /// повторяющихся имён) - текущая версия остаётся прежней.
+    void Reload();
+
+    /// Номер текущей версии
+    [[nodiscard]] uint64_t GetVersion() const { return version_.load(std::memory_order_relaxed); }
+    /// Удаляет версии, которые уже никто не читает; число оставшихся
+    size_t Reclaim() { return schema_.Reclaim(); }
+
+  private:
+    std::unique_ptr<const ParamSchema> Load(uint64_t version) const;
+
+    const std::string         options_path_;
+    const std::string         reports_path_;
+    /// Сериализует Reload
+    std::mutex                reload_mutex_;
+    std::atomic<uint64_t>     version_{1};
+    rcu::Pointer<ParamSchema> schema_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,36 @@
+#include "params_files.h"
+
+#include "mapped_file.h"
+
+#include <google/protobuf/struct.pb.h>
+#include <google/protobuf/util/json_util.h>
+
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+std::vector<std::string> ParseParamNames(std::string_view json)
+{
+    // JSON-представление ListValue - как раз массив
+    google::protobuf::ListValue list;
+    const auto status = google::protobuf::util::JsonStringToMessage(std::string(json), &list);
+    if (!status.ok())
+        throw std::runtime_error("Param names are not a JSON array: " + std::string(status.message()));
+
+    std::vector<std::string> names;
+    names.reserve(list.values_size());
+    for (const auto &value : list.values()) {
+        if (value.kind_case() != google::protobuf::Value::kStringValue)
+            throw std::runtime_error("Param name is not a string");
+        names.push_back(value.string_value());
+    }
+    return names;
+}
+
+std::vector<std::string> LoadParamNames(const std::string &path)
+{
+    const MappedFile file(path);
+    return ParseParamNames(file.GetData());
+}
+
+}  // namespace iot::backend::proto
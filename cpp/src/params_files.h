@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Имена из params/reports.json и params/options.json: JSON-массив строк в
+/// порядке файла. Для строки, которая не является таким массивом, и для
+/// нечитаемого файла - std::runtime_error.
+[[nodiscard]] std::vector<std::string> ParseParamNames(std::string_view json);
+[[nodiscard]] std::vector<std::string> LoadParamNames(const std::string &path);
+
+}  // namespace iot::backend::proto
@@ -1,27 +1,213 @@
 #include "protocol_converter.h"
+#include "binary_json.h"
+#include "hot_path_metrics.h"
 #include "packet.pb.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr char kBase64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Бинарное представление пакетов до этого размера для перевода в JSON
+// собирается на стеке
+constexpr size_t kStackBinarySize = 4096;
+
+size_t Base64EncodedSize(size_t size)
+{
+    return (size + 2) / 3 * 4;
+}
+
+/*
+ * Сериализует пакет и кодирует его в base64 в одном буфере за один проход.
+ *
+ * Бинарное представление пишется в хвост буфера, начиная с позиции
+ * start = Base64EncodedSize(n) - n, а base64 пишется с начала буфера.
+ * Группа k читается из [start + 3k, start + 3k + 3) и пишется в
+ * [4k, 4k + 4). Запись не догоняет ещё не прочитанные данные, пока
+ * 4k + 4 <= start + 3k + 3, т.е. k < start; это верно для всех групп,
+ * поскольку start >= ceil(n / 3).
+ */
+void SerializeBinaryAsBase64(const iot::backend::proto::Packet &packet,
+                             size_t binary_size, char *out)
+{
+    const size_t encoded_size = Base64EncodedSize(binary_size);
+    auto *binary = reinterpret_cast<uint8_t *>(out + encoded_size - binary_size);
+    packet.SerializeWithCachedSizesToArray(binary);
+
+    char  *dst = out;
+    size_t i = 0;
+    for (; i + 3 <= binary_size; i += 3) {
+        const uint32_t value = (uint32_t(binary[i]) << 16) |
+                               (uint32_t(binary[i + 1]) << 8) | binary[i + 2];
+        dst[0] = kBase64Alphabet[value >> 18];
+        dst[1] = kBase64Alphabet[(value >> 12) & 0x3F];
+        dst[2] = kBase64Alphabet[(value >> 6) & 0x3F];
+        dst[3] = kBase64Alphabet[value & 0x3F];
+        dst += 4;
+    }
+
+    const size_t rest = binary_size - i;
+    if (rest != 0) {
+        uint32_t value = uint32_t(binary[i]) << 16;
+        if (rest == 2)
+            value |= uint32_t(binary[i + 1]) << 8;
+        dst[0] = kBase64Alphabet[value >> 18];
+        dst[1] = kBase64Alphabet[(value >> 12) & 0x3F];
+        dst[2] = rest == 2 ? kBase64Alphabet[(value >> 6) & 0x3F] : '=';
+        dst[3] = '=';
+    }
+}
+
+/*
+ * Бинарное представление пакета для BinaryToJson. MessageToJsonString
+ * делает то же самое (сериализует пакет и переводит бинарный вид в JSON),
+ * но выделяет память на каждом шаге; здесь оно лежит на стеке, если
+ * помещается в kStackBinarySize.
+ */
+class JsonSource {
+  public:
+    explicit JsonSource(const iot::backend::proto::Packet &packet)
+        : descriptor_(*packet.GetDescriptor()), size_(packet.ByteSizeLong())
+    {
+        char *binary = stack_.data();
+        if (size_ > stack_.size()) {
+            heap_.resize(size_);
+            binary = heap_.data();
+        }
+        packet.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(binary));
+    }
+
+    JsonSource(const JsonSource &) = delete;
+    JsonSource &operator=(const JsonSource &) = delete;
+
+    [[nodiscard]] size_t GetBinarySize() const { return size_; }
+
+    /// Размер JSON; сам JSON пишется в out, если помещается
+    size_t Write(std::span<char> out) const
+    {
+        const char *binary = size_ > stack_.size() ? heap_.data() : stack_.data();
+        return iot::backend::proto::BinaryToJson(descriptor_, std::string_view(binary, size_), out);
+    }
+
+  private:
+    const google::protobuf::Descriptor &descriptor_;
+    const size_t                        size_;
+    std::array<char, kStackBinarySize>  stack_;
+    std::string                         heap_;
+};
+
+void AppendJson(const iot::backend::proto::Packet &packet, std::string &out)
+{
+    const JsonSource source(packet);
+    const size_t     offset = out.size();
+    // Обычно JSON помещается в свободную ёмкость out и пишется за один
+    // проход. Её не заполняем целиком: out может быть большим буфером
+    // для многих сообщений.
+    out.resize(std::max(offset, std::min(out.capacity(), offset + 4 * source.GetBinarySize() + 64)));
+    const size_t size = source.Write(std::span<char>(out).subspan(offset));
+    if (offset + size > out.size()) {
+        out.resize(offset + size);
+        source.Write(std::span<char>(out).subspan(offset));
+    }
+    out.resize(offset + size);
+}
+
+void AppendBinary(const iot::backend::proto::Packet &packet, std::string &out)
+{
+    const size_t binary_size = packet.ByteSizeLong();
+    const size_t offset = out.size();
+    out.resize(offset + Base64EncodedSize(binary_size));
+    SerializeBinaryAsBase64(packet, binary_size, out.data() + offset);
+}
+
+iot::backend::proto::metrics::Transport ToMetricsTransport(
+    iot::backend::proto::ProtocolConverter::TransportDataType type)
+{
+    using Type = iot::backend::proto::ProtocolConverter::TransportDataType;
+    return type == Type::JSON ? iot::backend::proto::metrics::Transport::JSON
+                              : iot::backend::proto::metrics::Transport::BINARY;
+}
+
+}  // namespace
+
 namespace iot::backend::proto {
 
 ProtocolConverter::ProtocolConverter(TransportDataType type) : type_(type) {}
 
 Packet ProtocolConverter::Deserialize(const std::string &buffer) const
 {
-    if (type_ == TransportDataType::BINARY) {
-        return helpers::BinaryToProtoPacket<Packet>(
-            helpers::FromBase64(buffer));
-    }
+    metrics::OperationTimer timer(metrics::Operation::DESERIALIZE,
+                                  ToMetricsTransport(type_));
+    Packet packet = type_ == TransportDataType::BINARY
+                        ? helpers::BinaryToProtoPacket<Packet>(helpers::FromBase64(buffer))
+                        : helpers::JsonToProtoPacket<Packet>(buffer);
+    timer.Finish(packet.what_case(), buffer.size());
+    return packet;
+}
 
-    return helpers::JsonToProtoPacket<Packet>(buffer);
+void ProtocolConverter::Deserialize(const std::string &buffer,
+                                    Packet            &packet) const
+{
+    metrics::OperationTimer timer(metrics::Operation::DESERIALIZE,
+                                  ToMetricsTransport(type_));
+    if (type_ == TransportDataType::BINARY)
+        helpers::BinaryToProtoPacket(helpers::FromBase64(buffer), packet);
+    else
+        helpers::JsonToProtoPacket(buffer, packet);
+    timer.Finish(packet.what_case(), buffer.size());
 }
 
 std::string ProtocolConverter::Serialize(const Packet &packet) const
 {
-    if (type_ == TransportDataType::BINARY) {
-        return helpers::ToBase64(helpers::ProtoPacketToBinary(packet));
-    }
+    metrics::OperationTimer timer(metrics::Operation::SERIALIZE,
+                                  ToMetricsTransport(type_));
+    std::string result;
+    if (type_ == TransportDataType::BINARY)
+        AppendBinary(packet, result);
+    else
+        AppendJson(packet, result);
+    timer.Finish(packet.what_case(), result.size());
+    return result;
+}
 
-    return helpers::ProtoPacketToJson(packet);
+void ProtocolConverter::SerializeTo(const Packet &packet, std::string &out) const
+{
+    metrics::OperationTimer timer(metrics::Operation::SERIALIZE,
+                                  ToMetricsTransport(type_));
+    const size_t offset = out.size();
+    if (type_ == TransportDataType::JSON)
+        AppendJson(packet, out);
+    else
+        AppendBinary(packet, out);
+    timer.Finish(packet.what_case(), out.size() - offset);
+}
+
+size_t ProtocolConverter::SerializeTo(const Packet   &packet,
+                                      std::span<char> out) const
+{
+    metrics::OperationTimer timer(metrics::Operation::SERIALIZE,
+                                  ToMetricsTransport(type_));
+    size_t size = 0;
+    if (type_ == TransportDataType::JSON) {
+        // Не поместившееся сообщение не должно испортить out, поэтому
+        // сначала считаем размер
+        const JsonSource source(packet);
+        size = source.Write({});
+        if (size <= out.size())
+            source.Write(out);
+    } else {
+        const size_t binary_size = packet.ByteSizeLong();
+        size = Base64EncodedSize(binary_size);
+        if (size <= out.size())
+            SerializeBinaryAsBase64(packet, binary_size, out.data());
+    }
+    // Не поместившееся сообщение не записано - это неудача сериализации
+    timer.Finish(packet.what_case(), size, size <= out.size());
+    return size;
 }
 
 ProtocolConverter::TransportDataType ProtocolConverter::GetType() const
@@ -31,7 +217,7 @@ ProtocolConverter::TransportDataType ProtocolConverter::GetType() const
 
 std::string ProtocolConverter::ToString(const proto::Packet &packet)
 {
-    // todo bench this, maybe critical for telemetry processing
+    // See BM_ProtocolConverter_ToString in benchmarks/
     return helpers::ProtoPacketToJson(packet);
 }
 
@@ -2,6 +2,8 @@
 
 #include "helpers.h"
 
+#include <span>
+
 namespace iot::backend::proto {
 
 /// Класс помошник для конвертации в объект пришедших сообщений
@@ -20,6 +22,23 @@ class ProtocolConverter {
     [[nodiscard]] Packet      Deserialize(const std::string &buffer) const;
     [[nodiscard]] std::string Serialize(const Packet &packet) const;
 
+    /// Разбирает buffer в уже существующий пакет (например, из PacketPool),
+    /// прежнее содержимое packet заменяется
+    void Deserialize(const std::string &buffer, Packet &packet) const;
+
+    /// Дописывает сериализованный packet в конец out. Если ёмкости out
+    /// хватает, выделений памяти нет: буфер можно переиспользовать между
+    /// сообщениями (out.clear() сохраняет ёмкость). JSON пишется по
+    /// бинарному представлению пакета, собранному на стеке; пакеты больше
+    /// 4 КиБ в бинарном виде выделяют под него память.
+    void SerializeTo(const Packet &packet, std::string &out) const;
+
+    /// Сериализует packet в буфер фиксированного размера. Возвращает размер
+    /// сообщения. Если он больше out.size(), сообщение не записано, а
+    /// результат - необходимый размер буфера. Выделения памяти - как у
+    /// SerializeTo в std::string.
+    [[nodiscard]] size_t SerializeTo(const Packet &packet, std::span<char> out) const;
+
     [[nodiscard]] TransportDataType GetType() const;
 
     /// Debug method to get human readable string for logging
@@ -0,0 +1,64 @@
+#include "rcu.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace iot::backend::proto::rcu::detail {
+
+namespace {
+
+/// Ячейки всех потоков; только добавляются
+std::atomic<Slot *> slots{nullptr};
+
+/// Возвращает ячейку при завершении потока
+struct SlotOwner {
+    Slot *slot = nullptr;
+
+    ~SlotOwner()
+    {
+        slot->epoch.store(0, std::memory_order_release);
+        slot->depth = 0;
+        slot->in_use.store(false, std::memory_order_release);
+    }
+};
+
+}  // namespace
+
+// 0 в ячейке - поток вне секции, поэтому эпохи начинаются с 1
+std::atomic<uint64_t> global_epoch{1};
+
+Slot &AcquireSlot()
+{
+    thread_local SlotOwner owner;
+    for (Slot *slot = slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+        bool free = false;
+        if (slot->in_use.compare_exchange_strong(free, true, std::memory_order_acquire)) {
+            owner.slot = slot;
+            return *slot;
+        }
+    }
+    auto *slot = new Slot();
+    slot->in_use.store(true, std::memory_order_relaxed);
+    slot->next = slots.load(std::memory_order_relaxed);
+    while (!slots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    owner.slot = slot;
+    return *slot;
+}
+
+uint64_t AdvanceEpoch()
+{
+    return global_epoch.fetch_add(1, std::memory_order_seq_cst);
+}
+
+uint64_t GetMinActiveEpoch()
+{
+    uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+    for (Slot *slot = slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+        if (const uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst); epoch != 0)
+            min_epoch = std::min(min_epoch, epoch);
+    }
+    return min_epoch;
+}
+
+}  // namespace iot::backend::proto::rcu::detail
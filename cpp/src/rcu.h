@@ -0,0 +1,132 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/// RCU на эпохах для редко меняющихся данных, которые читаются на горячем
+/// пути. Читатель не берёт блокировок и не трогает счётчиков ссылок: он
+/// объявляет текущую эпоху в своей ячейке (отдельная строка кеша на поток)
+/// и снимает объявление в конце секции. Писатель публикует новую версию,
+/// сдвигает эпоху и удаляет старую версию, когда все читатели, которые
+/// могли её видеть, вышли из своих секций.
+namespace iot::backend::proto::rcu {
+
+namespace detail {
+
+struct alignas(64) Slot {
+    /// Эпоха, объявленная читателем; 0 - поток вне читающей секции
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool>     in_use{false};
+    /// Вложенность секций; меняет только поток-владелец
+    uint32_t              depth = 0;
+    Slot                 *next = nullptr;
+};
+
+extern std::atomic<uint64_t> global_epoch;
+
+/// Ячейка потока; при завершении потока освобождается для других
+Slot &AcquireSlot();
+
+inline Slot &GetSlot()
+{
+    thread_local Slot *slot = &AcquireSlot();
+    return *slot;
+}
+
+/// Сдвигает эпоху; объекты, снятые с публикации до вызова, можно удалять,
+/// когда GetMinActiveEpoch() станет больше возвращённого значения
+uint64_t AdvanceEpoch();
+/// Наименьшая эпоха, объявленная читателями, или UINT64_MAX
+uint64_t GetMinActiveEpoch();
+
+}  // namespace detail
+
+/// Читающая секция потока: пока она жива, объекты, полученные через
+/// rcu::Pointer::Get, не удаляются. Секции можно вкладывать. Объект живёт
+/// только на стеке и не передаётся в другой поток.
+class ReadLock {
+  public:
+    ReadLock() : slot_(detail::GetSlot())
+    {
+        if (slot_.depth++ == 0) {
+            // seq_cst: объявление видно писателю раньше, чем мы прочитаем
+            // указатель. Устаревшая эпоха только задерживает удаление.
+            slot_.epoch.store(detail::global_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+        }
+    }
+
+    ~ReadLock()
+    {
+        if (--slot_.depth == 0)
+            slot_.epoch.store(0, std::memory_order_release);
+    }
+
+    ReadLock(const ReadLock &) = delete;
+    ReadLock &operator=(const ReadLock &) = delete;
+
+  private:
+    detail::Slot &slot_;
+};
+
+/// Указатель на текущую версию неизменяемого объекта
+template <class T>
+class Pointer {
+  public:
+    explicit Pointer(std::unique_ptr<const T> value) : current_(value.release()) {}
+
+    /// Читателей к этому моменту быть не должно
+    ~Pointer()
+    {
+        delete current_.load();
+        for (const auto &[value, epoch] : retired_)
+            delete value;
+    }
+
+    Pointer(const Pointer &) = delete;
+    Pointer &operator=(const Pointer &) = delete;
+
+    /// Текущая версия; действительна до конца секции lock
+    [[nodiscard]] const T *Get(const ReadLock & /*lock*/) const { return current_.load(std::memory_order_seq_cst); }
+
+    /// Публикует новую версию. Прежняя удаляется этим или следующими
+    /// Publish и Reclaim, когда её больше никто не читает.
+    void Publish(std::unique_ptr<const T> value)
+    {
+        std::lock_guard lock(mutex_);
+        const T        *previous = current_.exchange(value.release(), std::memory_order_seq_cst);
+        retired_.emplace_back(previous, detail::AdvanceEpoch());
+        ReclaimLocked();
+    }
+
+    /// Удаляет версии, которые уже никто не читает; возвращает число
+    /// оставшихся снятых версий
+    size_t Reclaim()
+    {
+        std::lock_guard lock(mutex_);
+        ReclaimLocked();
+        return retired_.size();
+    }
+
+  private:
+    void ReclaimLocked()
+    {
+        const uint64_t min_epoch = detail::GetMinActiveEpoch();
+        std::erase_if(retired_, [min_epoch](const auto &retired) {
+            if (retired.second >= min_epoch)
+                return false;
+            delete retired.first;
+            return true;
+        });
+    }
+
+    std::atomic<const T *> current_;
+    std::mutex             mutex_;
+    /// Снятые версии и эпоха снятия
+    std::vector<std::pair<const T *, uint64_t>> retired_;
+};
+
+}  // namespace iot::backend::proto::rcu
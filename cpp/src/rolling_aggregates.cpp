@@ -0,0 +1,168 @@
+#include "rolling_aggregates.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+void MetricSummary::Add(float value, uint32_t time_s)
+{
+    if (count == 0) {
+        min = max = first = last = value;
+        first_s = last_s = time_s;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    ++count;
+    sum += value;
+    // Опоздавшее значение не заменяет более позднее
+    if (time_s < first_s) {
+        first = value;
+        first_s = time_s;
+    }
+    if (time_s >= last_s) {
+        last = value;
+        last_s = time_s;
+    }
+}
+
+void MetricSummary::Merge(const MetricSummary &other)
+{
+    if (other.count == 0)
+        return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    if (other.first_s < first_s) {
+        first = other.first;
+        first_s = other.first_s;
+    }
+    if (other.last_s >= last_s) {
+        last = other.last;
+        last_s = other.last_s;
+    }
+}
+
+void WindowAggregate::Merge(const WindowAggregate &other)
+{
+    for (size_t i = 0; i < kTelemetryMetricCount; ++i)
+        metrics[i].Merge(other.metrics[i]);
+}
+
+std::optional<float> WindowAggregate::GetBatteryDrainPerHour() const
+{
+    const auto &battery = Get(TelemetryMetric::BATTERY_LEVEL);
+    if (battery.count == 0 || battery.last_s <= battery.first_s)
+        return std::nullopt;
+    return (battery.first - battery.last) * 3600.0f / static_cast<float>(battery.last_s - battery.first_s);
+}
+
+RollingAggregates::RollingAggregates(RollingAggregatesOptions options)
+{
+    for (const auto &window : options.windows) {
+        if (window.buckets == 0 || window.duration.count() <= 0 || window.duration.count() % window.buckets != 0)
+            throw std::invalid_argument("Rolling window must split into whole-second buckets");
+        rings_.push_back({static_cast<uint32_t>(window.duration.count() / window.buckets), window.buckets, bucket_count_});
+        bucket_count_ += window.buckets;
+    }
+}
+
+size_t RollingAggregates::GetBytesPerDevice() const
+{
+    return bucket_count_ * sizeof(Bucket);
+}
+
+void RollingAggregates::Update(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload)
+{
+    uint32_t device;
+    if (const auto it = index_.find(device_id); it != index_.end()) {
+        device = it->second;
+    } else {
+        if (!free_.empty()) {
+            device = free_.back();
+            free_.pop_back();
+        } else {
+            device = static_cast<uint32_t>(index_.size());
+            buckets_.resize(buckets_.size() + bucket_count_);
+        }
+        index_.emplace(std::string(device_id), device);
+    }
+
+    // Значения метрик, присутствующих в пакете
+    float  values[kTelemetryMetricCount];
+    size_t metrics[kTelemetryMetricCount];
+    size_t present = 0;
+    if (payload.has_battery_level()) {
+        values[present] = static_cast<float>(payload.battery_level());
+        metrics[present++] = static_cast<size_t>(TelemetryMetric::BATTERY_LEVEL);
+    }
+    if (payload.has_speed_kmh()) {
+        values[present] = payload.speed_kmh();
+        metrics[present++] = static_cast<size_t>(TelemetryMetric::SPEED_KMH);
+    }
+    if (payload.has_gsm_signal_level()) {
+        values[present] = static_cast<float>(payload.gsm_signal_level());
+        metrics[present++] = static_cast<size_t>(TelemetryMetric::GSM_SIGNAL_LEVEL);
+    }
+    if (present == 0)
+        return;
+
+    const auto time = static_cast<uint32_t>(time_s);
+    Bucket    *buckets = GetBuckets(device);
+    for (const Ring &ring : rings_) {
+        const uint32_t epoch = time / ring.width_s;
+        Bucket        &bucket = buckets[ring.offset + epoch % ring.buckets];
+        if (bucket.epoch != epoch) {
+            // Место занято корзиной, вышедшей из окна, или, для сильно
+            // опоздавшего пакета, более новой
+            if (bucket.epoch > epoch)
+                continue;
+            bucket = Bucket{};
+            bucket.epoch = epoch;
+        }
+        for (size_t i = 0; i < present; ++i)
+            bucket.metrics[metrics[i]].Add(values[i], time);
+    }
+}
+
+std::optional<WindowAggregate>
+RollingAggregates::Query(std::string_view device_id, size_t window, uint64_t now_s) const
+{
+    if (window >= rings_.size())
+        throw std::out_of_range("Unknown rolling window");
+    const auto it = index_.find(device_id);
+    if (it == index_.end())
+        return std::nullopt;
+
+    const Ring     &ring = rings_[window];
+    const Bucket   *ring_buckets = GetBuckets(it->second) + ring.offset;
+    const uint64_t  now_epoch = now_s / ring.width_s;
+    WindowAggregate aggregate;
+    for (uint32_t i = 0; i < ring.buckets; ++i) {
+        const Bucket &bucket = ring_buckets[i];
+        if (bucket.epoch > now_epoch || bucket.epoch + uint64_t{ring.buckets} <= now_epoch)
+            continue;
+        for (size_t metric = 0; metric < kTelemetryMetricCount; ++metric)
+            aggregate.metrics[metric].Merge(bucket.metrics[metric]);
+    }
+    return aggregate;
+}
+
+void RollingAggregates::Forget(std::string_view device_id)
+{
+    const auto it = index_.find(device_id);
+    if (it == index_.end())
+        return;
+    const uint32_t device = it->second;
+    std::fill_n(GetBuckets(device), bucket_count_, Bucket{});
+    free_.push_back(device);
+    index_.erase(it);
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "telemetry_payload.pb.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Поля TelemetryPayload, по которым считаются агрегаты
+enum class TelemetryMetric : uint8_t {
+    BATTERY_LEVEL,
+    SPEED_KMH,
+    GSM_SIGNAL_LEVEL,
+};
+inline constexpr size_t kTelemetryMetricCount = 3;
+
+/// Сводка значений одной метрики. Сводки объединяются (Merge) в любом
+/// порядке: по корзинам окна, по шардам или по устройствам.
+struct MetricSummary {
+    uint32_t count = 0;
+    /// Время первого и последнего значения, секунды UTC
+    uint32_t first_s = 0;
+    uint32_t last_s = 0;
+    float    sum = 0;
+    float    min = 0;
+    float    max = 0;
+    float    first = 0;
+    float    last = 0;
+
+    void Add(float value, uint32_t time_s);
+    void Merge(const MetricSummary &other);
+
+    [[nodiscard]] std::optional<float> GetAverage() const
+    {
+        return count == 0 ? std::nullopt : std::optional<float>(sum / count);
+    }
+};
+
+/// Агрегаты устройства за окно
+struct WindowAggregate {
+    MetricSummary metrics[kTelemetryMetricCount];
+
+    [[nodiscard]] const MetricSummary &Get(TelemetryMetric metric) const
+    {
+        return metrics[static_cast<size_t>(metric)];
+    }
+
+    void Merge(const WindowAggregate &other);
+
+    /// Расход заряда, % в час, между первым и последним значением в окне;
+    /// nullopt, если они не разнесены во времени
+    [[nodiscard]] std::optional<float> GetBatteryDrainPerHour() const;
+};
+
+struct RollingWindow {
+    std::chrono::seconds duration;
+    /// Число корзин кольца; окно отстаёт от точного не больше чем на
+    /// duration / buckets
+    uint32_t buckets = 0;
+};
+
+struct RollingAggregatesOptions {
+    std::vector<RollingWindow> windows = {
+        {std::chrono::minutes(5), 5},
+        {std::chrono::hours(1), 12},
+        {std::chrono::hours(24), 24},
+    };
+};
+
+/// Скользящие агрегаты телеметрии по устройствам без хранения истории.
+///
+/// На каждое окно у устройства кольцо из buckets корзин ширины
+/// duration / buckets со сводками метрик. Корзина помнит свой номер
+/// (время / ширина): Update пишет в корзину кольца, соответствующую времени
+/// пакета, и обнуляет её, если там лежит более старая корзина. Пакет
+/// трогает одну корзину на окно, и стоимость не зависит от истории. Query
+/// объединяет корзины, попадающие в окно. Память на устройство постоянна,
+/// см. GetBytesPerDevice. Не потокобезопасен.
+class RollingAggregates {
+  public:
+    /// std::invalid_argument для окна без корзин или с шириной корзины
+    /// не в целое число секунд
+    explicit RollingAggregates(RollingAggregatesOptions options = {});
+
+    /// Значения присутствующих в payload метрик в момент time_s (секунды
+    /// UTC, Packet::timestamp). Опоздавшие значения попадают в свою
+    /// корзину, пока её место в кольце не занято более новой.
+    void Update(std::string_view device_id, uint64_t time_s, const TelemetryPayload &payload);
+
+    /// Агрегаты за окно options.windows[window], заканчивающееся в now_s.
+    /// nullopt для неизвестного устройства, std::out_of_range для
+    /// несуществующего окна.
+    [[nodiscard]] std::optional<WindowAggregate>
+    Query(std::string_view device_id, size_t window, uint64_t now_s) const;
+
+    void Forget(std::string_view device_id);
+
+    [[nodiscard]] size_t GetDeviceCount() const { return index_.size(); }
+    /// Размер колец одного устройства, без учёта индекса по id
+    [[nodiscard]] size_t GetBytesPerDevice() const;
+
+  private:
+    struct Ring {
+        uint32_t width_s = 0;
+        uint32_t buckets = 0;
+        /// Смещение корзин кольца в блоке устройства, в корзинах
+        uint32_t offset = 0;
+    };
+
+    struct Bucket {
+        /// Время начала корзины / ширина
+        uint32_t      epoch = 0;
+        MetricSummary metrics[kTelemetryMetricCount];
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    [[nodiscard]] Bucket *GetBuckets(uint32_t device) { return buckets_.data() + size_t{device} * bucket_count_; }
+    [[nodiscard]] const Bucket *GetBuckets(uint32_t device) const
+    {
+        return buckets_.data() + size_t{device} * bucket_count_;
+    }
+
+    std::vector<Ring> rings_;
+    uint32_t          bucket_count_ = 0;
+
+    /// Блоки устройств по bucket_count_ корзин
+    std::vector<Bucket>   buckets_;
+    std::vector<uint32_t> free_;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> index_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,158 @@
+#include "sensor_record.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+bool ParseInt(std::string_view text, int64_t &value)
+{
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool ParseFloat(std::string_view text, double &value)
+{
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+bool ParseBool(std::string_view text, bool &value)
+{
+    if (text == "1" || text == "true") {
+        value = true;
+        return true;
+    }
+    if (text == "0" || text == "false") {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+SensorSchema::SensorSchema(std::vector<SensorField> fields) : fields_(std::move(fields))
+{
+    slots_.reserve(fields_.size());
+    index_.reserve(fields_.size());
+    for (uint32_t i = 0; i < fields_.size(); ++i) {
+        if (!index_.emplace(fields_[i].name, i).second)
+            throw std::invalid_argument("Duplicate sensor name: " + fields_[i].name);
+        slots_.push_back(fields_[i].type == SensorType::STRING ? string_count_++ : value_count_++);
+    }
+}
+
+SensorSchema SensorSchema::FromOptions(const std::vector<std::string> &options)
+{
+    std::unordered_map<std::string_view, SensorType> types;
+    for (const auto &field : GetSensorTypes())
+        types.emplace(field.name, field.type);
+
+    std::vector<SensorField> fields;
+    fields.reserve(options.size() + types.size());
+    for (const auto &name : options) {
+        const auto it = types.find(name);
+        if (it == types.end()) {
+            fields.push_back({name, SensorType::STRING});
+        } else {
+            fields.push_back({name, it->second});
+            types.erase(it);
+        }
+    }
+    for (const auto &field : GetSensorTypes()) {
+        if (types.contains(field.name))
+            fields.push_back(field);
+    }
+    return SensorSchema(std::move(fields));
+}
+
+const std::vector<SensorField> &SensorSchema::GetSensorTypes()
+{
+    static const std::vector<SensorField> kTypes = {
+        {"battery_charge", SensorType::INT},
+        {"battery_heat_cell1_temp", SensorType::FLOAT},
+        {"battery_heat_cell2_temp", SensorType::FLOAT},
+        {"battery_heat_cell3_temp", SensorType::FLOAT},
+        {"battery_is_charging", SensorType::BOOL},
+        {"battery_is_plugged", SensorType::BOOL},
+        {"battery_temp", SensorType::FLOAT},
+        {"battery_voltage", SensorType::FLOAT},
+        {"cable_lock", SensorType::BOOL},
+        {"chainlock_exists", SensorType::BOOL},
+        {"gsm_area_code", SensorType::INT},
+        {"gsm_cell_id", SensorType::INT},
+        {"gsm_info_ts", SensorType::INT},
+        {"gsm_network_code", SensorType::INT},
+        {"gsm_signal_strength", SensorType::INT},
+        {"gsm_sim_slot", SensorType::INT},
+        {"iot_voltage", SensorType::FLOAT},
+        {"last_unlock_ts", SensorType::INT},
+        {"loc_altitude", SensorType::FLOAT},
+        {"loc_hdop", SensorType::FLOAT},
+        {"loc_lat", SensorType::FLOAT},
+        {"loc_lon", SensorType::FLOAT},
+        {"loc_satellites", SensorType::INT},
+        {"loc_updated_at", SensorType::INT},
+        {"mileage", SensorType::INT},
+        {"remaining_mileage", SensorType::INT},
+        {"speed", SensorType::FLOAT},
+        {"speed_limit", SensorType::INT},
+        {"usernearby", SensorType::BOOL},
+        {"vehicle_online", SensorType::BOOL},
+        // Только в телеметрии
+        {"imei", SensorType::STRING},
+        {"odometer_m", SensorType::INT},
+        {"temperature", SensorType::FLOAT},
+        {"Tyre pressure", SensorType::FLOAT},
+        {"Wheel count", SensorType::INT},
+    };
+    return kTypes;
+}
+
+void SensorRecord::Decode(const SensorSchema &schema, const TelemetryPayload &payload)
+{
+    // Размеры сверяются на каждом вызове, а не по адресу схемы: новая
+    // версия схемы может оказаться по адресу удалённой
+    schema_ = &schema;
+    present_.assign((schema.fields_.size() + 63) / 64, 0);
+    if (values_.size() != schema.value_count_)
+        values_.resize(schema.value_count_);
+    if (strings_.size() != schema.string_count_)
+        strings_.resize(schema.string_count_);
+    unknown_.clear();
+    invalid_count_ = 0;
+
+    for (const auto &[key, text] : payload.sensors()) {
+        const std::string_view value(text);
+        const auto             field = schema.Find(key);
+        if (!field) {
+            unknown_.emplace_back(key, value);
+            continue;
+        }
+        const uint32_t slot = schema.slots_[*field];
+        bool           parsed = true;
+        switch (schema.fields_[*field].type) {
+            case SensorType::INT:
+                parsed = ParseInt(value, values_[slot].i);
+                break;
+            case SensorType::FLOAT:
+                parsed = ParseFloat(value, values_[slot].f);
+                break;
+            case SensorType::BOOL:
+                parsed = ParseBool(value, values_[slot].b);
+                break;
+            case SensorType::STRING:
+                strings_[slot] = value;
+                break;
+        }
+        if (parsed)
+            present_[*field / 64] |= uint64_t{1} << (*field % 64);
+        else
+            ++invalid_count_;
+    }
+}
+
+}  // namespace iot::backend::proto
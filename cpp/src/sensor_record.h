@@ -0,0 +1,149 @@
+#pragma once
+
+#include "telemetry_payload.pb.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace iot::backend::proto {
+
+enum class SensorType : uint8_t {
+    INT,
+    FLOAT,
+    BOOL,
+    /// Значение хранится как есть (ссылкой на строку пакета)
+    STRING,
+};
+
+struct SensorField {
+    std::string name;
+    SensorType  type;
+};
+
+/// Известные ключи TelemetryPayload.sensors и их типы. Номер поля - его
+/// место в схеме; он же используется для чтения из SensorRecord, поэтому
+/// номера ищутся один раз, а не на каждый пакет.
+class SensorSchema {
+  public:
+    /// std::invalid_argument для повторяющихся имён
+    explicit SensorSchema(std::vector<SensorField> fields);
+
+    /// Схема по именам params/options.json: тип известных ключей берётся из
+    /// GetSensorTypes(), остальные - STRING. Ключи из GetSensorTypes(),
+    /// которых нет среди параметров (imei, "Tyre pressure", ...),
+    /// добавляются в конец.
+    static SensorSchema FromOptions(const std::vector<std::string> &options);
+
+    /// Типы ключей, которые присылают устройства
+    static const std::vector<SensorField> &GetSensorTypes();
+
+    /// Номер поля
+    [[nodiscard]] std::optional<uint32_t> Find(std::string_view name) const
+    {
+        const auto it = index_.find(name);
+        return it != index_.end() ? std::optional<uint32_t>(it->second) : std::nullopt;
+    }
+
+    [[nodiscard]] const SensorField &GetField(uint32_t field) const { return fields_[field]; }
+    [[nodiscard]] size_t GetFieldCount() const { return fields_.size(); }
+
+  private:
+    friend class SensorRecord;
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+    };
+
+    std::vector<SensorField> fields_;
+    /// Место поля в SensorRecord: числа и bool - в values_, строки - в strings_
+    std::vector<uint32_t>    slots_;
+    size_t                   value_count_ = 0;
+    size_t                   string_count_ = 0;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> index_;
+};
+
+/// Разобранные значения TelemetryPayload.sensors: числа и bool по типам
+/// схемы разбираются один раз при Decode и лежат в фиксированных ячейках,
+/// строки и неизвестные ключи - ссылками на строки пакета. Потребители
+/// читают поля по номеру из SensorSchema::Find без разбора текста и
+/// поиска в map.
+///
+/// Запись переиспользуется между пакетами: после первого Decode память не
+/// выделяется. Строки действительны, пока жив и не изменён payload, а
+/// номера полей - пока жива схема.
+class SensorRecord {
+  public:
+    /// Заменяет содержимое значениями payload.sensors(). Значение, которое
+    /// не разбирается по типу поля, считается отсутствующим (см.
+    /// GetInvalidCount).
+    void Decode(const SensorSchema &schema, const TelemetryPayload &payload);
+
+    /// Поле есть в пакете и разобрано
+    [[nodiscard]] bool Has(uint32_t field) const
+    {
+        return schema_ && field < schema_->fields_.size() && ((present_[field / 64] >> (field % 64)) & 1);
+    }
+
+    /// Значение поля своего типа; nullopt, если его нет в пакете или тип
+    /// поля другой
+    [[nodiscard]] std::optional<int64_t> GetInt(uint32_t field) const
+    {
+        if (!Has(field, SensorType::INT))
+            return std::nullopt;
+        return values_[schema_->slots_[field]].i;
+    }
+    [[nodiscard]] std::optional<double> GetFloat(uint32_t field) const
+    {
+        if (!Has(field, SensorType::FLOAT))
+            return std::nullopt;
+        return values_[schema_->slots_[field]].f;
+    }
+    [[nodiscard]] std::optional<bool> GetBool(uint32_t field) const
+    {
+        if (!Has(field, SensorType::BOOL))
+            return std::nullopt;
+        return values_[schema_->slots_[field]].b;
+    }
+    [[nodiscard]] std::optional<std::string_view> GetString(uint32_t field) const
+    {
+        if (!Has(field, SensorType::STRING))
+            return std::nullopt;
+        return strings_[schema_->slots_[field]];
+    }
+
+    /// Ключи, которых нет в схеме, с их значениями
+    [[nodiscard]] const std::vector<std::pair<std::string_view, std::string_view>> &GetUnknown() const
+    {
+        return unknown_;
+    }
+    /// Значения, не разобранные по типу поля
+    [[nodiscard]] size_t GetInvalidCount() const { return invalid_count_; }
+
+  private:
+    union Value {
+        int64_t i;
+        double  f;
+        bool    b;
+    };
+
+    bool Has(uint32_t field, SensorType type) const
+    {
+        return Has(field) && schema_->fields_[field].type == type;
+    }
+
+    const SensorSchema           *schema_ = nullptr;
+    std::vector<uint64_t>         present_;
+    std::vector<Value>            values_;
+    std::vector<std::string_view> strings_;
+    std::vector<std::pair<std::string_view, std::string_view>> unknown_;
+    size_t                        invalid_count_ = 0;
+};
+
+}  // namespace iot::backend::proto
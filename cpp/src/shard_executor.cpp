@@ -0,0 +1,227 @@
+#include "shard_executor.h"
+
+#include "device_id_filter.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <chrono>
+#include <stdexcept>
+
+namespace iot::backend::proto {
+
+namespace {
+
+// Сообщений из одного кольца подряд: остальные источники не ждут долго
+constexpr size_t kBatch = 64;
+// Пустых проходов по кольцам до засыпания
+constexpr size_t kSpins = 256;
+
+void PinThread(std::thread &thread, size_t shard)
+{
+#if defined(__linux__)
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t    set;
+    CPU_ZERO(&set);
+    CPU_SET(shard % cores, &set);
+    // Без закрепления (нет прав, cgroup с меньшим числом ядер) шард
+    // работает, просто может переезжать
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)shard;
+#endif
+}
+
+}  // namespace
+
+ShardExecutor::Ring::Ring(size_t size)
+{
+    size_t capacity = 1;
+    while (capacity < size)
+        capacity <<= 1;
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+ShardExecutor::ShardExecutor(ShardExecutorOptions options, const HandlerFactory &factory) : options_(options)
+{
+    const size_t count = options_.shards > 0 ? options_.shards : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < count; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->handler = factory(i);
+        if (!shard->handler)
+            throw std::invalid_argument("Shard handler factory returned null");
+        // Кольца источников AddProducer создаются по мере добавления
+        shard->inbox.resize(count + options_.max_producers);
+        for (size_t source = 0; source < count; ++source)
+            shard->inbox[source] = std::make_unique<Ring>(options_.ring_size);
+        shard->outbox.resize(count);
+        shards_.push_back(std::move(shard));
+    }
+    source_count_.store(count, std::memory_order_release);
+    producers_.reserve(options_.max_producers);
+
+    for (size_t i = 0; i < count; ++i) {
+        shards_[i]->thread = std::thread([this, i]() { Run(i); });
+        if (options_.pin_threads)
+            PinThread(shards_[i]->thread, i);
+    }
+}
+
+ShardExecutor::~ShardExecutor()
+{
+    Drain();
+    stop_.store(true);
+    for (auto &shard : shards_) {
+        shard->parking.epoch.fetch_add(1, std::memory_order_release);
+        shard->parking.epoch.notify_one();
+    }
+    for (auto &shard : shards_)
+        shard->thread.join();
+}
+
+ShardExecutor::Producer &ShardExecutor::AddProducer()
+{
+    std::lock_guard lock(producer_mutex_);
+    if (producers_.size() >= options_.max_producers)
+        throw std::runtime_error("Too many shard executor producers");
+    const size_t source = shards_.size() + producers_.size();
+    auto         producer = std::unique_ptr<Producer>(new Producer(*this));
+    for (auto &shard : shards_) {
+        shard->inbox[source] = std::make_unique<Ring>(options_.ring_size);
+        producer->rings_.push_back(shard->inbox[source].get());
+    }
+    producers_.push_back(std::move(producer));
+    // Кольцо становится видно шардам вместе с числом источников
+    source_count_.store(source + 1, std::memory_order_release);
+    return *producers_.back();
+}
+
+size_t ShardExecutor::GetShard(std::string_view device_id) const
+{
+    // Старшие биты хеша: младшие остаются равномерными внутри шарда для
+    // его собственных хеш-таблиц
+    const uint64_t high = DeviceIdFilter::Hash(device_id) >> 32;
+    return static_cast<size_t>((high * shards_.size()) >> 32);
+}
+
+void ShardContext::Send(std::string_view device_id, Packet &packet)
+{
+    auto        &source = *executor_.shards_[shard_];
+    const size_t target = executor_.GetShard(device_id);
+    source.sent.value.store(source.sent.value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    auto &outbox = source.outbox[target];
+    auto &ring = *executor_.shards_[target]->inbox[shard_];
+    if (outbox.empty() && ring.HasSpace()) {
+        ring.Push(device_id, packet);
+        ShardExecutor::Wake(executor_.shards_[target]->parking);
+        return;
+    }
+    auto &message = outbox.emplace_back();
+    message.device_id.assign(device_id);
+    message.packet.Swap(&packet);
+    ++source.outbox_size;
+}
+
+void ShardExecutor::FlushOutbox(Shard &shard, size_t source)
+{
+    for (size_t target = 0; target < shards_.size() && shard.outbox_size > 0; ++target) {
+        auto &outbox = shard.outbox[target];
+        Ring &ring = *shards_[target]->inbox[source];
+        bool  pushed = false;
+        while (!outbox.empty() && ring.HasSpace()) {
+            ring.Push(outbox.front().device_id, outbox.front().packet);
+            outbox.pop_front();
+            --shard.outbox_size;
+            pushed = true;
+        }
+        if (pushed)
+            Wake(shards_[target]->parking);
+    }
+}
+
+bool ShardExecutor::HasInput(const Shard &shard) const
+{
+    const size_t sources = source_count_.load(std::memory_order_acquire);
+    for (size_t source = 0; source < sources; ++source) {
+        if (!shard.inbox[source]->IsEmpty())
+            return true;
+    }
+    return false;
+}
+
+void ShardExecutor::Run(size_t index)
+{
+    Shard       &shard = *shards_[index];
+    ShardContext context(*this, index);
+    size_t       idle = 0;
+    for (;;) {
+        if (shard.outbox_size > 0)
+            FlushOutbox(shard, index);
+
+        size_t       handled = 0;
+        const size_t sources = source_count_.load(std::memory_order_acquire);
+        for (size_t source = 0; source < sources; ++source) {
+            handled += shard.inbox[source]->Consume(kBatch, [&](Message &message) {
+                shard.handler->Handle(context, message.device_id, message.packet);
+            });
+        }
+        if (handled > 0) {
+            shard.processed.value.store(shard.processed.value.load(std::memory_order_relaxed) + handled,
+                                        std::memory_order_release);
+            idle = 0;
+            continue;
+        }
+        if (stop_.load(std::memory_order_acquire) && shard.outbox_size == 0)
+            return;
+        // Пока есть что переслать, шард не спит: получатель его не разбудит
+        if (++idle < kSpins || shard.outbox_size > 0) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const uint32_t epoch = shard.parking.epoch.load(std::memory_order_acquire);
+        shard.parking.sleeping.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!HasInput(shard) && !stop_.load(std::memory_order_acquire))
+            shard.parking.epoch.wait(epoch, std::memory_order_acquire);
+        shard.parking.sleeping.store(0, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void ShardExecutor::Drain()
+{
+    const auto sum_sent = [this]() {
+        uint64_t sent = 0;
+        for (const auto &shard : shards_)
+            sent += shard->sent.value.load(std::memory_order_acquire);
+        std::lock_guard lock(producer_mutex_);
+        for (const auto &producer : producers_)
+            sent += producer->sent_.value.load(std::memory_order_acquire);
+        return sent;
+    };
+    // Счётчики только растут: если сумма отправленных не изменилась за
+    // время чтения обработанных, за это время ничего не отправлялось, и
+    // равенство значит, что обработано всё
+    for (;;) {
+        const uint64_t before = sum_sent();
+        const uint64_t processed = GetProcessedCount();
+        if (processed == before && sum_sent() == before)
+            return;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+uint64_t ShardExecutor::GetProcessedCount() const
+{
+    uint64_t processed = 0;
+    for (const auto &shard : shards_)
+        processed += shard->processed.value.load(std::memory_order_acquire);
+    return processed;
+}
+
+}  // namespace iot::backend::proto
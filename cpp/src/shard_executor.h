@@ -0,0 +1,263 @@
+#pragma once
+
+#include "packet.pb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct ShardExecutorOptions {
+    /// Число шардов (потоков); 0 - по числу ядер
+    size_t shards = 0;
+    /// Ёмкость каждого кольца, округляется до степени двойки
+    size_t ring_size = 256;
+    /// Наибольшее число источников (потоков приёма), см. AddProducer
+    size_t max_producers = 16;
+    /// Закрепить поток шарда за ядром номер шарда % число ядер
+    bool   pin_threads = true;
+};
+
+class ShardContext;
+
+/// Состояние устройств одного шарда (теневое состояние, ожидающие
+/// команды, лимиты) и обработка их пакетов. Все вызовы идут из потока
+/// шарда, поэтому состоянию не нужны блокировки.
+class ShardHandler {
+  public:
+    virtual ~ShardHandler() = default;
+
+    /// Пакет устройства этого шарда. packet лежит в ячейке кольца и живёт
+    /// до возврата; его можно изменить или переслать через context.Send.
+    virtual void Handle(ShardContext &context, std::string_view device_id, Packet &packet) = 0;
+};
+
+/// Исполнение по шардам, поток на ядро: id устройства хешируется в шард,
+/// и все пакеты устройства обрабатывает один закреплённый за ядром поток,
+/// которому принадлежит состояние устройства. Данные устройства не
+/// переезжают между ядрами, а обработчики работают без блокировок.
+///
+/// Сообщения идут через кольца с одним писателем и одним читателем
+/// (SPSC): у каждого источника (поток приёма или другой шард) своё кольцо
+/// в каждый шард. Пакет не копируется, а обменивается с ячейкой кольца
+/// (Packet::Swap), так что память пакетов переиспользуется. Простаивающий
+/// поток шарда засыпает, источник будит его, только если он спит.
+class ShardExecutor {
+  public:
+    using HandlerFactory = std::function<std::unique_ptr<ShardHandler>(size_t shard)>;
+
+    class Producer;
+
+    /// factory создаёт обработчик каждого шарда
+    ShardExecutor(ShardExecutorOptions options, const HandlerFactory &factory);
+    /// Дообрабатывает отправленное и останавливает потоки
+    ~ShardExecutor();
+
+    ShardExecutor(const ShardExecutor &) = delete;
+    ShardExecutor &operator=(const ShardExecutor &) = delete;
+
+    /// Источник для одного потока приёма: его методы нельзя вызывать из
+    /// разных потоков одновременно. Живёт, пока жив исполнитель.
+    /// std::runtime_error сверх max_producers.
+    Producer &AddProducer();
+
+    /// Ждёт, пока будут обработаны все сообщения, отправленные до вызова, и
+    /// все сообщения, которые они породили
+    void Drain();
+
+    [[nodiscard]] size_t GetShard(std::string_view device_id) const;
+    [[nodiscard]] size_t GetShardCount() const { return shards_.size(); }
+    /// Обработчик шарда; читать его состояние можно только после Drain,
+    /// пока новых сообщений нет
+    [[nodiscard]] ShardHandler &GetHandler(size_t shard) { return *shards_[shard]->handler; }
+    /// Обработанные сообщения всех шардов
+    [[nodiscard]] uint64_t GetProcessedCount() const;
+
+  private:
+    friend class ShardContext;
+
+    struct Message {
+        std::string device_id;
+        Packet      packet;
+    };
+
+    /// Кольцо SPSC; индексы писателя и читателя на разных строках кеша
+    class Ring {
+      public:
+        explicit Ring(size_t size);
+
+        /// Писатель: есть ли место. Место, которое увидел писатель, не
+        /// пропадёт до его Push.
+        bool HasSpace()
+        {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cached_head_ < slots_.size())
+                return true;
+            cached_head_ = head_.load(std::memory_order_acquire);
+            return tail - cached_head_ < slots_.size();
+        }
+
+        /// Писатель, после HasSpace
+        void Push(std::string_view device_id, Packet &packet)
+        {
+            const size_t tail = tail_.load(std::memory_order_relaxed);
+            Message     &message = slots_[tail & mask_];
+            message.device_id.assign(device_id);
+            message.packet.Swap(&packet);
+            tail_.store(tail + 1, std::memory_order_release);
+        }
+
+        /// Читатель: func(message) для не больше чем limit сообщений
+        template <class Func>
+        size_t Consume(size_t limit, Func &&func)
+        {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (head == cached_tail_) {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_)
+                    return 0;
+            }
+            const size_t count = std::min(limit, cached_tail_ - head);
+            for (size_t i = 0; i < count; ++i) {
+                func(slots_[head & mask_]);
+                head_.store(++head, std::memory_order_release);
+            }
+            return count;
+        }
+
+        [[nodiscard]] bool IsEmpty() const
+        {
+            return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+        }
+
+      private:
+        std::vector<Message> slots_;
+        size_t               mask_;
+
+        alignas(64) std::atomic<size_t> head_{0};
+        size_t cached_tail_ = 0;
+        alignas(64) std::atomic<size_t> tail_{0};
+        size_t cached_head_ = 0;
+    };
+
+    /// Засыпание простаивающего шарда (eventcount): поток шарда ставит
+    /// sleeping, перепроверяет кольца и ждёт смены epoch; источник после
+    /// записи будит его, только если видит sleeping
+    struct alignas(64) Parking {
+        std::atomic<uint32_t> sleeping{0};
+        std::atomic<uint32_t> epoch{0};
+    };
+
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> value{0};
+    };
+
+    struct Shard {
+        std::unique_ptr<ShardHandler> handler;
+        Parking                       parking;
+        /// Обработанные сообщения и сообщения, отправленные шардом
+        Counter                       processed;
+        Counter                       sent;
+        /// Кольца в этот шард по номеру источника: сначала шарды, потом
+        /// источники AddProducer
+        std::vector<std::unique_ptr<Ring>> inbox;
+        /// Сообщения в другие шарды, не поместившиеся в кольцо, по номеру
+        /// шарда-получателя; порядок сохраняется
+        std::vector<std::deque<Message>>   outbox;
+        size_t                             outbox_size = 0;
+        std::thread                        thread;
+    };
+
+    static void Wake(Parking &parking)
+    {
+        // Пара к fence в Run: либо шард увидит новое сообщение, либо мы -
+        // его sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parking.sleeping.load(std::memory_order_relaxed)) {
+            parking.epoch.fetch_add(1, std::memory_order_release);
+            parking.epoch.notify_one();
+        }
+    }
+
+    void Run(size_t shard);
+    /// Пересылает, что поместится, из outbox шарда
+    void FlushOutbox(Shard &shard, size_t source);
+    [[nodiscard]] bool HasInput(const Shard &shard) const;
+
+    const ShardExecutorOptions          options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::mutex                             producer_mutex_;
+    std::vector<std::unique_ptr<Producer>> producers_;
+    /// Источники, кольца которых уже есть во всех шардах
+    std::atomic<size_t>                    source_count_{0};
+    std::atomic<bool>                      stop_{false};
+};
+
+/// Источник сообщений одного потока приёма
+class ShardExecutor::Producer {
+  public:
+    /// Отправляет пакет в шард устройства; false, если кольцо шарда полно.
+    /// packet обменивается с ячейкой кольца: после успешного вызова его
+    /// содержимое не определено, но память можно переиспользовать.
+    bool TrySubmit(std::string_view device_id, Packet &packet)
+    {
+        const size_t shard = executor_.GetShard(device_id);
+        if (!rings_[shard]->HasSpace())
+            return false;
+        // Счёт до записи: сообщение не может оказаться обработанным раньше,
+        // чем отправленным (см. Drain)
+        sent_.value.store(sent_.value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        rings_[shard]->Push(device_id, packet);
+        Wake(executor_.shards_[shard]->parking);
+        return true;
+    }
+
+    /// То же, но ждёт места в кольце
+    void Submit(std::string_view device_id, Packet &packet)
+    {
+        while (!TrySubmit(device_id, packet))
+            std::this_thread::yield();
+    }
+
+  private:
+    friend class ShardExecutor;
+
+    explicit Producer(ShardExecutor &executor) : executor_(executor) {}
+
+    ShardExecutor     &executor_;
+    /// Свои кольца в каждый шард
+    std::vector<Ring *> rings_;
+    Counter            sent_;
+};
+
+/// Шард, в потоке которого идёт ShardHandler::Handle
+class ShardContext {
+  public:
+    [[nodiscard]] size_t GetShard() const { return shard_; }
+
+    /// Сообщение устройству любого шарда (в том числе этого) через кольцо
+    /// шард -> шард. Не блокируется: если кольцо полно, сообщение ждёт в
+    /// очереди шарда. packet, как и в Producer::TrySubmit, обменивается с
+    /// ячейкой.
+    void Send(std::string_view device_id, Packet &packet);
+
+  private:
+    friend class ShardExecutor;
+
+    ShardContext(ShardExecutor &executor, size_t shard) : executor_(executor), shard_(shard) {}
+
+    ShardExecutor &executor_;
+    size_t         shard_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,559 @@
+#include "telemetry_sink.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define IOT_SCALE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace iot::backend::proto {
+
+namespace {
+
+using google::protobuf::io::CodedOutputStream;
+
+[[noreturn]] void ThrowError(const char *action, const std::string &path)
+{
+    throw std::runtime_error(std::string(action) + " failed for " + path + ": " + std::strerror(errno));
+}
+
+/// Запись, вернувшую 0 байт или EAGAIN/EINTR, имеет смысл повторить
+bool IsRetryable(int error)
+{
+    return error == 0 || error == EAGAIN || error == EINTR;
+}
+
+}  // namespace
+
+#if defined(IOT_SCALE_HAS_IO_URING)
+
+/// Минимальная обвязка io_uring на системных вызовах, без liburing: одно
+/// кольцо, которым пользуется один поток
+class TelemetrySink::Uring {
+  public:
+    /// nullptr, если io_uring недоступен или ядро старше 5.6 (нет
+    /// IORING_OP_WRITE)
+    static std::unique_ptr<Uring> Create(unsigned entries)
+    {
+        io_uring_params params{};
+        const int       fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0)
+            return nullptr;
+        std::unique_ptr<Uring> ring(new Uring());
+        ring->fd_ = fd;
+        if ((params.features & IORING_FEAT_RW_CUR_POS) == 0 || !ring->Map(params))
+            return nullptr;
+        return ring;
+    }
+
+    ~Uring()
+    {
+        if (sqes_)
+            ::munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_)
+            ::munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_)
+            ::munmap(sq_ring_, sq_ring_size_);
+        ::close(fd_);
+    }
+
+    /// Регистрирует буферы для IORING_OP_WRITE_FIXED; false, если ядро
+    /// отказало (например, по RLIMIT_MEMLOCK)
+    bool RegisterBuffers(const std::vector<Buffer> &buffers, size_t size)
+    {
+        std::vector<iovec> iovecs;
+        for (const Buffer &buffer : buffers)
+            iovecs.push_back({buffer.data, size});
+        return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size()) == 0;
+    }
+
+    /// Ставит запись оставшейся части буфера в очередь отправки; false,
+    /// если очередь полна
+    bool PrepareWrite(int fd, const Buffer &buffer, bool fixed)
+    {
+        if (sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+            return false;
+        const unsigned index = sq_tail_ & sq_mask_;
+        io_uring_sqe  &sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer.data + buffer.written);
+        sqe.len = static_cast<uint32_t>(buffer.used - buffer.written);
+        sqe.off = buffer.offset + buffer.written;
+        if (fixed)
+            sqe.buf_index = static_cast<uint16_t>(buffer.index);
+        sqe.user_data = buffer.index;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_ptr_, ++sq_tail_, __ATOMIC_RELEASE);
+        ++to_submit_;
+        return true;
+    }
+
+    /// Отправляет ядру всё поставленное одним вызовом и ждёт min_complete
+    /// завершений. false, если кольцо неисправно (ошибка кроме EINTR,
+    /// EAGAIN и EBUSY): неотправленное остаётся в очереди, см. Cancel
+    bool Enter(unsigned min_complete)
+    {
+        for (;;) {
+            const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+            const long     result = ::syscall(__NR_io_uring_enter, fd_, to_submit_, min_complete, flags, nullptr, 0);
+            if (result >= 0) {
+                to_submit_ -= static_cast<unsigned>(result);
+                return true;
+            }
+            if (errno == EINTR)
+                continue;
+            // Кольцо завершений заполнено: сначала нужно забрать завершения
+            return errno == EAGAIN || errno == EBUSY;
+        }
+    }
+
+    /// Забирает из очереди отправки то, что ещё не отправлено ядру:
+    /// func(user_data) для каждой такой записи. Без SQPOLL ядро читает
+    /// очередь только в io_uring_enter, так что хвост можно откатить.
+    template <class Func>
+    void Cancel(Func &&func)
+    {
+        for (; to_submit_ > 0; --to_submit_)
+            func(sqes_[--sq_tail_ & sq_mask_].user_data);
+        __atomic_store_n(sq_tail_ptr_, sq_tail_, __ATOMIC_RELEASE);
+    }
+
+    /// func(user_data, res) для каждого завершения
+    template <class Func>
+    void Reap(Func &&func)
+    {
+        unsigned       head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+            func(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+  private:
+    Uring() = default;
+
+    bool Map(const io_uring_params &params)
+    {
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single)
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        sq_ring_ = MapRing(sq_ring_size_, IORING_OFF_SQ_RING);
+        if (!sq_ring_)
+            return false;
+        cq_ring_ = single ? sq_ring_ : MapRing(cq_ring_size_, IORING_OFF_CQ_RING);
+        if (!cq_ring_)
+            return false;
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe *>(MapRing(sqes_size_, IORING_OFF_SQES));
+        if (!sqes_)
+            return false;
+
+        auto *sq = static_cast<char *>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        sq_tail_ptr_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_entries);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        sq_tail_ = *sq_tail_ptr_;
+
+        auto *cq = static_cast<char *>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void *MapRing(size_t size, off_t offset) const
+    {
+        void *data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return data == MAP_FAILED ? nullptr : data;
+    }
+
+    int           fd_ = -1;
+    void         *sq_ring_ = nullptr;
+    void         *cq_ring_ = nullptr;
+    size_t        sq_ring_size_ = 0;
+    size_t        cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t        sqes_size_ = 0;
+
+    unsigned     *sq_head_ = nullptr;
+    unsigned     *sq_tail_ptr_ = nullptr;
+    unsigned     *sq_array_ = nullptr;
+    unsigned      sq_mask_ = 0;
+    unsigned      sq_entries_ = 0;
+    /// Локальная копия хвоста очереди отправки: её пишет только этот поток
+    unsigned      sq_tail_ = 0;
+    unsigned      to_submit_ = 0;
+
+    unsigned     *cq_head_ = nullptr;
+    unsigned     *cq_tail_ = nullptr;
+    unsigned      cq_mask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+};
+
+#else
+
+class TelemetrySink::Uring {
+  public:
+    static std::unique_ptr<Uring> Create(unsigned) { return nullptr; }
+
+    bool RegisterBuffers(const std::vector<Buffer> &, size_t) { return false; }
+    bool PrepareWrite(int, const Buffer &, bool) { return false; }
+    bool Enter(unsigned) { return false; }
+    template <class Func>
+    void Cancel(Func &&)
+    {
+    }
+    template <class Func>
+    void Reap(Func &&)
+    {
+    }
+};
+
+#endif
+
+TelemetrySink::TelemetrySink(TelemetrySinkOptions options) : options_(options), backend_(options.backend)
+{
+    if (options_.buffer_bytes == 0 || options_.buffers == 0 || options_.max_files == 0)
+        throw std::invalid_argument("Telemetry sink needs buffers and files");
+
+    memory_.reset(new char[options_.buffers * options_.buffer_bytes]);
+    buffers_.resize(options_.buffers);
+    for (size_t i = 0; i < options_.buffers; ++i) {
+        buffers_[i].data = memory_.get() + i * options_.buffer_bytes;
+        buffers_[i].index = static_cast<uint32_t>(i);
+    }
+    for (size_t i = options_.buffers; i > 0; --i)
+        free_.push_back(&buffers_[i - 1]);
+    files_ = std::make_unique<File[]>(options_.max_files);
+
+    if (backend_ != Backend::THREAD_POOL) {
+        // Операций в полёте не больше, чем буферов
+        uring_ = Uring::Create(static_cast<unsigned>(options_.buffers));
+        if (!uring_ && backend_ == Backend::IO_URING)
+            throw std::runtime_error("io_uring is not available");
+    }
+    if (uring_) {
+        backend_ = Backend::IO_URING;
+        fixed_buffers_ = uring_->RegisterBuffers(buffers_, options_.buffer_bytes);
+        threads_.emplace_back([this]() { RunUring(); });
+    } else {
+        backend_ = Backend::THREAD_POOL;
+        for (size_t i = 0; i < std::max<size_t>(options_.threads, 1); ++i)
+            threads_.emplace_back([this]() { RunPool(); });
+    }
+}
+
+TelemetrySink::~TelemetrySink()
+{
+    Flush();
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    queued_.notify_all();
+    for (auto &thread : threads_)
+        thread.join();
+    // Регистрация буферов снимается вместе с кольцом
+    uring_.reset();
+    for (size_t i = 0; i < file_count_.load(); ++i)
+        ::close(files_[i].fd);
+}
+
+uint32_t TelemetrySink::Open(const std::string &path)
+{
+    std::lock_guard lock(open_mutex_);
+    const uint32_t  index = file_count_.load(std::memory_order_relaxed);
+    if (index >= options_.max_files)
+        throw std::runtime_error("Too many telemetry sink files");
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        ThrowError("open", path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        ThrowError("fstat", path);
+    }
+    // Смещения буферов назначаются сами, так что дозапись идёт с конца
+    files_[index].fd = fd;
+    files_[index].offset = static_cast<uint64_t>(info.st_size);
+    file_count_.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+template <class Fill>
+bool TelemetrySink::Append(uint32_t file, size_t size, Fill &&fill)
+{
+    if (file >= file_count_.load(std::memory_order_acquire))
+        throw std::out_of_range("Unknown telemetry sink file");
+    const size_t total = CodedOutputStream::VarintSize32(static_cast<uint32_t>(size)) + size;
+    if (total > options_.buffer_bytes)
+        throw std::invalid_argument("Telemetry record does not fit into a sink buffer");
+
+    File           &target = files_[file];
+    std::lock_guard lock(target.mutex);
+    if (target.current && target.current->used + total > options_.buffer_bytes)
+        Seal(target);
+    if (!target.current) {
+        target.current = Acquire();
+        if (!target.current) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        target.current->file = file;
+    }
+    auto *out = reinterpret_cast<uint8_t *>(target.current->data + target.current->used);
+    out = CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(size), out);
+    fill(out);
+    target.current->used += total;
+    ++target.records;
+    target.bytes += total;
+    return true;
+}
+
+bool TelemetrySink::Write(uint32_t file, std::string_view record)
+{
+    return Append(file, record.size(), [&](uint8_t *out) { std::memcpy(out, record.data(), record.size()); });
+}
+
+bool TelemetrySink::WritePacket(uint32_t file, const Packet &packet)
+{
+    return Append(file, packet.ByteSizeLong(), [&](uint8_t *out) { packet.SerializeWithCachedSizesToArray(out); });
+}
+
+void TelemetrySink::Seal(File &file)
+{
+    Buffer *buffer = std::exchange(file.current, nullptr);
+    if (!buffer)
+        return;
+    if (buffer->used == 0) {
+        file.current = buffer;
+        return;
+    }
+    buffer->offset = file.offset;
+    file.offset += buffer->used;
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(buffer);
+        buffer->sequence = ++submitted_;
+        in_flight_bytes_ += buffer->used;
+    }
+    queued_.notify_one();
+}
+
+void TelemetrySink::SealAll()
+{
+    const uint32_t count = file_count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::lock_guard lock(files_[i].mutex);
+        Seal(files_[i]);
+    }
+}
+
+TelemetrySink::Buffer *TelemetrySink::Acquire()
+{
+    std::lock_guard lock(mutex_);
+    if (free_.empty())
+        return nullptr;
+    Buffer *buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+}
+
+void TelemetrySink::Release(Buffer &buffer, bool failed)
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (failed) {
+            ++errors_;
+            lost_.push_back({buffer.file, buffer.offset + buffer.written, buffer.used - buffer.written});
+            lost_bytes_ += buffer.used - buffer.written;
+        }
+        in_flight_bytes_ -= buffer.used;
+        buffer.used = 0;
+        buffer.written = 0;
+        buffer.sequence = 0;
+        buffer.attempts = 0;
+        free_.push_back(&buffer);
+    }
+    released_.notify_all();
+}
+
+void TelemetrySink::Flush()
+{
+    SealAll();
+    std::unique_lock lock(mutex_);
+    const uint64_t   target = submitted_;
+    // Сравнивать число завершённых нельзя: буфер, запечатанный после
+    // начала Flush, может записаться раньше более старого
+    released_.wait(lock, [&]() {
+        return std::none_of(buffers_.begin(), buffers_.end(), [target](const Buffer &buffer) {
+            return buffer.sequence != 0 && buffer.sequence <= target;
+        });
+    });
+}
+
+void TelemetrySink::WriteSync(Buffer &buffer)
+{
+    const int fd = files_[buffer.file].fd;
+    while (buffer.written < buffer.used) {
+        const ssize_t written = ::pwrite(fd, buffer.data + buffer.written, buffer.used - buffer.written,
+                                         static_cast<off_t>(buffer.offset + buffer.written));
+        if (written > 0) {
+            buffer.written += static_cast<size_t>(written);
+            buffer.attempts = 0;
+        } else if (!IsRetryable(written < 0 ? errno : 0) || ++buffer.attempts >= kMaxWriteAttempts) {
+            Release(buffer, true);
+            return;
+        }
+    }
+    Release(buffer, false);
+}
+
+void TelemetrySink::RunUring()
+{
+    size_t                in_flight = 0;
+    // io_uring_enter отказал: всё дальнейшее пишется через pwrite
+    bool                  broken = false;
+    std::vector<Buffer *> batch;
+    std::vector<Buffer *> retry;
+    auto                  sealed_at = std::chrono::steady_clock::now();
+    for (;;) {
+        {
+            std::unique_lock lock(mutex_);
+            if (in_flight == 0 && retry.empty())
+                queued_.wait_for(lock, options_.flush_interval, [&]() { return stop_ || !queue_.empty(); });
+            if (stop_ && queue_.empty() && in_flight == 0 && retry.empty())
+                return;
+            batch.swap(queue_);
+        }
+        if (const auto now = std::chrono::steady_clock::now(); now - sealed_at >= options_.flush_interval) {
+            SealAll();
+            sealed_at = now;
+        }
+
+        // Все готовые буферы уходят одним io_uring_enter
+        batch.insert(batch.end(), retry.begin(), retry.end());
+        retry.clear();
+        for (Buffer *buffer : batch) {
+            if (broken)
+                WriteSync(*buffer);
+            // Очередь отправки полна: буфер уйдёт после следующих завершений
+            else if (uring_->PrepareWrite(files_[buffer->file].fd, *buffer, fixed_buffers_))
+                ++in_flight;
+            else
+                retry.push_back(buffer);
+        }
+        batch.clear();
+        if (in_flight == 0)
+            continue;
+        if (broken) {
+            // Ждать в io_uring_enter нельзя, а уже отправленные операции
+            // ядро всё равно завершит: опрашиваем кольцо завершений
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else if (!uring_->Enter(1)) {
+            broken = true;
+            uring_->Cancel([&](uint64_t index) {
+                --in_flight;
+                retry.push_back(&buffers_[index]);
+            });
+        }
+        uring_->Reap([&](uint64_t index, int32_t result) {
+            Buffer &buffer = buffers_[index];
+            --in_flight;
+            if (result > 0) {
+                // Короткая запись дописывается следующей операцией
+                buffer.written += static_cast<size_t>(result);
+                buffer.attempts = 0;
+                if (buffer.written < buffer.used)
+                    retry.push_back(&buffer);
+                else
+                    Release(buffer, false);
+            } else if (IsRetryable(-result) && ++buffer.attempts < kMaxWriteAttempts) {
+                retry.push_back(&buffer);
+            } else {
+                Release(buffer, true);
+            }
+        });
+    }
+}
+
+void TelemetrySink::RunPool()
+{
+    auto sealed_at = std::chrono::steady_clock::now();
+    for (;;) {
+        Buffer *buffer = nullptr;
+        {
+            std::unique_lock lock(mutex_);
+            queued_.wait_for(lock, options_.flush_interval, [&]() { return stop_ || !queue_.empty(); });
+            if (!queue_.empty()) {
+                buffer = queue_.front();
+                queue_.erase(queue_.begin());
+            } else if (stop_) {
+                return;
+            }
+        }
+        if (const auto now = std::chrono::steady_clock::now(); now - sealed_at >= options_.flush_interval) {
+            SealAll();
+            sealed_at = now;
+        }
+        if (buffer)
+            WriteSync(*buffer);
+    }
+}
+
+TelemetrySinkStats TelemetrySink::GetStats() const
+{
+    TelemetrySinkStats stats;
+    const uint32_t     count = file_count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::lock_guard lock(files_[i].mutex);
+        stats.records += files_[i].records;
+        stats.bytes += files_[i].bytes;
+    }
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    std::lock_guard lock(mutex_);
+    stats.submitted = submitted_;
+    stats.errors = errors_;
+    stats.lost_bytes = lost_bytes_;
+    return stats;
+}
+
+size_t TelemetrySink::GetInFlightBytes() const
+{
+    std::lock_guard lock(mutex_);
+    return in_flight_bytes_;
+}
+
+std::vector<TelemetrySinkLostRange> TelemetrySink::GetLostRanges() const
+{
+    std::lock_guard lock(mutex_);
+    return lost_;
+}
+
+}  // namespace iot::backend::proto
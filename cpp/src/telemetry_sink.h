@@ -0,0 +1,194 @@
+#pragma once
+
+#include "packet.pb.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct TelemetrySinkOptions {
+    enum class Backend {
+        /// io_uring, если ядро его поддерживает, иначе THREAD_POOL
+        AUTO,
+        IO_URING,
+        /// pwrite из пула потоков
+        THREAD_POOL,
+    };
+
+    Backend backend = Backend::AUTO;
+    /// Размер буфера; запись длиннее буфера не принимается
+    size_t  buffer_bytes = 1 << 20;
+    /// Число буферов. buffers * buffer_bytes - предел памяти под
+    /// ещё не записанные данные всех файлов.
+    size_t  buffers = 32;
+    /// Наибольшее число открытых файлов
+    size_t  max_files = 64;
+    /// Потоки записи для THREAD_POOL
+    size_t  threads = 2;
+    /// Не до конца заполненный буфер уходит на запись не позже, чем
+    /// через этот интервал
+    std::chrono::milliseconds flush_interval{10};
+};
+
+struct TelemetrySinkStats {
+    uint64_t records = 0;
+    uint64_t bytes = 0;
+    /// Записи, не принятые из-за нехватки буферов
+    uint64_t rejected = 0;
+    /// Буферы, отданные на запись, и ошибки их записи
+    uint64_t submitted = 0;
+    uint64_t errors = 0;
+    /// Байты, так и не записанные из-за ошибок (см. GetLostRanges)
+    uint64_t lost_bytes = 0;
+};
+
+/// Участок файла, который не удалось записать
+struct TelemetrySinkLostRange {
+    uint32_t file = 0;
+    uint64_t offset = 0;
+    uint64_t bytes = 0;
+};
+
+/// Асинхронная запись пакетов телеметрии в файлы: поток приёма только
+/// копирует запись (длина varint и Packet в бинарном виде) в буфер файла,
+/// а на диск буферы пишет фоновый поток.
+///
+/// Буферы выделяются один раз и регистрируются в io_uring
+/// (IORING_OP_WRITE_FIXED); заполненные буферы всех файлов отправляются
+/// ядру пачкой одним io_uring_enter. Без io_uring (старое ядро, seccomp)
+/// буферы пишет пул потоков через pwrite. Место каждого буфера в файле
+/// назначается при его заполнении, так что записи файла идут в порядке
+/// Write независимо от порядка завершения операций.
+///
+/// Память ограничена числом буферов: если свободных нет (диск не успевает),
+/// Write не блокируется, а возвращает false - это сигнал давления, запись
+/// не принята.
+///
+/// Пустая запись (0 байт), EAGAIN и EINTR повторяются до kMaxWriteAttempts
+/// раз подряд, короткая запись дописывается. Если буфер так и не записан
+/// (ENOSPC, EIO), его место в файле остаётся дырой из нулей: смещения
+/// следующих буферов уже назначены. Такие участки перечисляет
+/// GetLostRanges; читатель должен их пропускать, иначе нули прочитаются
+/// как пустые записи. Если отказывает сам io_uring_enter, неотправленные
+/// буферы и все следующие пишутся через pwrite.
+///
+/// Write и WritePacket можно вызывать из разных потоков; записи одного
+/// файла сериализуются короткой блокировкой файла на время копирования.
+class TelemetrySink {
+  public:
+    using Backend = TelemetrySinkOptions::Backend;
+
+    /// std::invalid_argument для нулевых размеров, std::runtime_error, если
+    /// явно выбранный IO_URING недоступен
+    explicit TelemetrySink(TelemetrySinkOptions options = {});
+    /// Дописывает всё принятое и закрывает файлы
+    ~TelemetrySink();
+
+    TelemetrySink(const TelemetrySink &) = delete;
+    TelemetrySink &operator=(const TelemetrySink &) = delete;
+
+    /// Открывает файл на дозапись; номер файла для Write.
+    /// std::runtime_error при ошибке открытия или сверх max_files.
+    uint32_t Open(const std::string &path);
+
+    /// Дописывает запись с префиксом длины. false - запись не принята из-за
+    /// давления. std::invalid_argument для записи длиннее буфера.
+    bool Write(uint32_t file, std::string_view record);
+    /// То же для пакета: сериализуется сразу в буфер
+    bool WritePacket(uint32_t file, const Packet &packet);
+
+    /// Отдаёт на запись неполные буферы и ждёт, пока всё принятое до вызова
+    /// будет записано
+    void Flush();
+
+    [[nodiscard]] Backend            GetBackend() const { return backend_; }
+    [[nodiscard]] TelemetrySinkStats GetStats() const;
+    /// Байты в буферах, ещё не записанных в файл
+    [[nodiscard]] size_t             GetInFlightBytes() const;
+    /// Участки файлов, которые не удалось записать, в порядке ошибок
+    [[nodiscard]] std::vector<TelemetrySinkLostRange> GetLostRanges() const;
+
+    static constexpr uint32_t kMaxWriteAttempts = 3;
+
+  private:
+    struct Buffer {
+        char    *data = nullptr;
+        uint32_t index = 0;
+        uint32_t file = 0;
+        size_t   used = 0;
+        size_t   written = 0;
+        uint64_t offset = 0;
+        /// Номер запечатывания (под mutex_); 0 - буфер не в записи
+        uint64_t sequence = 0;
+        /// Неудачные попытки записи подряд
+        uint32_t attempts = 0;
+    };
+
+    struct File {
+        int        fd = -1;
+        std::mutex mutex;
+        Buffer    *current = nullptr;
+        /// Смещение следующего буфера в файле
+        uint64_t   offset = 0;
+        uint64_t   records = 0;
+        uint64_t   bytes = 0;
+    };
+
+    class Uring;
+
+    /// Копирует запись размера size в буфер файла; fill(out) пишет её
+    template <class Fill>
+    bool Append(uint32_t file, size_t size, Fill &&fill);
+    /// Отдаёт текущий буфер файла на запись; под file.mutex
+    void Seal(File &file);
+    /// Seal всех неполных буферов
+    void SealAll();
+    /// Свободный буфер или nullptr
+    Buffer *Acquire();
+    /// Буфер записан (или не записан из-за ошибки) и снова свободен
+    void Release(Buffer &buffer, bool failed);
+    /// Пишет буфер через pwrite и освобождает его
+    void WriteSync(Buffer &buffer);
+
+    void RunUring();
+    void RunPool();
+
+    const TelemetrySinkOptions options_;
+    Backend                    backend_;
+
+    std::unique_ptr<char[]>  memory_;
+    std::vector<Buffer>      buffers_;
+    std::unique_ptr<File[]>  files_;
+    std::atomic<uint32_t>    file_count_{0};
+    std::mutex               open_mutex_;
+    std::atomic<uint64_t>    rejected_{0};
+
+    /// Очередь на запись, свободные буферы и счётчики
+    mutable std::mutex                  mutex_;
+    std::condition_variable             queued_;
+    std::condition_variable             released_;
+    std::vector<Buffer *>               queue_;
+    std::vector<Buffer *>               free_;
+    uint64_t                            submitted_ = 0;
+    uint64_t                            errors_ = 0;
+    std::vector<TelemetrySinkLostRange> lost_;
+    uint64_t                            lost_bytes_ = 0;
+    size_t                              in_flight_bytes_ = 0;
+    bool                                stop_ = false;
+
+    std::unique_ptr<Uring>   uring_;
+    /// Буферы зарегистрированы в кольце
+    bool                     fixed_buffers_ = false;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,335 @@
+#include "topic_router.h"
+
+#include "device_topics.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace iot::backend::proto {
+
+namespace {
+
+// Рёбер не больше этого ищутся линейно, у узлов с большим числом рёбер
+// строится хеш-таблица
+constexpr uint32_t kLinearSearchEdges = 8;
+
+inline uint64_t Load64(const char *data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t Load32(const char *data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Сравнение коротких строк словами с перекрытием: метки уровней обычно
+// короче 16 байт, и вызов memcmp обходится дороже самого сравнения
+inline bool EqualBytes(const char *a, const char *b, size_t size)
+{
+    if (size >= 8) {
+        for (size_t i = 0; i + 8 < size; i += 8) {
+            if (Load64(a + i) != Load64(b + i))
+                return false;
+        }
+        return Load64(a + size - 8) == Load64(b + size - 8);
+    }
+    if (size >= 4)
+        return Load32(a) == Load32(b) && Load32(a + size - 4) == Load32(b + size - 4);
+    for (size_t i = 0; i < size; ++i) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+inline uint64_t Mix(uint64_t value)
+{
+    value *= 0x9E3779B97F4A7C15ULL;
+    return value ^ (value >> 29);
+}
+
+// Хеш метки для узлов с множеством рёбер (например, id устройств)
+inline uint64_t HashLabel(const char *data, size_t size)
+{
+    uint64_t hash = Mix(size);
+    if (size >= 8) {
+        for (size_t i = 0; i + 8 < size; i += 8)
+            hash = Mix(hash ^ Load64(data + i));
+        return Mix(hash ^ Load64(data + size - 8));
+    }
+    if (size >= 4)
+        return Mix(hash ^ ((static_cast<uint64_t>(Load32(data)) << 32) | Load32(data + size - 4)));
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+        value = (value << 8) | static_cast<uint8_t>(data[i]);
+    return Mix(hash ^ value);
+}
+
+// Позиция первого '/' в rest или rest.size(). Уровень '+' - обычно id
+// устройства длиной 15-36 байт, его конец ищется по 16 байт за раз.
+inline size_t FindSlash(std::string_view rest)
+{
+    const char *data = rest.data();
+    size_t      i = 0;
+#if defined(__SSE2__)
+    const __m128i slash = _mm_set1_epi8('/');
+    for (; i + 16 <= rest.size(); i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const int     mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, slash));
+        if (mask != 0)
+            return i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    while (i < rest.size() && data[i] != '/')
+        ++i;
+    return i;
+}
+
+bool IsCapture(std::string_view label)
+{
+    return label.size() >= 2 && label.front() == '{' && label.back() == '}';
+}
+
+}  // namespace
+
+struct TopicRouter::BuildNode {
+    std::map<std::string, std::unique_ptr<BuildNode>, std::less<>> children;
+    std::unique_ptr<BuildNode>                                      plus;
+    int32_t                                                         terminal = -1;
+    int32_t                                                         hash_terminal = -1;
+};
+
+TopicRouter::TopicRouter(const std::vector<TopicRoute> &routes)
+{
+    BuildNode root;
+    for (const auto &route : routes) {
+        const std::string_view pattern = route.pattern;
+        if (pattern.empty())
+            throw std::invalid_argument("Empty topic pattern");
+
+        BuildNode *node = &root;
+        Terminal   terminal{route.handler, -1};
+        bool       hash = false;
+        size_t     level = 0;
+        size_t     begin = 0;
+        while (begin != std::string_view::npos) {
+            const size_t end = pattern.find('/', begin);
+            const auto   label = pattern.substr(begin, end == std::string_view::npos ? end : end - begin);
+            begin = end == std::string_view::npos ? end : end + 1;
+
+            if (hash)
+                throw std::invalid_argument("'#' must be the last level of topic pattern " + route.pattern);
+            if (label == "#") {
+                hash = true;
+                continue;
+            }
+            if (level == kMaxLevels)
+                throw std::invalid_argument("Too many levels in topic pattern " + route.pattern);
+
+            if (label == "+" || IsCapture(label)) {
+                if (label != "+") {
+                    if (terminal.capture_level >= 0)
+                        throw std::invalid_argument("Several captures in topic pattern " + route.pattern);
+                    terminal.capture_level = static_cast<int32_t>(level);
+                }
+                if (!node->plus)
+                    node->plus = std::make_unique<BuildNode>();
+                node = node->plus.get();
+            } else {
+                if (label.find_first_of("+#") != std::string_view::npos)
+                    throw std::invalid_argument("Wildcard must occupy a whole level in topic pattern " + route.pattern);
+                auto it = node->children.find(label);
+                if (it == node->children.end())
+                    it = node->children.emplace(std::string(label), std::make_unique<BuildNode>()).first;
+                node = it->second.get();
+            }
+            ++level;
+        }
+
+        int32_t &slot = hash ? node->hash_terminal : node->terminal;
+        if (slot >= 0)
+            throw std::invalid_argument("Duplicate topic pattern " + route.pattern);
+        slot = static_cast<int32_t>(terminals_.size());
+        terminals_.push_back(terminal);
+    }
+    Flatten(root);
+}
+
+uint32_t TopicRouter::Flatten(const BuildNode &node)
+{
+    // Рёбра узла лежат подряд
+    const auto index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_[index].terminal = node.terminal;
+    nodes_[index].hash_terminal = node.hash_terminal;
+    nodes_[index].first_edge = static_cast<uint32_t>(edges_.size());
+    nodes_[index].edge_count = static_cast<uint32_t>(node.children.size());
+
+    for (const auto &[label, child] : node.children) {
+        edges_.push_back({static_cast<uint32_t>(labels_.size()), static_cast<uint32_t>(label.size()), 0});
+        labels_ += label;
+    }
+
+    // Открытая адресация с линейным пробированием, заполнение не выше 1/2
+    if (node.children.size() > kLinearSearchEdges) {
+        size_t size = 1;
+        while (size < node.children.size() * 2)
+            size <<= 1;
+        nodes_[index].first_slot = static_cast<uint32_t>(slots_.size());
+        nodes_[index].slot_mask = static_cast<uint32_t>(size - 1);
+        slots_.resize(slots_.size() + size, 0);
+        for (uint32_t edge = nodes_[index].first_edge; edge < edges_.size(); ++edge) {
+            const auto label = GetLabel(edges_[edge]);
+            size_t     slot = HashLabel(label.data(), label.size()) & (size - 1);
+            while (slots_[nodes_[index].first_slot + slot] != 0)
+                slot = (slot + 1) & (size - 1);
+            slots_[nodes_[index].first_slot + slot] = edge + 1;
+        }
+    }
+
+    uint32_t edge = nodes_[index].first_edge;
+    for (const auto &[label, child] : node.children)
+        edges_[edge++].node = Flatten(*child);
+    if (node.plus)
+        nodes_[index].plus_child = static_cast<int32_t>(Flatten(*node.plus));
+    return index;
+}
+
+int32_t TopicRouter::FindChild(const Node &node, std::string_view rest, size_t &label_size) const
+{
+    if (node.edge_count <= kLinearSearchEdges) {
+        // Метки сравниваются прямо с началом остатка топика, без поиска '/'
+        const Edge *first = edges_.data() + node.first_edge;
+        const Edge *last = first + node.edge_count;
+        for (const Edge *edge = first; edge != last; ++edge) {
+            const size_t size = edge->label_size;
+            if (rest.size() < size || (rest.size() != size && rest[size] != '/'))
+                continue;
+            if (EqualBytes(rest.data(), labels_.data() + edge->label_offset, size)) {
+                label_size = size;
+                return static_cast<int32_t>(edge->node);
+            }
+        }
+        return -1;
+    }
+
+    label_size = FindSlash(rest);
+    const uint32_t *slots = slots_.data() + node.first_slot;
+    for (size_t slot = HashLabel(rest.data(), label_size) & node.slot_mask;; slot = (slot + 1) & node.slot_mask) {
+        if (slots[slot] == 0)
+            return -1;
+        const Edge &edge = edges_[slots[slot] - 1];
+        if (edge.label_size == label_size && EqualBytes(rest.data(), labels_.data() + edge.label_offset, label_size))
+            return static_cast<int32_t>(edge.node);
+    }
+}
+
+int32_t TopicRouter::Match(std::string_view topic, Span *plus_levels) const
+{
+    // Перебор с возвратом без рекурсии: на каждом уровне сначала точная
+    // метка, затем '+', затем '#'. Непроверенные варианты уровня
+    // запоминаются в стеке, только если они есть.
+    enum class Stage : uint8_t { LITERAL, PLUS, HASH };
+    struct Frame {
+        uint32_t node;
+        uint32_t level;
+        size_t   position;
+        Stage    stage;
+    };
+    Frame  stack[kMaxLevels + 1];
+    size_t depth = 0;
+
+    uint32_t node_index = 0;
+    uint32_t level = 0;
+    size_t   position = 0;
+    Stage    stage = Stage::LITERAL;
+    while (true) {
+        const Node &node = nodes_[node_index];
+        // Первый уровень на '$' совпадает только с точной меткой
+        const bool wildcards = level != 0 || topic[0] != '$';
+
+        if (position == std::string_view::npos) {
+            // Уровни топика закончились; "a/#" совпадает и с "a"
+            const int32_t terminal = node.terminal >= 0 ? node.terminal : node.hash_terminal;
+            if (terminal >= 0)
+                return terminal;
+        } else {
+            const std::string_view rest(topic.data() + position, topic.size() - position);
+            if (stage == Stage::LITERAL && node.edge_count != 0) {
+                size_t label_size = 0;
+                if (const int32_t child = FindChild(node, rest, label_size); child >= 0) {
+                    if (wildcards && (node.plus_child >= 0 || node.hash_terminal >= 0))
+                        stack[depth++] = {node_index, level, position, Stage::PLUS};
+                    node_index = static_cast<uint32_t>(child);
+                    position = label_size == rest.size() ? std::string_view::npos : position + label_size + 1;
+                    ++level;
+                    continue;
+                }
+            }
+            if (stage != Stage::HASH && node.plus_child >= 0 && wildcards) {
+                if (node.hash_terminal >= 0)
+                    stack[depth++] = {node_index, level, position, Stage::HASH};
+                // Уровни '+' запоминаются для захвата: при возврате уровень
+                // перезаписывается, так что в итоге остаётся совпавший путь
+                const size_t size = FindSlash(rest);
+                plus_levels[level] = {position, size};
+                node_index = static_cast<uint32_t>(node.plus_child);
+                position = size == rest.size() ? std::string_view::npos : position + size + 1;
+                stage = Stage::LITERAL;
+                ++level;
+                continue;
+            }
+            if (wildcards && node.hash_terminal >= 0)
+                return node.hash_terminal;
+        }
+
+        if (depth == 0)
+            return -1;
+        const Frame &frame = stack[--depth];
+        node_index = frame.node;
+        level = frame.level;
+        position = frame.position;
+        stage = frame.stage;
+    }
+}
+
+std::optional<TopicMatch> TopicRouter::Route(std::string_view topic) const
+{
+    if (topic.empty())
+        return std::nullopt;
+
+    Span          plus_levels[kMaxLevels];
+    const int32_t terminal_index = Match(topic, plus_levels);
+    if (terminal_index < 0)
+        return std::nullopt;
+
+    const Terminal &terminal = terminals_[terminal_index];
+    TopicMatch      match{terminal.handler, {}};
+    if (terminal.capture_level >= 0) {
+        const Span &span = plus_levels[terminal.capture_level];
+        match.device_id = topic.substr(span.position, span.size);
+    }
+    return match;
+}
+
+TopicRouter TopicRouter::MakeDeviceTopicRouter()
+{
+    return TopicRouter({
+        {"$devices/{device_id}/commands/command", static_cast<uint32_t>(DeviceTopicKind::COMMAND)},
+        {"$devices/{device_id}/events/telemetry", static_cast<uint32_t>(DeviceTopicKind::TELEMETRY)},
+        {"$devices/{device_id}/events/status", static_cast<uint32_t>(DeviceTopicKind::STATUS)},
+    });
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+struct TopicRoute {
+    /// Фильтр MQTT: '+' - любой один уровень, '#' - любые оставшиеся уровни
+    /// (последним уровнем). Уровень вида "{device_id}" совпадает как '+' и
+    /// попадает в TopicMatch::device_id; такой уровень в шаблоне один.
+    std::string pattern;
+    uint32_t    handler = 0;
+};
+
+struct TopicMatch {
+    uint32_t handler = 0;
+    /// Уровень топика на месте "{...}" шаблона, пусто без захвата (и для
+    /// пустого уровня, как в "$devices//events/status", с которым '+'
+    /// совпадает). Ссылается на разобранный топик.
+    std::string_view device_id;
+};
+
+/// Маршрутизатор входящих сообщений по топику. Шаблоны компилируются в
+/// префиксное дерево по уровням топика, которое хранится в плоских массивах:
+/// узлы, рёбра с метками уровней (поиск линейный для нескольких рёбер и по
+/// хеш-таблице для многих, например id устройств) и отдельные переходы по
+/// '+' и '#'. Route не выделяет память и потокобезопасен.
+///
+/// Если топику соответствует несколько шаблонов, на каждом уровне
+/// точное совпадение предпочитается '+', а '+' - '#'. Как и в MQTT,
+/// '+' и '#' на первом уровне не совпадают с топиками на '$'.
+class TopicRouter {
+  public:
+    /// Наибольшее количество уровней шаблона
+    static constexpr size_t kMaxLevels = 32;
+
+    /// std::invalid_argument для некорректного или повторяющегося шаблона
+    explicit TopicRouter(const std::vector<TopicRoute> &routes);
+
+    [[nodiscard]] std::optional<TopicMatch> Route(std::string_view topic) const;
+
+    /// Шаблоны топиков устройств с обработчиками, равными DeviceTopicKind:
+    /// $devices/{device_id}/commands/command, .../events/telemetry и
+    /// .../events/status
+    [[nodiscard]] static TopicRouter MakeDeviceTopicRouter();
+
+  private:
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        /// Хеш-таблица рёбер в slots_, если их больше kLinearSearchEdges
+        uint32_t first_slot = 0;
+        uint32_t slot_mask = 0;
+        int32_t  plus_child = -1;
+        /// Индексы в terminals_: шаблон заканчивается здесь или '#' здесь
+        int32_t terminal = -1;
+        int32_t hash_terminal = -1;
+    };
+
+    struct Edge {
+        uint32_t label_offset = 0;
+        uint32_t label_size = 0;
+        uint32_t node = 0;
+    };
+
+    struct Terminal {
+        uint32_t handler = 0;
+        /// Номер уровня "{...}", -1 без захвата
+        int32_t capture_level = -1;
+    };
+
+    struct BuildNode;
+    uint32_t Flatten(const BuildNode &node);
+
+    [[nodiscard]] std::string_view GetLabel(const Edge &edge) const
+    {
+        return {labels_.data() + edge.label_offset, edge.label_size};
+    }
+    /// Ребро, метка которого - первый уровень rest; label_size - её длина
+    [[nodiscard]] int32_t FindChild(const Node &node, std::string_view rest, size_t &label_size) const;
+    /// Уровень топика, совпавший с '+'
+    struct Span {
+        size_t position;
+        size_t size;
+    };
+
+    /// Индекс в terminals_ или -1. plus_levels[level] заполняется для
+    /// уровней совпавшего пути, пройденных через '+'.
+    [[nodiscard]] int32_t Match(std::string_view topic, Span *plus_levels) const;
+
+    std::vector<Node>     nodes_;
+    std::vector<Edge>     edges_;
+    /// Номер ребра + 1, 0 - пустой слот
+    std::vector<uint32_t> slots_;
+    std::vector<Terminal> terminals_;
+    std::string           labels_;
+};
+
+}  // namespace iot::backend::proto
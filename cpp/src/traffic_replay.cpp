@@ -0,0 +1,248 @@
+#include "traffic_replay.h"
+
+#include "mapped_file.h"
+#include "packet_validator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace iot::backend::proto {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Позиция первого '\n' в [from, size) или size
+size_t FindNewline(const char *data, size_t from, size_t size)
+{
+    size_t i = from;
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask != 0)
+            return i + __builtin_ctz(static_cast<unsigned>(mask));
+    }
+#endif
+    const void *found = std::memchr(data + i, '\n', size - i);
+    return found ? static_cast<const char *>(found) - data : size;
+}
+
+void Merge(ReplayReport &to, const ReplayReport &from)
+{
+    to.lines += from.lines;
+    to.packets += from.packets;
+    to.errors += from.errors;
+    to.bytes += from.bytes;
+    to.lag_ns.Merge(from.lag_ns);
+}
+
+// Запускает body(thread) в threads потоках и ждёт их завершения
+template <class Body>
+void RunThreads(size_t threads, const Body &body)
+{
+    if (threads == 1) {
+        body(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; ++t)
+        workers.emplace_back([&body, t]() { body(t); });
+    for (auto &worker : workers)
+        worker.join();
+}
+
+}  // namespace
+
+std::vector<std::string_view> SplitLines(std::string_view data)
+{
+    std::vector<std::string_view> lines;
+    size_t begin = 0;
+    while (begin < data.size()) {
+        const size_t end = FindNewline(data.data(), begin, data.size());
+        size_t line_end = end;
+        if (line_end > begin && data[line_end - 1] == '\r')
+            --line_end;
+        if (line_end > begin)
+            lines.push_back(data.substr(begin, line_end - begin));
+        begin = end + 1;
+    }
+    return lines;
+}
+
+void ValidatingSink::OnPacket(const Packet &packet, size_t thread)
+{
+    (void)thread;
+    (IsValid(packet) ? valid_ : invalid_).fetch_add(1, std::memory_order_relaxed);
+}
+
+void CountingSink::OnStart(size_t threads)
+{
+    shards_.assign(threads, Shard{});
+}
+
+void CountingSink::OnPacket(const Packet &packet, size_t thread)
+{
+    const auto what = static_cast<size_t>(packet.what_case());
+    ++shards_[thread].counts[what < kWhatCount ? what : 0];
+}
+
+uint64_t CountingSink::GetCount(Packet::WhatCase what) const
+{
+    uint64_t count = 0;
+    for (const auto &shard : shards_)
+        count += shard.counts[static_cast<size_t>(what)];
+    return count;
+}
+
+uint64_t CountingSink::GetTotal() const
+{
+    uint64_t count = 0;
+    for (const auto &shard : shards_) {
+        for (const auto value : shard.counts)
+            count += value;
+    }
+    return count;
+}
+
+double ReplayReport::GetPacketsPerSecond() const
+{
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? static_cast<double>(packets) / seconds : 0;
+}
+
+TrafficReplay::TrafficReplay(ReplayOptions options) : options_(std::move(options))
+{
+    if (options_.threads == 0)
+        throw std::invalid_argument("TrafficReplay needs at least one thread");
+    if (options_.speed < 0)
+        throw std::invalid_argument("TrafficReplay speed can't be negative");
+}
+
+std::vector<std::chrono::nanoseconds>
+TrafficReplay::MakeSchedule(const std::vector<uint64_t> &timestamps,
+                            double                       speed,
+                            std::chrono::milliseconds    max_gap)
+{
+    using Seconds = std::chrono::duration<double>;
+
+    std::vector<std::chrono::nanoseconds> schedule(timestamps.size());
+    const auto first = std::find_if(timestamps.begin(), timestamps.end(),
+                                    [](uint64_t timestamp) { return timestamp != 0; });
+    if (first == timestamps.end() || speed <= 0)
+        return schedule;
+
+    // Пакеты одной секунды распределяются по ней равномерно; если паузы
+    // сокращаются меньше чем до секунды, то и по сокращённому интервалу
+    Seconds width(1);
+    if (max_gap.count() != 0)
+        width = std::min<Seconds>(width, max_gap);
+
+    uint64_t prev = *first;
+    Seconds  base(0);
+    for (size_t begin = 0; begin < timestamps.size();) {
+        // Серия пакетов с одинаковым (с учётом поправок) временем
+        uint64_t current = std::max(prev, timestamps[begin]);
+        size_t   end = begin + 1;
+        while (end < timestamps.size() &&
+               (timestamps[end] == 0 || timestamps[end] <= current))
+            ++end;
+
+        Seconds gap(static_cast<double>(current - prev));
+        if (max_gap.count() != 0)
+            gap = std::min<Seconds>(gap, max_gap);
+        base += gap;
+        prev = current;
+
+        const double count = static_cast<double>(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            const Seconds offset = base + width * (static_cast<double>(i - begin) / count);
+            schedule[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(offset / speed);
+        }
+        begin = end;
+    }
+    return schedule;
+}
+
+ReplayReport TrafficReplay::Replay(std::string_view capture, ReplaySink &sink) const
+{
+    const auto lines = SplitLines(capture);
+    const size_t threads = std::max<size_t>(1, std::min(options_.threads, lines.size()));
+    const ProtocolConverter converter(options_.transport);
+
+    std::vector<std::chrono::nanoseconds> schedule;
+    if (options_.speed > 0) {
+        std::vector<uint64_t> timestamps(lines.size());
+        RunThreads(threads, [&](size_t thread) {
+            Packet      packet;
+            std::string buffer;
+            for (size_t i = thread; i < lines.size(); i += threads) {
+                buffer.assign(lines[i]);
+                try {
+                    converter.Deserialize(buffer, packet);
+                    timestamps[i] = packet.timestamp();
+                } catch (const std::exception &) {
+                    // Ошибку разбора сообщит основной проход
+                }
+            }
+        });
+        schedule = MakeSchedule(timestamps, options_.speed, options_.max_gap);
+    }
+
+    sink.OnStart(threads);
+    std::vector<ReplayReport> reports(threads);
+    const auto start = Clock::now();
+    RunThreads(threads, [&](size_t thread) {
+        auto       &report = reports[thread];
+        Packet      packet;
+        std::string buffer;
+        for (size_t i = thread; i < lines.size(); i += threads) {
+            ++report.lines;
+            report.bytes += lines[i].size();
+            buffer.assign(lines[i]);
+            try {
+                converter.Deserialize(buffer, packet);
+            } catch (const std::exception &) {
+                ++report.errors;
+                sink.OnError(lines[i], thread);
+                continue;
+            }
+
+            if (!schedule.empty()) {
+                const auto due = start + schedule[i];
+                auto       now = Clock::now();
+                if (now < due) {
+                    std::this_thread::sleep_until(due);
+                    now = Clock::now();
+                }
+                report.lag_ns.Add(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+            }
+            ++report.packets;
+            sink.OnPacket(packet, thread);
+        }
+    });
+
+    ReplayReport report;
+    report.elapsed = Clock::now() - start;
+    for (const auto &thread_report : reports)
+        Merge(report, thread_report);
+    return report;
+}
+
+ReplayReport TrafficReplay::ReplayFile(const std::string &path, ReplaySink &sink) const
+{
+    const MappedFile file(path, MappedFile::Access::SEQUENTIAL);
+    return Replay(file.GetData(), sink);
+}
+
+}  // namespace iot::backend::proto
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "hot_path_metrics.h"
+#include "protocol_converter.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace iot::backend::proto {
+
+/// Разбивает data на строки по '\n' (поиск по 16 байт за раз через SSE2).
+/// '\r' в конце строки отбрасывается, пустые строки пропускаются.
+/// Строки ссылаются на data.
+[[nodiscard]] std::vector<std::string_view> SplitLines(std::string_view data);
+
+/// Получатель воспроизводимых пакетов: валидатор, device shadow,
+/// счётчик для бенчмарка и т.п.
+class ReplaySink {
+  public:
+    virtual ~ReplaySink() = default;
+
+    /// Вызывается перед воспроизведением: OnPacket и OnError будут
+    /// вызываться из threads потоков одновременно
+    virtual void OnStart(size_t threads) { (void)threads; }
+
+    /// thread - номер рабочего потока из [0, threads), удобен для
+    /// счётчиков без синхронизации
+    virtual void OnPacket(const Packet &packet, size_t thread) = 0;
+
+    /// Строку не удалось разобрать через ProtocolConverter
+    virtual void OnError(std::string_view line, size_t thread)
+    {
+        (void)line;
+        (void)thread;
+    }
+};
+
+/// Проверяет пакеты через IsValid
+class ValidatingSink final : public ReplaySink {
+  public:
+    void OnPacket(const Packet &packet, size_t thread) override;
+
+    [[nodiscard]] uint64_t GetValidCount() const { return valid_.load(); }
+    [[nodiscard]] uint64_t GetInvalidCount() const { return invalid_.load(); }
+
+  private:
+    std::atomic<uint64_t> valid_{0};
+    std::atomic<uint64_t> invalid_{0};
+};
+
+/// Считает пакеты по типу (Packet::what_case) в отдельных счётчиках
+/// каждого потока
+class CountingSink final : public ReplaySink {
+  public:
+    void OnStart(size_t threads) override;
+    void OnPacket(const Packet &packet, size_t thread) override;
+
+    [[nodiscard]] uint64_t GetCount(Packet::WhatCase what) const;
+    [[nodiscard]] uint64_t GetTotal() const;
+
+  private:
+    static constexpr size_t kWhatCount = Packet::kNotification + 1;
+
+    struct alignas(64) Shard {
+        std::array<uint64_t, kWhatCount> counts{};
+    };
+
+    std::vector<Shard> shards_;
+};
+
+struct ReplayOptions {
+    /// Формат строк записи: Packet в JSON или base64 бинарного Packet
+    ProtocolConverter::TransportDataType transport =
+        ProtocolConverter::TransportDataType::JSON;
+    size_t threads = 1;
+    /// 0 - как можно быстрее, 1 - в темпе записи, 10 - в 10 раз быстрее
+    double speed = 0;
+    /// Паузы записи длиннее max_gap сокращаются до max_gap, 0 - не сокращать
+    std::chrono::milliseconds max_gap{0};
+};
+
+struct ReplayReport {
+    uint64_t lines = 0;
+    uint64_t packets = 0;
+    /// Строки, которые не разобрал ProtocolConverter
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    std::chrono::nanoseconds elapsed{0};
+    /// Опоздание пакетов относительно расписания (только при speed > 0)
+    metrics::Histogram lag_ns;
+
+    [[nodiscard]] double GetPacketsPerSecond() const;
+};
+
+/// Воспроизводит запись трафика в формате JSON lines: одна строка - один
+/// пакет, как он пришёл по транспорту. Строки разбираются через
+/// ProtocolConverter в options.threads потоках (поток t берёт строки
+/// t, t + threads, ...) и передаются в sink.
+///
+/// Время прихода пакета - Packet::timestamp. Пакеты одной секунды
+/// равномерно распределяются по этой секунде. При speed > 0 строки сначала
+/// разбираются один раз, чтобы построить расписание (см. MakeSchedule), а
+/// затем ещё раз при отправке: держать в памяти разобранные пакеты большой
+/// записи дороже.
+class TrafficReplay {
+  public:
+    explicit TrafficReplay(ReplayOptions options);
+
+    ReplayReport Replay(std::string_view capture, ReplaySink &sink) const;
+    /// Читает запись через mmap
+    ReplayReport ReplayFile(const std::string &path, ReplaySink &sink) const;
+
+    /// Смещения отправки пакетов от начала воспроизведения по их timestamp
+    /// (секунды). timestamp 0 (строка не разобрана) и уменьшение timestamp
+    /// считаются тем же моментом, что и у предыдущего пакета.
+    [[nodiscard]] static std::vector<std::chrono::nanoseconds>
+    MakeSchedule(const std::vector<uint64_t> &timestamps,
+                 double                       speed,
+                 std::chrono::milliseconds    max_gap);
+
+  private:
+    const ReplayOptions options_;
+};
+
+}  // namespace iot::backend::proto
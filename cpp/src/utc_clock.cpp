@@ -0,0 +1,59 @@
+#include "utc_clock.h"
+
+#include <algorithm>
+
+namespace iot::backend::proto {
+
+namespace {
+
+const SystemUtcClock         kSystemClock;
+std::atomic<const UtcClock *> default_clock{&kSystemClock};
+
+}  // namespace
+
+uint64_t SystemUtcClock::NowMs() const
+{
+    // Почему system_clock, а не std::time или utc_clock - см. helpers.cpp
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+CoarseUtcClock::CoarseUtcClock(std::chrono::milliseconds resolution)
+    : resolution_(std::max(resolution, std::chrono::milliseconds(1)))
+{
+    // Показания валидны сразу после конструктора, не дожидаясь потока
+    now_ms_.store(kSystemClock.NowMs(), std::memory_order_relaxed);
+    updater_ = std::thread([this]() {
+        while (!stop_.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(resolution_);
+            Update();
+        }
+    });
+}
+
+CoarseUtcClock::~CoarseUtcClock()
+{
+    stop_.store(true, std::memory_order_relaxed);
+    updater_.join();
+}
+
+void CoarseUtcClock::Update()
+{
+    const auto now_ms = kSystemClock.NowMs();
+    if (now_ms > now_ms_.load(std::memory_order_relaxed))
+        now_ms_.store(now_ms, std::memory_order_relaxed);
+}
+
+const UtcClock &GetDefaultClock()
+{
+    return *default_clock.load(std::memory_order_acquire);
+}
+
+const UtcClock *SetDefaultClock(const UtcClock *clock)
+{
+    return default_clock.exchange(clock ? clock : &kSystemClock,
+                                  std::memory_order_acq_rel);
+}
+
+}  // namespace iot::backend::proto
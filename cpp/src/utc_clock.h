@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace iot::backend::proto {
+
+/// Источник текущего времени UTC для пакетов и проверок срока жизни.
+///
+/// helpers::GetCurrentUtcTimestamp/GetCurrentUtcTimestampMs (а через них
+/// MakePacket, MakeCommand* и IsExpired) берут время из часов по умолчанию,
+/// см. GetDefaultClock/SetDefaultClock. По умолчанию это точные SystemUtcClock.
+class UtcClock {
+  public:
+    virtual ~UtcClock() = default;
+
+    /// Миллисекунды с начала эпохи (UTC)
+    [[nodiscard]] virtual uint64_t NowMs() const = 0;
+
+    /// Секунды с начала эпохи (UTC)
+    [[nodiscard]] uint64_t NowS() const { return NowMs() / 1000; }
+};
+
+/// Точные часы: std::chrono::system_clock при каждом вызове
+class SystemUtcClock final : public UtcClock {
+  public:
+    [[nodiscard]] uint64_t NowMs() const override;
+};
+
+/// Грубые часы: фоновый поток раз в resolution кладёт время в атомарную
+/// переменную на отдельной кэш-линии, чтение - одна relaxed загрузка.
+///
+/// Точность: показания отстают от system_clock не больше чем на
+/// resolution плюс задержку пробуждения фонового потока планировщиком
+/// (на ненагруженной машине это единицы мс при resolution 1 мс).
+/// Показания не убывают, даже если системное время перевели назад.
+class CoarseUtcClock final : public UtcClock {
+  public:
+    explicit CoarseUtcClock(
+        std::chrono::milliseconds resolution = std::chrono::milliseconds(1));
+    ~CoarseUtcClock() override;
+
+    CoarseUtcClock(const CoarseUtcClock &) = delete;
+    CoarseUtcClock &operator=(const CoarseUtcClock &) = delete;
+
+    [[nodiscard]] uint64_t NowMs() const override
+    {
+        return now_ms_.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::chrono::milliseconds GetResolution() const
+    {
+        return resolution_;
+    }
+
+  private:
+    void Update();
+
+    static constexpr size_t kCacheLineSize = 64;
+
+    // Часто читаемое значение не должно делить кэш-линию с чем-то изменяемым
+    alignas(kCacheLineSize) std::atomic<uint64_t> now_ms_{0};
+    alignas(kCacheLineSize) const std::chrono::milliseconds resolution_;
+    std::atomic<bool> stop_{false};
+    std::thread       updater_;
+};
+
+/// Управляемые вручную часы для тестов
+class FakeUtcClock final : public UtcClock {
+  public:
+    explicit FakeUtcClock(uint64_t now_ms = 0) : now_ms_(now_ms) {}
+
+    [[nodiscard]] uint64_t NowMs() const override
+    {
+        return now_ms_.load(std::memory_order_relaxed);
+    }
+
+    void SetMs(uint64_t now_ms) { now_ms_.store(now_ms, std::memory_order_relaxed); }
+    void Advance(std::chrono::milliseconds delta)
+    {
+        now_ms_.fetch_add(delta.count(), std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<uint64_t> now_ms_;
+};
+
+/// Часы, которыми пользуются helpers::GetCurrentUtcTimestamp*
+const UtcClock &GetDefaultClock();
+
+/// Подменяет часы по умолчанию. Объект должен жить, пока он установлен.
+/// nullptr возвращает SystemUtcClock. Возвращает предыдущие часы.
+const UtcClock *SetDefaultClock(const UtcClock *clock);
+
+/// Подменяет часы по умолчанию на время жизни объекта (удобно в тестах)
+class ScopedDefaultClock {
+  public:
+    explicit ScopedDefaultClock(const UtcClock &clock)
+        : previous_(SetDefaultClock(&clock))
+    {
+    }
+    ~ScopedDefaultClock() { SetDefaultClock(previous_); }
+
+    ScopedDefaultClock(const ScopedDefaultClock &) = delete;
+    ScopedDefaultClock &operator=(const ScopedDefaultClock &) = delete;
+
+  private:
+    const UtcClock *previous_;
+};
+
+}  // namespace iot::backend::proto
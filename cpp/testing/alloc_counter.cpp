@@ -0,0 +1,139 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Только тривиальные thread_local: их инициализация сама не выделяет память
+thread_local uint32_t active_scopes = 0;
+thread_local uint64_t allocation_count = 0;
+thread_local uint64_t allocation_bytes = 0;
+
+void CountAllocation(std::size_t size)
+{
+    if (active_scopes != 0) {
+        ++allocation_count;
+        allocation_bytes += size;
+    }
+}
+
+void *Allocate(std::size_t size)
+{
+    CountAllocation(size);
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *AllocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    CountAllocation(size);
+    const auto align = static_cast<std::size_t>(alignment);
+    // aligned_alloc требует размер, кратный выравниванию
+    const std::size_t rounded = (size + align - 1) / align * align;
+    if (void *ptr = std::aligned_alloc(align, rounded ? rounded : align))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+}  // namespace
+
+namespace iot::backend::proto::testing {
+
+AllocationScope::AllocationScope()
+{
+    start_ = AllocationStats{allocation_count, allocation_bytes};
+    ++active_scopes;
+}
+
+AllocationScope::~AllocationScope()
+{
+    --active_scopes;
+}
+
+AllocationStats AllocationScope::Get() const
+{
+    return AllocationStats{allocation_count - start_.count,
+                           allocation_bytes - start_.bytes};
+}
+
+}  // namespace iot::backend::proto::testing
+
+void *operator new(std::size_t size)
+{
+    return Allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return Allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return Allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return Allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return AllocateAligned(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
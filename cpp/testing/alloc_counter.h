@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace iot::backend::proto::testing {
+
+/// Количество и суммарный размер выделений памяти
+struct AllocationStats {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+/// Считает выделения памяти через operator new (все его формы: массивы,
+/// выровненные, nothrow), сделанные текущим потоком, пока объект жив.
+/// Области можно вкладывать друг в друга.
+///
+/// Библиотека подменяет глобальные operator new/delete, поэтому подключать её
+/// стоит только в тестах и бенчмарках. Прямые вызовы malloc не считаются:
+/// protobuf и стандартная библиотека выделяют память через operator new.
+class AllocationScope {
+  public:
+    AllocationScope();
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+
+    /// Выделения с момента создания объекта
+    [[nodiscard]] AllocationStats Get() const;
+
+  private:
+    AllocationStats start_;
+};
+
+/// Выделения памяти, сделанные при вызове func
+template <class Func>
+AllocationStats CountAllocations(Func &&func)
+{
+    AllocationScope scope;
+    std::forward<Func>(func)();
+    return scope.Get();
+}
+
+}  // namespace iot::backend::proto::testing
@@ -0,0 +1,146 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/packet_pool.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+#include "iot_scale/cpp/testing/alloc_counter.h"
+
+#include <array>
+#include <span>
+
+/*
+ * Бюджеты на выделения памяти в горячих путях.
+ *
+ * Абсолютные бюджеты ставим только там, где они не зависят от версии
+ * protobuf (ноль для валидаторов и сериализации в готовый буфер).
+ * Для разбора и сериализации проверяем накладные расходы наших обёрток
+ * относительно прямого вызова protobuf: лишняя копия входной строки
+ * (например, TProtoStringType(json_string) в JsonToProtoPacket) ломает тест.
+ */
+
+using iot::backend::proto::testing::CountAllocations;
+
+namespace {
+
+using DataType = iot::backend::proto::ProtocolConverter::TransportDataType;
+
+const std::string kTelemetryJson =
+    R"({"version":16777216,"timestamp":"1707425629","telemetry":{"payload":{"batteryLevel":87,"speedKmh":14.5,"voltage":373,"gsmSignalLevel":70,"locked":false,"sensors":{"imei":"869492042841493","Tyre pressure":"2"}}}})";
+
+iot::backend::proto::Packet MakeTelemetry()
+{
+    return iot::backend::proto::ProtocolConverter(DataType::JSON).Deserialize(kTelemetryJson);
+}
+
+iot::backend::proto::Packet MakeSetParams()
+{
+    auto packet = iot::backend::proto::helpers::MakeCommand(
+        std::chrono::seconds(300), "856ccfc0-8c02-4f6b-a6f6-376b4871f246");
+    (*packet.mutable_command()->mutable_payload()->mutable_set_params()->mutable_params())["vehicle_lock"] = "locked";
+    return packet;
+}
+
+iot::backend::proto::Packet MakeResult()
+{
+    return iot::backend::proto::helpers::MakeCommandResultSuccess(
+        "856ccfc0-8c02-4f6b-a6f6-376b4871f246", std::nullopt, 1, 35);
+}
+
+}  // namespace
+
+TEST(BikeIotProto_Allocations, CounterWorks) {
+    static std::array<char, 100> *volatile sink = nullptr;
+    const auto stats = CountAllocations([]() {
+        sink = new std::array<char, 100>();
+        delete sink;
+    });
+    EXPECT_EQ(stats.count, 1u);
+    EXPECT_GE(stats.bytes, 100u);
+}
+
+TEST(BikeIotProto_Allocations, ValidationAllocatesNothing) {
+    using namespace iot::backend::proto;
+
+    for (const auto& packet : {MakeTelemetry(), MakeSetParams(), MakeResult()}) {
+        ASSERT_TRUE(IsValid(packet));
+        EXPECT_EQ(CountAllocations([&]() { IsValid(packet); }).count, 0u)
+            << ProtocolConverter::ToString(packet);
+        EXPECT_EQ(CountAllocations([&]() { IsExpired(packet); }).count, 0u);
+    }
+}
+
+TEST(BikeIotProto_Allocations, SerializeToReusedBufferAllocatesNothing) {
+    using namespace iot::backend::proto;
+    const auto packet = MakeTelemetry();
+
+    for (const auto type : {DataType::BINARY, DataType::JSON}) {
+        const ProtocolConverter converter(type);
+
+        std::string buffer;
+        buffer.reserve(1024);
+        EXPECT_EQ(CountAllocations([&]() { converter.SerializeTo(packet, buffer); }).count, 0u);
+
+        std::array<char, 1024> fixed;
+        EXPECT_EQ(CountAllocations([&]() { (void)converter.SerializeTo(packet, std::span<char>(fixed)); }).count, 0u);
+
+        // The result string is the only allocation
+        EXPECT_EQ(CountAllocations([&]() { (void)converter.Serialize(packet); }).count, 1u);
+    }
+}
+
+TEST(BikeIotProto_Allocations, BinaryDeserializeOverhead) {
+    using namespace iot::backend::proto;
+    const ProtocolConverter converter(DataType::BINARY);
+    const auto encoded = converter.Serialize(MakeTelemetry());
+    const auto binary = helpers::FromBase64(encoded);
+
+    const auto raw = CountAllocations([&]() {
+        Packet packet;
+        EXPECT_TRUE(packet.ParseFromArray(binary.data(), static_cast<int>(binary.size())));
+    });
+    const auto decode = CountAllocations([&]() { (void)helpers::FromBase64(encoded); });
+    // Base64 decoding is the only extra cost over plain protobuf parsing
+    EXPECT_LE(CountAllocations([&]() { (void)converter.Deserialize(encoded); }).count,
+              raw.count + decode.count);
+
+    Packet target;
+    EXPECT_LE(CountAllocations([&]() { helpers::BinaryToProtoPacket(binary, target); }).count, raw.count);
+}
+
+TEST(BikeIotProto_Allocations, JsonConversionOverhead) {
+    using namespace iot::backend::proto;
+    const auto packet = MakeTelemetry();
+
+    // Warm up protobuf's lazily built type resolver
+    (void)helpers::ProtoPacketToJson(packet);
+    (void)helpers::JsonToProtoPacket<Packet>(kTelemetryJson);
+
+    const auto raw_parse = CountAllocations([&]() {
+        Packet parsed;
+        EXPECT_TRUE(google::protobuf::util::JsonStringToMessage(kTelemetryJson, &parsed).ok());
+    });
+    EXPECT_LE(CountAllocations([&]() { (void)helpers::JsonToProtoPacket<Packet>(kTelemetryJson); }).count,
+              raw_parse.count);
+
+    const auto raw_print = CountAllocations([&]() {
+        TProtoStringType json;
+        EXPECT_TRUE(google::protobuf::util::MessageToJsonString(packet, &json).ok());
+    });
+    EXPECT_LE(CountAllocations([&]() { (void)helpers::ProtoPacketToJson(packet); }).count,
+              raw_print.count);
+}
+
+TEST(BikeIotProto_Allocations, PooledBuildersReuseMemory) {
+    using namespace iot::backend::proto;
+
+    // Warm up the pool of this thread
+    PacketPool::Acquire().Reset();
+
+    const auto by_value = CountAllocations([]() { (void)MakeResult(); });
+    const auto pooled = CountAllocations([]() {
+        auto packet = PacketPool::Acquire();
+        helpers::MakeCommandResultSuccess(*packet, "856ccfc0-8c02-4f6b-a6f6-376b4871f246", std::nullopt, 1, 35);
+    });
+    EXPECT_LT(pooled.count, by_value.count);
+}
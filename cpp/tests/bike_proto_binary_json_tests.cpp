@@ -0,0 +1,104 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/binary_json.h"
+#include "iot_scale/cpp/src/helpers.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using iot::backend::proto::Packet;
+
+std::string ToJson(const Packet& packet)
+{
+    const auto binary = packet.SerializeAsString();
+    std::string json(iot::backend::proto::BinaryToJson(*Packet::descriptor(), binary, {}), '\0');
+    EXPECT_EQ(iot::backend::proto::BinaryToJson(*Packet::descriptor(), binary, json), json.size());
+    return json;
+}
+
+std::vector<Packet> MakePackets()
+{
+    std::vector<Packet> packets(1);
+
+    Packet telemetry;
+    telemetry.set_version(0x1000000);
+    telemetry.set_timestamp(1707425629);
+    auto& payload = *telemetry.mutable_telemetry()->mutable_payload();
+    payload.set_battery_level(0);
+    payload.set_speed_kmh(14.5f);
+    payload.set_charging(false);
+    payload.mutable_location()->set_lat(55.7558f);
+    payload.mutable_location()->set_lon(-37.6173f);
+    payload.mutable_location()->set_hdop(0.1f);
+    payload.mutable_location()->set_utc_time_ms(std::numeric_limits<uint64_t>::max());
+    (*payload.mutable_sensors())["imei"] = "869492042841493";
+    (*payload.mutable_sensors())["Tyre pressure"] = "2";
+    (*payload.mutable_sensors())[""] = "";
+    packets.push_back(telemetry);
+
+    for (const float special : {std::nanf(""), std::numeric_limits<float>::infinity(), -0.0f, 1e-30f, 3e38f}) {
+        Packet packet;
+        packet.mutable_telemetry()->mutable_payload()->set_speed_kmh(special);
+        packets.push_back(packet);
+    }
+
+    // Экранирование: кавычки, управляющие символы, HTML, невидимые символы
+    // Unicode, суррогатные пары и недопустимый UTF-8
+    for (const std::string chain_id : {"\"quoted\" \\ <a&b>", "\t\n\x01\x7f", "\xc2\xad \xe2\x80\xa8 \xef\xbb\xbf",
+                                       "\xf0\x9d\x85\xb3 \xf0\x9f\x9a\xb2 кириллица", "bad \xff\xc3 \xed\xa0\x80 \xe2\x82"}) {
+        packets.push_back(iot::backend::proto::helpers::MakeCommandResultSuccess(chain_id, chain_id, 1, -35));
+    }
+
+    auto command = iot::backend::proto::helpers::MakeCommand(std::chrono::seconds(300), "chain");
+    auto& configure = *command.mutable_command()->mutable_payload()->mutable_configure();
+    configure.set_state_name("state_riding");
+    (*(*configure.mutable_states())["state_riding"].mutable_state_params())["dashboard_color"] = "white";
+    (*configure.mutable_states())["state_empty"];
+    packets.push_back(command);
+
+    Packet get_params;
+    auto& params = *get_params.mutable_command()->mutable_payload()->mutable_get_params();
+    params.add_param("speed_limit");
+    params.add_param("");
+    params.add_param("vehicle_lock");
+    packets.push_back(get_params);
+
+    // Неизвестное значение enum пишется числом
+    for (const int result : {42, -1}) {
+        Packet packet;
+        packet.mutable_command_result()->set_result(static_cast<iot::backend::proto::ResultCode>(result));
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_BinaryJson, MatchesMessageToJsonString) {
+    for (const auto& packet : MakePackets()) {
+        std::string expected;
+        ASSERT_TRUE(google::protobuf::util::MessageToJsonString(packet, &expected).ok());
+        EXPECT_EQ(ToJson(packet), expected);
+    }
+}
+
+TEST(BikeIotProto_BinaryJson, SkipsUnknownFields) {
+    Packet packet;
+    packet.set_version(7);
+    auto binary = packet.SerializeAsString();
+    // Поле 1000 типа varint и поле 1001 длиной 3 байта
+    binary += std::string("\xc0\x3e\x05\xca\x3e\x03" "abc", 9);
+    const std::string_view view(binary);
+    std::string            json(iot::backend::proto::BinaryToJson(*Packet::descriptor(), view, {}), '\0');
+    iot::backend::proto::BinaryToJson(*Packet::descriptor(), view, json);
+    EXPECT_EQ(json, R"({"version":7})");
+}
+
+TEST(BikeIotProto_BinaryJson, ThrowsOnMalformedBinary) {
+    const auto binary = MakePackets()[1].SerializeAsString();
+    EXPECT_THROW((void)iot::backend::proto::BinaryToJson(*Packet::descriptor(), std::string_view(binary).substr(0, binary.size() - 1), {}),
+                 std::invalid_argument);
+}
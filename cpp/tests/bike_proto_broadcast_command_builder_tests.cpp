@@ -0,0 +1,98 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/broadcast_command_builder.h"
+
+#include <google/protobuf/util/message_differencer.h>
+
+namespace {
+
+using DataType = iot::backend::proto::ProtocolConverter::TransportDataType;
+
+iot::backend::proto::CommandPayload MakeSetParamsPayload()
+{
+    iot::backend::proto::CommandPayload payload;
+    (*payload.mutable_set_params()->mutable_params())["vehicle_lock"] = "locked";
+    return payload;
+}
+
+iot::backend::proto::CommandPayload MakeConfigurePayload()
+{
+    iot::backend::proto::CommandPayload payload;
+    auto* configure = payload.mutable_configure();
+    configure->set_state_name("state_riding");
+    (*(*configure->mutable_states())["state_riding"].mutable_state_params())["dashboard_color"] = "white";
+    return payload;
+}
+
+std::string SerializeRegular(DataType type, const iot::backend::proto::CommandPayload& payload,
+                             std::optional<std::chrono::seconds> valid_period_s,
+                             const std::string& chain_id, uint64_t timestamp)
+{
+    iot::backend::proto::Packet packet;
+    packet.set_version(0x10000);
+    packet.set_timestamp(timestamp);
+    if (valid_period_s)
+        packet.set_valid_until(timestamp + valid_period_s->count());
+    packet.mutable_command()->set_chain_id(chain_id);
+    *packet.mutable_command()->mutable_payload() = payload;
+    return iot::backend::proto::ProtocolConverter(type).Serialize(packet);
+}
+
+}  // namespace
+
+class BroadcastCommandBuilderFixture
+        : public ::testing::TestWithParam<std::tuple<DataType, iot::backend::proto::CommandPayload, std::optional<std::chrono::seconds>>> {};
+
+TEST_P(BroadcastCommandBuilderFixture, ByteIdenticalToRegularPath) {
+    const auto& [type, payload, valid_period_s] = GetParam();
+    iot::backend::proto::BroadcastCommandBuilder builder(type, payload, valid_period_s);
+
+    for (const std::string& chain_id : {iot::backend::proto::helpers::GenerateChainId(), std::string("with \"quotes\" <&>"), std::string(),
+                                     std::string("ab"), std::string(300, 'c')}) {
+        for (const uint64_t timestamp : {uint64_t(1677599130), uint64_t(0), uint64_t(1) << 40}) {
+            EXPECT_EQ(builder.Build(chain_id, timestamp),
+                      SerializeRegular(type, payload, valid_period_s, chain_id, timestamp))
+                << "chain_id: '" << chain_id << "', timestamp: " << timestamp;
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        Broadcast, BroadcastCommandBuilderFixture,
+        testing::Combine(
+            testing::Values(DataType::JSON, DataType::BINARY),
+            testing::Values(MakeSetParamsPayload(), MakeConfigurePayload(), iot::backend::proto::CommandPayload()),
+            testing::Values(std::optional<std::chrono::seconds>(), std::optional<std::chrono::seconds>(300))));
+
+TEST(BikeIotProto_BroadcastCommandBuilder, MultiKeyMap) {
+    // Binary order of map entries is unspecified, so compare decoded packets
+    iot::backend::proto::CommandPayload payload;
+    auto& params = *payload.mutable_set_params()->mutable_params();
+    for (int i = 0; i < 20; ++i)
+        params["param_" + std::to_string(i)] = std::to_string(i);
+
+    for (const auto type : {DataType::JSON, DataType::BINARY}) {
+        iot::backend::proto::BroadcastCommandBuilder builder(type, payload, std::chrono::seconds(300));
+        const iot::backend::proto::ProtocolConverter converter(type);
+        const auto expected = SerializeRegular(type, payload, std::chrono::seconds(300), "chain", 1677599130);
+        EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
+            converter.Deserialize(builder.Build("chain", 1677599130)), converter.Deserialize(expected)));
+        EXPECT_EQ(builder.Build("chain", 1677599130), builder.Build("chain", 1677599130));
+    }
+}
+
+TEST(BikeIotProto_BroadcastCommandBuilder, BuildForFleet) {
+    using namespace std::literals::chrono_literals;
+    iot::backend::proto::BroadcastCommandBuilder builder(DataType::JSON, MakeSetParamsPayload(), 300s);
+    const iot::backend::proto::ProtocolConverter converter(DataType::JSON);
+
+    const std::vector<std::string> devices(100, "bike");
+    const auto messages = builder.BuildForFleet(devices, 4);
+    ASSERT_EQ(messages.size(), devices.size());
+    for (const auto& message : messages) {
+        const auto packet = converter.Deserialize(message.data);
+        EXPECT_EQ(packet.command().chain_id(), message.chain_id);
+        EXPECT_EQ(packet.valid_until() - packet.timestamp(), 300u);
+    }
+    EXPECT_NE(messages.front().chain_id, messages.back().chain_id);
+}
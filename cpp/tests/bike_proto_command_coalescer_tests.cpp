@@ -0,0 +1,127 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/command_coalescer.h"
+
+using namespace std::literals::chrono_literals;
+
+namespace {
+
+iot::backend::proto::Packet MakeSetParams(const char* chain_id, const char* name, const char* value)
+{
+    auto packet = iot::backend::proto::helpers::MakeCommand(300s, chain_id);
+    (*packet.mutable_command()->mutable_payload()->mutable_set_params()->mutable_params())[name] = value;
+    return packet;
+}
+
+iot::backend::proto::Packet MakeGetParams(const char* chain_id, std::initializer_list<const char*> names)
+{
+    auto packet = iot::backend::proto::helpers::MakeCommand(300s, chain_id);
+    auto* get_params = packet.mutable_command()->mutable_payload()->mutable_get_params();
+    for (const auto* name : names)
+        get_params->add_param(name);
+    return packet;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_CommandCoalescer, SetParamsLastWriteWins) {
+    iot::backend::proto::CommandCoalescer coalescer(100ms);
+    coalescer.Add("bike1", MakeSetParams("c1", "vehicle_lock", "locked"), 1000);
+    coalescer.Add("bike1", MakeSetParams("c2", "speed_limit", "25"), 1050);
+    coalescer.Add("bike1", MakeSetParams("c3", "vehicle_lock", "unlocked"), 1080);
+
+    EXPECT_TRUE(coalescer.Flush(1099).empty());
+    const auto commands = coalescer.Flush(1100);
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_EQ(commands[0].device_id, "bike1");
+    EXPECT_EQ(commands[0].source_chain_ids, (std::vector<std::string>{"c1", "c2", "c3"}));
+
+    const auto& params = commands[0].packet.command().payload().set_params().params();
+    ASSERT_EQ(params.size(), 2u);
+    EXPECT_EQ(params.at("vehicle_lock"), "unlocked");
+    EXPECT_EQ(params.at("speed_limit"), "25");
+    EXPECT_TRUE(commands[0].packet.has_valid_until());
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 1u);
+}
+
+TEST(BikeIotProto_CommandCoalescer, SingleCommandKeepsChainId) {
+    iot::backend::proto::CommandCoalescer coalescer(100ms);
+    coalescer.Add("bike1", MakeGetParams("c1", {"imei"}), 1000);
+    const auto commands = coalescer.FlushAll();
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_EQ(commands[0].packet.command().chain_id(), "c1");
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 0u);
+}
+
+TEST(BikeIotProto_CommandCoalescer, OtherKindFlushesPendingFirst) {
+    iot::backend::proto::CommandCoalescer coalescer(100ms);
+    coalescer.Add("bike1", MakeSetParams("c1", "vehicle_lock", "locked"), 1000);
+    coalescer.Add("bike1", MakeGetParams("c2", {"vehicle_lock"}), 1001);
+
+    const auto commands = coalescer.Flush(1002);
+    ASSERT_EQ(commands.size(), 1u);
+    EXPECT_EQ(commands[0].packet.command().chain_id(), "c1");
+    EXPECT_EQ(coalescer.PendingCount(), 1u);
+}
+
+TEST(BikeIotProto_CommandCoalescer, FanOutGetParams) {
+    using namespace iot::backend::proto;
+
+    CommandCoalescer coalescer(100ms);
+    coalescer.Add("bike1", MakeGetParams("c1", {"imei", "iot_fw"}), 1000);
+    coalescer.Add("bike1", MakeGetParams("c2", {"imei", "mileage"}), 1010);
+    const auto commands = coalescer.FlushAll();
+    ASSERT_EQ(commands.size(), 1u);
+    ASSERT_EQ(commands[0].packet.command().payload().get_params().param_size(), 3);
+
+    auto result = helpers::MakeCommandResultSuccess(
+        commands[0].packet.command().chain_id(), std::nullopt, 1, 20);
+    auto* values = result.mutable_command_result()->mutable_payload()->mutable_get_params()->mutable_values();
+    (*values)["imei"] = "869492042841493";
+    (*values)["iot_fw"] = "1.2.3";
+    (*values)["mileage"] = "42";
+
+    const auto results = coalescer.FanOut(result);
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].command_result().chain_id(), "c1");
+    EXPECT_EQ(results[0].command_result().payload().get_params().values().size(), 2u);
+    EXPECT_EQ(results[0].command_result().payload().get_params().values().count("mileage"), 0u);
+    EXPECT_EQ(results[1].command_result().chain_id(), "c2");
+    EXPECT_EQ(results[1].command_result().payload().get_params().values().count("iot_fw"), 0u);
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 0u);
+
+    // Unknown chain id goes through untouched
+    EXPECT_EQ(coalescer.FanOut(result).size(), 1u);
+}
+
+TEST(BikeIotProto_CommandCoalescer, NonCommandThrows) {
+    iot::backend::proto::CommandCoalescer coalescer(100ms);
+    EXPECT_THROW(coalescer.Add("bike1", iot::backend::proto::helpers::MakePacket()), std::invalid_argument);
+}
+
+TEST(BikeIotProto_CommandCoalescer, ForgetsAwaitingWithoutResult) {
+    using namespace iot::backend::proto;
+
+    CommandCoalescer coalescer(100ms, 60s);
+    auto             first = MakeSetParams("c1", "vehicle_lock", "locked");
+    first.clear_valid_until();
+    auto second = MakeSetParams("c2", "speed_limit", "25");
+    second.clear_valid_until();
+    coalescer.Add("bike1", first, 1000000);
+    coalescer.Add("bike1", second, 1000010);
+    coalescer.Add("bike2", MakeGetParams("c3", {"imei"}), 1000000);
+    coalescer.Add("bike2", MakeGetParams("c4", {"iot_fw"}), 1000010);
+    ASSERT_EQ(coalescer.FlushAll().size(), 2u);
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 2u);
+
+    // Без valid_until команда ждёт результата не дольше max_awaiting
+    coalescer.DropExpired(1000 + 60);
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 2u);
+    coalescer.DropExpired(1000 + 61);
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 1u);
+
+    coalescer.Forget("bike1");
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 1u);
+    coalescer.Forget("bike2");
+    EXPECT_EQ(coalescer.AwaitingResultCount(), 0u);
+}
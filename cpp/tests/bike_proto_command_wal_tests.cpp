@@ -0,0 +1,145 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/command_wal.h"
+
+#include <filesystem>
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+constexpr uint64_t kNowS = 1700000000;
+
+Packet MakeSetState(const std::string &chain_id, const char *state, std::optional<uint64_t> valid_until = {})
+{
+    Packet packet;
+    packet.set_version(0x00010000);
+    packet.set_timestamp(kNowS);
+    if (valid_until)
+        packet.set_valid_until(*valid_until);
+    packet.mutable_command()->set_chain_id(chain_id);
+    packet.mutable_command()->mutable_payload()->mutable_set_state()->set_state(state);
+    return packet;
+}
+
+CommandWalOptions MakeOptions(const std::string &name, size_t segment_bytes = 64 << 20)
+{
+    CommandWalOptions options;
+    options.directory = ::testing::TempDir() + name;
+    options.segment_bytes = segment_bytes;
+    std::filesystem::remove_all(options.directory);
+    return options;
+}
+
+size_t CountFiles(const std::string &directory)
+{
+    return std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator());
+}
+
+}  // namespace
+
+TEST(BikeIotProto_CommandWal, RecoversPendingCommands) {
+    const auto options = MakeOptions("bike_proto_wal_recover");
+    {
+        CommandWal wal(options);
+        wal.Append("bike1", MakeSetState("c1", "locked"));
+        wal.Append("bike2", MakeSetState("c2", "unlocked", kNowS + 300));
+        wal.Append("bike1", MakeSetState("c3", "unlocked", kNowS - 1));
+        wal.Append("bike3", MakeSetState("c4", "locked", kNowS + 300));
+        Packet result;
+        result.mutable_command_result()->set_chain_id("c4");
+        EXPECT_TRUE(wal.Acknowledge(result.command_result()));
+        EXPECT_FALSE(wal.Acknowledge("c4"));
+        EXPECT_EQ(wal.GetPendingCount(), 3u);
+        EXPECT_TRUE(wal.TakeRecovered(kNowS).empty());
+        EXPECT_THROW(wal.Append("bike1", Packet()), std::invalid_argument);
+    }
+
+    CommandWal wal(options);
+    EXPECT_EQ(wal.GetPendingCount(), 3u);
+    // c3 просрочена, c4 подтверждена
+    const auto recovered = wal.TakeRecovered(kNowS);
+    ASSERT_EQ(recovered.size(), 2u);
+    EXPECT_EQ(recovered[0].device_id, "bike1");
+    EXPECT_EQ(recovered[0].packet.command().chain_id(), "c1");
+    EXPECT_EQ(recovered[0].packet.command().payload().set_state().state(), "locked");
+    EXPECT_EQ(recovered[1].device_id, "bike2");
+    EXPECT_EQ(recovered[1].packet.valid_until(), kNowS + 300);
+    EXPECT_EQ(wal.GetPendingCount(), 2u);
+    EXPECT_TRUE(wal.TakeRecovered(kNowS).empty());
+
+    wal.DropExpired(kNowS + 301);
+    EXPECT_EQ(wal.GetPendingCount(), 1u);
+    EXPECT_TRUE(wal.Acknowledge("c1"));
+    EXPECT_EQ(wal.GetPendingCount(), 0u);
+}
+
+TEST(BikeIotProto_CommandWal, AcknowledgedSegmentsAreRemoved) {
+    const auto options = MakeOptions("bike_proto_wal_segments", 128);
+    CommandWal wal(options);
+    for (size_t i = 0; i < 20; ++i)
+        wal.Append("bike" + std::to_string(i), MakeSetState("c" + std::to_string(i), "locked"));
+    EXPECT_GT(wal.GetSegmentCount(), 4u);
+    EXPECT_EQ(CountFiles(options.directory), wal.GetSegmentCount());
+
+    // Сегменты удаляются только с начала журнала
+    wal.Acknowledge("c19");
+    const size_t segments = wal.GetSegmentCount();
+    for (size_t i = 0; i < 10; ++i)
+        wal.Acknowledge("c" + std::to_string(i));
+    EXPECT_LT(wal.GetSegmentCount(), segments);
+    for (size_t i = 10; i < 19; ++i)
+        wal.Acknowledge("c" + std::to_string(i));
+    EXPECT_EQ(wal.GetSegmentCount(), 1u);
+    // Текущий сегмент, если подтверждения уже дошли до write
+    EXPECT_LE(CountFiles(options.directory), 1u);
+}
+
+TEST(BikeIotProto_CommandWal, TornTailIsIgnored) {
+    const auto options = MakeOptions("bike_proto_wal_torn");
+    {
+        CommandWal wal(options);
+        wal.Append("bike1", MakeSetState("c1", "locked"));
+        wal.Append("bike2", MakeSetState("c2", "locked"));
+    }
+    // Обрываем последнюю запись, как при падении посреди write
+    const auto segment = std::filesystem::directory_iterator(options.directory)->path();
+    std::filesystem::resize_file(segment, std::filesystem::file_size(segment) - 3);
+
+    {
+        CommandWal wal(options);
+        const auto recovered = wal.TakeRecovered(kNowS);
+        ASSERT_EQ(recovered.size(), 1u);
+        EXPECT_EQ(recovered[0].packet.command().chain_id(), "c1");
+        wal.Append("bike3", MakeSetState("c3", "locked"));
+    }
+    CommandWal wal(options);
+    const auto recovered = wal.TakeRecovered(kNowS);
+    ASSERT_EQ(recovered.size(), 2u);
+    EXPECT_EQ(recovered[1].packet.command().chain_id(), "c3");
+}
+
+TEST(BikeIotProto_CommandWal, ConcurrentAppendsShareSyncs) {
+    constexpr size_t kThreads = 4;
+    constexpr size_t kCommands = 50;
+    const auto       options = MakeOptions("bike_proto_wal_group");
+    {
+        CommandWal               wal(options);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = 0; i < kCommands; ++i) {
+                    const auto id = std::to_string(t * kCommands + i);
+                    wal.Append("bike" + id, MakeSetState("c" + id, "locked"));
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        EXPECT_EQ(wal.GetPendingCount(), kThreads * kCommands);
+        EXPECT_LE(wal.GetSyncCount(), kThreads * kCommands);
+    }
+    CommandWal wal(options);
+    EXPECT_EQ(wal.TakeRecovered(kNowS).size(), kThreads * kCommands);
+}
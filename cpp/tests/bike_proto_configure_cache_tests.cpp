@@ -0,0 +1,121 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/configure_cache.h"
+
+namespace {
+
+iot::backend::proto::CmdConfigure MakeConfigure(const char* speed_limit)
+{
+    iot::backend::proto::CmdConfigure configure;
+    configure.set_state_name("state_riding");
+    auto& riding = *(*configure.mutable_states())["state_riding"].mutable_state_params();
+    riding["engine_lock"] = "disable";
+    riding["speed_limit"] = speed_limit;
+    auto& service = *(*configure.mutable_states())["state_service"].mutable_state_params();
+    service["engine_lock"] = "disable";
+    service["speed_limit"] = "5";
+    return configure;
+}
+
+iot::backend::proto::CommandResult MakeResult(const char* chain_id, iot::backend::proto::ResultCode code)
+{
+    iot::backend::proto::CommandResult result;
+    result.set_chain_id(chain_id);
+    result.set_result(code);
+    return result;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_ConfigureCache, HashIgnoresInsertionOrder) {
+    using namespace iot::backend::proto;
+
+    CmdConfigure lhs;
+    (*(*lhs.mutable_states())["a"].mutable_state_params())["x"] = "1";
+    (*(*lhs.mutable_states())["a"].mutable_state_params())["y"] = "2";
+    (*lhs.mutable_states())["b"];
+
+    CmdConfigure rhs;
+    (*rhs.mutable_states())["b"];
+    (*(*rhs.mutable_states())["a"].mutable_state_params())["y"] = "2";
+    (*(*rhs.mutable_states())["a"].mutable_state_params())["x"] = "1";
+
+    EXPECT_EQ(HashConfigure(lhs), HashConfigure(rhs));
+    (*(*rhs.mutable_states())["a"].mutable_state_params())["x"] = "3";
+    EXPECT_NE(HashConfigure(lhs), HashConfigure(rhs));
+}
+
+TEST(BikeIotProto_ConfigureCache, Plan) {
+    using namespace iot::backend::proto;
+    using Action = ConfigureCache::Plan::Action;
+
+    ConfigureCache cache;
+    const auto initial = MakeConfigure("25");
+    EXPECT_EQ(cache.MakePlan("bike1", initial).action, Action::FULL);
+
+    cache.MarkSent("c1", "bike1", initial);
+    EXPECT_FALSE(cache.OnCommandResult(MakeResult("c1", RESULT_FAILED)));
+    EXPECT_FALSE(cache.GetAcknowledgedHash("bike1").has_value());
+
+    cache.MarkSent("c2", "bike1", initial);
+    EXPECT_TRUE(cache.OnCommandResult(MakeResult("c2", RESULT_SUCCESS)));
+    EXPECT_EQ(cache.GetAcknowledgedHash("bike1"), HashConfigure(initial));
+    EXPECT_EQ(cache.MakePlan("bike1", initial).action, Action::SKIP);
+
+    const auto plan = cache.MakePlan("bike1", MakeConfigure("20"));
+    EXPECT_EQ(plan.action, Action::DELTA);
+    ASSERT_EQ(plan.configure.states_size(), 1);
+    EXPECT_EQ(plan.configure.states().at("state_riding").state_params().at("speed_limit"), "20");
+    EXPECT_TRUE(plan.configure.state_name().empty());
+
+    auto reduced = initial;
+    reduced.mutable_states()->erase("state_service");
+    EXPECT_EQ(cache.MakePlan("bike1", reduced).action, Action::FULL);
+}
+
+TEST(BikeIotProto_ConfigureCache, SharedStorage) {
+    using namespace iot::backend::proto;
+
+    ConfigureCache cache;
+    for (int i = 0; i < 100; ++i)
+        cache.SetAcknowledged("bike" + std::to_string(i), MakeConfigure("25"));
+    EXPECT_EQ(cache.UniqueConfigCount(), 1u);
+
+    cache.SetAcknowledged("bike0", MakeConfigure("20"));
+    EXPECT_EQ(cache.UniqueConfigCount(), 2u);
+}
+
+TEST(BikeIotProto_ConfigureCache, DropsUnansweredCommands) {
+    using namespace iot::backend::proto;
+    using namespace std::literals::chrono_literals;
+
+    ConfigureCache cache(60s);
+    cache.MarkSent("c1", "bike1", MakeConfigure("25"), std::nullopt, 1000);
+    cache.MarkSent("c2", "bike2", MakeConfigure("20"), 2000, 1000);
+    cache.MarkSent("c3", "bike3", MakeConfigure("15"), std::nullopt, 1000);
+    EXPECT_EQ(cache.UniqueConfigCount(), 3u);
+
+    // Без valid_until - через max_sent, с ним - по valid_until
+    cache.DropExpired(1061);
+    EXPECT_FALSE(cache.OnCommandResult(MakeResult("c1", RESULT_SUCCESS)));
+    EXPECT_EQ(cache.UniqueConfigCount(), 1u);
+
+    cache.Forget("bike2");
+    EXPECT_FALSE(cache.OnCommandResult(MakeResult("c2", RESULT_SUCCESS)));
+    EXPECT_EQ(cache.UniqueConfigCount(), 0u);
+    EXPECT_FALSE(cache.GetAcknowledgedHash("bike2").has_value());
+}
+
+TEST(BikeIotProto_ConfigureCache, StoreDoesNotGrow) {
+    using namespace iot::backend::proto;
+
+    // Каждая конфигурация подтверждается одним устройством и тут же
+    // заменяется следующей: освободившиеся слоты не копятся
+    ConfigureCache cache;
+    for (int i = 0; i < 10000; ++i)
+        cache.SetAcknowledged("bike1", MakeConfigure(std::to_string(i).c_str()));
+    EXPECT_EQ(cache.UniqueConfigCount(), 1u);
+    EXPECT_LE(cache.StoreSlotCount(), 128u);
+    cache.DropExpired();
+    EXPECT_EQ(cache.StoreSlotCount(), 1u);
+}
@@ -0,0 +1,147 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/device_id_filter.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+std::string MakeId(size_t i)
+{
+    return std::to_string(860000000000000ULL + i);
+}
+
+}  // namespace
+
+TEST(BikeIotProto_DeviceIdFilter, NoFalseNegativesAndRareFalsePositives) {
+    constexpr size_t kIds = 100000;
+    DeviceIdFilter   filter(kIds);
+    for (size_t i = 0; i < kIds; ++i)
+        ASSERT_TRUE(filter.Insert(MakeId(i))) << i;
+    EXPECT_EQ(filter.GetSize(), kIds);
+    EXPECT_EQ(filter.GetMemoryBytes(), filter.GetBucketCount() * 8);
+
+    for (size_t i = 0; i < kIds; ++i)
+        ASSERT_TRUE(filter.MayContain(MakeId(i))) << i;
+
+    size_t false_positives = 0;
+    for (size_t i = kIds; i < 2 * kIds; ++i)
+        false_positives += filter.MayContain(MakeId(i));
+    EXPECT_LT(false_positives, kIds / 1000);
+
+    // Пакетная проверка совпадает с поштучной
+    std::vector<std::string>      ids;
+    std::vector<std::string_view> views;
+    for (size_t i = kIds - 50; i < kIds + 50; ++i)
+        ids.push_back(MakeId(i));
+    views.assign(ids.begin(), ids.end());
+    bool results[100];
+    filter.MayContainBatch(views.data(), views.size(), results);
+    for (size_t i = 0; i < views.size(); ++i)
+        EXPECT_EQ(results[i], filter.MayContain(views[i])) << ids[i];
+}
+
+TEST(BikeIotProto_DeviceIdFilter, RemoveAndOverflow) {
+    DeviceIdFilter filter(1000);
+    for (size_t i = 0; i < 1000; ++i)
+        ASSERT_TRUE(filter.Insert(MakeId(i)));
+    for (size_t i = 0; i < 1000; i += 2)
+        ASSERT_TRUE(filter.Remove(MakeId(i)));
+    EXPECT_EQ(filter.GetSize(), 500u);
+    for (size_t i = 1; i < 1000; i += 2)
+        EXPECT_TRUE(filter.MayContain(MakeId(i)));
+    size_t removed_found = 0;
+    for (size_t i = 0; i < 1000; i += 2)
+        removed_found += filter.MayContain(MakeId(i));
+    EXPECT_LT(removed_found, 5u);
+
+    // Заполнение сверх всех позиций заканчивается отказом, а не порчей
+    DeviceIdFilter small(8);
+    size_t         inserted = 0;
+    while (inserted < 4 * small.GetBucketCount() && small.Insert(MakeId(inserted)))
+        ++inserted;
+    EXPECT_FALSE(small.Insert(MakeId(1000000)));
+    for (size_t i = 0; i < inserted; ++i)
+        EXPECT_TRUE(small.MayContain(MakeId(i)));
+}
+
+TEST(BikeIotProto_DeviceIdFilter, ReadersNeverMissDuringKicks) {
+    // Заполнение ~95%: почти каждая вставка двигает отпечатки по цепочкам
+    constexpr size_t kStable = 3000;
+    DeviceIdFilter   filter(4096);
+    const size_t     slots = 4 * filter.GetBucketCount();
+    for (size_t i = 0; i < kStable; ++i)
+        ASSERT_TRUE(filter.Insert(MakeId(i)));
+
+    std::atomic<bool>   stop{false};
+    std::atomic<size_t> misses{0};
+    std::thread         reader([&]() {
+        while (!stop.load()) {
+            for (size_t i = 0; i < kStable; ++i)
+                misses += !filter.MayContain(MakeId(i));
+        }
+    });
+
+    size_t next = kStable;
+    for (size_t round = 0; round < 200; ++round) {
+        const size_t first = next;
+        while (filter.GetSize() < slots * 95 / 100 && filter.Insert(MakeId(next)))
+            ++next;
+        for (size_t i = first; i < next; ++i)
+            ASSERT_TRUE(filter.Remove(MakeId(i)));
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(misses.load(), 0u);
+    EXPECT_EQ(filter.GetSize(), kStable);
+}
+
+TEST(BikeIotProto_DeviceIdFilter, HolderRebuildKeepsReadersServed) {
+    DeviceIdFilterHolder holder;
+    {
+        rcu::ReadLock lock;
+        EXPECT_FALSE(holder.Get(lock)->MayContain(MakeId(0)));
+    }
+    // Пустой фильтр - одна корзина на 4 отпечатка
+    size_t inserted = 0;
+    while (inserted < 10 && holder.Insert(MakeId(inserted)))
+        ++inserted;
+    EXPECT_EQ(inserted, 4u);
+
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < 10000; ++i)
+        ids.push_back(MakeId(i));
+
+    std::atomic<bool>   stop{false};
+    std::atomic<size_t> misses{0};
+    std::thread         reader([&]() {
+        while (!stop.load()) {
+            // Фильтр держится на пачку проверок и не меняется под читателем
+            rcu::ReadLock lock;
+            const auto   *filter = holder.Get(lock);
+            if (filter->GetSize() < 100)
+                continue;
+            for (size_t i = 0; i < 100; ++i)
+                misses += !filter->MayContain(ids[i]);
+        }
+    });
+    for (size_t round = 0; round < 20; ++round)
+        holder.Rebuild(ids, 2 * ids.size());
+    stop = true;
+    reader.join();
+    EXPECT_EQ(misses.load(), 0u);
+
+    rcu::ReadLock lock;
+    const auto   *filter = holder.Get(lock);
+    EXPECT_EQ(filter->GetSize(), ids.size());
+    EXPECT_TRUE(holder.Insert(MakeId(20000)));
+    EXPECT_TRUE(filter->MayContain(MakeId(20000)));
+    EXPECT_TRUE(holder.Remove(MakeId(20000)));
+    EXPECT_THROW(holder.Rebuild(std::vector<std::string>(100, "same"), 1), std::runtime_error);
+    EXPECT_EQ(holder.Get(lock), filter);
+}
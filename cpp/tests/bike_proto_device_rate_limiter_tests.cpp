@@ -0,0 +1,133 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/device_rate_limiter.h"
+#include "iot_scale/cpp/src/device_topics.h"
+
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+constexpr uint64_t kNowMs = 1700000000000;
+
+DeviceRateLimiterOptions MakeOptions(size_t max_devices = 1024)
+{
+    DeviceRateLimiterOptions options;
+    options.limits.push_back({Packet::kTelemetry, 3, 1});
+    options.limits.push_back({Packet::kCommandResult, 2, 0.5});
+    options.max_devices = max_devices;
+    return options;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_DeviceRateLimiter, PeeksPacketType) {
+    Packet packet;
+    packet.set_version(0x00010000);
+    packet.set_timestamp(1700000000);
+    packet.set_valid_until(1700000300);
+    EXPECT_EQ(PeekPacketType(packet.SerializeAsString()), Packet::WHAT_NOT_SET);
+    packet.mutable_telemetry()->mutable_payload()->set_battery_level(50);
+    EXPECT_EQ(PeekPacketType(packet.SerializeAsString()), Packet::kTelemetry);
+    packet.mutable_command_result()->set_chain_id("c1");
+    EXPECT_EQ(PeekPacketType(packet.SerializeAsString()), Packet::kCommandResult);
+
+    const auto data = packet.SerializeAsString();
+    EXPECT_EQ(PeekPacketType(data.substr(0, 3)), Packet::WHAT_NOT_SET);
+    EXPECT_EQ(PeekPacketType("garbage"), Packet::WHAT_NOT_SET);
+    EXPECT_EQ(PeekPacketType(""), Packet::WHAT_NOT_SET);
+}
+
+TEST(BikeIotProto_DeviceRateLimiter, RefillsBuckets) {
+    DeviceRateLimiter limiter(MakeOptions(), kNowMs);
+    // Запас burst, дальше один пакет в секунду
+    for (size_t i = 0; i < 3; ++i)
+        EXPECT_TRUE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs));
+    EXPECT_FALSE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs));
+    EXPECT_FALSE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 999));
+    EXPECT_TRUE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 1000));
+    EXPECT_FALSE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 1000));
+
+    // Частые отказы не мешают накопить токен при медленном пополнении
+    for (uint64_t ms = 1000; ms < 2000; ms += 10)
+        EXPECT_FALSE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + ms));
+    EXPECT_TRUE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 2000));
+
+    // Корзина не копит больше burst
+    for (size_t i = 0; i < 3; ++i)
+        EXPECT_TRUE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 60000));
+    EXPECT_FALSE(limiter.Admit("bike1", Packet::kTelemetry, kNowMs + 60000));
+    EXPECT_EQ(limiter.GetDroppedCount(Packet::kTelemetry), 104u);
+    EXPECT_EQ(limiter.GetDroppedCount(), 104u);
+}
+
+TEST(BikeIotProto_DeviceRateLimiter, SeparatesDevicesAndTypes) {
+    DeviceRateLimiter limiter(MakeOptions(), kNowMs);
+    const auto        telemetry_topic = MakeDeviceTopic("bike1", DeviceTopicKind::TELEMETRY);
+    Packet            packet;
+    packet.mutable_telemetry();
+    const auto telemetry = packet.SerializeAsString();
+    packet.mutable_command_result()->set_chain_id("c1");
+    const auto result = packet.SerializeAsString();
+    packet.mutable_request();
+    const auto request = packet.SerializeAsString();
+
+    for (size_t i = 0; i < 3; ++i)
+        EXPECT_TRUE(limiter.Admit(telemetry_topic, telemetry, kNowMs));
+    EXPECT_FALSE(limiter.Admit(telemetry_topic, telemetry, kNowMs));
+    EXPECT_TRUE(limiter.Admit("bike2", Packet::kTelemetry, kNowMs));
+
+    const auto status_topic = MakeDeviceTopic("bike1", DeviceTopicKind::STATUS);
+    EXPECT_TRUE(limiter.Admit(status_topic, result, kNowMs));
+    EXPECT_TRUE(limiter.Admit(status_topic, result, kNowMs));
+    EXPECT_FALSE(limiter.Admit(status_topic, result, kNowMs));
+    EXPECT_FALSE(limiter.Admit(status_topic, result, kNowMs + 1999));
+    EXPECT_TRUE(limiter.Admit(status_topic, result, kNowMs + 2000));
+
+    // Типы без лимита и чужие топики не ограничиваются
+    for (size_t i = 0; i < 10; ++i) {
+        EXPECT_TRUE(limiter.Admit(status_topic, request, kNowMs));
+        EXPECT_TRUE(limiter.Admit("$other/topic", telemetry, kNowMs));
+    }
+    EXPECT_EQ(limiter.GetDroppedCount(Packet::kTelemetry), 1u);
+    EXPECT_EQ(limiter.GetDroppedCount(Packet::kCommandResult), 2u);
+    EXPECT_EQ(limiter.GetDeviceCount(), 2u);
+
+    auto options = MakeOptions();
+    options.limits.push_back({Packet::kTelemetry, 1, 1});
+    EXPECT_THROW(DeviceRateLimiter(options, kNowMs), std::invalid_argument);
+    options.limits.pop_back();
+    options.limits.push_back({Packet::kRequest, 0, 1});
+    EXPECT_THROW(DeviceRateLimiter(options, kNowMs), std::invalid_argument);
+}
+
+TEST(BikeIotProto_DeviceRateLimiter, OverflowIsNotLimited) {
+    DeviceRateLimiter limiter(MakeOptions(1), kNowMs);
+    for (size_t i = 0; i < 100; ++i)
+        EXPECT_TRUE(limiter.Admit("bike" + std::to_string(i), Packet::kTelemetry, kNowMs));
+    EXPECT_LE(limiter.GetDeviceCount(), 2u);
+    EXPECT_GE(limiter.GetUntrackedCount(), 98u);
+}
+
+TEST(BikeIotProto_DeviceRateLimiter, ConcurrentAdmitsShareBurst) {
+    constexpr size_t         kThreads = 4;
+    DeviceRateLimiterOptions options;
+    options.limits.push_back({Packet::kTelemetry, 1000, 1});
+    DeviceRateLimiter        limiter(options, kNowMs);
+    std::atomic<size_t>      admitted{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < 1000; ++i) {
+                admitted += limiter.Admit("bike1", Packet::kTelemetry, kNowMs);
+                // Новые устройства занимают места параллельно
+                limiter.Admit("scooter" + std::to_string(i), Packet::kTelemetry, kNowMs);
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    EXPECT_EQ(admitted.load(), 1000u);
+    EXPECT_EQ(limiter.GetDeviceCount(), 1001u);
+}
@@ -0,0 +1,121 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/fleet_simulator.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+
+using namespace std::chrono_literals;
+using namespace iot::backend::proto;
+
+TEST(BikeIotProto_FleetSimulator, ModelIsDeterministic) {
+    FleetModel first(10, 42);
+    FleetModel second(10, 42);
+    // Устройство 5 не зависит от того, в какой части парка оно симулируется
+    FleetModel slice(3, 42, 5);
+
+    Packet a, b, c;
+    for (int step = 0; step < 100; ++step) {
+        first.MakeTelemetry(5, 10s, a);
+        second.MakeTelemetry(5, 10s, b);
+        EXPECT_EQ(a.telemetry().payload().location().lat(), b.telemetry().payload().location().lat());
+        EXPECT_EQ(a.telemetry().payload().sensors().at("odometer_m"), b.telemetry().payload().sensors().at("odometer_m"));
+    }
+    EXPECT_EQ(first.GetDevice(5).lon, second.GetDevice(5).lon);
+    EXPECT_EQ(first.GetDevice(5).battery, second.GetDevice(5).battery);
+    EXPECT_EQ(first.GetDevice(5).imei, slice.GetDevice(0).imei);
+    EXPECT_EQ(FleetModel(10, 42).GetDevice(5).lat, slice.GetDevice(0).lat);
+    EXPECT_NE(FleetModel(10, 43).GetDevice(5).lat, slice.GetDevice(0).lat);
+
+    slice.MakeTelemetry(0, 10s, c);
+    EXPECT_TRUE(IsValid(c));
+    EXPECT_EQ(c.telemetry().payload().sensors().at("imei"), slice.GetDevice(0).imei);
+}
+
+TEST(BikeIotProto_FleetSimulator, DevicesMoveAndDrain) {
+    FleetModel model(50, 7);
+    std::vector<SimulatedDevice> initial;
+    for (size_t i = 0; i < model.GetDeviceCount(); ++i)
+        initial.push_back(model.GetDevice(i));
+
+    // Два часа модельного времени с телеметрией раз в 10 секунд
+    Packet packet;
+    size_t moving_reports = 0;
+    for (int step = 0; step < 720; ++step) {
+        for (size_t i = 0; i < model.GetDeviceCount(); ++i) {
+            model.MakeTelemetry(i, 10s, packet);
+            ASSERT_TRUE(IsValid(packet));
+            const auto &payload = packet.telemetry().payload();
+            EXPECT_LE(payload.battery_level(), 100u);
+            if (!payload.locked()) {
+                ++moving_reports;
+                EXPECT_GT(payload.speed_kmh(), 0);
+            } else {
+                EXPECT_EQ(payload.speed_kmh(), 0);
+            }
+        }
+    }
+    EXPECT_GT(moving_reports, 0u);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < model.GetDeviceCount(); ++i) {
+        const auto &device = model.GetDevice(i);
+        if (device.odometer_m > initial[i].odometer_m) {
+            ++moved;
+            // 2 часа не больше 30 км/ч
+            EXPECT_LT(std::abs(device.lat - initial[i].lat), 0.6);
+            EXPECT_TRUE(device.battery < initial[i].battery || device.charging || initial[i].battery < 20);
+        }
+    }
+    EXPECT_GT(moved, model.GetDeviceCount() / 2);
+}
+
+TEST(BikeIotProto_FleetSimulator, CommandResults) {
+    FleetModel model(1, 1);
+    Packet     packet;
+    size_t     failed = 0;
+    for (int i = 0; i < 1000; ++i) {
+        model.MakeCommandResult("856ccfc0-8c02-4f6b-a6f6-376b4871f246", packet);
+        ASSERT_TRUE(IsValid(packet));
+        const auto &result = packet.command_result();
+        EXPECT_GT(result.cmd_execution_time_ms(), 0);
+        EXPECT_LE(result.cmd_execution_time_ms(), 60000);
+        failed += result.result() == RESULT_FAILED;
+    }
+    EXPECT_GT(failed, 0u);
+    EXPECT_LT(failed, 100u);
+}
+
+TEST(BikeIotProto_FleetSimulator, Run) {
+    for (const auto transport : {ProtocolConverter::TransportDataType::BINARY, ProtocolConverter::TransportDataType::JSON}) {
+        FleetSimulatorOptions options;
+        options.device_count = 100;
+        options.threads = 3;
+        options.transport = transport;
+        options.command_result_ratio = 0.2;
+        options.duration = 0ms;
+        options.packet_limit = 1000;
+
+        const auto report = RunFleetSimulation(options);
+        EXPECT_EQ(report.packets, 1000u);
+        EXPECT_EQ(report.telemetry + report.command_results, 1000u);
+        EXPECT_GT(report.command_results, 100u);
+        EXPECT_LT(report.command_results, 300u);
+        EXPECT_EQ(report.invalid, 0u);
+        EXPECT_GT(report.bytes, 1000u * 50);
+        EXPECT_EQ(report.decode_ns.GetCount(), 1000u);
+        EXPECT_GT(report.GetPacketsPerSecond(), 0);
+        EXPECT_NE(report.ToText().find("packets:             1000 "), std::string::npos);
+    }
+}
+
+TEST(BikeIotProto_FleetSimulator, RateLimit) {
+    FleetSimulatorOptions options;
+    options.device_count = 10;
+    options.threads = 2;
+    options.packets_per_second = 1000;
+    options.duration = 0ms;
+    options.packet_limit = 100;
+
+    const auto report = RunFleetSimulation(options);
+    EXPECT_EQ(report.packets, 100u);
+    EXPECT_GE(report.elapsed, 90ms);
+}
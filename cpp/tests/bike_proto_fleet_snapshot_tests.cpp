@@ -0,0 +1,153 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/fleet_snapshot.h"
+
+#include <cmath>
+#include <random>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+constexpr uint64_t kNowS = 1700000000;
+
+struct Row {
+    std::optional<uint32_t> battery;
+    std::optional<float>    speed;
+    std::optional<uint32_t> gsm;
+    std::optional<bool>     locked;
+    uint64_t                time_s = 0;
+};
+
+TelemetryPayload MakePayload(const Row &row)
+{
+    TelemetryPayload payload;
+    if (row.battery)
+        payload.set_battery_level(*row.battery);
+    if (row.speed)
+        payload.set_speed_kmh(*row.speed);
+    if (row.gsm)
+        payload.set_gsm_signal_level(*row.gsm);
+    if (row.locked)
+        payload.set_locked(*row.locked);
+    return payload;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_FleetSnapshot, UpdateKeepsLastKnownValues) {
+    FleetSnapshot    snapshot;
+    TelemetryPayload payload;
+    payload.set_battery_level(80);
+    payload.mutable_location()->set_lat(55.75f);
+    payload.mutable_location()->set_lon(37.62f);
+    payload.set_gsm_signal_level(30);
+    EXPECT_EQ(snapshot.Update("a", kNowS, payload), 0u);
+
+    payload.Clear();
+    payload.set_locked(true);
+    payload.set_gsm_signal_level(0);
+    EXPECT_EQ(snapshot.Update("a", kNowS + 60, payload), 0u);
+    EXPECT_EQ(snapshot.Update("b", kNowS + 60, payload), 1u);
+
+    EXPECT_EQ(snapshot.GetSize(), 2u);
+    EXPECT_EQ(snapshot.FindRow("b"), 1);
+    EXPECT_EQ(snapshot.FindRow("c"), -1);
+    EXPECT_EQ(snapshot.GetDeviceId(1), "b");
+    EXPECT_EQ(snapshot.GetValue(FleetColumn::BATTERY_LEVEL, 0), 80);
+    EXPECT_FLOAT_EQ(snapshot.GetValue(FleetColumn::LAT, 0), 55.75f);
+    EXPECT_EQ(snapshot.GetValue(FleetColumn::LOCKED, 0), 1);
+    EXPECT_EQ(snapshot.GetValue(FleetColumn::LAST_SEEN_S, 0), kNowS + 60);
+    // Уровень 0 - не сигнал
+    EXPECT_EQ(snapshot.GetValue(FleetColumn::GSM_SEEN_S, 0), kNowS);
+    EXPECT_EQ(snapshot.GetValue(FleetColumn::GSM_SEEN_S, 1), 0);
+    EXPECT_TRUE(std::isnan(snapshot.GetValue(FleetColumn::BATTERY_LEVEL, 1)));
+    EXPECT_TRUE(std::isnan(snapshot.GetValue(FleetColumn::CHARGING, 1)));
+}
+
+TEST(BikeIotProto_FleetSnapshot, FilterMatchesScalarScan) {
+    // Случайные строки с пропусками, все виды колонок и сравнений
+    FleetSnapshot    snapshot;
+    std::vector<Row> rows;
+    std::mt19937     random(3);
+    for (size_t i = 0; i < 1000; ++i) {
+        Row row;
+        if (random() % 5 != 0)
+            row.battery = random() % 101;
+        if (random() % 5 != 0)
+            row.speed = static_cast<float>(random() % 30);
+        if (random() % 5 != 0)
+            row.gsm = random() % 3 == 0 ? 0 : random() % 100;
+        if (random() % 5 != 0)
+            row.locked = random() % 2 == 0;
+        row.time_s = kNowS - random() % 3600;
+        snapshot.Update("d" + std::to_string(i), row.time_s, MakePayload(row));
+        rows.push_back(row);
+    }
+
+    const auto expect = [&](const std::vector<FleetPredicate> &predicates, auto &&matches) {
+        const auto selection = snapshot.Filter(predicates);
+        size_t     count = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            ASSERT_EQ(selection.Test(i), matches(rows[i])) << i;
+            count += matches(rows[i]);
+        }
+        EXPECT_EQ(selection.Count(), count);
+        // Параллельный обход даёт ту же маску
+        EXPECT_EQ(snapshot.ParallelFilter(predicates, 3).GetWords(), selection.GetWords());
+    };
+
+    expect({}, [](const Row &) { return true; });
+    expect({{FleetColumn::BATTERY_LEVEL, FleetCompare::LESS, 15}}, [](const Row &r) { return r.battery && *r.battery < 15; });
+    expect({{FleetColumn::SPEED_KMH, FleetCompare::NOT_EQUAL, 0}}, [](const Row &r) { return r.speed && *r.speed != 0; });
+    expect({{FleetColumn::SPEED_KMH, FleetCompare::GREATER_EQUAL, 25}}, [](const Row &r) { return r.speed && *r.speed >= 25; });
+    expect({{FleetColumn::LOCKED, FleetCompare::NOT_EQUAL, 1}}, [](const Row &r) { return r.locked && !*r.locked; });
+    expect({{FleetColumn::LOCKED, FleetCompare::LESS_EQUAL, 1}}, [](const Row &r) { return r.locked.has_value(); });
+    expect({{FleetColumn::LAST_SEEN_S, FleetCompare::GREATER, kNowS - 600}}, [](const Row &r) { return r.time_s > kNowS - 600; });
+    expect({{FleetColumn::LAST_SEEN_S, FleetCompare::LESS_EQUAL, kNowS - 600}}, [](const Row &r) { return r.time_s <= kNowS - 600; });
+
+    // "Незаблокированные с зарядом меньше 15% и без GSM 10 минут"
+    expect(
+        {
+            {FleetColumn::LOCKED, FleetCompare::EQUAL, 0},
+            {FleetColumn::BATTERY_LEVEL, FleetCompare::LESS, 15},
+            {FleetColumn::GSM_SEEN_S, FleetCompare::LESS, kNowS - 600},
+        },
+        [](const Row &r) {
+            const bool gsm_seen = r.gsm && *r.gsm > 0 && r.time_s >= kNowS - 600;
+            return r.locked && !*r.locked && r.battery && *r.battery < 15 && !gsm_seen;
+        });
+}
+
+TEST(BikeIotProto_FleetSnapshot, ProjectionAndSelections) {
+    FleetSnapshot snapshot;
+    for (uint32_t i = 0; i < 130; ++i)
+        snapshot.Update(std::to_string(i), kNowS, MakePayload({i % 101, static_cast<float>(i), {}, {}, 0}));
+
+    auto low = snapshot.Filter({{FleetColumn::BATTERY_LEVEL, FleetCompare::LESS, 3}});
+    EXPECT_EQ(snapshot.Project(low, FleetColumn::SPEED_KMH), (std::vector<double>{0, 1, 2, 101, 102, 103}));
+
+    low &= snapshot.Filter({{FleetColumn::SPEED_KMH, FleetCompare::GREATER, 100}});
+    EXPECT_EQ(low.Count(), 3u);
+    low |= snapshot.Filter({{FleetColumn::SPEED_KMH, FleetCompare::EQUAL, 129}});
+    std::vector<size_t> selected;
+    low.ForEach([&](size_t row) { selected.push_back(row); });
+    EXPECT_EQ(selected, (std::vector<size_t>{101, 102, 103, 129}));
+}
+
+TEST(BikeIotProto_FleetSnapshot, InvalidPredicatesAndRanges) {
+    FleetSnapshot snapshot;
+    for (uint32_t i = 0; i < 100; ++i)
+        snapshot.Update(std::to_string(i), kNowS, TelemetryPayload());
+    EXPECT_THROW((void)snapshot.Filter({{FleetColumn::LOCKED, FleetCompare::EQUAL, 2}}), std::invalid_argument);
+    EXPECT_THROW((void)snapshot.Filter({{FleetColumn::LAST_SEEN_S, FleetCompare::LESS, -1}}), std::invalid_argument);
+    EXPECT_THROW((void)snapshot.Filter({{FleetColumn::SPEED_KMH, FleetCompare::LESS, NAN}}), std::invalid_argument);
+    EXPECT_THROW((void)snapshot.ParallelFilter({{FleetColumn::CHARGING, FleetCompare::EQUAL, 2}}, 4),
+                 std::invalid_argument);
+
+    FleetSelection selection(snapshot.GetSize());
+    EXPECT_THROW(snapshot.Filter({}, selection, 1, 64), std::invalid_argument);
+    EXPECT_THROW(snapshot.Filter({}, selection, 0, 65), std::invalid_argument);
+    snapshot.Filter({}, selection, 64, 100);
+    EXPECT_EQ(selection.Count(), 36u);
+}
@@ -0,0 +1,182 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/fleet_state_file.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+constexpr uint64_t kNowS = 1700000000;
+
+std::string MakeId(size_t i)
+{
+    return std::to_string(860000000000000ULL + i);
+}
+
+TelemetryPayload MakePayload(size_t i)
+{
+    TelemetryPayload payload;
+    payload.set_battery_level(i % 101);
+    payload.set_locked(i % 2 == 0);
+    payload.set_gsm_signal_level(i % 3 == 0 ? 0 : 40);
+    return payload;
+}
+
+DeviceStateTable MakeTable(size_t devices)
+{
+    DeviceStateTable table;
+    for (size_t i = 0; i < devices; ++i)
+        table.UpdateTelemetry(MakeId(i), kNowS + i, MakePayload(i));
+    return table;
+}
+
+std::string ReadFile(const std::string &path)
+{
+    std::ifstream input(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+}
+
+void WriteFile(const std::string &path, const std::string &data)
+{
+    std::ofstream(path, std::ios::binary) << data;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_FleetStateFile, TableKeepsLastKnownState) {
+    DeviceStateTable table;
+    TelemetryPayload payload;
+    payload.set_battery_level(80);
+    payload.mutable_location()->set_lat(55.75f);
+    payload.set_gsm_signal_level(30);
+    EXPECT_EQ(table.UpdateTelemetry("a", kNowS, payload), 0u);
+
+    payload.Clear();
+    payload.set_locked(true);
+    payload.set_gsm_signal_level(0);
+    EXPECT_EQ(table.UpdateTelemetry("a", kNowS + 60, payload), 0u);
+    const auto chain_id = ChainId::Generate();
+    table.SetCommandChainId("b", chain_id);
+    table.SetConfigHash("b", 42);
+
+    ASSERT_EQ(table.GetSize(), 2u);
+    const DeviceState *a = table.Find("a");
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a->GetDeviceId(), "a");
+    EXPECT_EQ(a->battery_level, 80);
+    EXPECT_FLOAT_EQ(a->lat, 55.75f);
+    EXPECT_EQ(a->gsm_signal_level, 0);
+    EXPECT_EQ(a->gsm_seen_s, kNowS);
+    EXPECT_EQ(a->last_seen_s, kNowS + 60);
+    EXPECT_EQ(a->locked, 1);
+    EXPECT_EQ(a->charging, DeviceState::kUnknownFlag);
+    EXPECT_TRUE(std::isnan(a->speed_kmh));
+
+    const DeviceState *b = table.Find("b");
+    ASSERT_NE(b, nullptr);
+    EXPECT_EQ(b->command_chain_id, chain_id);
+    EXPECT_TRUE(b->result_chain_id.IsNil());
+    EXPECT_EQ(b->config_hash, 42u);
+    EXPECT_EQ(b->last_seen_s, 0u);
+    EXPECT_EQ(table.Find("c"), nullptr);
+
+    EXPECT_THROW(table.SetConfigHash(std::string(DeviceState::kMaxDeviceIdSize + 1, 'x'), 1), std::invalid_argument);
+}
+
+TEST(BikeIotProto_FleetStateFile, SnapshotIsCopyOnWrite) {
+    DeviceStateTable table = MakeTable(3000);
+    const auto       snapshot = table.TakeSnapshot();
+
+    TelemetryPayload payload;
+    payload.set_battery_level(5);
+    table.UpdateTelemetry(MakeId(0), kNowS + 10000, payload);
+    table.UpdateTelemetry(MakeId(2999), kNowS + 10000, payload);
+    table.UpdateTelemetry(MakeId(5000), kNowS + 10000, payload);
+
+    // Снимок видит состояние на момент снятия
+    ASSERT_EQ(snapshot.GetSize(), 3000u);
+    EXPECT_EQ(snapshot.Get(0).battery_level, 0);
+    EXPECT_EQ(snapshot.Get(2999).battery_level, 2999 % 101);
+    EXPECT_EQ(snapshot.Get(2999).last_seen_s, kNowS + 2999);
+    EXPECT_EQ(table.Find(MakeId(0))->battery_level, 5);
+    EXPECT_EQ(table.Find(MakeId(2999))->battery_level, 5);
+    EXPECT_EQ(table.GetSize(), 3001u);
+}
+
+TEST(BikeIotProto_FleetStateFile, RoundTrip) {
+    const std::string path = ::testing::TempDir() + "bike_proto_fleet_state.bin";
+    DeviceStateTable  table = MakeTable(5000);
+    const auto        chain_id = ChainId::Generate();
+    table.SetResultChainId(MakeId(1234), chain_id);
+    WriteFleetStateFile(table.TakeSnapshot(), path, kNowS);
+
+    const FleetStateFile file(path);
+    EXPECT_EQ(file.GetSize(), 5000u);
+    EXPECT_EQ(file.GetCreatedS(), kNowS);
+    EXPECT_EQ(file.GetBlockCount(), 5u);
+    for (size_t i = 0; i < 5000; ++i) {
+        const DeviceState *state = file.Find(MakeId(i));
+        ASSERT_NE(state, nullptr) << i;
+        EXPECT_EQ(state->GetDeviceId(), MakeId(i));
+        EXPECT_EQ(state->battery_level, i % 101);
+        EXPECT_EQ(state->locked, i % 2 == 0);
+        EXPECT_EQ(state->last_seen_s, kNowS + i);
+    }
+    EXPECT_EQ(file.Find(MakeId(1234))->result_chain_id, chain_id);
+    EXPECT_EQ(file.Find(MakeId(5000)), nullptr);
+    EXPECT_TRUE(file.Validate().empty());
+
+    // Таблица, поднятая из файла, продолжает работу с того же состояния
+    DeviceStateTable restored(file);
+    EXPECT_EQ(restored.GetSize(), 5000u);
+    EXPECT_EQ(restored.Find(MakeId(4999))->last_seen_s, kNowS + 4999);
+    EXPECT_EQ(restored.UpdateTelemetry(MakeId(5000), kNowS, TelemetryPayload()), 5000u);
+
+    // Пустой парк - тоже корректный файл
+    WriteFleetStateFile(DeviceStateTable().TakeSnapshot(), path, kNowS);
+    EXPECT_EQ(FleetStateFile(path).GetSize(), 0u);
+    EXPECT_EQ(FleetStateFile(path).Find("a"), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(BikeIotProto_FleetStateFile, CorruptionIsDetected) {
+    const std::string path = ::testing::TempDir() + "bike_proto_fleet_state_corrupt.bin";
+    WriteFleetStateFile(MakeTable(3000).TakeSnapshot(), path, kNowS);
+    const std::string data = ReadFile(path);
+
+    // Испорченная запись в последнем блоке: остальные блоки читаются,
+    // ошибка - только при обращении к испорченному
+    std::string damaged = data;
+    damaged[damaged.size() - 100] ^= 1;
+    WriteFile(path, damaged);
+    {
+        const FleetStateFile file(path);
+        EXPECT_NE(file.Find(MakeId(0)), nullptr);
+        EXPECT_THROW((void)file.Find(MakeId(2999)), std::runtime_error);
+        EXPECT_EQ(file.Validate(), std::vector<size_t>{2});
+        EXPECT_THROW(DeviceStateTable{file}, std::runtime_error);
+    }
+
+    // Заголовок, индекс и размер проверяются при открытии
+    damaged = data;
+    damaged[20] ^= 1;
+    WriteFile(path, damaged);
+    EXPECT_THROW(FleetStateFile{path}, std::runtime_error);
+
+    damaged = data;
+    damaged[200] ^= 1;
+    WriteFile(path, damaged);
+    EXPECT_THROW(FleetStateFile{path}, std::runtime_error);
+
+    WriteFile(path, data.substr(0, data.size() - 128));
+    EXPECT_THROW(FleetStateFile{path}, std::runtime_error);
+
+    WriteFile(path, "not a fleet state");
+    EXPECT_THROW(FleetStateFile{path}, std::runtime_error);
+    std::remove(path.c_str());
+}
@@ -1,3 +1,4 @@
+#include "iot_scale/cpp/src/chain_id.h"
 #include "iot_scale/cpp/src/helpers.h"
 #include "iot_scale/cpp/src/packet_validator.h"
 
@@ -20,6 +21,52 @@ TEST(BikeIotProto_Helpers, GenerateChainId) {
     }
 }
 
+TEST(BikeIotProto_Helpers, ChainIdIsUuidV7) {
+    using iot::backend::proto::ChainId;
+
+    std::regex reV7Format("[0-9a-f]{8}-[0-9a-f]{4}-7[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+    const auto before = iot::backend::proto::helpers::GetCurrentUtcTimestampMs();
+    const auto id = ChainId::Generate();
+    const auto after = iot::backend::proto::helpers::GetCurrentUtcTimestampMs();
+
+    EXPECT_EQ(id.GetVersion(), 7);
+    EXPECT_LE(before, id.GetTimestampMs());
+    EXPECT_GE(after + 1, id.GetTimestampMs());
+    EXPECT_TRUE(std::regex_match(id.ToString(), reV7Format))
+        << "Chain ID "<< id.ToString() << " does not match pattern";
+}
+
+TEST(BikeIotProto_Helpers, ChainIdIsTimeOrdered) {
+    using iot::backend::proto::ChainId;
+
+    auto prev = ChainId::Generate();
+    for (int i = 0; i < 10000; ++i) {
+        const auto id = ChainId::Generate();
+        ASSERT_LT(prev, id);
+        // Text form sorts the same way as binary one
+        ASSERT_LT(prev.ToString(), id.ToString());
+        prev = id;
+    }
+}
+
+TEST(BikeIotProto_Helpers, ChainIdParse) {
+    using iot::backend::proto::ChainId;
+
+    const auto id = ChainId::Generate();
+    EXPECT_EQ(ChainId::Parse(id.ToString()), id);
+
+    const auto parsed = ChainId::Parse("856CCFC0-8c02-4f6b-a6f6-376b4871f246");
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->ToString(), "856ccfc0-8c02-4f6b-a6f6-376b4871f246");
+    EXPECT_EQ(ChainId::Parse("de2466e4066b494c86438e4197cc70be")->ToString(), "de2466e4-066b-494c-8643-8e4197cc70be");
+
+    EXPECT_FALSE(ChainId::Parse("123").has_value());
+    EXPECT_FALSE(ChainId::Parse("856ccfc0+8c02-4f6b-a6f6-376b4871f246").has_value());
+    EXPECT_FALSE(ChainId::Parse("z56ccfc0-8c02-4f6b-a6f6-376b4871f246").has_value());
+    EXPECT_TRUE(ChainId().IsNil());
+    EXPECT_EQ(ChainId().ToString(), "00000000-0000-0000-0000-000000000000");
+}
+
 TEST(BikeIotProto_Helpers, MakePacket) {
     using namespace std::literals::chrono_literals;
     const auto packet = iot::backend::proto::helpers::MakePacket(5s);
@@ -0,0 +1,194 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/helpers.h"
+#include "iot_scale/cpp/src/hot_path_metrics.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/protocol_converter.h"
+
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+using DataType = ProtocolConverter::TransportDataType;
+
+class BikeIotProto_HotPathMetrics : public ::testing::Test {
+  protected:
+    void SetUp() override
+    {
+        metrics::Reset();
+        metrics::SetLatencySampleRate(1);
+        metrics::SetEnabled(true);
+    }
+
+    void TearDown() override
+    {
+        metrics::SetEnabled(false);
+        metrics::SetLatencySampleRate(metrics::kDefaultLatencySampleRate);
+        metrics::Reset();
+    }
+};
+
+Packet MakeSetParams()
+{
+    auto packet = helpers::MakeCommand(std::chrono::seconds(300), "856ccfc0-8c02-4f6b-a6f6-376b4871f246");
+    (*packet.mutable_command()->mutable_payload()->mutable_set_params()->mutable_params())["vehicle_lock"] = "locked";
+    return packet;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_HotPathMetricsHistogram, Buckets) {
+    using metrics::Histogram;
+
+    size_t prev_bucket = 0;
+    for (uint64_t value : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 9ull, 100ull, 1000ull, 123456789ull}) {
+        const size_t bucket = Histogram::GetBucket(value);
+        EXPECT_GE(bucket, prev_bucket);
+        prev_bucket = bucket;
+
+        const uint64_t upper = Histogram::GetBucketUpperBound(bucket);
+        EXPECT_GE(upper, value);
+        // Относительная ошибка не больше 1 / kSubBuckets
+        EXPECT_LE(upper - value, value / Histogram::kSubBuckets);
+        EXPECT_EQ(Histogram::GetBucket(upper), bucket);
+        EXPECT_EQ(Histogram::GetBucket(upper + 1), bucket + 1);
+    }
+    EXPECT_EQ(Histogram::GetBucket(~0ull), Histogram::kBucketCount - 1);
+}
+
+TEST(BikeIotProto_HotPathMetricsHistogram, Quantiles) {
+    metrics::Histogram histogram;
+    EXPECT_EQ(histogram.GetQuantile(0.5), 0u);
+
+    for (uint64_t value = 1; value <= 100; ++value)
+        histogram.Add(value);
+    EXPECT_EQ(histogram.GetCount(), 100u);
+    EXPECT_EQ(histogram.GetQuantile(0.5), metrics::Histogram::GetBucketUpperBound(metrics::Histogram::GetBucket(50)));
+    EXPECT_EQ(histogram.GetQuantile(1), metrics::Histogram::GetBucketUpperBound(metrics::Histogram::GetBucket(100)));
+
+    metrics::Histogram other;
+    other.Add(1, 100);
+    histogram.Merge(other);
+    EXPECT_EQ(histogram.GetCount(), 200u);
+    EXPECT_EQ(histogram.GetQuantile(0.5), 1u);
+}
+
+TEST_F(BikeIotProto_HotPathMetrics, DisabledRecordsNothing) {
+    metrics::SetEnabled(false);
+    EXPECT_TRUE(IsValid(MakeSetParams()));
+    EXPECT_TRUE(metrics::Collect().entries.empty());
+}
+
+TEST_F(BikeIotProto_HotPathMetrics, CountsByTypeAndTransport) {
+    const ProtocolConverter binary(DataType::BINARY);
+    const ProtocolConverter json(DataType::JSON);
+    const auto packet = MakeSetParams();
+
+    const auto encoded = binary.Serialize(packet);
+    std::string buffer;
+    json.SerializeTo(packet, buffer);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_TRUE(IsValid(binary.Deserialize(encoded)));
+    EXPECT_FALSE(IsValid(Packet()));
+
+    const auto snapshot = metrics::Collect();
+    EXPECT_EQ(snapshot.latency_sample_rate, 1u);
+
+    const auto *serialized = snapshot.Find(metrics::Operation::SERIALIZE, metrics::Transport::BINARY, Packet::kCommand);
+    ASSERT_TRUE(serialized);
+    EXPECT_EQ(serialized->count, 1u);
+    EXPECT_EQ(serialized->bytes, encoded.size());
+
+    const auto *serialized_json = snapshot.Find(metrics::Operation::SERIALIZE, metrics::Transport::JSON, Packet::kCommand);
+    ASSERT_TRUE(serialized_json);
+    EXPECT_EQ(serialized_json->bytes, buffer.size());
+
+    const auto *deserialized = snapshot.Find(metrics::Operation::DESERIALIZE, metrics::Transport::BINARY, Packet::kCommand);
+    ASSERT_TRUE(deserialized);
+    EXPECT_EQ(deserialized->count, 3u);
+    EXPECT_EQ(deserialized->failures, 0u);
+    EXPECT_EQ(deserialized->bytes, 3 * encoded.size());
+    EXPECT_EQ(deserialized->latency_ns.GetCount(), 3u);
+
+    const auto *validated = snapshot.Find(metrics::Operation::VALIDATE, metrics::Transport::NONE, Packet::kCommand);
+    ASSERT_TRUE(validated);
+    EXPECT_EQ(validated->count, 3u);
+    EXPECT_EQ(validated->failures, 0u);
+
+    const auto *invalid = snapshot.Find(metrics::Operation::VALIDATE, metrics::Transport::NONE, Packet::WHAT_NOT_SET);
+    ASSERT_TRUE(invalid);
+    EXPECT_EQ(invalid->count, 1u);
+    EXPECT_EQ(invalid->failures, 1u);
+
+    EXPECT_EQ(snapshot.entries.size(), 5u);
+}
+
+TEST_F(BikeIotProto_HotPathMetrics, FailuresAndSampling) {
+    const ProtocolConverter json(DataType::JSON);
+    EXPECT_ANY_THROW((void)json.Deserialize("{not a json"));
+
+    std::array<char, 4> small;
+    EXPECT_GT(ProtocolConverter(DataType::BINARY).SerializeTo(MakeSetParams(), small), small.size());
+
+    metrics::SetLatencySampleRate(5);
+    EXPECT_EQ(metrics::GetLatencySampleRate(), 8u);
+    for (int i = 0; i < 64; ++i)
+        (void)IsValid(MakeSetParams());
+
+    const auto snapshot = metrics::Collect();
+    const auto *failed = snapshot.Find(metrics::Operation::DESERIALIZE, metrics::Transport::JSON, Packet::WHAT_NOT_SET);
+    ASSERT_TRUE(failed);
+    EXPECT_EQ(failed->failures, 1u);
+
+    const auto *overflow = snapshot.Find(metrics::Operation::SERIALIZE, metrics::Transport::BINARY, Packet::kCommand);
+    ASSERT_TRUE(overflow);
+    EXPECT_EQ(overflow->failures, 1u);
+
+    const auto *validated = snapshot.Find(metrics::Operation::VALIDATE, metrics::Transport::NONE, Packet::kCommand);
+    ASSERT_TRUE(validated);
+    EXPECT_EQ(validated->count, 64u);
+    EXPECT_EQ(validated->latency_ns.GetCount(), 8u);
+}
+
+TEST_F(BikeIotProto_HotPathMetrics, MergesThreads) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 100; ++i)
+                (void)IsValid(MakeSetParams());
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    (void)IsValid(MakeSetParams());
+
+    const auto snapshot = metrics::Collect();
+    const auto *validated = snapshot.Find(metrics::Operation::VALIDATE, metrics::Transport::NONE, Packet::kCommand);
+    ASSERT_TRUE(validated);
+    EXPECT_EQ(validated->count, 401u);
+
+    metrics::Reset();
+    EXPECT_TRUE(metrics::Collect().entries.empty());
+}
+
+TEST_F(BikeIotProto_HotPathMetrics, Export) {
+    (void)IsValid(MakeSetParams());
+    const auto snapshot = metrics::Collect();
+
+    const auto text = snapshot.ToText();
+    EXPECT_NE(text.find("# TYPE iot_proto_packets_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("iot_proto_packets_total{operation=\"validate\",transport=\"none\",what=\"command\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("iot_proto_latency_ns{operation=\"validate\",transport=\"none\",what=\"command\",quantile=\"0.99\"} "),
+              std::string::npos);
+    EXPECT_NE(text.find("iot_proto_latency_ns_count{operation=\"validate\",transport=\"none\",what=\"command\"} 1\n"),
+              std::string::npos);
+
+    const auto json = snapshot.ToJson();
+    EXPECT_EQ(json.rfind("{\"latency_sample_rate\":1,\"entries\":[{\"operation\":\"validate\",\"transport\":\"none\","
+                        "\"what\":\"command\",\"count\":1,\"failures\":0,\"bytes\":0,\"latency_ns\":{\"samples\":1,", 0),
+              0u);
+    EXPECT_EQ(json.substr(json.size() - 6), "]]}}]}");
+}
@@ -0,0 +1,184 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/liveness_tracker.h"
+#include "iot_scale/cpp/src/params_files.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+constexpr uint64_t kStartMs = 1700000000000ULL;
+
+LivenessOptions MakeOptions()
+{
+    LivenessOptions options;
+    options.reports = {"heartbeat", "location", "info"};
+    options.default_interval = std::chrono::seconds(60);
+    options.missed_reports = 2;
+    return options;
+}
+
+CmdSetParams MakeSetParams(std::initializer_list<std::pair<const char *, const char *>> params)
+{
+    CmdSetParams set_params;
+    for (const auto &[name, value] : params)
+        (*set_params.mutable_params())[name] = value;
+    return set_params;
+}
+
+std::vector<std::string> Collect(LivenessTracker &tracker, uint64_t now_ms)
+{
+    std::vector<std::string> ids;
+    tracker.Advance(now_ms, [&](const LivenessEvent &event) { ids.emplace_back(event.device_id); });
+    return ids;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_LivenessTracker, SilentDeviceIsReportedOnce) {
+    LivenessTracker tracker(MakeOptions(), kStartMs);
+    EXPECT_FALSE(tracker.OnPacket("a", kStartMs));
+    EXPECT_FALSE(tracker.OnPacket("b", kStartMs));
+
+    // "a" продолжает присылать пакеты раз в минуту, "b" молчит
+    for (uint64_t minute = 1; minute <= 2; ++minute) {
+        EXPECT_TRUE(Collect(tracker, kStartMs + minute * 60000 - 1000).empty());
+        tracker.OnPacket("a", kStartMs + minute * 60000);
+    }
+
+    LivenessEvent event;
+    size_t        calls = 0;
+    EXPECT_EQ(tracker.Advance(kStartMs + 120000, [&](const LivenessEvent &e) { event = e; ++calls; }), 1u);
+    EXPECT_EQ(calls, 1u);
+    EXPECT_EQ(event.device_id, "b");
+    EXPECT_EQ(event.last_seen_ms, kStartMs);
+    EXPECT_EQ(event.deadline_ms, kStartMs + 120000);
+    EXPECT_FALSE(tracker.IsOnline("b"));
+    EXPECT_TRUE(tracker.IsOnline("a"));
+    EXPECT_EQ(tracker.GetScheduledCount(), 1u);
+
+    // Повторно не сообщается, пока устройство не вернётся
+    EXPECT_EQ(Collect(tracker, kStartMs + 3600000), std::vector<std::string>{"a"});
+    EXPECT_TRUE(tracker.OnPacket("b", kStartMs + 3600000));
+    EXPECT_TRUE(tracker.IsOnline("b"));
+    EXPECT_FALSE(tracker.OnPacket("b", kStartMs + 3600001));
+}
+
+TEST(BikeIotProto_LivenessTracker, IntervalsFromSetParams) {
+    LivenessTracker tracker(MakeOptions(), kStartMs);
+    tracker.OnPacket("a", kStartMs);
+    EXPECT_EQ(tracker.GetInterval("a"), std::chrono::seconds(60));
+
+    // Наименьший включённый интервал; чужие и некорректные параметры
+    // пропускаются
+    tracker.ApplySetParams("a", MakeSetParams({{"heartbeat", "30"}, {"location", "10"}, {"vehicle_lock", "1"}, {"info", "x"}}));
+    EXPECT_EQ(tracker.GetInterval("a"), std::chrono::seconds(10));
+    EXPECT_TRUE(Collect(tracker, kStartMs + 19000).empty());
+    EXPECT_EQ(Collect(tracker, kStartMs + 20000), std::vector<std::string>{"a"});
+
+    tracker.OnPacket("a", kStartMs + 20000);
+    tracker.ApplySetParams("a", MakeSetParams({{"location", "0"}}));
+    EXPECT_EQ(tracker.GetInterval("a"), std::chrono::seconds(30));
+    EXPECT_TRUE(Collect(tracker, kStartMs + 79000).empty());
+    EXPECT_EQ(Collect(tracker, kStartMs + 80000), std::vector<std::string>{"a"});
+
+    // Одинаковые наборы интервалов хранятся один раз
+    const size_t profiles = tracker.GetProfileCount();
+    for (int i = 0; i < 100; ++i)
+        tracker.ApplySetParams("d" + std::to_string(i), MakeSetParams({{"heartbeat", "30"}}));
+    EXPECT_EQ(tracker.GetProfileCount(), profiles);
+}
+
+TEST(BikeIotProto_LivenessTracker, MatchesBruteForce) {
+    // Дедлайны на всех уровнях колеса, в том числе дальше его горизонта, и
+    // Advance с шагами разной длины
+    LivenessOptions options = MakeOptions();
+    options.tick = std::chrono::milliseconds(100);
+    LivenessTracker tracker(options, kStartMs);
+
+    std::mt19937_64                 random(42);
+    std::map<std::string, uint64_t> deadlines;
+    const std::vector<uint64_t>     intervals = {1, 5, 60, 600, 3600, 86400, 30 * 86400, 365 * 86400};
+    for (int i = 0; i < 3000; ++i) {
+        const std::string id = std::to_string(i);
+        const uint64_t    interval = intervals[random() % intervals.size()];
+        const uint64_t    seen_ms = kStartMs + random() % 1000000;
+        tracker.ApplySetParams(id, MakeSetParams({{"heartbeat", std::to_string(interval).c_str()}}));
+        tracker.OnPacket(id, seen_ms);
+        deadlines[id] = seen_ms + interval * 2000;
+    }
+
+    uint64_t now_ms = kStartMs;
+    // Начало последнего обработанного тика
+    uint64_t processed_ms = kStartMs;
+    size_t   reported = 0;
+    while (reported < deadlines.size()) {
+        now_ms += 1 + random() % (random() % 4 == 0 ? 100000000 : 100000);
+        const uint64_t previous_ms = processed_ms;
+        processed_ms = now_ms - (now_ms - kStartMs) % 100;
+        tracker.Advance(now_ms, [&](const LivenessEvent &event) {
+            const uint64_t deadline = deadlines.at(std::string(event.device_id));
+            EXPECT_EQ(event.deadline_ms, deadline);
+            // На первом тике, начало которого не раньше дедлайна
+            EXPECT_LE(deadline, processed_ms);
+            EXPECT_GT(deadline, previous_ms);
+            ++reported;
+        });
+        for (const auto &[id, deadline] : deadlines)
+            ASSERT_EQ(tracker.IsOnline(id), deadline > processed_ms) << id << " at " << now_ms;
+    }
+    EXPECT_EQ(tracker.GetScheduledCount(), 0u);
+}
+
+TEST(BikeIotProto_LivenessTracker, CallbackMayReschedule) {
+    LivenessTracker tracker(MakeOptions(), kStartMs);
+    for (const char *id : {"a", "b", "c"})
+        tracker.OnPacket(id, kStartMs);
+
+    std::vector<std::string> ids;
+    tracker.Advance(kStartMs + 120000, [&](const LivenessEvent &event) {
+        ids.emplace_back(event.device_id);
+        // Первый обработчик "оживляет" все устройства той же ячейки
+        for (const char *id : {"a", "b", "c"}) {
+            if (event.device_id != id)
+                tracker.OnPacket(id, kStartMs + 120000);
+        }
+        tracker.Forget("missing");
+    });
+    ASSERT_EQ(ids.size(), 1u);
+    EXPECT_EQ(tracker.GetScheduledCount(), 2u);
+
+    for (const char *id : {"a", "b", "c"}) {
+        if (ids[0] != id)
+            tracker.Forget(id);
+    }
+    EXPECT_EQ(tracker.GetDeviceCount(), 1u);
+    EXPECT_EQ(tracker.GetScheduledCount(), 0u);
+}
+
+TEST(BikeIotProto_LivenessTracker, InvalidOptions) {
+    LivenessOptions options = MakeOptions();
+    options.tick = std::chrono::milliseconds(0);
+    EXPECT_THROW(LivenessTracker(options, 0), std::invalid_argument);
+    options = MakeOptions();
+    options.missed_reports = 0;
+    EXPECT_THROW(LivenessTracker(options, 0), std::invalid_argument);
+}
+
+TEST(BikeIotProto_ParamsFiles, ParseAndLoad) {
+    EXPECT_EQ(ParseParamNames(R"(["heartbeat", "location"])"), (std::vector<std::string>{"heartbeat", "location"}));
+    EXPECT_TRUE(ParseParamNames("[]").empty());
+    EXPECT_THROW(ParseParamNames(R"({"heartbeat": 1})"), std::runtime_error);
+    EXPECT_THROW(ParseParamNames(R"(["heartbeat", 1])"), std::runtime_error);
+
+    const std::string path = ::testing::TempDir() + "reports.json";
+    std::ofstream(path) << "[\n    \"heartbeat\",\n    \"info\"\n]\n";
+    EXPECT_EQ(LoadParamNames(path), (std::vector<std::string>{"heartbeat", "info"}));
+    std::remove(path.c_str());
+    EXPECT_THROW(LoadParamNames(path), std::runtime_error);
+}
@@ -0,0 +1,277 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/device_topics.h"
+#include "iot_scale/cpp/src/fleet_simulator.h"
+#include "iot_scale/cpp/src/helpers.h"
+#include "iot_scale/cpp/src/mqtt_broker.h"
+#include "iot_scale/cpp/src/mqtt_client.h"
+#include "iot_scale/cpp/src/mqtt_codec.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <set>
+
+using namespace std::chrono_literals;
+using namespace iot::backend::proto;
+
+namespace {
+
+// Сырое соединение с брокером для пакетов, которые MqttClient не отправляет
+std::string Exchange(uint16_t port, const std::string &request)
+{
+    const int   fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)), 0);
+    EXPECT_EQ(::send(fd, request.data(), request.size(), 0), static_cast<ssize_t>(request.size()));
+
+    // Брокер закрывает соединение после ответа
+    std::string response;
+    char        buffer[256];
+    ssize_t     size;
+    while ((size = ::recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        response.append(buffer, size);
+    ::close(fd);
+    return response;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_MqttBroker, RemainingLength) {
+    for (const size_t size : {0, 1, 127, 128, 16383, 16384, 2097151, 2097152}) {
+        std::string packet;
+        mqtt::AppendPublish(packet, "t", std::string(size - std::min<size_t>(size, 3), 'x'), 0);
+        const auto header = mqtt::ParseFixedHeader(packet);
+        ASSERT_TRUE(header);
+        EXPECT_EQ(header->type, mqtt::PacketType::PUBLISH);
+        EXPECT_EQ(header->header_size + header->remaining_length, packet.size());
+        // Заголовка без последнего байта длины недостаточно
+        EXPECT_FALSE(mqtt::ParseFixedHeader(std::string_view(packet).substr(0, header->header_size - 1)));
+    }
+    EXPECT_EQ(mqtt::ParseFixedHeader(std::string("\x30\x7f", 2))->header_size, 2u);
+    EXPECT_EQ(mqtt::ParseFixedHeader(std::string("\x30\x80\x01", 3))->remaining_length, 128u);
+    EXPECT_THROW((void)mqtt::ParseFixedHeader(std::string("\x30\xff\xff\xff\xff\x01", 6)), std::invalid_argument);
+    EXPECT_THROW((void)mqtt::ParseFixedHeader(std::string("\x00\x00", 2)), std::invalid_argument);
+    // SUBSCRIBE обязан иметь флаги 0010, QoS 3 запрещён
+    EXPECT_THROW((void)mqtt::ParseFixedHeader(std::string("\x80\x00", 2)), std::invalid_argument);
+    EXPECT_THROW((void)mqtt::ParseFixedHeader(std::string("\x36\x00", 2)), std::invalid_argument);
+}
+
+TEST(BikeIotProto_MqttBroker, CodecRoundTrip) {
+    std::string buffer;
+    mqtt::AppendConnect(buffer, "bike-1", 60);
+    auto header = mqtt::ParseFixedHeader(buffer);
+    ASSERT_TRUE(header);
+    const auto connect = mqtt::ParseConnect(std::string_view(buffer).substr(header->header_size));
+    EXPECT_EQ(connect.client_id, "bike-1");
+    EXPECT_EQ(connect.keep_alive_s, 60);
+    EXPECT_TRUE(connect.clean_session);
+    EXPECT_TRUE(connect.IsSupportedProtocol());
+
+    buffer.clear();
+    mqtt::AppendPublish(buffer, "$devices/1/events/status", "{}", 1, 42);
+    header = mqtt::ParseFixedHeader(buffer);
+    const auto publish = mqtt::ParsePublish(header->flags, std::string_view(buffer).substr(header->header_size));
+    EXPECT_EQ(publish.topic, "$devices/1/events/status");
+    EXPECT_EQ(publish.payload, "{}");
+    EXPECT_EQ(publish.qos, 1);
+    EXPECT_EQ(publish.packet_id, 42);
+
+    buffer.clear();
+    mqtt::AppendSubscribe(buffer, 7, {{"$devices/+/events/#", 1}, {"a/b", 0}});
+    header = mqtt::ParseFixedHeader(buffer);
+    EXPECT_EQ(header->flags, 0x02);
+    const auto subscribe = mqtt::ParseSubscribe(std::string_view(buffer).substr(header->header_size));
+    EXPECT_EQ(subscribe.packet_id, 7);
+    ASSERT_EQ(subscribe.filters.size(), 2u);
+    EXPECT_EQ(subscribe.filters[0].first, "$devices/+/events/#");
+    EXPECT_EQ(subscribe.filters[0].second, 1);
+    EXPECT_EQ(subscribe.filters[1].first, "a/b");
+
+    // Обрезанный пакет и нулевой packet id
+    EXPECT_THROW((void)mqtt::ParseSubscribe(std::string_view(buffer).substr(header->header_size, 6)), std::invalid_argument);
+    EXPECT_THROW((void)mqtt::ParsePacketId(std::string("\0\0", 2)), std::invalid_argument);
+}
+
+TEST(BikeIotProto_MqttBroker, TopicMatches) {
+    EXPECT_TRUE(mqtt::TopicMatches("a/b", "a/b"));
+    EXPECT_FALSE(mqtt::TopicMatches("a/b", "a/b/c"));
+    EXPECT_TRUE(mqtt::TopicMatches("a/+/c", "a/b/c"));
+    EXPECT_FALSE(mqtt::TopicMatches("a/+", "a/b/c"));
+    EXPECT_TRUE(mqtt::TopicMatches("a/#", "a/b/c"));
+    EXPECT_TRUE(mqtt::TopicMatches("a/#", "a"));
+    EXPECT_TRUE(mqtt::TopicMatches("+/+", "/b"));
+    EXPECT_TRUE(mqtt::TopicMatches("#", "a/b"));
+    // Топики на '$' не совпадают с фильтрами, начинающимися с wildcard
+    EXPECT_FALSE(mqtt::TopicMatches("#", "$devices/1/events/status"));
+    EXPECT_FALSE(mqtt::TopicMatches("+/1/events/status", "$devices/1/events/status"));
+    EXPECT_TRUE(mqtt::TopicMatches(kAllDeviceEventsFilter, "$devices/1/events/status"));
+    EXPECT_TRUE(mqtt::TopicMatches(kAllDeviceEventsFilter, "$devices/1/events/telemetry"));
+    EXPECT_FALSE(mqtt::TopicMatches(kAllDeviceEventsFilter, "$devices/1/commands/command"));
+
+    EXPECT_TRUE(mqtt::IsValidTopicFilter("a/+/#"));
+    EXPECT_FALSE(mqtt::IsValidTopicFilter("a/#/b"));
+    EXPECT_FALSE(mqtt::IsValidTopicFilter("a/b+"));
+    EXPECT_FALSE(mqtt::IsValidTopicName("a/+"));
+}
+
+TEST(BikeIotProto_MqttBroker, DeviceTopics) {
+    const auto topic = MakeDeviceTopic("869492042841493", DeviceTopicKind::TELEMETRY);
+    EXPECT_EQ(topic, "$devices/869492042841493/events/telemetry");
+    const auto parsed = ParseDeviceTopic(topic);
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(parsed->device_id, "869492042841493");
+    EXPECT_EQ(parsed->kind, DeviceTopicKind::TELEMETRY);
+
+    EXPECT_EQ(ParseDeviceTopic("$devices/x/commands/command")->kind, DeviceTopicKind::COMMAND);
+    EXPECT_EQ(ParseDeviceTopic("$devices/x/events/status")->kind, DeviceTopicKind::STATUS);
+    EXPECT_FALSE(ParseDeviceTopic("$devices//events/status"));
+    EXPECT_FALSE(ParseDeviceTopic("$devices/x/events/other"));
+    EXPECT_FALSE(ParseDeviceTopic("$registries/x/events/status"));
+}
+
+TEST(BikeIotProto_MqttBroker, CommandRoundTrip) {
+    LoopbackMqttBroker broker;
+    broker.Start();
+    ASSERT_NE(broker.GetPort(), 0);
+
+    const ProtocolConverter converter(ProtocolConverter::TransportDataType::JSON);
+    MqttClient              backend(broker.GetPort(), "backend");
+    EXPECT_EQ(backend.Subscribe(kAllDeviceEventsFilter, 1), 1);
+
+    FleetModel model(3, 1);
+    std::vector<std::unique_ptr<MqttClient>> devices;
+    for (size_t i = 0; i < model.GetDeviceCount(); ++i) {
+        const auto &imei = model.GetDevice(i).imei;
+        devices.push_back(std::make_unique<MqttClient>(broker.GetPort(), imei));
+        devices.back()->Subscribe(MakeDeviceTopic(imei, DeviceTopicKind::COMMAND), 1);
+    }
+
+    for (size_t i = 0; i < devices.size(); ++i) {
+        const auto &imei = model.GetDevice(i).imei;
+        auto command = helpers::MakeCommand(300s, "chain-" + std::to_string(i));
+        (*command.mutable_command()->mutable_payload()->mutable_set_params()->mutable_params())["vehicle_lock"] = "locked";
+        backend.Publish(MakeDeviceTopic(imei, DeviceTopicKind::COMMAND), converter.Serialize(command), 1);
+    }
+    backend.WaitForAcks();
+
+    // Устройство разбирает и проверяет команду и отвечает в events/status
+    MqttMessage message;
+    Packet      packet;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        ASSERT_TRUE(devices[i]->Receive(message, 5s));
+        EXPECT_EQ(message.qos, 1);
+        EXPECT_EQ(ParseDeviceTopic(message.topic)->kind, DeviceTopicKind::COMMAND);
+        converter.Deserialize(message.payload, packet);
+        ASSERT_TRUE(IsValid(packet));
+        const std::string chain_id = packet.command().chain_id();
+        EXPECT_EQ(chain_id, "chain-" + std::to_string(i));
+
+        model.MakeCommandResult(chain_id, packet);
+        devices[i]->Publish(MakeDeviceTopic(model.GetDevice(i).imei, DeviceTopicKind::STATUS),
+                            converter.Serialize(packet),
+                            1);
+        devices[i]->WaitForAcks();
+    }
+
+    std::map<std::string, std::string> chain_ids;
+    for (size_t i = 0; i < devices.size(); ++i)
+        chain_ids[model.GetDevice(i).imei] = "chain-" + std::to_string(i);
+
+    std::set<std::string> results;
+    for (size_t i = 0; i < devices.size(); ++i) {
+        ASSERT_TRUE(backend.Receive(message, 5s));
+        const auto topic = ParseDeviceTopic(message.topic);
+        ASSERT_TRUE(topic);
+        EXPECT_EQ(topic->kind, DeviceTopicKind::STATUS);
+        converter.Deserialize(message.payload, packet);
+        EXPECT_TRUE(IsValid(packet));
+        EXPECT_EQ(packet.command_result().chain_id(), chain_ids[std::string(topic->device_id)]);
+        results.insert(std::string(topic->device_id));
+    }
+    EXPECT_EQ(results.size(), devices.size());
+    EXPECT_FALSE(backend.Receive(message, 10ms));
+
+    const auto stats = broker.GetStats();
+    EXPECT_EQ(stats.connections, 4u);
+    EXPECT_EQ(stats.publishes_received, 6u);
+    EXPECT_EQ(stats.messages_delivered, 6u);
+    EXPECT_EQ(stats.protocol_errors, 0u);
+    broker.Stop();
+}
+
+TEST(BikeIotProto_MqttBroker, QosDowngradeAndUnsubscribe) {
+    LoopbackMqttBroker broker;
+    broker.Start();
+
+    MqttClient subscriber(broker.GetPort(), "subscriber");
+    MqttClient publisher(broker.GetPort(), "publisher");
+    EXPECT_EQ(subscriber.Subscribe("$devices/1/events/telemetry", 0), 0);
+    // Пересекающаяся подписка: одна доставка с большим QoS
+    EXPECT_EQ(subscriber.Subscribe("$devices/+/events/telemetry", 1), 1);
+    EXPECT_THROW(subscriber.Subscribe("a/#/b", 0), std::runtime_error);
+
+    publisher.Publish("$devices/1/events/telemetry", "first", 1);
+    publisher.Publish("$devices/2/events/telemetry", "second", 0);
+    publisher.WaitForAcks();
+
+    MqttMessage message;
+    ASSERT_TRUE(subscriber.Receive(message, 5s));
+    EXPECT_EQ(message.payload, "first");
+    EXPECT_EQ(message.qos, 1);
+    ASSERT_TRUE(subscriber.Receive(message, 5s));
+    EXPECT_EQ(message.payload, "second");
+    EXPECT_EQ(message.qos, 0);
+
+    subscriber.Unsubscribe("$devices/+/events/telemetry");
+    publisher.Publish("$devices/2/events/telemetry", "third", 1);
+    publisher.Publish("$devices/1/events/telemetry", "fourth", 1);
+    publisher.WaitForAcks();
+    ASSERT_TRUE(subscriber.Receive(message, 5s));
+    EXPECT_EQ(message.payload, "fourth");
+    EXPECT_EQ(message.qos, 0);
+    subscriber.Ping();
+    EXPECT_FALSE(subscriber.Receive(message, 10ms));
+}
+
+TEST(BikeIotProto_MqttBroker, SessionRules) {
+    LoopbackMqttBroker broker;
+    broker.Start();
+
+    // Повторный client id отключает прежнее соединение
+    MqttClient first(broker.GetPort(), "bike");
+    MqttClient second(broker.GetPort(), "bike");
+    second.Ping();
+    EXPECT_THROW(first.Ping(), std::runtime_error);
+
+    // MQTT 3.1 (уровень 3) не поддерживается: CONNACK с кодом 1
+    std::string connect;
+    mqtt::AppendConnect(connect, "old", 0);
+    connect[8] = 3;
+    auto response = Exchange(broker.GetPort(), connect);
+    ASSERT_EQ(response.size(), 4u);
+    EXPECT_EQ(static_cast<mqtt::PacketType>(static_cast<uint8_t>(response[0]) >> 4), mqtt::PacketType::CONNACK);
+    EXPECT_EQ(mqtt::ParseConnack(std::string_view(response).substr(2)), mqtt::kConnectBadProtocol);
+
+    // Пакет до CONNECT и QoS 2 закрывают соединение без ответа
+    std::string publish;
+    mqtt::AppendPublish(publish, "a", "b", 0);
+    EXPECT_TRUE(Exchange(broker.GetPort(), publish).empty());
+    connect.clear();
+    mqtt::AppendConnect(connect, "qos2", 0);
+    publish = std::string("\x34\x05\x00\x01\x61\x00\x01", 7);
+    response = Exchange(broker.GetPort(), connect + publish);
+    EXPECT_EQ(response.size(), 4u);
+    EXPECT_EQ(broker.GetStats().protocol_errors, 2u);
+
+    second.Disconnect();
+    broker.Stop();
+}
@@ -0,0 +1,90 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/packet_pool.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/protocol_converter.h"
+#include "iot_scale/cpp/src/utc_clock.h"
+
+#include <thread>
+
+TEST(BikeIotProto_PacketPool, ReuseAfterRelease) {
+    using namespace iot::backend::proto;
+
+    PacketPool::Trim();
+    Packet* raw = nullptr;
+    {
+        auto packet = PacketPool::Acquire();
+        raw = packet.Get();
+        helpers::MakeCommand(*packet, std::chrono::seconds(5), "chain");
+        packet->mutable_command()->mutable_payload()->mutable_ping();
+        EXPECT_TRUE(IsValid(*packet));
+    }
+    EXPECT_EQ(PacketPool::GetFreeCount(), 1u);
+
+    auto packet = PacketPool::Acquire();
+    EXPECT_EQ(packet.Get(), raw);
+    EXPECT_EQ(packet->what_case(), Packet::WHAT_NOT_SET);
+    EXPECT_FALSE(packet->has_valid_until());
+    EXPECT_EQ(PacketPool::GetFreeCount(), 0u);
+
+    auto moved = std::move(packet);
+    EXPECT_FALSE(packet);
+    moved.Reset();
+    EXPECT_FALSE(moved);
+    EXPECT_EQ(PacketPool::GetFreeCount(), 1u);
+}
+
+TEST(BikeIotProto_PacketPool, MaxFreeCount) {
+    using namespace iot::backend::proto;
+
+    PacketPool::Trim();
+    PacketPool::SetMaxFreeCount(2);
+    {
+        auto a = PacketPool::Acquire();
+        auto b = PacketPool::Acquire();
+        auto c = PacketPool::Acquire();
+    }
+    EXPECT_EQ(PacketPool::GetFreeCount(), 2u);
+    PacketPool::SetMaxFreeCount(PacketPool::kDefaultMaxFreeCount);
+}
+
+TEST(BikeIotProto_PacketPool, ReleaseOnAnotherThread) {
+    using namespace iot::backend::proto;
+
+    PacketPool::Trim();
+    auto packet = PacketPool::Acquire();
+    size_t other_thread_free = 0;
+    std::thread([&packet, &other_thread_free]() {
+        packet.Reset();
+        other_thread_free = PacketPool::GetFreeCount();
+    }).join();
+
+    EXPECT_EQ(other_thread_free, 1u);
+    EXPECT_EQ(PacketPool::GetFreeCount(), 0u);
+}
+
+TEST(BikeIotProto_PacketPool, InPlaceHelpersMatchByValue) {
+    using namespace iot::backend::proto;
+
+    FakeUtcClock clock(1677599130000);
+    ScopedDefaultClock scoped(clock);
+    const ProtocolConverter converter(ProtocolConverter::TransportDataType::JSON);
+
+    auto packet = PacketPool::Acquire();
+    helpers::MakeCommandResultError(*packet, "chain", RESULT_FAILED, STATUS_OTHER, "message", "prev", 1, 2);
+    EXPECT_EQ(converter.Serialize(*packet),
+              converter.Serialize(helpers::MakeCommandResultError("chain", RESULT_FAILED, STATUS_OTHER, "message", "prev", 1, 2)));
+
+    helpers::MakeCommandResultSuccess(*packet, "chain", std::nullopt, 1, 2);
+    EXPECT_EQ(converter.Serialize(*packet),
+              converter.Serialize(helpers::MakeCommandResultSuccess("chain", std::nullopt, 1, 2)));
+
+    const std::string json = R"({"version":65536,"timestamp":"1677599130","validUntil":"1677599135","command":{"chainId":"de2466e4066b494c86438e4197cc70be","payload":{"configure":{}}}})";
+    converter.Deserialize(json, *packet);
+    EXPECT_EQ(converter.Serialize(*packet), json);
+
+    const ProtocolConverter binary_converter(ProtocolConverter::TransportDataType::BINARY);
+    binary_converter.Deserialize(binary_converter.Serialize(helpers::MakePacket()), *packet);
+    EXPECT_FALSE(packet->has_command());
+    EXPECT_EQ(packet->timestamp(), 1677599130u);
+}
@@ -0,0 +1,140 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/param_schema_registry.h"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+struct SchemaFiles {
+    std::string options = ::testing::TempDir() + "bike_proto_schema_options.json";
+    std::string reports = ::testing::TempDir() + "bike_proto_schema_reports.json";
+
+    void Write(const std::string &options_json, const std::string &reports_json) const
+    {
+        std::ofstream(options) << options_json;
+        std::ofstream(reports) << reports_json;
+    }
+};
+
+/// Считает удалённые версии
+struct Tracked {
+    explicit Tracked(int value, std::atomic<int> &deleted) : value(value), deleted(deleted) {}
+    ~Tracked() { ++deleted; }
+
+    int               value;
+    std::atomic<int> &deleted;
+};
+
+}  // namespace
+
+TEST(BikeIotProto_ParamSchemaRegistry, ReloadsSchema) {
+    SchemaFiles files;
+    files.Write(R"(["gsm_apn", "lock_state", "max_speed"])", R"(["heartbeat", "location"])");
+    ParamSchemaRegistry registry(files.options, files.reports);
+    {
+        rcu::ReadLock lock;
+        const auto   *schema = registry.Get(lock);
+        EXPECT_EQ(schema->GetVersion(), 1u);
+        EXPECT_EQ(schema->FindOption("max_speed"), 2u);
+        EXPECT_EQ(schema->FindOption("unknown"), std::nullopt);
+        EXPECT_TRUE(schema->IsReport("location"));
+        EXPECT_FALSE(schema->IsReport("max_speed"));
+        EXPECT_TRUE(schema->GetSensors().Find("max_speed"));
+
+        CmdSetParams set_params;
+        (*set_params.mutable_params())["max_speed"] = "25";
+        EXPECT_TRUE(schema->IsValid(set_params));
+        (*set_params.mutable_params())["turbo"] = "1";
+        EXPECT_FALSE(schema->IsValid(set_params));
+        CmdGetParams get_params;
+        get_params.add_param("gsm_apn");
+        EXPECT_TRUE(schema->IsValid(get_params));
+    }
+
+    files.Write(R"(["gsm_apn", "turbo"])", R"(["heartbeat"])");
+    registry.Reload();
+    EXPECT_EQ(registry.GetVersion(), 2u);
+    {
+        rcu::ReadLock lock;
+        const auto   *schema = registry.Get(lock);
+        EXPECT_EQ(schema->GetVersion(), 2u);
+        EXPECT_EQ(schema->FindOption("turbo"), 1u);
+        EXPECT_FALSE(schema->IsOption("max_speed"));
+        EXPECT_FALSE(schema->IsReport("location"));
+    }
+
+    // Ошибка в файлах не трогает текущую версию
+    files.Write(R"(["gsm_apn", 1])", R"(["heartbeat"])");
+    EXPECT_THROW(registry.Reload(), std::runtime_error);
+    files.Write(R"(["gsm_apn", "gsm_apn"])", R"(["heartbeat"])");
+    EXPECT_THROW(registry.Reload(), std::invalid_argument);
+    EXPECT_EQ(registry.GetVersion(), 2u);
+    rcu::ReadLock lock;
+    EXPECT_TRUE(registry.Get(lock)->IsOption("turbo"));
+    EXPECT_THROW(ParamSchemaRegistry("/nonexistent/options.json", files.reports), std::runtime_error);
+}
+
+TEST(BikeIotProto_ParamSchemaRegistry, KeepsVersionsWhileRead) {
+    std::atomic<int>           deleted{0};
+    rcu::Pointer<Tracked>      pointer(std::make_unique<const Tracked>(1, deleted));
+    std::atomic<bool>          entered{false};
+    std::atomic<bool>          release{false};
+    std::thread reader([&]() {
+        rcu::ReadLock  lock;
+        const Tracked *value = pointer.Get(lock);
+        entered = true;
+        while (!release)
+            std::this_thread::yield();
+        // Версия жива до конца секции, хотя уже заменена
+        EXPECT_EQ(value->value, 1);
+    });
+    while (!entered)
+        std::this_thread::yield();
+
+    pointer.Publish(std::make_unique<const Tracked>(2, deleted));
+    pointer.Publish(std::make_unique<const Tracked>(3, deleted));
+    {
+        // Вложенная секция в потоке, начатая после публикации
+        rcu::ReadLock outer;
+        rcu::ReadLock inner;
+        EXPECT_EQ(pointer.Get(inner)->value, 3);
+    }
+    EXPECT_EQ(deleted.load(), 0);
+    EXPECT_EQ(pointer.Reclaim(), 2u);
+
+    release = true;
+    reader.join();
+    EXPECT_EQ(pointer.Reclaim(), 0u);
+    EXPECT_EQ(deleted.load(), 2);
+}
+
+TEST(BikeIotProto_ParamSchemaRegistry, ConcurrentReadersAndReloads) {
+    SchemaFiles files;
+    files.Write(R"(["gsm_apn", "max_speed"])", R"(["heartbeat"])");
+    ParamSchemaRegistry      registry(files.options, files.reports);
+    std::atomic<bool>        stop{false};
+    std::atomic<size_t>      failures{0};
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 3; ++t) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                rcu::ReadLock lock;
+                const auto   *schema = registry.Get(lock);
+                failures += !schema->IsOption("max_speed") || schema->GetOptions().size() != 2;
+            }
+        });
+    }
+    for (size_t i = 0; i < 200; ++i)
+        registry.Reload();
+    stop = true;
+    for (auto &reader : readers)
+        reader.join();
+    EXPECT_EQ(failures.load(), 0u);
+    EXPECT_EQ(registry.GetVersion(), 201u);
+    EXPECT_EQ(registry.Reclaim(), 0u);
+}
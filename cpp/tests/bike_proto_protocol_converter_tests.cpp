@@ -2,6 +2,8 @@
 
 #include "iot_scale/cpp/src/protocol_converter.h"
 
+#include <vector>
+
 class ProtocolConverterPiplineFixture
         : public ::testing::TestWithParam<std::string> {};
 
@@ -29,3 +31,49 @@ INSTANTIATE_TEST_SUITE_P(
         R"({"version":65536,"timestamp":"1677844914","commandResult":{"chainId":"856ccfc0-8c02-4f6b-a6f6-376b4871f246","result":"RESULT_FAILED"}})",
         R"({"version":16777216,"timestamp":"1707425629","telemetry":{"payload":{"voltage":373,"sensors":{"imei":"869492042841493"}}}})",
         "{\"version\":16777216,\"timestamp\":\"1707427135\",\"telemetry\":{\"payload\":{\"voltage\":413,\"sensors\":{\"imei\":\"869492042841493\"}}}}"));
+
+class ProtocolConverterSerializeToFixture
+        : public ::testing::TestWithParam<iot::backend::proto::ProtocolConverter::TransportDataType> {};
+
+TEST_P(ProtocolConverterSerializeToFixture, MatchesSerialize) {
+    using namespace iot::backend::proto;
+    const ProtocolConverter converter(GetParam());
+
+    std::string buffer;
+    // Different chain id lengths cover every base64 tail (0, 1 and 2 extra bytes)
+    for (size_t length = 0; length < 12; ++length) {
+        const auto packet = helpers::MakeCommand(std::chrono::seconds(5), std::string(length, 'a'));
+        const auto expected = converter.Serialize(packet);
+        if (GetParam() == ProtocolConverter::TransportDataType::BINARY) {
+            EXPECT_EQ(expected, helpers::ToBase64(helpers::ProtoPacketToBinary(packet)));
+        }
+
+        buffer.clear();
+        converter.SerializeTo(packet, buffer);
+        EXPECT_EQ(buffer, expected);
+
+        std::vector<char> fixed(expected.size());
+        EXPECT_EQ(converter.SerializeTo(packet, std::span<char>(fixed)), expected.size());
+        EXPECT_EQ(std::string(fixed.begin(), fixed.end()), expected);
+    }
+}
+
+TEST_P(ProtocolConverterSerializeToFixture, AppendsAndReportsSize) {
+    using namespace iot::backend::proto;
+    const ProtocolConverter converter(GetParam());
+    const auto packet = helpers::MakeCommandResultSuccess("856ccfc0-8c02-4f6b-a6f6-376b4871f246", std::nullopt, 1, 2);
+    const auto expected = converter.Serialize(packet);
+
+    std::string buffer = "prefix";
+    converter.SerializeTo(packet, buffer);
+    EXPECT_EQ(buffer, "prefix" + expected);
+
+    std::vector<char> small(expected.size() - 1, 'x');
+    EXPECT_EQ(converter.SerializeTo(packet, std::span<char>(small)), expected.size());
+    EXPECT_EQ(std::string(small.begin(), small.end()), std::string(expected.size() - 1, 'x'));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+        SerializeTo, ProtocolConverterSerializeToFixture,
+        testing::Values(iot::backend::proto::ProtocolConverter::TransportDataType::JSON,
+                        iot::backend::proto::ProtocolConverter::TransportDataType::BINARY));
@@ -0,0 +1,126 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/rolling_aggregates.h"
+
+#include <random>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+// Начало суток UTC: границы корзин всех окон совпадают с началом теста
+constexpr uint64_t kStartS = 1700006400;
+
+enum Window : size_t { MINUTES_5, HOUR, DAY };
+
+TelemetryPayload MakePayload(uint32_t battery, float speed, uint32_t gsm)
+{
+    TelemetryPayload payload;
+    payload.set_battery_level(battery);
+    payload.set_speed_kmh(speed);
+    payload.set_gsm_signal_level(gsm);
+    return payload;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_RollingAggregates, SummariesPerWindow) {
+    RollingAggregates aggregates;
+    // Пакет в минуту в течение двух часов: заряд падает на 1% за 6 минут
+    for (uint64_t minute = 0; minute < 120; ++minute)
+        aggregates.Update("a", kStartS + minute * 60, MakePayload(100 - minute / 6, static_cast<float>(minute % 10), 50));
+    const uint64_t now_s = kStartS + 119 * 60;
+
+    const auto last_5 = aggregates.Query("a", MINUTES_5, now_s);
+    ASSERT_TRUE(last_5);
+    const auto &speed = last_5->Get(TelemetryMetric::SPEED_KMH);
+    EXPECT_EQ(speed.count, 5u);
+    EXPECT_FLOAT_EQ(*speed.GetAverage(), (5 + 6 + 7 + 8 + 9) / 5.0f);
+    EXPECT_FLOAT_EQ(speed.min, 5);
+    EXPECT_FLOAT_EQ(speed.max, 9);
+    EXPECT_FLOAT_EQ(speed.last, 9);
+    EXPECT_EQ(speed.last_s, now_s);
+
+    const auto hour = aggregates.Query("a", HOUR, now_s);
+    ASSERT_TRUE(hour);
+    // Окно из 12 корзин по 5 минут, текущая корзина только началась
+    EXPECT_EQ(hour->Get(TelemetryMetric::GSM_SIGNAL_LEVEL).count, 60u);
+    EXPECT_FLOAT_EQ(*hour->GetBatteryDrainPerHour(), (90 - 81) * 60.0f / 59);
+
+    const auto day = aggregates.Query("a", DAY, now_s);
+    ASSERT_TRUE(day);
+    EXPECT_EQ(day->Get(TelemetryMetric::BATTERY_LEVEL).count, 120u);
+    EXPECT_FLOAT_EQ(day->Get(TelemetryMetric::BATTERY_LEVEL).max, 100);
+    EXPECT_FLOAT_EQ(day->Get(TelemetryMetric::BATTERY_LEVEL).min, 81);
+
+    // Через сутки без пакетов окна пусты, устройство известно
+    const auto later = aggregates.Query("a", DAY, now_s + 25 * 3600);
+    ASSERT_TRUE(later);
+    EXPECT_EQ(later->Get(TelemetryMetric::BATTERY_LEVEL).count, 0u);
+    EXPECT_FALSE(later->GetBatteryDrainPerHour());
+    EXPECT_FALSE(aggregates.Query("b", DAY, now_s));
+    EXPECT_THROW((void)aggregates.Query("a", 3, now_s), std::out_of_range);
+}
+
+TEST(BikeIotProto_RollingAggregates, AbsentFieldsAndLatePackets) {
+    RollingAggregates aggregates;
+    TelemetryPayload  payload;
+    payload.set_speed_kmh(12);
+    aggregates.Update("a", kStartS + 100, payload);
+    // Опоздавший пакет считается, но не становится последним значением
+    payload.set_speed_kmh(3);
+    aggregates.Update("a", kStartS + 50, payload);
+    // Пакет старше кольца 5-минутного окна в него не попадает
+    aggregates.Update("a", kStartS - 600, payload);
+
+    const auto last_5 = aggregates.Query("a", MINUTES_5, kStartS + 100);
+    ASSERT_TRUE(last_5);
+    EXPECT_EQ(last_5->Get(TelemetryMetric::SPEED_KMH).count, 2u);
+    EXPECT_FLOAT_EQ(last_5->Get(TelemetryMetric::SPEED_KMH).last, 12);
+    EXPECT_EQ(last_5->Get(TelemetryMetric::BATTERY_LEVEL).count, 0u);
+    EXPECT_EQ(aggregates.Query("a", DAY, kStartS + 100)->Get(TelemetryMetric::SPEED_KMH).count, 3u);
+}
+
+TEST(BikeIotProto_RollingAggregates, ShardsMergeToWhole) {
+    // Пакеты одного устройства, разложенные по двум шардам, дают те же
+    // сводки, что и один шард
+    RollingAggregates whole;
+    RollingAggregates shards[2];
+    std::mt19937      random(7);
+    for (uint64_t i = 0; i < 2000; ++i) {
+        const auto payload = MakePayload(random() % 101, static_cast<float>(random() % 40), random() % 101);
+        const uint64_t time_s = kStartS + i * 30;
+        whole.Update("a", time_s, payload);
+        shards[random() % 2].Update("a", time_s, payload);
+    }
+
+    const uint64_t now_s = kStartS + 1999 * 30;
+    for (const size_t window : {MINUTES_5, HOUR, DAY}) {
+        auto merged = *shards[0].Query("a", window, now_s);
+        merged.Merge(*shards[1].Query("a", window, now_s));
+        const auto expected = *whole.Query("a", window, now_s);
+        for (size_t m = 0; m < kTelemetryMetricCount; ++m) {
+            EXPECT_EQ(merged.metrics[m].count, expected.metrics[m].count);
+            EXPECT_NEAR(merged.metrics[m].sum, expected.metrics[m].sum, 1e-3 * expected.metrics[m].sum);
+            EXPECT_EQ(merged.metrics[m].min, expected.metrics[m].min);
+            EXPECT_EQ(merged.metrics[m].max, expected.metrics[m].max);
+            EXPECT_EQ(merged.metrics[m].first, expected.metrics[m].first);
+            EXPECT_EQ(merged.metrics[m].last, expected.metrics[m].last);
+        }
+        EXPECT_EQ(merged.GetBatteryDrainPerHour(), expected.GetBatteryDrainPerHour());
+    }
+}
+
+TEST(BikeIotProto_RollingAggregates, ForgetAndOptions) {
+    RollingAggregates aggregates;
+    aggregates.Update("a", kStartS, MakePayload(50, 1, 1));
+    aggregates.Forget("a");
+    EXPECT_EQ(aggregates.GetDeviceCount(), 0u);
+    // Блок переиспользуется без старых данных
+    aggregates.Update("b", kStartS + 1, MakePayload(40, 1, 1));
+    EXPECT_EQ(aggregates.Query("b", DAY, kStartS + 1)->Get(TelemetryMetric::BATTERY_LEVEL).count, 1u);
+    EXPECT_GT(aggregates.GetBytesPerDevice(), 0u);
+
+    EXPECT_THROW(RollingAggregates({{{std::chrono::seconds(10), 0}}}), std::invalid_argument);
+    EXPECT_THROW(RollingAggregates({{{std::chrono::seconds(10), 3}}}), std::invalid_argument);
+}
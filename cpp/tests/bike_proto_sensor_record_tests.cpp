@@ -0,0 +1,85 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/sensor_record.h"
+
+#include <optional>
+
+using namespace iot::backend::proto;
+
+TEST(BikeIotProto_SensorRecord, DecodesTypedValues) {
+    const auto schema = SensorSchema::FromOptions({"battery_temp", "gsm_apn", "mileage", "usernearby"});
+    const auto battery_temp = *schema.Find("battery_temp");
+    const auto gsm_apn = *schema.Find("gsm_apn");
+    const auto mileage = *schema.Find("mileage");
+    const auto usernearby = *schema.Find("usernearby");
+    const auto imei = *schema.Find("imei");
+    const auto tyre_pressure = *schema.Find("Tyre pressure");
+    EXPECT_EQ(schema.GetField(gsm_apn).type, SensorType::STRING);
+    EXPECT_EQ(schema.GetField(tyre_pressure).type, SensorType::FLOAT);
+    EXPECT_EQ(schema.GetFieldCount(), 4 + SensorSchema::GetSensorTypes().size() - 3);
+
+    TelemetryPayload payload;
+    auto            &sensors = *payload.mutable_sensors();
+    sensors["battery_temp"] = "23.5";
+    sensors["gsm_apn"] = "internet";
+    sensors["mileage"] = "18342";
+    sensors["usernearby"] = "true";
+    sensors["imei"] = "869492042841493";
+    sensors["Tyre pressure"] = "2";
+    sensors["iot_fw_build"] = "2.14.7";
+
+    SensorRecord record;
+    EXPECT_FALSE(record.Has(mileage));
+    record.Decode(schema, payload);
+    EXPECT_EQ(record.GetFloat(battery_temp), 23.5);
+    EXPECT_EQ(record.GetString(gsm_apn), "internet");
+    EXPECT_EQ(record.GetInt(mileage), 18342);
+    EXPECT_EQ(record.GetBool(usernearby), true);
+    EXPECT_EQ(record.GetString(imei), "869492042841493");
+    EXPECT_EQ(record.GetFloat(tyre_pressure), 2.0);
+    // Другой тип - как отсутствующее поле
+    EXPECT_EQ(record.GetInt(battery_temp), std::nullopt);
+    EXPECT_FALSE(record.Has(*schema.Find("Wheel count")));
+    ASSERT_EQ(record.GetUnknown().size(), 1u);
+    EXPECT_EQ(record.GetUnknown()[0].first, "iot_fw_build");
+    EXPECT_EQ(record.GetUnknown()[0].second, "2.14.7");
+    EXPECT_EQ(record.GetInvalidCount(), 0u);
+
+    // Повторный Decode заменяет содержимое; неразобранные значения отсутствуют
+    payload.clear_sensors();
+    sensors["mileage"] = "18k";
+    sensors["usernearby"] = "0";
+    sensors["Tyre pressure"] = "";
+    record.Decode(schema, payload);
+    EXPECT_FALSE(record.Has(mileage));
+    EXPECT_FALSE(record.Has(tyre_pressure));
+    EXPECT_FALSE(record.Has(imei));
+    EXPECT_EQ(record.GetBool(usernearby), false);
+    EXPECT_TRUE(record.GetUnknown().empty());
+    EXPECT_EQ(record.GetInvalidCount(), 2u);
+
+    EXPECT_THROW(SensorSchema({{"imei", SensorType::STRING}, {"imei", SensorType::INT}}), std::invalid_argument);
+}
+
+TEST(BikeIotProto_SensorRecord, SchemaAtSameAddress) {
+    std::optional<SensorSchema> schema;
+    schema.emplace(std::vector<SensorField>{{"mileage", SensorType::INT}});
+    TelemetryPayload payload;
+    (*payload.mutable_sensors())["mileage"] = "1";
+    SensorRecord record;
+    record.Decode(*schema, payload);
+    EXPECT_EQ(record.GetInt(0), 1);
+
+    // Новая схема по тому же адресу, как новая версия после перезагрузки
+    std::vector<SensorField> fields;
+    for (size_t i = 0; i < 200; ++i)
+        fields.push_back({"sensor_" + std::to_string(i), i % 2 ? SensorType::INT : SensorType::STRING});
+    schema.emplace(std::move(fields));
+    (*payload.mutable_sensors())["sensor_198"] = "a";
+    (*payload.mutable_sensors())["sensor_199"] = "42";
+    record.Decode(*schema, payload);
+    EXPECT_EQ(record.GetString(198), "a");
+    EXPECT_EQ(record.GetInt(199), 42);
+    EXPECT_FALSE(record.Has(0));
+    EXPECT_EQ(record.GetUnknown().size(), 1u);
+}
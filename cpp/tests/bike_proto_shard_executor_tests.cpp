@@ -0,0 +1,148 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/shard_executor.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+/// Запоминает timestamp пакетов каждого устройства; телеметрию устройства
+/// "relay" пересылает устройству из её battery_level
+class RecordingHandler : public ShardHandler {
+  public:
+    void Handle(ShardContext &context, std::string_view device_id, Packet &packet) override
+    {
+        if (thread == std::thread::id())
+            thread = std::this_thread::get_id();
+        wrong_thread |= thread != std::this_thread::get_id();
+        if (device_id == "relay") {
+            const auto target = "bike" + std::to_string(packet.telemetry().payload().battery_level());
+            packet.clear_telemetry();
+            context.Send(target, packet);
+            return;
+        }
+        timestamps[std::string(device_id)].push_back(packet.timestamp());
+    }
+
+    std::thread::id                              thread;
+    bool                                         wrong_thread = false;
+    std::map<std::string, std::vector<uint64_t>> timestamps;
+};
+
+ShardExecutorOptions MakeOptions(size_t shards, size_t ring_size = 256)
+{
+    ShardExecutorOptions options;
+    options.shards = shards;
+    options.ring_size = ring_size;
+    options.max_producers = 4;
+    options.pin_threads = false;
+    return options;
+}
+
+ShardExecutor::HandlerFactory MakeFactory()
+{
+    return [](size_t) { return std::make_unique<RecordingHandler>(); };
+}
+
+RecordingHandler &GetHandler(ShardExecutor &executor, size_t shard)
+{
+    return static_cast<RecordingHandler &>(executor.GetHandler(shard));
+}
+
+Packet MakePacket(uint64_t timestamp)
+{
+    Packet packet;
+    packet.set_timestamp(timestamp);
+    return packet;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_ShardExecutor, DeviceStaysOnItsShard) {
+    // Кольцо меньше числа пакетов: источник ждёт места
+    ShardExecutor executor(MakeOptions(4, 8), MakeFactory());
+    EXPECT_EQ(executor.GetShardCount(), 4u);
+    auto &producer = executor.AddProducer();
+    for (uint64_t i = 0; i < 1000; ++i) {
+        auto packet = MakePacket(i);
+        producer.Submit("bike" + std::to_string(i % 50), packet);
+    }
+    executor.Drain();
+    EXPECT_EQ(executor.GetProcessedCount(), 1000u);
+
+    size_t devices = 0;
+    for (size_t shard = 0; shard < executor.GetShardCount(); ++shard) {
+        auto &handler = GetHandler(executor, shard);
+        EXPECT_FALSE(handler.wrong_thread);
+        for (const auto &[device_id, timestamps] : handler.timestamps) {
+            EXPECT_EQ(executor.GetShard(device_id), shard);
+            // Пакеты устройства идут в порядке отправки
+            ASSERT_EQ(timestamps.size(), 20u);
+            for (size_t i = 1; i < timestamps.size(); ++i)
+                EXPECT_EQ(timestamps[i], timestamps[i - 1] + 50);
+            ++devices;
+        }
+    }
+    EXPECT_EQ(devices, 50u);
+}
+
+TEST(BikeIotProto_ShardExecutor, ForwardsBetweenShards) {
+    // Кольца шард -> шард на 2 сообщения: пересылка уходит в очередь шарда
+    ShardExecutor executor(MakeOptions(3, 2), MakeFactory());
+    auto         &producer = executor.AddProducer();
+    for (uint64_t i = 0; i < 300; ++i) {
+        auto packet = MakePacket(i);
+        packet.mutable_telemetry()->mutable_payload()->set_battery_level(i % 10);
+        producer.Submit("relay", packet);
+    }
+    executor.Drain();
+    // Пакет relay и пересланный пакет
+    EXPECT_EQ(executor.GetProcessedCount(), 600u);
+
+    size_t forwarded = 0;
+    for (size_t shard = 0; shard < executor.GetShardCount(); ++shard) {
+        for (const auto &[device_id, timestamps] : GetHandler(executor, shard).timestamps) {
+            EXPECT_EQ(executor.GetShard(device_id), shard);
+            EXPECT_TRUE(std::is_sorted(timestamps.begin(), timestamps.end()));
+            forwarded += timestamps.size();
+        }
+    }
+    EXPECT_EQ(forwarded, 300u);
+}
+
+TEST(BikeIotProto_ShardExecutor, ConcurrentProducers) {
+    constexpr size_t kProducers = 4;
+    constexpr size_t kPackets = 5000;
+    ShardExecutor                          executor(MakeOptions(2), MakeFactory());
+    std::vector<ShardExecutor::Producer *> producers;
+    for (size_t p = 0; p < kProducers; ++p)
+        producers.push_back(&executor.AddProducer());
+    EXPECT_THROW(executor.AddProducer(), std::runtime_error);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < kProducers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t i = 0; i < kPackets; ++i) {
+                auto packet = MakePacket(i);
+                producers[p]->Submit("bike" + std::to_string(p * 100 + i % 7), packet);
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    executor.Drain();
+    EXPECT_EQ(executor.GetProcessedCount(), kProducers * kPackets);
+
+    size_t devices = 0;
+    for (size_t shard = 0; shard < executor.GetShardCount(); ++shard) {
+        for (const auto &[device_id, timestamps] : GetHandler(executor, shard).timestamps) {
+            EXPECT_TRUE(std::is_sorted(timestamps.begin(), timestamps.end()));
+            ++devices;
+        }
+    }
+    EXPECT_EQ(devices, kProducers * 7);
+}
@@ -0,0 +1,235 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/telemetry_sink.h"
+
+#include <google/protobuf/io/coded_stream.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+using namespace iot::backend::proto;
+
+namespace {
+
+using Backend = TelemetrySinkOptions::Backend;
+
+std::string MakePath(const std::string &name)
+{
+    const auto path = ::testing::TempDir() + name;
+    std::filesystem::remove(path);
+    return path;
+}
+
+/// Записи файла с префиксом длины
+std::vector<std::string> ReadRecords(const std::string &path)
+{
+    std::ifstream     file(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t *>(data.data()),
+                                                 static_cast<int>(data.size()));
+    std::vector<std::string>               records;
+    uint32_t                               size;
+    while (input.ReadVarint32(&size)) {
+        std::string record;
+        EXPECT_TRUE(input.ReadString(&record, static_cast<int>(size)));
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+TelemetrySinkOptions MakeOptions(size_t buffer_bytes, size_t buffers, Backend backend = Backend::AUTO)
+{
+    TelemetrySinkOptions options;
+    options.backend = backend;
+    options.buffer_bytes = buffer_bytes;
+    options.buffers = buffers;
+    return options;
+}
+
+std::vector<Backend> GetBackends()
+{
+    std::vector<Backend> backends{Backend::THREAD_POOL};
+    if (TelemetrySink(MakeOptions(64, 1)).GetBackend() == Backend::IO_URING)
+        backends.push_back(Backend::IO_URING);
+    return backends;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_TelemetrySink, KeepsRecordOrderPerFile) {
+    for (const auto backend : GetBackends()) {
+        const auto first = MakePath("bike_proto_sink_first");
+        const auto second = MakePath("bike_proto_sink_second");
+        {
+            // Маленькие буферы: записи файла расходятся по многим операциям
+            TelemetrySink sink(MakeOptions(256, 64, backend));
+            EXPECT_EQ(sink.GetBackend(), backend);
+            const auto a = sink.Open(first);
+            const auto b = sink.Open(second);
+            for (size_t i = 0; i < 1000; ++i) {
+                ASSERT_TRUE(sink.Write(a, "a" + std::to_string(i)));
+                if (i % 3 == 0) {
+                    ASSERT_TRUE(sink.Write(b, "b" + std::to_string(i)));
+                }
+                // Даём буферам освободиться
+                if (i % 100 == 0)
+                    sink.Flush();
+            }
+            sink.Flush();
+            EXPECT_EQ(sink.GetInFlightBytes(), 0u);
+            const auto stats = sink.GetStats();
+            EXPECT_EQ(stats.records, 1334u);
+            EXPECT_EQ(stats.rejected, 0u);
+            EXPECT_EQ(stats.errors, 0u);
+            EXPECT_GT(stats.submitted, 10u);
+        }
+        const auto a = ReadRecords(first);
+        ASSERT_EQ(a.size(), 1000u);
+        for (size_t i = 0; i < a.size(); ++i)
+            EXPECT_EQ(a[i], "a" + std::to_string(i));
+        const auto b = ReadRecords(second);
+        ASSERT_EQ(b.size(), 334u);
+        EXPECT_EQ(b.back(), "b999");
+    }
+}
+
+TEST(BikeIotProto_TelemetrySink, AppendsPackets) {
+    for (const auto backend : GetBackends()) {
+        const auto path = MakePath("bike_proto_sink_packets");
+        Packet     packet;
+        packet.set_version(0x00010000);
+        packet.set_timestamp(1700000000);
+        packet.mutable_telemetry()->mutable_payload()->set_battery_level(77);
+        for (size_t round = 0; round < 2; ++round) {
+            // Повторное открытие дописывает в конец
+            TelemetrySink sink(MakeOptions(1 << 20, 4, backend));
+            const auto    file = sink.Open(path);
+            EXPECT_TRUE(sink.WritePacket(file, packet));
+            EXPECT_TRUE(sink.Write(file, "raw"));
+        }
+        const auto records = ReadRecords(path);
+        ASSERT_EQ(records.size(), 4u);
+        Packet parsed;
+        ASSERT_TRUE(parsed.ParseFromString(records[2]));
+        EXPECT_EQ(parsed.telemetry().payload().battery_level(), 77u);
+        EXPECT_EQ(records[3], "raw");
+    }
+}
+
+TEST(BikeIotProto_TelemetrySink, SignalsBackpressure) {
+    EXPECT_THROW(TelemetrySink(MakeOptions(1 << 20, 0)), std::invalid_argument);
+
+    auto options = MakeOptions(16, 2);
+    options.max_files = 1;
+    options.flush_interval = std::chrono::hours(1);
+    TelemetrySink sink(options);
+    const auto    file = sink.Open(MakePath("bike_proto_sink_pressure"));
+    EXPECT_THROW(sink.Open(MakePath("bike_proto_sink_extra")), std::runtime_error);
+    EXPECT_THROW(sink.Write(file, std::string(16, 'x')), std::invalid_argument);
+    EXPECT_THROW(sink.Write(file + 1, "x"), std::out_of_range);
+
+    // Пока фоновая запись не вернула буферы, часть записей может быть не
+    // принята, но память не растёт
+    size_t accepted = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        accepted += sink.Write(file, "0123456789");
+        EXPECT_LE(sink.GetInFlightBytes(), 32u);
+    }
+    sink.Flush();
+    const auto stats = sink.GetStats();
+    EXPECT_EQ(stats.records, accepted);
+    EXPECT_EQ(stats.records + stats.rejected, 100u);
+    EXPECT_EQ(sink.GetInFlightBytes(), 0u);
+}
+
+TEST(BikeIotProto_TelemetrySink, ConcurrentWriters) {
+    constexpr size_t kThreads = 4;
+    constexpr size_t kRecords = 2000;
+    const auto       path = MakePath("bike_proto_sink_concurrent");
+    {
+        TelemetrySink            sink(MakeOptions(4096, 8));
+        const auto               file = sink.Open(path);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = 0; i < kRecords; ++i) {
+                    const auto record = std::to_string(t) + ":" + std::to_string(i);
+                    while (!sink.Write(file, record))
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+    // Записи каждого потока идут в своём порядке
+    std::vector<size_t> next(kThreads, 0);
+    const auto          records = ReadRecords(path);
+    ASSERT_EQ(records.size(), kThreads * kRecords);
+    for (const auto &record : records) {
+        const size_t thread = std::stoul(record.substr(0, record.find(':')));
+        EXPECT_EQ(record.substr(record.find(':') + 1), std::to_string(next[thread]++));
+    }
+}
+
+TEST(BikeIotProto_TelemetrySink, FlushWaitsForOlderBuffers) {
+    constexpr size_t kThreads = 4;
+    for (const auto backend : GetBackends()) {
+        TelemetrySink            sink(MakeOptions(512, 32, backend));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&, t]() {
+                const auto path = MakePath("bike_proto_sink_flush_" + std::to_string(t));
+                const auto file = sink.Open(path);
+                size_t     bytes = 0;
+                for (size_t i = 0; i < 2000; ++i) {
+                    const auto record = std::to_string(i);
+                    while (!sink.Write(file, record))
+                        std::this_thread::yield();
+                    bytes += 1 + record.size();
+                    // Буферы других потоков запечатываются и пишутся
+                    // параллельно: Flush ждёт все, принятые до вызова
+                    if (i % 50 == 0) {
+                        sink.Flush();
+                        EXPECT_EQ(std::filesystem::file_size(path), bytes);
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+}
+
+TEST(BikeIotProto_TelemetrySink, RecordsLostRanges) {
+    if (!std::filesystem::exists("/dev/full"))
+        GTEST_SKIP() << "No /dev/full";
+    for (const auto backend : GetBackends()) {
+        TelemetrySink sink(MakeOptions(64, 4, backend));
+        // Любая запись в /dev/full завершается ENOSPC
+        const auto    full = sink.Open("/dev/full");
+        const auto    path = MakePath("bike_proto_sink_lost");
+        const auto    good = sink.Open(path);
+        for (size_t i = 0; i < 20; ++i) {
+            ASSERT_TRUE(sink.Write(full, "0123456789"));
+            ASSERT_TRUE(sink.Write(good, "0123456789"));
+            sink.Flush();
+        }
+        const auto stats = sink.GetStats();
+        EXPECT_EQ(stats.errors, 20u);
+        EXPECT_EQ(stats.lost_bytes, 20u * 11);
+        EXPECT_EQ(sink.GetInFlightBytes(), 0u);
+
+        const auto lost = sink.GetLostRanges();
+        ASSERT_EQ(lost.size(), 20u);
+        for (size_t i = 0; i < lost.size(); ++i) {
+            EXPECT_EQ(lost[i].file, full);
+            EXPECT_EQ(lost[i].offset, i * 11);
+            EXPECT_EQ(lost[i].bytes, 11u);
+        }
+        EXPECT_EQ(ReadRecords(path).size(), 20u);
+    }
+}
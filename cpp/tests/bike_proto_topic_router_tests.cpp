@@ -0,0 +1,132 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/device_topics.h"
+#include "iot_scale/cpp/src/topic_router.h"
+
+#include "iot_scale/cpp/testing/alloc_counter.h"
+
+using namespace iot::backend::proto;
+
+namespace {
+
+enum Handler : uint32_t {
+    TELEMETRY,
+    STATUS,
+    ANY_EVENT,
+    DEVICE_ANY,
+    SPECIAL_DEVICE,
+    EVERYTHING,
+};
+
+TopicRouter MakeRouter()
+{
+    return TopicRouter({
+        {"$devices/{device_id}/events/telemetry", TELEMETRY},
+        {"$devices/{device_id}/events/status", STATUS},
+        {"$devices/{id}/events/+", ANY_EVENT},
+        {"$devices/+/#", DEVICE_ANY},
+        {"$devices/special/events/telemetry", SPECIAL_DEVICE},
+        {"#", EVERYTHING},
+    });
+}
+
+}  // namespace
+
+TEST(BikeIotProto_TopicRouter, RoutesAndCaptures) {
+    const auto router = MakeRouter();
+
+    auto match = router.Route("$devices/869492042841493/events/telemetry");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->handler, TELEMETRY);
+    EXPECT_EQ(match->device_id, "869492042841493");
+
+    match = router.Route("$devices/42/events/status");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->handler, STATUS);
+    EXPECT_EQ(match->device_id, "42");
+
+    match = router.Route("$devices/42/events/config");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->handler, ANY_EVENT);
+    EXPECT_EQ(match->device_id, "42");
+
+    // Захвата нет: device_id пуст
+    match = router.Route("$devices/42/commands/command");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->handler, DEVICE_ANY);
+    EXPECT_TRUE(match->device_id.empty());
+
+    // '#' совпадает и с родительским уровнем
+    EXPECT_EQ(router.Route("$devices/42")->handler, DEVICE_ANY);
+    EXPECT_EQ(router.Route("other/topic")->handler, EVERYTHING);
+    // '#' на первом уровне не совпадает с топиками на '$'
+    EXPECT_FALSE(router.Route("$registries/1/events/status"));
+    EXPECT_FALSE(router.Route(""));
+}
+
+TEST(BikeIotProto_TopicRouter, ExactBeatsWildcard) {
+    const auto router = MakeRouter();
+    EXPECT_EQ(router.Route("$devices/special/events/telemetry")->handler, SPECIAL_DEVICE);
+
+    // Точная ветка "special" не доходит до конца - возврат к '+'
+    const auto match = router.Route("$devices/special/events/status");
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->handler, STATUS);
+    EXPECT_EQ(match->device_id, "special");
+
+    // Пустой уровень совпадает с '+'
+    EXPECT_EQ(router.Route("$devices//events/status")->device_id, "");
+}
+
+TEST(BikeIotProto_TopicRouter, ManyLiteralChildren) {
+    // Больше kLinearSearchEdges рёбер у узла: бинарный поиск
+    std::vector<TopicRoute> routes;
+    for (uint32_t i = 0; i < 1000; ++i)
+        routes.push_back({"$devices/" + std::to_string(i) + "/commands/command", i});
+    routes.push_back({"$devices/+/commands/command", 1000});
+    const TopicRouter router(routes);
+
+    for (uint32_t i = 0; i < 1000; ++i)
+        EXPECT_EQ(router.Route("$devices/" + std::to_string(i) + "/commands/command")->handler, i);
+    EXPECT_EQ(router.Route("$devices/1000/commands/command")->handler, 1000u);
+    EXPECT_EQ(router.Route("$devices/00/commands/command")->handler, 1000u);
+    EXPECT_FALSE(router.Route("$devices/1/commands"));
+}
+
+TEST(BikeIotProto_TopicRouter, InvalidPatterns) {
+    EXPECT_THROW(TopicRouter({{"", 0}}), std::invalid_argument);
+    EXPECT_THROW(TopicRouter({{"a/#/b", 0}}), std::invalid_argument);
+    EXPECT_THROW(TopicRouter({{"a/b+", 0}}), std::invalid_argument);
+    EXPECT_THROW(TopicRouter({{"{a}/{b}", 0}}), std::invalid_argument);
+    EXPECT_THROW(TopicRouter({{"a/+", 0}, {"a/{id}", 1}}), std::invalid_argument);
+    EXPECT_THROW(TopicRouter({{std::string(TopicRouter::kMaxLevels * 2, '/'), 0}}), std::invalid_argument);
+    EXPECT_NO_THROW(TopicRouter({{"a/#", 0}, {"a", 1}}));
+}
+
+TEST(BikeIotProto_TopicRouter, DeviceTopicRouterAgreesWithParser) {
+    const auto router = TopicRouter::MakeDeviceTopicRouter();
+    for (const auto kind : {DeviceTopicKind::COMMAND, DeviceTopicKind::TELEMETRY, DeviceTopicKind::STATUS}) {
+        const auto topic = MakeDeviceTopic("869492042841493", kind);
+        const auto match = router.Route(topic);
+        const auto parsed = ParseDeviceTopic(topic);
+        ASSERT_TRUE(match);
+        ASSERT_TRUE(parsed);
+        EXPECT_EQ(match->handler, static_cast<uint32_t>(parsed->kind));
+        EXPECT_EQ(match->device_id, parsed->device_id);
+    }
+    EXPECT_FALSE(router.Route("$devices/1/events/other"));
+    EXPECT_FALSE(router.Route("$devices/1/events/status/extra"));
+}
+
+TEST(BikeIotProto_TopicRouter, RouteAllocatesNothing) {
+    const auto        router = MakeRouter();
+    const std::string topic = "$devices/869492042841493/events/telemetry";
+    const std::string deep_topic = "$devices/1" + std::string(100, '/') + "x";
+    const auto        stats = iot::backend::proto::testing::CountAllocations([&]() {
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(router.Route(topic)->handler, TELEMETRY);
+            EXPECT_EQ(router.Route(deep_topic)->handler, DEVICE_ANY);
+        }
+    });
+    EXPECT_EQ(stats.count, 0u);
+}
@@ -0,0 +1,151 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/fleet_simulator.h"
+#include "iot_scale/cpp/src/mapped_file.h"
+#include "iot_scale/cpp/src/traffic_replay.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace std::chrono_literals;
+using namespace iot::backend::proto;
+
+namespace {
+
+using DataType = ProtocolConverter::TransportDataType;
+
+// Запись трафика: телеметрия парка, по packets_per_second пакетов в секунду
+std::string MakeCapture(DataType type, size_t packets, size_t packets_per_second)
+{
+    const ProtocolConverter converter(type);
+    FleetModel              model(10, 1);
+    Packet                  packet;
+    std::string             capture;
+    for (size_t i = 0; i < packets; ++i) {
+        model.MakeTelemetry(i % model.GetDeviceCount(), 1s, packet);
+        packet.set_timestamp(1707425629 + i / packets_per_second);
+        converter.SerializeTo(packet, capture);
+        capture += '\n';
+    }
+    return capture;
+}
+
+}  // namespace
+
+TEST(BikeIotProto_TrafficReplay, SplitLines) {
+    EXPECT_TRUE(SplitLines("").empty());
+    EXPECT_TRUE(SplitLines("\n\r\n\n").empty());
+
+    const std::string long_line(100, 'x');
+    const std::string data = "a\nbb\r\n\n" + long_line + "\n0123456789abcdef\n" + long_line;
+    const auto lines = SplitLines(data);
+    ASSERT_EQ(lines.size(), 5u);
+    EXPECT_EQ(lines[0], "a");
+    EXPECT_EQ(lines[1], "bb");
+    EXPECT_EQ(lines[2], long_line);
+    EXPECT_EQ(lines[3], "0123456789abcdef");
+    EXPECT_EQ(lines[4], long_line);
+    EXPECT_EQ(lines[4].data() + lines[4].size(), data.data() + data.size());
+
+    // Перевод строки на каждой позиции внутри 16-байтного блока
+    for (size_t position = 0; position < 40; ++position) {
+        std::string text(40, 'y');
+        text[position] = '\n';
+        const auto parts = SplitLines(text);
+        const size_t expected = (position != 0) + (position != text.size() - 1);
+        ASSERT_EQ(parts.size(), expected) << position;
+        if (position != 0) {
+            EXPECT_EQ(parts[0].size(), position);
+        }
+    }
+}
+
+TEST(BikeIotProto_TrafficReplay, Schedule) {
+    // Две секунды по два пакета, затем пауза в час и один пакет
+    const std::vector<uint64_t> timestamps = {100, 100, 101, 0, 3701};
+
+    const auto real_time = TrafficReplay::MakeSchedule(timestamps, 1, 0ms);
+    ASSERT_EQ(real_time.size(), timestamps.size());
+    EXPECT_EQ(real_time[0], 0ns);
+    EXPECT_EQ(real_time[1], 500ms);
+    EXPECT_EQ(real_time[2], 1s);
+    // Неразобранная строка делит секунду с предыдущей
+    EXPECT_EQ(real_time[3], 1500ms);
+    EXPECT_EQ(real_time[4], 3601s);
+
+    const auto fast = TrafficReplay::MakeSchedule(timestamps, 10, 0ms);
+    EXPECT_EQ(fast[1], 50ms);
+    EXPECT_EQ(fast[4], 360100ms);
+
+    const auto compressed = TrafficReplay::MakeSchedule(timestamps, 1, 2s);
+    EXPECT_EQ(compressed[2], 1s);
+    EXPECT_EQ(compressed[4], 3s);
+
+    // Сокращённые меньше секунды паузы сжимают и саму секунду
+    const auto dense = TrafficReplay::MakeSchedule(timestamps, 1, 100ms);
+    EXPECT_EQ(dense[1], 50ms);
+    EXPECT_EQ(dense[4], 200ms);
+
+    // Без скорости расписания нет
+    EXPECT_EQ(TrafficReplay::MakeSchedule(timestamps, 0, 0ms)[4], 0ns);
+}
+
+TEST(BikeIotProto_TrafficReplay, AsFastAsPossible) {
+    for (const auto type : {DataType::JSON, DataType::BINARY}) {
+        auto capture = MakeCapture(type, 1000, 1000);
+        capture += "not a packet\n";
+
+        ReplayOptions options;
+        options.transport = type;
+        options.threads = 4;
+        const TrafficReplay replay(options);
+
+        CountingSink counting;
+        const auto   report = replay.Replay(capture, counting);
+        EXPECT_EQ(report.lines, 1001u);
+        EXPECT_EQ(report.packets, 1000u);
+        EXPECT_EQ(report.errors, 1u);
+        EXPECT_EQ(report.bytes + 1001, capture.size());
+        EXPECT_EQ(report.lag_ns.GetCount(), 0u);
+        EXPECT_EQ(counting.GetCount(Packet::kTelemetry), 1000u);
+        EXPECT_EQ(counting.GetTotal(), 1000u);
+
+        ValidatingSink validating;
+        (void)replay.Replay(capture, validating);
+        EXPECT_EQ(validating.GetValidCount(), 1000u);
+        EXPECT_EQ(validating.GetInvalidCount(), 0u);
+    }
+}
+
+TEST(BikeIotProto_TrafficReplay, Retimed) {
+    // 3 секунды записи с ускорением в 20 раз - 150 мс
+    const auto capture = MakeCapture(DataType::JSON, 60, 20);
+
+    ReplayOptions options;
+    options.threads = 2;
+    options.speed = 20;
+    CountingSink sink;
+    const auto   report = TrafficReplay(options).Replay(capture, sink);
+    EXPECT_EQ(report.packets, 60u);
+    EXPECT_GE(report.elapsed, 140ms);
+    EXPECT_LT(report.elapsed, 2s);
+    EXPECT_EQ(report.lag_ns.GetCount(), 60u);
+}
+
+TEST(BikeIotProto_TrafficReplay, File) {
+    const std::string path = ::testing::TempDir() + "bike_proto_replay_capture.jsonl";
+    const auto        capture = MakeCapture(DataType::JSON, 100, 10);
+    std::ofstream(path, std::ios::binary) << capture;
+
+    {
+        const MappedFile file(path);
+        EXPECT_EQ(file.GetData(), capture);
+    }
+
+    CountingSink sink;
+    const auto   report = TrafficReplay(ReplayOptions()).ReplayFile(path, sink);
+    EXPECT_EQ(report.packets, 100u);
+    std::remove(path.c_str());
+
+    EXPECT_THROW(MappedFile("/nonexistent/capture.jsonl"), std::runtime_error);
+}
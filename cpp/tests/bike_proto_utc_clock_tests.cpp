@@ -0,0 +1,49 @@
+#include <library/cpp/testing/gtest/gtest.h>
+
+#include "iot_scale/cpp/src/helpers.h"
+#include "iot_scale/cpp/src/packet_validator.h"
+#include "iot_scale/cpp/src/utc_clock.h"
+
+using namespace std::literals::chrono_literals;
+
+TEST(BikeIotProto_UtcClock, FakeClockDrivesPackets) {
+    using namespace iot::backend::proto;
+
+    FakeUtcClock clock(1677599130500);
+    {
+        ScopedDefaultClock scoped(clock);
+        EXPECT_EQ(helpers::GetCurrentUtcTimestampMs(), 1677599130500u);
+        EXPECT_EQ(helpers::GetCurrentUtcTimestamp(), 1677599130u);
+
+        const auto packet = helpers::MakePacket(5s);
+        EXPECT_EQ(packet.timestamp(), 1677599130u);
+        EXPECT_EQ(packet.valid_until(), 1677599135u);
+        EXPECT_FALSE(IsExpired(packet));
+
+        clock.Advance(5s);
+        EXPECT_FALSE(IsExpired(packet));
+        clock.Advance(1s);
+        EXPECT_TRUE(IsExpired(packet));
+        EXPECT_FALSE(IsExpired(helpers::MakePacket()));
+    }
+    EXPECT_EQ(&GetDefaultClock(), SetDefaultClock(nullptr));
+    EXPECT_GT(helpers::GetCurrentUtcTimestamp(), 1677599136u);
+}
+
+TEST(BikeIotProto_UtcClock, CoarseClockAccuracy) {
+    using namespace iot::backend::proto;
+
+    const SystemUtcClock system;
+    const CoarseUtcClock coarse(1ms);
+    uint64_t prev = 0;
+    for (int i = 0; i < 20; ++i) {
+        const auto coarse_ms = coarse.NowMs();
+        const auto system_ms = system.NowMs();
+        EXPECT_LE(coarse_ms, system_ms);
+        // Generous bound: the updater thread may be descheduled on a busy host
+        EXPECT_LE(system_ms - coarse_ms, 200u);
+        EXPECT_GE(coarse_ms, prev);
+        prev = coarse_ms;
+        std::this_thread::sleep_for(1ms);
+    }
+}